@@ -18,6 +18,7 @@
 #include <CGAL/Polyhedron_3.h>
 #include <CGAL/Nef_polyhedron_3.h>
 #include <CGAL/Polyhedron_items_with_id_3.h>
+#include <CGAL/Surface_mesh.h>
 
 namespace CGAL {
     typedef Exact_predicates_exact_constructions_kernel Kernel;	// Mostly referenced as "Epeck"
@@ -30,6 +31,7 @@ namespace CGAL {
     typedef Vector_3<Kernel>			Vector;
     typedef Point_3<Kernel>				Point;
     typedef Aff_transformation_3<Kernel> Transformation;
+    typedef Surface_mesh<Point>         SurfaceMesh; // used by the corefinement backend
 }
 
 class CGALPolyhedron {
@@ -5,12 +5,11 @@
 #include "core/objects/geometry/OSGGeometry.h"
 #include "core/objects/geometry/VRGeoData.h"
 #include "core/objects/material/VRMaterial.h"
-#include "core/math/partitioning/Octree.h"
-#include "core/math/partitioning/OctreeT.h"
 #include "core/math/pose.h"
 #include "core/utils/toString.h"
 
 #include <OpenSG/OSGGeoFunctions.h>
+#include <cmath>
 
 using namespace OSG;
 
@@ -27,7 +26,10 @@ CSGGeometry::CSGGeometry(string name) : VRGeometry(name) {
 	store("op", &operation);
 }
 
-CSGGeometry::~CSGGeometry() {}
+CSGGeometry::~CSGGeometry() {
+    if (polyhedron) delete polyhedron;
+    for (auto& c : leafCache) if (c.second.polyhedron) delete c.second.polyhedron;
+}
 CSGGeometryPtr CSGGeometry::ptr() { return static_pointer_cast<CSGGeometry>( shared_from_this() ); }
 
 CSGGeometryPtr CSGGeometry::create(string name) {
@@ -37,7 +39,6 @@ CSGGeometryPtr CSGGeometry::create(string name) {
 }
 
 void CSGGeometry::init() {
-	oct = Octree<size_t>::create(thresholdL);
 	type = "CSGGeometry";
 	setPose(oldWorldTrans);
 	polyhedron = new CGALPolyhedron();
@@ -102,14 +103,77 @@ void CSGGeometry::toOsgGeometry(CGALPolyhedron *P) {
 	calcVertexNormals(mesh->geo, 0.523598775598); // 30 degrees
 }
 
-size_t CSGGeometry::isKnownPoint(Pnt3f newPoint) {
-	vector<size_t> resultData = oct->radiusSearch(Vec3d(newPoint), thresholdL);
-	if (resultData.size() > 0) return resultData[0];
+static size_t gridCell(long long x, long long y, long long z) {
+    return size_t(x*73856093LL) ^ size_t(y*19349663LL) ^ size_t(z*83492791LL);
+}
+
+size_t CSGGeometry::isKnownPoint(Pnt3f newPoint) { // search the 27 grid cells around the point
+    Vec3d p(newPoint);
+    double L2 = thresholdL*thresholdL;
+    long long c[3];
+    for (int i=0; i<3; i++) c[i] = (long long)floor(p[i]/thresholdL);
+
+    for (int x=-1; x<=1; x++) for (int y=-1; y<=1; y++) for (int z=-1; z<=1; z++) {
+        auto it = pointGrid.find( gridCell(c[0]+x, c[1]+y, c[2]+z) );
+        if (it == pointGrid.end()) continue;
+        for (auto i : it->second) if ((gridPoints[i]-p).squareLength() <= L2) return i;
+    }
 	return numeric_limits<size_t>::max();
 }
 
+void CSGGeometry::addKnownPoint(Vec3d p) {
+    long long c[3];
+    for (int i=0; i<3; i++) c[i] = (long long)floor(p[i]/thresholdL);
+    pointGrid[ gridCell(c[0], c[1], c[2]) ].push_back(gridPoints.size());
+    gridPoints.push_back(p);
+}
+
+size_t CSGGeometry::hashGeometry(VRGeometryPtr geo) { // detects changes of leaf geometries
+    size_t h = 14695981039346656037ULL;
+    auto mix = [&](const void* data, size_t N) {
+        auto b = (const unsigned char*)data;
+        for (size_t i=0; i<N; i++) { h ^= b[i]; h *= 1099511628211ULL; }
+    };
+
+    Matrix4d m = geo->getWorldMatrix();
+    mix(m.getValues(), 16*sizeof(double));
+    mix(&thresholdL, sizeof(thresholdL));
+    mix(&thresholdA, sizeof(thresholdA));
+    if (!geo->getMesh() || !geo->getMesh()->geo) return h;
+
+    auto g = geo->getMesh()->geo;
+    if (auto pos = g->getPositions()) {
+        for (size_t i=0; i<pos->size(); i++) {
+            Pnt3f p = pos->getValue<Pnt3f>(i);
+            mix(&p, sizeof(p));
+        }
+    }
+    if (auto inds = g->getIndices()) {
+        for (size_t i=0; i<inds->size(); i++) {
+            UInt32 j = inds->getValue<UInt32>(i);
+            mix(&j, sizeof(j));
+        }
+    }
+    if (auto lengths = g->getLengths()) {
+        for (size_t i=0; i<lengths->size(); i++) {
+            UInt32 j = lengths->getValue<UInt32>(i);
+            mix(&j, sizeof(j));
+        }
+    }
+    if (auto types = g->getTypes()) {
+        for (size_t i=0; i<types->size(); i++) {
+            UInt32 j = types->getValue<UInt32>(i);
+            mix(&j, sizeof(j));
+        }
+    }
+    return h;
+}
+
 void CSGGeometry::enableEditMode() { // Reset our result geometry
 	CGALPolyhedron* p = new CGALPolyhedron();
+	if (polyhedron && polyhedron != p) delete polyhedron;
+	polyhedron = 0;
+	dirty = true;
 	setCSGGeometry(p);
 	for (auto c : children) if (c->hasTag("geometry")) c->setVisible(true);
 }
@@ -158,3 +222,14 @@ void CSGGeometry::setOperation(string op) {
 
 bool CSGGeometry::getEditMode() { return editMode; }
 string CSGGeometry::getOperation() { return operation; }
+
+vector<string> CSGGeometry::getBackends() { return { "nef", "corefinement" }; }
+
+void CSGGeometry::setBackend(string b) {
+    auto backends = getBackends();
+	if (std::find(backends.begin(), backends.end(), b) == backends.end()) return;
+    backend = b;
+    dirty = true;
+}
+
+string CSGGeometry::getBackend() { return backend; }
@@ -6,6 +6,8 @@
 #include "core/math/VRMathFwd.h"
 #include "addons/Engineering/VREngineeringFwd.h"
 
+#include <unordered_map>
+
 class CGALPolyhedron;
 
 using namespace std;
@@ -13,23 +15,47 @@ OSG_BEGIN_NAMESPACE;
 
 class CSGGeometry : public VRGeometry {
     private:
+        struct LeafCache {
+            size_t hash = 0;
+            CGALPolyhedron* polyhedron = 0;
+        };
+
+        struct Task { // a sub tree to compute, operands are either cached or results of sub tasks
+            CSGGeometry* node = 0;
+            CGALPolyhedron* operands[2] = {0,0};
+            vector<shared_ptr<Task>> subtasks;
+            int subtaskOperand[2] = {-1,-1};
+            bool changed = false;
+        };
+
         CGALPolyhedron* polyhedron = 0;
         string operation = "unite";
+        string backend = "nef";
         bool editMode = true;
+        bool dirty = true;
         PosePtr oldWorldTrans;
         float thresholdL = 1e-4;
         float thresholdA = 1e-8;
-        shared_ptr<Octree<size_t>> oct;
+        unordered_map<size_t, vector<size_t>> pointGrid; // vertex merging, cells of size thresholdL
+        vector<Vec3d> gridPoints;
+        map<VRObject*, LeafCache> leafCache; // converted child geometries
+
+        bool prepare(shared_ptr<Task> task);
+        static void compute(shared_ptr<Task> task);
+        static void finish(shared_ptr<Task> task);
 
     protected:
         void applyTransform(CGALPolyhedron* p, PosePtr m);
         void setCSGGeometry(CGALPolyhedron* p);
         CGALPolyhedron* getCSGGeometry();
         size_t isKnownPoint(OSG::Pnt3f newPoint);
+        void addKnownPoint(Vec3d p);
+        size_t hashGeometry(VRGeometryPtr geo);
         void toOsgGeometry(CGALPolyhedron* p);
         CGALPolyhedron* toPolyhedron(VRGeometryPtr geo, PosePtr worldTransform, bool& success);
 
         void operate(CGALPolyhedron* minuend, CGALPolyhedron* subtrahend);
+        bool corefine(CGALPolyhedron* P1, CGALPolyhedron* P2);
 
         void enableEditMode();
         bool disableEditMode();
@@ -53,6 +79,10 @@ class CSGGeometry : public VRGeometry {
         string getOperation();
         static vector<string> getOperations();
 
+        void setBackend(string b);
+        string getBackend();
+        static vector<string> getBackends();
+
         void markEdges(vector<Vec2i> edges);
 };
 
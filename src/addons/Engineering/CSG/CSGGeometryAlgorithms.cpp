@@ -1,9 +1,8 @@
 #include "CSGGeometry.h"
 #include "CGALTypedefs.h"
-#include "core/math/partitioning/Octree.h"
-#include "core/math/partitioning/OctreeT.h"
 #include "core/objects/material/VRMaterial.h"
 #include "core/objects/geometry/OSGGeometry.h"
+#include "core/utils/Thread.h"
 
 #include "PolyhedronBuilder.h"
 
@@ -93,7 +92,7 @@ CGALPolyhedron* CSGGeometry::toPolyhedron(VRGeometryPtr geo, PosePtr worldTransf
 				positions.push_back( CGAL::Point(p[0], p[1], p[2]) );
 				IDs[i] = curIndex;
                 //cout << "add point " << curIndex << "   " << osgPos << endl;
-				oct->add(p, curIndex);
+				addKnownPoint(p);
 				curIndex++;
 			}
 		}
@@ -120,8 +119,8 @@ CGALPolyhedron* CSGGeometry::toPolyhedron(VRGeometryPtr geo, PosePtr worldTransf
 	}
 
 	// Cleanup
-	oct.reset();
-	oct = Octree<size_t>::create(thresholdL);
+	pointGrid.clear();
+	gridPoints.clear();
 
 	// Construct the polyhedron from raw data
     success = true;
@@ -155,10 +154,10 @@ void CSGGeometry::markEdges(vector<Vec2i> edges) {
     setColors(cols);
 }
 
-bool CSGGeometry::disableEditMode() {
+bool CSGGeometry::prepare(shared_ptr<Task> task) { // main thread, converts changed child geometries and collects the sub trees to recompute
+	task->node = this;
 	if (children.size() != 2) { cout << "CSGGeometry: Warning: editMode disabled with less than 2 children. Doing nothing.\n"; return false; }
-
-	vector<CGALPolyhedron*> polys(2,0); // We need two child geometries to work with
+	if (dirty || editMode) task->changed = true;
 
 	for (int i=0; i<2; i++) { // Prepare the polyhedra
 		VRObjectPtr obj = children[i];
@@ -166,16 +165,26 @@ bool CSGGeometry::disableEditMode() {
 
 		if(obj->getType() == "CSGGeometry") {
 			CSGGeometryPtr geo = static_pointer_cast<CSGGeometry>(obj);
-			polys[i] = geo->getCSGGeometry(); // TODO: where does this come from?? keep the old!
+			auto sub = make_shared<Task>();
+			if (!geo->prepare(sub)) return false;
+			if (sub->changed) { // recompute the sub tree, else reuse its result
+                task->subtaskOperand[i] = task->subtasks.size();
+                task->subtasks.push_back(sub);
+                task->changed = true;
+			} else task->operands[i] = geo->polyhedron;
 			continue;
 		}
 
 		if (obj->hasTag("geometry")) {
 			VRGeometryPtr geo = static_pointer_cast<VRGeometry>(obj);
+			auto& cache = leafCache[obj.get()];
+			if (cache.polyhedron && cache.hash == hashGeometry(geo)) { task->operands[i] = cache.polyhedron; continue; }
+
             cout << "child: " << geo->getName() << " toPolyhedron\n";
-            bool success;
+            bool success = false;
+            CGALPolyhedron* p = 0;
 			try {
-			    polys[i] = toPolyhedron( geo, geo->getWorldPose(), success );
+			    p = toPolyhedron( geo, geo->getWorldPose(), success );
 			} catch (exception e) {
 			    success = false;
 			    cout << getName() << ": toPolyhedron exception: " << e.what() << endl;
@@ -183,10 +192,15 @@ bool CSGGeometry::disableEditMode() {
 
             if (!success) {
 			    cout << getName() << ": toPolyhedron went totaly wrong :(\n";
-                //setCSGGeometry(polys[i]);
-                //obj->setVisible(true); // We stay in edit mode, so both children need to be visible
+			    if (p) delete p;
                 return false;
             }
+
+            if (cache.polyhedron) delete cache.polyhedron;
+            cache.polyhedron = p;
+            cache.hash = hashGeometry(geo); // toPolyhedron may have moved vertices of flat triangles
+            task->operands[i] = p;
+            task->changed = true;
 			continue;
 		}
 
@@ -195,13 +209,51 @@ bool CSGGeometry::disableEditMode() {
 		cout << ", it should be 'Geometry' or 'CSGGeometry'!" << endl;
 	}
 
-	if (polys[0] == 0) cout << "Warning! first polyhedron is 0! " << children[0]->getName() << endl;
-	if (polys[1] == 0) cout << "Warning! second polyhedron is 0! " << children[1]->getName() << endl;
-	if (polys[0] == 0 || polys[1] == 0) return false;
-    if (!polys[0]->polyhedron->is_closed() || !polys[1]->polyhedron->is_closed()) return false;
+	for (auto it = leafCache.begin(); it != leafCache.end();) { // forget removed children
+        if (it->first == children[0].get() || it->first == children[1].get()) { it++; continue; }
+        if (it->second.polyhedron) delete it->second.polyhedron;
+        it = leafCache.erase(it);
+	}
+
+	for (int i=0; i<2; i++) {
+        if (task->operands[i] == 0 && task->subtaskOperand[i] < 0) { cout << "Warning! polyhedron " << i << " is 0! " << children[i]->getName() << endl; return false; }
+        if (task->operands[i] && !task->operands[i]->polyhedron->is_closed()) return false;
+	}
+	return true;
+}
+
+void CSGGeometry::compute(shared_ptr<Task> task) { // independent sub trees are computed in parallel
+    vector<shared_ptr<::Thread>> threads;
+    for (size_t i=1; i<task->subtasks.size(); i++) {
+        auto sub = task->subtasks[i];
+        threads.push_back( make_shared<::Thread>("CSG sub tree", [sub]() { compute(sub); }) );
+    }
+    if (task->subtasks.size() > 0) compute(task->subtasks[0]);
+    for (auto t : threads) t->join();
 
-    operate(polys[0], polys[1]);
-	for (auto p : polys) delete p; // clean up
-    setCSGGeometry(polyhedron);
+    for (int i=0; i<2; i++) {
+        int j = task->subtaskOperand[i];
+        if (j >= 0) task->operands[i] = task->subtasks[j]->node->polyhedron;
+    }
+
+    auto node = task->node;
+    if (node->polyhedron) delete node->polyhedron;
+    node->polyhedron = new CGALPolyhedron();
+    node->operate(task->operands[0], task->operands[1]);
+}
+
+void CSGGeometry::finish(shared_ptr<Task> task) { // main thread, update the geometries of all recomputed nodes
+    for (auto sub : task->subtasks) finish(sub);
+    auto node = task->node;
+    node->dirty = false;
+    node->editMode = false;
+    node->setCSGGeometry(node->polyhedron);
+}
+
+bool CSGGeometry::disableEditMode() {
+    auto task = make_shared<Task>();
+    if (!prepare(task)) return false;
+    compute(task);
+    finish(task);
 	return true;
 }
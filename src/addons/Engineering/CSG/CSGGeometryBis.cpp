@@ -2,13 +2,41 @@
 #include "CGALTypedefs.h"
 #include "PolyhedronBuilder.h"
 
+#include <CGAL/Polygon_mesh_processing/corefinement.h>
+#include <CGAL/boost/graph/copy_face_graph.h>
+
 using namespace OSG;
 
+bool CSGGeometry::corefine(CGALPolyhedron* P1, CGALPolyhedron* P2) { // mesh corefinement, exact predicates, no Nef conversion
+    namespace PMP = CGAL::Polygon_mesh_processing;
+    CGAL::SurfaceMesh m1, m2, res;
+    CGAL::copy_face_graph(*P1->polyhedron, m1); // corefinement modifies its inputs, keep the cached operands
+    CGAL::copy_face_graph(*P2->polyhedron, m2);
+
+    bool ok = false;
+    if (operation == "unite") ok = PMP::corefine_and_compute_union(m1, m2, res);
+    else if(operation == "subtract") ok = PMP::corefine_and_compute_difference(m1, m2, res);
+    else if(operation == "intersect") ok = PMP::corefine_and_compute_intersection(m1, m2, res);
+    if (!ok) return false;
+
+    polyhedron->polyhedron->clear();
+    CGAL::copy_face_graph(res, *polyhedron->polyhedron);
+    return true;
+}
+
 void CSGGeometry::operate(CGALPolyhedron *P1, CGALPolyhedron *P2) {
     auto p1 = P1->polyhedron;
     auto p2 = P2->polyhedron;
 	if (!p1->is_closed() || !p2->is_closed()) return;
 
+	if (backend == "corefinement") {
+        try {
+            if (corefine(P1, P2)) return;
+        } catch (exception e) { cout << getName() << ": CSGGeometry::corefine exception: " << e.what() << endl; }
+        cout << getName() << ": corefinement failed, falling back to Nef polyhedra" << endl;
+        polyhedron->polyhedron->clear();
+	}
+
     try {
         CGAL::Nef_Polyhedron np1(*p1), np2(*p2);
         if (operation == "unite") np1 += np2;
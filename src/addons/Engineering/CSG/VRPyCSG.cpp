@@ -15,6 +15,8 @@ PyMethodDef VRPyCSGGeometry::methods[] = {
     {"setEditMode", (PyCFunction)VRPyCSGGeometry::setEditMode, METH_VARARGS, "set CSG object edit mode, set it to false to compute and show the result - setEditMode(bool b)" },
     {"markEdges", (PyCFunction)VRPyCSGGeometry::markEdges, METH_VARARGS, "Color the edges of the polyhedron, pass a list of int pairs - markEdges([[i1,i2],[i1,i3],...])\nPass an empty list to hide edges." },
     {"setThreshold", (PyCFunction)VRPyCSGGeometry::setThreshold, METH_VARARGS, "Set the threashold used to merge double vertices - setThreshold( float )\n default is 1e-4" },
+    {"setBackend", PyWrap(CSGGeometry, setBackend, "Set the boolean backend, 'nef' (default) or 'corefinement' (faster, falls back to 'nef' on failure)", void, string ) },
+    {"getBackend", PyWrap(CSGGeometry, getBackend, "Get the boolean backend", string ) },
     {NULL}  /* Sentinel */
 };
 
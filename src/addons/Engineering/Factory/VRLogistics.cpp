@@ -10,6 +10,8 @@
 #include "addons/Algorithms/VRPathFinding.h"
 
 #include <OpenSG/OSGMatrixUtility.h>
+#include <fstream>
+#include <algorithm>
 
 using namespace std;
 using namespace OSG;
@@ -19,6 +21,39 @@ int FID::getID() { return ID; }
 void FID::setID(int i) { ID = i; }
 
 
+// --------------------------------------------------------------------- EVENTS
+
+void FEventQueue::schedule(double t, function<void()> cb) {
+    Event e;
+    e.time = max(t, now);
+    e.seq = seq++;
+    e.cb = cb;
+    events.push(e);
+}
+
+void FEventQueue::advance(double t) {
+    while (!events.empty() && events.top().time <= t) {
+        Event e = events.top();
+        events.pop();
+        now = e.time;
+        processed++;
+        e.cb();
+    }
+    now = max(now, t);
+}
+
+void FEventQueue::clear() {
+    events = priority_queue<Event, vector<Event>, Later>();
+    now = 0;
+    seq = 0;
+    processed = 0;
+}
+
+double FEventQueue::getTime() { return now; }
+size_t FEventQueue::getPending() { return events.size(); }
+size_t FEventQueue::getProcessed() { return processed; }
+
+
 // --------------------------------------------------------------------- OBJECT
 
 FObject::FObject() {}
@@ -63,6 +98,15 @@ bool FObject::move(OSG::PathPtr p, float dx) {
     bool done = false;
     t += dx;
     if (t >= 1) { t = 1; done = true; }
+    place(p, t);
+
+    if (done) t = 0;
+    return done;
+}
+
+void FObject::place(OSG::PathPtr p, float t) {
+    VRTransformPtr trans = getTransformation();
+    if (trans == 0) return;
 
     Matrix4d m;
     Vec3d dir, up, pos;
@@ -71,9 +115,6 @@ bool FObject::move(OSG::PathPtr p, float dx) {
 
     MatrixLookAt( m, pos, pos+dir, up );
     trans->setWorldMatrix(m);
-
-    if (done) t = 0;
-    return done;
 }
 
 // --------------------------------------------------------------------- NODE
@@ -105,6 +146,7 @@ FNode::State FNode::getState() { return state; }
 
 void FNode::setTransform(OSG::VRTransformPtr t) { transform = t; }
 VRTransformPtr FNode::getTransform() { return transform; }
+bool FNode::isProcessing() { return processing; }
 
 
 // --------------------------------------------------------------------- PATH
@@ -134,9 +176,10 @@ int FContainer::getCapacity() { return capacity; }
 
 void FContainer::add(FProductPtr p) {
     auto t = p->getTransformation();
-    t->hide();
     products.push_back(p);
     setMetaData("Nb: " + toString(products.size()));
+    if (!t || !getTransformation()) return;
+    t->hide();
 
     Matrix4d wm;
     wm = t->getWorldMatrix();
@@ -150,7 +193,7 @@ FProductPtr FContainer::pop() {
     FProductPtr p = products.back();
     //p->getTransformation()->setMatrix(getTransformation()->getMatrix());
     products.pop_back();
-    p->getTransformation()->show();
+    if (auto t = p->getTransformation()) t->show();
     setMetaData("Nb: " + toString(products.size()));
     //p->setMetaData("ID: " + toString(p->getID()));
     return p;
@@ -176,13 +219,31 @@ void FTransporter::setTransportType(FTType type) { transport_type = type; }
 void FTransporter::setSpeed(float s) { speed = s; }
 float FTransporter::getSpeed() { return speed; }
 
-void FTransporter::update(float dt) {
-    if (!fpath) return;
+int FTransporter::incoming(FNodePtr n) {
+    int N = 0;
+    for (auto& c : cargo) if (c.second == n) N++;
+    return N;
+}
+
+void FTransporter::dispatch() { // called by the event queue whenever nodes along the path may have changed
+    dispatchPending = false;
+    if (!fpath || !logistics) return;
     auto net = network.lock();
     if (!net) return;
     vector<int>& nodes = fpath->nodes;
     if (!fpath->path) fpath->updatePath(net->getGraph());
 
+    auto depart = [&](FObjectPtr o, FNodePtr from, FNodePtr n) {
+        double now = logistics->getSimulationTime();
+        double T = fpath->path->getLength() / speed;
+        o->departure = now;
+        o->arrival = now + T;
+        if (cargo.size() == 0) busySince = now;
+        cargo[o] = n;
+        logistics->schedule(T, [this, o, n]() { arrive(o, n); });
+        logistics->dispatchAll(from); // wakes transporters waiting for the freed node, including this one
+    };
+
 
     FNodePtr n1, n2;
     FObjectPtr o1, o2;
@@ -212,11 +273,11 @@ void FTransporter::update(float dt) {
         (s1 == FNode::CONTAINER) ? c1 = dynamic_pointer_cast<FContainer>(o1) : c1 = 0;
         (s2 == FNode::CONTAINER) ? c2 = dynamic_pointer_cast<FContainer>(o2) : c2 = 0;
 
-        if (o1 == 0) continue; /* nothing here to do */                                     //if (getID() == test_id) cout << "\n Node content " << o1->getID() << " ,reserved?" << flush;
+        if (o1 == 0 || n1->isProcessing()) continue; /* nothing here to do */               //if (getID() == test_id) cout << "\n Node content " << o1->getID() << " ,reserved?" << flush;
         if (s2 == FNode::RESERVED) continue; /* next node reserved*/                        //if (getID() == test_id) cout << "\n Product there? " << flush;
 
         if (p2) continue; /* no place at next node */                                       //if (getID() == test_id) cout << "\n Container there? " << flush;
-        if (c2) if (c2->isFull()) continue; /* no place in container*/                      //if (getID() == test_id) cout << "\n Next node has place for a product " << flush;
+        if (c2) if (c2->getCount() + incoming(n2) >= c2->getCapacity()) continue; /* no place in container*/ //if (getID() == test_id) cout << "\n Next node has place for a product " << flush;
 
         switch(transport_type) {
             case PRODUCT:                                                                   //if (getID() == test_id) cout << "\n Transport product, container? " << flush;
@@ -230,8 +291,8 @@ void FTransporter::update(float dt) {
 
                 if (t1 == FObject::PRODUCT) {                                               //if (getID() == test_id) cout << "\n  a product, move it! " << flush;
                     if (n1->get() == o1) n1->set(0);
-                    cargo[n2] = o1;
                     if(c2 == 0) n2->setState(FNode::RESERVED);
+                    depart(o1, n1, n2);
                     continue;
                 }
                 continue;
@@ -241,7 +302,7 @@ void FTransporter::update(float dt) {
                 if (!c1->isFull()) continue; /* wait until container is full*/              //if (getID() == test_id) cout << "\n  yes, move it! " << flush;
                 n1->set(0);
                 n2->setState(FNode::RESERVED);
-                cargo[n2] = c1;
+                depart(c1, n1, n2);
                 continue;
 
             case CONTAINER_EMPTY:                                                           //if (getID() == test_id) cout << "\n Transport empty container, container?" << flush;
@@ -249,36 +310,27 @@ void FTransporter::update(float dt) {
                 if (!c1->isEmpty()) continue; /* wait until container is empty*/            //if (getID() == test_id) cout << "\n  yes, move it! " << flush;
                 n1->set(0);
                 n2->setState(FNode::RESERVED);
-                cargo[n2] = c1;
+                depart(c1, n1, n2);
                 continue;
         }
     }
+}
 
-    // objects in cargo are moved
-    vector<FNodePtr> toErase;
-    for (auto c : cargo) {
-        FNodePtr n = c.first;
-        FObjectPtr o = c.second;
-        if (n == 0) continue;
-        FObjectPtr no = n->get();
-
-        auto p = fpath->path;
-        float dx = speed*dt/p->getLength();
-        if (o->move(p, dx)) {
-            toErase.push_back(n);
-
-            if (no == 0) { n->set(o); continue; } // no is not a container, just place the object there
-
-            if (no->getType() == FObject::CONTAINER && o->getType() == FObject::PRODUCT) {
-                auto c = dynamic_pointer_cast<FContainer>(no);
-                auto p = dynamic_pointer_cast<FProduct>(o);
-                c->add(p);
-            }
-        }
+void FTransporter::arrive(FObjectPtr o, FNodePtr n) {
+    double now = logistics->getSimulationTime();
+    cargo.erase(o);
+    if (cargo.size() == 0) busyTime += now - busySince;
+    o->place(fpath->path, 1);
+
+    FObjectPtr no = n->get();
+    if (no == 0) n->set(o); // no is not a container, just place the object there
+    else if (no->getType() == FObject::CONTAINER && o->getType() == FObject::PRODUCT) {
+        auto c = dynamic_pointer_cast<FContainer>(no);
+        auto p = dynamic_pointer_cast<FProduct>(o);
+        c->add(p);
     }
 
-    // delete cargo
-    for (auto n : toErase) cargo.erase(n);
+    logistics->arrived(o, n);
 }
 
 
@@ -344,7 +396,7 @@ VRStrokePtr FNetwork::stroke(Color3f c, float k) {
 // --------------------------------------------------------------------- LOGISTICS
 
 
-FLogistics::FLogistics() {
+FLogistics::FLogistics() : rng(0) {
     network = FNetworkPtr(new FNetwork());
 }
 
@@ -370,6 +422,7 @@ FTransporterPtr FLogistics::addTransporter(string stype) {
     if (stype == "CONTAINER_EMPTY") type = FTransporter::CONTAINER_EMPTY;
     auto t = FTransporterPtr(new FTransporter());
     t->network = network;
+    t->logistics = this;
     t->setTransportType(type);
     transporter[t->getID()] = t;
     return t;
@@ -405,14 +458,165 @@ vector<FContainerPtr> FLogistics::getContainers() {
 
 shared_ptr<FLogistics> FLogistics::create() { return shared_ptr<FLogistics>(new FLogistics()); }
 
-void FLogistics::update() {
-    static float t2 = 0;
-    float t1 = getTime()*1e-6;//in seconds
-    if (t2 == 0) { t2 = t1; return; } // first update
-    float dt = t1 - t2;
-    t2 = t1;
+void FLogistics::update() { // advances the simulation with the scaled frame time, only here objects in transit are placed
+    double t1 = getTime()*1e-6;//in seconds
+    if (lastUpdate == 0) { lastUpdate = t1; return; } // first update
+    double dt = t1 - lastUpdate;
+    lastUpdate = t1;
+
+    dispatchAll(); // pick up changes from scripts
+    events.advance(events.getTime() + dt*timeScale);
+    updateVisuals();
+}
+
+void FLogistics::run(double duration) { // headless
+    dispatchAll();
+    events.advance(events.getTime() + duration);
+}
+
+void FLogistics::updateVisuals() {
+    double now = events.getTime();
+    for (auto& t : transporter) {
+        auto& T = t.second;
+        if (!T->fpath || !T->fpath->path) continue;
+        for (auto& c : T->cargo) {
+            auto& o = c.first;
+            if (!o->getTransformation()) continue;
+            double d = o->arrival - o->departure;
+            double f = d > 0 ? (now - o->departure) / d : 1.0;
+            o->place(T->fpath->path, min(1.0, max(0.0, f)));
+        }
+    }
+}
+
+void FLogistics::setSeed(int s) { seed = s; rng.seed(seed); }
+void FLogistics::setTimeScale(float s) { timeScale = s; }
+void FLogistics::schedule(double delay, function<void()> cb) { events.schedule(events.getTime() + delay, cb); }
+double FLogistics::getSimulationTime() { return events.getTime(); }
+
+void FLogistics::dispatchAll(FNodePtr n) { // only transporters with n on their path if given
+    for (auto& t : transporter) {
+        auto T = t.second.get();
+        if (T->dispatchPending) continue;
+        if (n) {
+            if (!T->fpath) continue;
+            auto& nodes = T->fpath->nodes;
+            if (find(nodes.begin(), nodes.end(), n->getID()) == nodes.end()) continue;
+        }
+        T->dispatchPending = true;
+        schedule(0, [T]() { T->dispatch(); });
+    }
+}
+
+void FLogistics::changeWip(int d) {
+    double now = events.getTime();
+    wipIntegral += wip * (now - wipChanged);
+    wipChanged = now;
+    wip += d;
+}
+
+void FLogistics::addSource(int nodeID, float interval, bool random, VRTransformPtr t) {
+    auto n = network->getNode(nodeID);
+    if (!n || interval <= 0) return;
+    bool scheduled = n->sourceInterval > 0;
+    n->sourceInterval = interval;
+    n->sourceRandom = random;
+    n->sourceTemplate = t;
+    if (!scheduled) schedule(0, [this, n]() { sourceTick(n); });
+}
 
-    for (auto& t : transporter) t.second->update(dt);
+void FLogistics::addSink(int nodeID) {
+    if (auto n = network->getNode(nodeID)) n->sink = true;
+}
+
+void FLogistics::addStation(int nodeID, float processTime) {
+    if (auto n = network->getNode(nodeID)) n->processTime = processTime;
+}
+
+void FLogistics::sourceTick(FNodePtr n) {
+    if (n->getState() == FNode::FREE) {
+        VRTransformPtr t = 0;
+        if (n->sourceTemplate) {
+            t = static_pointer_cast<VRTransform>(n->sourceTemplate->duplicate(true));
+            t->setVisible(true);
+            t->setPersistency(0);
+        }
+        auto p = addProduct(t);
+        p->created = events.getTime();
+        created++;
+        changeWip(1);
+        n->set(p);
+        dispatchAll(n);
+    } else n->blocked++;
+
+    double dt = n->sourceInterval;
+    if (n->sourceRandom) dt = exponential_distribution<double>(1.0/n->sourceInterval)(rng);
+    schedule(dt, [this, n]() { sourceTick(n); });
+}
+
+void FLogistics::processed(FNodePtr n) {
+    n->processing = false;
+    n->busyTime += n->processTime;
+    dispatchAll(n);
+}
+
+void FLogistics::arrived(FObjectPtr o, FNodePtr n) {
+    if (o->getType() == FObject::PRODUCT && n->get() == o) {
+        if (n->sink) {
+            n->set(0);
+            objects.erase(o->getID());
+            completed++;
+            leadTimes += events.getTime() - o->created;
+            changeWip(-1);
+            if (auto t = o->getTransformation()) t->destroy();
+        } else if (n->processTime > 0) {
+            n->processing = true;
+            schedule(n->processTime, [this, n]() { processed(n); });
+        }
+    }
+    dispatchAll(n);
+}
+
+map<string, double> FLogistics::getStatistics() {
+    map<string, double> res;
+    double now = events.getTime();
+    double T = max(now, 1e-9);
+    res["time"] = now;
+    res["events"] = events.getProcessed();
+    res["created"] = created;
+    res["completed"] = completed;
+    res["throughput"] = completed / T * 3600.0; // per hour
+    res["wip"] = wip;
+    res["wipAverage"] = (wipIntegral + wip * (now - wipChanged)) / T;
+    res["leadTime"] = completed > 0 ? leadTimes / completed : 0;
+
+    for (auto n : network->getNodes()) {
+        string id = toString(n->getID());
+        if (n->processTime > 0) res["utilisation_station_"+id] = n->busyTime / T;
+        if (n->sourceInterval > 0) res["blocked_source_"+id] = n->blocked;
+    }
+
+    for (auto& t : transporter) {
+        auto& tr = t.second;
+        double busy = tr->busyTime;
+        if (tr->cargo.size() > 0) busy += now - tr->busySince;
+        res["utilisation_transporter_"+toString(t.first)] = busy / T;
+    }
+    return res;
+}
+
+void FLogistics::exportStatistics(string path) { // appends one row per run
+    auto stats = getStatistics();
+    bool header = !exists(path);
+    ofstream file(path, ios::app);
+    if (header) {
+        file << "seed";
+        for (auto& s : stats) file << "," << s.first;
+        file << endl;
+    }
+    file << seed;
+    for (auto& s : stats) file << "," << s.second;
+    file << endl;
 }
 
 FPathPtr FLogistics::computeRoute(int n1, int n2) {
@@ -424,6 +628,23 @@ FPathPtr FLogistics::computeRoute(int n1, int n2) {
     return path;
 }
 
-void FLogistics::clear() { // TODO
-    ;
+void FLogistics::clear() { // resets the simulation time and statistics, sources restart
+    events.clear();
+    rng.seed(seed);
+    lastUpdate = 0;
+    created = completed = wip = 0;
+    wipIntegral = wipChanged = leadTimes = 0;
+
+    for (auto& t : transporter) {
+        t.second->cargo.clear();
+        t.second->dispatchPending = false;
+        t.second->busyTime = 0;
+    }
+
+    for (auto n : network->getNodes()) {
+        n->processing = false;
+        n->busyTime = 0;
+        n->blocked = 0;
+        if (n->sourceInterval > 0) schedule(0, [this, n]() { sourceTick(n); });
+    }
 }
@@ -4,7 +4,10 @@
 #include <map>
 #include <vector>
 #include <stack>
+#include <queue>
 #include <memory>
+#include <random>
+#include <functional>
 
 #include "core/math/OSGMathFwd.h"
 #include "core/objects/VRObjectFwd.h"
@@ -26,6 +29,34 @@ ptrFwd(FTransporter);
 ptrFwd(FContainer);
 ptrFwd(FLogistics);
 
+class FEventQueue { // discrete event kernel, events with equal times run in the order they were scheduled
+    public:
+        struct Event {
+            double time = 0;
+            size_t seq = 0;
+            function<void()> cb;
+        };
+
+    private:
+        struct Later {
+            bool operator()(const Event& a, const Event& b) const { return a.time > b.time || (a.time == b.time && a.seq > b.seq); }
+        };
+
+        priority_queue<Event, vector<Event>, Later> events;
+        double now = 0;
+        size_t seq = 0;
+        size_t processed = 0;
+
+    public:
+        void schedule(double t, function<void()> cb);
+        void advance(double t);
+        void clear();
+
+        double getTime();
+        size_t getPending();
+        size_t getProcessed();
+};
+
 class FID {
     private:
         int ID;
@@ -47,6 +78,9 @@ class FObject : public FID {
         VRTransformPtr transform = 0;
         VRSpritePtr metaData = 0;
         float t = 0;
+        double created = 0; // simulation times
+        double departure = 0;
+        double arrival = 0;
 
     protected:
         FObject();
@@ -60,10 +94,12 @@ class FObject : public FID {
         void setTransformation(VRTransformPtr t);
         VRTransformPtr getTransformation();
         bool move(PathPtr p, float dx);
+        void place(PathPtr p, float t);
 
         void setMetaData(string s);
 
         friend class FLogistics;
+        friend class FTransporter;
 };
 
 class FNode : public FID, public enable_shared_from_this<FNode> {
@@ -76,6 +112,16 @@ class FNode : public FID, public enable_shared_from_this<FNode> {
         State state;
         VRTransformPtr transform = 0;
 
+        // production roles, set by FLogistics
+        double sourceInterval = 0;
+        bool sourceRandom = false;
+        VRTransformPtr sourceTemplate = 0;
+        bool sink = false;
+        double processTime = 0;
+        bool processing = false;
+        double busyTime = 0;
+        int blocked = 0;
+
     protected:
         FNode();
 
@@ -90,7 +136,10 @@ class FNode : public FID, public enable_shared_from_this<FNode> {
         void setTransform(VRTransformPtr t);
         VRTransformPtr getTransform();
 
+        bool isProcessing();
+
         friend class FNetwork;
+        friend class FLogistics;
 };
 
 class FPath {
@@ -167,11 +216,18 @@ class FTransporter : public FID {
         enum FTType { PRODUCT, CONTAINER_FULL, CONTAINER_EMPTY };
 
     private:
-        map<shared_ptr<FNode>, FObjectPtr> cargo;
+        map<FObjectPtr, shared_ptr<FNode>> cargo; // objects in transit and their target nodes
         FPathPtr fpath;
         FTType transport_type;
         float speed;
         weak_ptr<FNetwork> network;
+        FLogistics* logistics = 0;
+        bool dispatchPending = false;
+        double busyTime = 0;
+        double busySince = 0;
+
+        int incoming(FNodePtr n);
+        void arrive(FObjectPtr o, FNodePtr n);
 
     public:
         FTransporter();
@@ -186,7 +242,7 @@ class FTransporter : public FID {
         void load();
         void unload();
 
-        void update(float dt);
+        void dispatch();
 
         friend class FLogistics;
 };
@@ -197,6 +253,27 @@ class FLogistics {
         map<int, FObjectPtr> objects;
         map<int, FTransporterPtr> transporter;
 
+        FEventQueue events;
+        mt19937 rng;
+        unsigned int seed = 0;
+        double timeScale = 1;
+        double lastUpdate = 0;
+
+        // statistics
+        int created = 0;
+        int completed = 0;
+        int wip = 0;
+        double wipIntegral = 0;
+        double wipChanged = 0;
+        double leadTimes = 0;
+
+        void changeWip(int d);
+        void sourceTick(FNodePtr n);
+        void processed(FNodePtr n);
+        void dispatchAll(FNodePtr n = 0);
+        void arrived(FObjectPtr o, FNodePtr n);
+        void updateVisuals();
+
     public:
         FLogistics();
         ~FLogistics();
@@ -212,9 +289,23 @@ class FLogistics {
 
         FPathPtr computeRoute(int n1, int n2);
 
+        void addSource(int nodeID, float interval, bool random = false, VRTransformPtr t = 0);
+        void addSink(int nodeID);
+        void addStation(int nodeID, float processTime);
+
+        void setSeed(int s);
+        void setTimeScale(float s);
+        void schedule(double delay, function<void()> cb);
+        double getSimulationTime();
+
         void update();
-        void run();
+        void run(double duration);
         void clear();
+
+        map<string, double> getStatistics();
+        void exportStatistics(string path);
+
+        friend class FTransporter;
 };
 
 OSG_END_NAMESPACE;
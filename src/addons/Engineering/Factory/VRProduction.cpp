@@ -64,7 +64,19 @@ VRProduct::VRProduct(string name) {
 }
 
 void VRProduction::stop() { running = false; }
-void VRProduction::start() { running = true; }
+
+void VRProduction::start() { // the takt runs on the event queue of the intra logistics
+    if (running) return;
+    running = true;
+    taktChain++;
+    int chain = taktChain;
+    intraLogistics->schedule(0, [this, chain]() { step(chain); });
+}
+
+void VRProduction::setRate(float seconds) { takt = seconds*1000; }
+void VRProduction::update() { intraLogistics->update(); }
+void VRProduction::run(double duration) { intraLogistics->run(duration); }
+shared_ptr<FLogistics> VRProduction::getLogistics() { return intraLogistics; }
 
 VRProcessResult::VRProcessResult(string name) { this->name = name;}
 
@@ -75,13 +87,9 @@ VRProcessResult* VRProcessFragment::addResult(string name) {
     return r;
 }
 
-void VRProduction::update() {
-    if (!running) return;
-
-    int t = getTime()*1e-3;
-    int dt = t-last_takt;
-    if (dt < takt) return;
-    last_takt = t;
+void VRProduction::step(int chain) {
+    if (!running || chain != taktChain) return;
+    intraLogistics->schedule(takt*0.001, [this, chain]() { step(chain); });
 
     VROntologyPtr production = description;
     //for (VRProductionJob* job : jobs) {
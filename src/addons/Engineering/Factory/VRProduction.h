@@ -75,8 +75,10 @@ class VRProduction {
         shared_ptr<FLogistics> intraLogistics;
         shared_ptr<FNetwork> network;
         bool running = false;
-        int takt = 2000;
-        int last_takt = 0;
+        int takt = 2000; // ms
+        int taktChain = 0;
+
+        void step(int chain);
 
     public:
         VRProduction();
@@ -90,6 +92,8 @@ class VRProduction {
         void start();
         void stop();
         void update();
+        void run(double duration);
+        shared_ptr<FLogistics> getLogistics();
 
         static VRObjectPtr test();
 };
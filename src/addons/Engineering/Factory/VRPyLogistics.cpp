@@ -66,6 +66,8 @@ PyMethodDef VRPyFProduct::methods[] = {
     {NULL}  /* Sentinel */
 };
 
+typedef map<string, double> mapSD;
+
 PyMethodDef VRPyFLogistics::methods[] = {
     {"addProduct", PyWrapOpt2(FLogistics, addProduct, "Add a new product from geometry", "0", FProductPtr, VRTransformPtr) },
     {"addNetwork", PyWrap2(FLogistics, addNetwork, "Add a new network", FNetworkPtr) },
@@ -74,9 +76,18 @@ PyMethodDef VRPyFLogistics::methods[] = {
     {"addContainer", PyWrap2(FLogistics, addContainer, "Add a new container", FContainerPtr, VRTransformPtr) },
     {"fillContainer", PyWrap2(FLogistics, fillContainer, "Fill container : fillContainer(container, N, obj)", void, FContainerPtr, int, VRTransformPtr) },
     {"update", PyWrap2(FLogistics, update, "Update logistics simulation", void) },
-    {"clear", PyWrap2(FLogistics, clear, "Clear logistics simulation", void) },
+    {"clear", PyWrap2(FLogistics, clear, "Reset simulation time and statistics", void) },
     {"getContainers", PyWrap2(FLogistics, getContainers, "Destroy logistics simulation", vector<FContainerPtr>) },
     {"computeRoute", PyWrap2(FLogistics, computeRoute, "Compute route", FPathPtr, int, int) },
+    {"addSource", PyWrapOpt2(FLogistics, addSource, "Create products at a node - addSource(node, interval, random, obj)\n random: exponential inter arrival times, obj: template for product geometries", "0|0", void, int, float, bool, VRTransformPtr) },
+    {"addSink", PyWrap2(FLogistics, addSink, "Remove products arriving at a node - addSink(node)", void, int) },
+    {"addStation", PyWrap2(FLogistics, addStation, "Hold products arriving at a node for a processing time in seconds - addStation(node, time)", void, int, float) },
+    {"setSeed", PyWrap2(FLogistics, setSeed, "Set random seed of the simulation", void, int) },
+    {"setTimeScale", PyWrap2(FLogistics, setTimeScale, "Set simulated seconds per real second used by update", void, float) },
+    {"run", PyWrap2(FLogistics, run, "Run the simulation headless for a duration in simulated seconds", void, double) },
+    {"getSimulationTime", PyWrap2(FLogistics, getSimulationTime, "Get simulated time in seconds", double) },
+    {"getStatistics", PyWrap2(FLogistics, getStatistics, "Get statistics, throughput per hour, WIP, lead time and utilisations", mapSD) },
+    {"exportStatistics", PyWrap2(FLogistics, exportStatistics, "Append the statistics of this run to a CSV file", void, string) },
     {NULL}  /* Sentinel */
 };
 
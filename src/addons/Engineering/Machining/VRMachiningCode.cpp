@@ -4,49 +4,110 @@
 #include "core/objects/material/VRMaterial.h"
 
 #include <OpenSG/OSGMatrix.h>
+#include <OpenSG/OSGQuaternion.h>
+#include <algorithm>
+#include <fstream>
 
 using namespace OSG;
 
 VRMachiningCode::VRMachiningCode() {}
-VRMachiningCode::~VRMachiningCode() {}
+
+VRMachiningCode::~VRMachiningCode() {
+    abortLoading = true;
+    waitForLoading();
+}
 
 VRMachiningCodePtr VRMachiningCode::create() { return VRMachiningCodePtr( new VRMachiningCode() ); }
 VRMachiningCodePtr VRMachiningCode::ptr() { return static_pointer_cast<VRMachiningCode>(shared_from_this()); }
 
-void VRMachiningCode::reset() { process.pointer = 0; }
-size_t VRMachiningCode::length() { return process.instructions.size() - process.pointer; }
+size_t VRMachiningCode::length() {
+    VRLock lock(mtx);
+    return segments.size();
+}
+
+double VRMachiningCode::getDuration() {
+    VRLock lock(mtx);
+    if (segments.size() == 0) return 0;
+    return segments.back().tStart + segments.back().duration;
+}
+
+bool VRMachiningCode::isLoading() { return loading; }
+
+void VRMachiningCode::waitForLoading() {
+    if (!loader) return;
+    loader->join();
+    loader = 0;
+}
 
 void VRMachiningCode::clear() {
+    abortLoading = true;
+    waitForLoading();
+    abortLoading = false;
     program.subroutines.clear();
     program.main = Function("main");
-    process.instructions.clear();
-    process.pointer = 0;
+    VRLock lock(mtx);
+    segments.clear();
+    pending.clear();
 }
 
-VRMachiningCode::Instruction VRMachiningCode::next() {
-	if (process.pointer <= process.instructions.size()) return process.instructions[process.pointer++];
-	return Instruction();
+void VRMachiningCode::flush() { // hands the parsed segments over to the readers
+    if (pending.size() == 0) return;
+    VRLock lock(mtx);
+    double t = getDuration();
+    for (auto& s : pending) {
+        s.tStart = t;
+        t += s.duration;
+    }
+    segments.insert(segments.end(), pending.begin(), pending.end());
+    pending.clear();
+}
+
+size_t VRMachiningCode::findSegment(double t) { // binary search over the segment start times
+    VRLock lock(mtx);
+    if (segments.size() == 0) return 0;
+    auto it = upper_bound(segments.begin(), segments.end(), t, [](double t, const Segment& s) { return t < s.tStart; });
+    if (it == segments.begin()) return 0;
+    return it - segments.begin() - 1;
+}
+
+VRMachiningCode::Segment VRMachiningCode::getSegment(size_t i) {
+    VRLock lock(mtx);
+    if (i >= segments.size()) return Segment();
+    return segments[i];
+}
+
+int VRMachiningCode::arcSteps(const Segment& s) { return max(1, int(abs(s.angle) / (2*Pi/arcPrecision))); }
+
+Vec3d VRMachiningCode::evalSegment(const Segment& s, double f) {
+    if (s.G == 1) return Vec3d(s.p0) + Vec3d(s.p1 - s.p0) * f;
+    Quaterniond Q(Vec3d(s.axis), s.angle * f);
+    Vec3d r;
+    Q.multVec(Vec3d(s.p0 - s.center), r);
+    return Vec3d(s.center) + r;
+}
+
+Vec3d VRMachiningCode::getPosition(double t) {
+    VRLock lock(mtx);
+    if (segments.size() == 0) return Vec3d();
+    auto& s = segments[findSegment(t)];
+    double f = s.duration > 0 ? (t - s.tStart) / s.duration : 1.0;
+    return evalSegment(s, max(0.0, min(1.0, f)));
 }
 
 void VRMachiningCode::translate(Vec3d vec_0, Vec3d vec_1, double v) { // G01 translation
 	vec_0 *= 0.001;
 	vec_1 *= 0.001;
-	Vec3d vecf = vec_1 - vec_0;
-
-	double L = vecf.length();
-	double T = L / v * 1000;
-	if (T * (skippedSteps + 1) > 1.0 / 60 || true) {
-		Instruction i;
-		i.G = 0;
-		i.d = vecf;
-		i.p0 = vec_0;
-		i.T = T;
-		process.instructions.push_back(i);
-		skippedSteps = 0;
-	} else skippedSteps += 1;
+
+	Segment s;
+	s.G = 1;
+	s.p0 = Vec3f(vec_0);
+	s.p1 = Vec3f(vec_1);
+	s.duration = (vec_1 - vec_0).length() / v * 1000;
+	pending.push_back(s);
+	if (pending.size() >= 4096) flush();
 }
 
-void VRMachiningCode::rotate(Vec3d start, Vec3d end, Vec3d center, Vec3d axis, double v_0, int mode) { // G02 and G03 rotation
+void VRMachiningCode::rotate(Vec3d start, Vec3d end, Vec3d center, Vec3d axis, double v_0, int mode) { // G02 and G03 rotation, stored as one segment
 	double a = 0;
 	if (mode == 1) a = 1;
 	else a = -1;
@@ -54,28 +115,26 @@ void VRMachiningCode::rotate(Vec3d start, Vec3d end, Vec3d center, Vec3d axis, d
 	// vector
 	Vec3d r0 = start - center;
 	Vec3d r1 = end - center;
+	double l = r0.length() * r1.length();
+	if (l < 1e-12) { translate(start, end, v_0); return; }
 
 	// theta
-	double theta = 0;
-	if ( (r0.dot(r1) / (r0.length() * r1.length())) > 1 ) theta = acos(1);
-	else theta = acos(r0.dot(r1) / (r0.length() * r1.length()));
-	int N = max(1.0, theta / (2*Pi/arcPrecision) );
-	double dtheta = a * theta / N;
-    Quaterniond Q(axis, dtheta);
-
-    cout << "rotate theta " << theta << ", N " << N << " -> dtheta " << dtheta << endl;
-
-	// move
-	double A = 0;
-	for (int q = 0; q < N; q++) {
-		// rotate vector 0 around dtheta degrees
-		Vec3d r;
-		Q.multVec(r0, r);
-		translate(r0 + center, r + center, v_0);
-		r0 = r;
-		A += dtheta;
-        cout << " rotate " << q << ", A " << A << endl;
-	}
+	double theta = acos( max(-1.0, min(1.0, r0.dot(r1) / l)) );
+
+	Segment s;
+	s.G = mode == 1 ? 2 : 3;
+	s.p0 = Vec3f(start * 0.001);
+	s.p1 = Vec3f(end * 0.001);
+	s.center = Vec3f(center * 0.001);
+	s.axis = Vec3f(axis);
+	s.angle = a * theta;
+
+	// time of the tessellated arc
+	int N = arcSteps(s);
+	double chord = 2 * r0.length() * 0.001 * sin(theta / N * 0.5);
+	s.duration = N * chord / v_0 * 1000;
+	pending.push_back(s);
+	if (pending.size() >= 4096) flush();
 }
 
 // https://ncviewer.com/
@@ -86,16 +145,62 @@ void VRMachiningCode::parseFolder(string path) {
 	}
 }
 
-void VRMachiningCode::readGCode(string path, double speedMultiplier) {
+void VRMachiningCode::readGCode(string path, double speedMultiplier, bool background) {
 	cout << "VRMachiningCode::readGCode " << path << " " << speedMultiplier << endl;
+	waitForLoading();
+
+	auto load = [this, path, speedMultiplier]() {
+        if (isFile(path)) streamFile(path, speedMultiplier);
+        else {
+            if (isFolder(path)) parseFolder(path);
+            computePaths(speedMultiplier);
+        }
+        program.main.lines.clear(); // consumed
+
+        cout << " read " << program.subroutines.size() << " subroutines" << endl;
+        cout << " read " << length() << " segments" << endl;
+        VRLock lock(mtx);
+        loading = false;
+	};
+
+	loading = true;
+	if (background) loader = make_shared<::Thread>("G code loader", load);
+	else load();
+}
+
+void VRMachiningCode::streamFile(string path, double speedMultiplier) { // subroutines are collected first, the main program is processed while reading
+	parseFile(path, true);
+
+	ifstream file;
+	file.open(path);
+	if (!file.is_open()) return;
 
-	if (isFile(path)) parseFile(path);
-	else if (isFolder(path)) parseFolder(path);
+	Flow flow;
+	map<string, string> params;
+	function<void(string, Context&)> cb = [&](string s, Context& c) { parseCommands(s, c, speedMultiplier); };
+	for (auto& line : program.main.lines) { // from previous parseFile calls
+        if (processLine(line, flow, params, cb)) { flush(); return; }
+	}
 
-	computePaths(speedMultiplier);
+	string line;
+	bool inSubroutine = false;
+	while (getline(file, line) && !abortLoading) {
+        size_t c = line.find(';');
+        if (c != string::npos) line.resize(c); // remove comments
+        toUpper(line);
+        size_t b = line.find_first_not_of(" \t\r");
+        if (b == string::npos) continue;
+        string first = line.substr(b, line.find_first_of(" \t\r", b) - b);
 
-	cout << " read " << program.subroutines.size() << " subroutines" << endl;
-	cout << " read " << process.instructions.size() << " instructions" << endl;
+        if (first == "PROC") { inSubroutine = true; continue; }
+        if (inSubroutine) {
+            if (first == "RET") inSubroutine = false;
+            continue;
+        }
+        if (first == "EXTERN" || first == "DEF") continue;
+        if (processLine(line, flow, params, cb)) break;
+	}
+	flush();
 }
 
 void VRMachiningCode::parseFile(string path, bool onlySubroutines) {
@@ -148,6 +253,7 @@ void VRMachiningCode::parseFile(string path, bool onlySubroutines) {
 void VRMachiningCode::computePaths(double speedMultiplier) {
     auto cb = [&](string s, Context& c) { parseCommands(s,c,speedMultiplier); };
     processFlow(cb);
+    flush();
 }
 
 void VRMachiningCode::parseCommands(string line, Context& ctx, double speedMultiplier) {
@@ -156,14 +262,19 @@ void VRMachiningCode::parseCommands(string line, Context& ctx, double speedMulti
         float value = 0;
 	};
 
-    // parse commands
+    // parse commands, words like X12.5 are read in place
     vector<Command> commands;
-    for (auto i : splitString(line)) {
-        if (i.size() <= 1) { cout << " Warning! empty line: '" << line << "'" << endl; continue; }
+    const char* w = line.c_str();
+    while (*w) {
+        if (*w == ' ' || *w == '\t' || *w == '\r') { w++; continue; }
+        const char* e = w+1;
+        while (*e && *e != ' ' && *e != '\t' && *e != '\r') e++;
+        if (e == w+1) { cout << " Warning! empty line: '" << line << "'" << endl; w = e; continue; }
         Command c;
-        c.code = i[0];
-        c.value = toFloat(subString(i, 1));
+        c.code = w[0];
+        c.value = strtof(w+1, 0);
         commands.push_back( c );
+        w = e;
     }
 
     // apply commands to current state
@@ -234,103 +345,101 @@ void VRMachiningCode::parseCommands(string line, Context& ctx, double speedMulti
     //implementation of the other G Code commands!
 }
 
-void VRMachiningCode::processFlow(function<void(string, Context&)> cb) {
-	bool inIf = false;
-	bool inWhile = false;
-	bool condEval = false;
-
-	Context cxtTmp; // TODO: find out which scope is correct
-
-	function<void(Function&, string, map<string, string>)> computeFunction = [&](Function& func, string indent, map<string, string> params) {
-	    cout << indent << "enter subroutine " << func.name << " (" << toString(params) << ")" << endl;
-
-	    Context ctx; // TODO: find out which scope is correct
-
-        for (auto& line : func.lines) {
-            if (startsWith(line, "ENDIF")) { inIf = false; continue; }
-            if (startsWith(line, "ENDWHILE")) { inWhile = false; continue; }
-            if (inIf && !condEval) { /*cout << indent << " skip if content" << endl;*/ continue; }
-            if (inWhile && !condEval) { /*cout << indent << " skip while content" << endl;*/ continue; }
-            cout << indent << " line: " << line << endl;
-
-            // check for IF
-            if (startsWith(line, "IF ")) {
-                inIf = true;
-                auto parts = splitString(line);
-                if (parts.size() == 4) {
-                    if (parts[2] != "==") continue;
-                    if (!params.count(parts[1])) continue;
-                    condEval = bool(parts[3] == params[parts[1]]);
-                    cout << indent << " check if, " << line << " -> " << condEval << endl;
-                }
-                continue;
-            }
+bool VRMachiningCode::processLine(string& line, Flow& flow, map<string, string>& params, function<void(string, Context&)>& cb) { // returns true on RET
+    if (startsWith(line, "ENDIF")) { flow.inIf = false; return false; }
+    if (startsWith(line, "ENDWHILE")) { flow.inWhile = false; return false; }
+    if (flow.inIf && !flow.condEval) { /*cout << " skip if content" << endl;*/ return false; }
+    if (flow.inWhile && !flow.condEval) { /*cout << " skip while content" << endl;*/ return false; }
+    //cout << " line: " << line << endl;
 
-            // check for WHILE
-            if (startsWith(line, "WHILE ")) { // TODO
-                inWhile = true;
-                continue;
-            }
+    // check for IF
+    if (startsWith(line, "IF ")) {
+        flow.inIf = true;
+        auto parts = splitString(line);
+        if (parts.size() == 4) {
+            if (parts[2] != "==") return false;
+            if (!params.count(parts[1])) return false;
+            flow.condEval = bool(parts[3] == params[parts[1]]);
+            //cout << " check if, " << line << " -> " << flow.condEval << endl;
+        }
+        return false;
+    }
 
-            if (startsWith(line, "RET")) { return; }
+    // check for WHILE
+    if (startsWith(line, "WHILE ")) { // TODO
+        flow.inWhile = true;
+        return false;
+    }
 
-            // check for variable assignment
-            if (contains(line, " = ")) {
-                auto parts = splitString(line, " = ");
-                params[parts[0]] = parts[1];
-                continue;
-            }
+    if (startsWith(line, "RET")) return true;
 
-            // check for subroutine
-            string sub;
-            if (contains(line, "(")) sub = splitString(line, '(')[0];
-            else sub = splitString(line)[0];
-            //cout << indent << "  sub " << sub << ", known: " << program.subroutines.count(sub) << endl;
-            if (program.subroutines.count(sub)) {
-                auto& f = program.subroutines[sub];
-                map<string, string> values;
-
-                if (f.args.size() > 0) { // params expected
-                    if (contains(line, "(") && contains(line, ")")) {
-                        int i=0;
-                        auto vals = splitString( splitString( splitString(line, '(')[1], ')')[0], ',');
-                        for (auto p : vals) {
-                            if (p[0] == ' ') p = subString(p, 1);
-                            if (params.count(p)) p = params[p];
-                            values[f.args[i]] = p;
-                            i++;
-                        }
-                    }
-                }
+    // check for variable assignment
+    if (contains(line, " = ")) {
+        auto parts = splitString(line, " = ");
+        params[parts[0]] = parts[1];
+        return false;
+    }
 
-                computeFunction(f, indent+" ", values);
-                continue;
-            }
+    // check for subroutine
+    size_t b = line.find_first_not_of(' ');
+    string sub = line.substr(b, line.find_first_of(" (", b) - b);
+    if (program.subroutines.count(sub)) {
+        auto& f = program.subroutines[sub];
+        map<string, string> values;
 
-            cout << indent << "  cmd: " << line << endl;
-            cb(line, cxtTmp);
+        if (f.args.size() > 0) { // params expected
+            if (contains(line, "(") && contains(line, ")")) {
+                size_t i=0;
+                auto vals = splitString( splitString( splitString(line, '(')[1], ')')[0], ',');
+                for (auto p : vals) {
+                    if (i >= f.args.size()) break;
+                    if (p[0] == ' ') p = subString(p, 1);
+                    if (params.count(p)) p = params[p];
+                    values[f.args[i]] = p;
+                    i++;
+                }
+            }
         }
-	};
 
-    computeFunction(program.main, "", {});
-}
+        processFunction(f, flow, values, cb);
+        return false;
+    }
 
-//Implement here to plot the gcode path
+    //cout << "  cmd: " << line << endl;
+    cb(line, flow.ctx);
+    return false;
+}
 
-VRGeometryPtr VRMachiningCode::asGeometry() {
-    VRGeoData data;
+void VRMachiningCode::processFunction(Function& func, Flow& flow, map<string, string> params, function<void(string, Context&)>& cb) {
+    //cout << "enter subroutine " << func.name << " (" << toString(params) << ")" << endl;
+    for (auto& line : func.lines) {
+        if (processLine(line, flow, params, cb)) return;
+    }
+}
 
-    // Print all elements of the vector
-    for (const auto& element : process.instructions) {
+void VRMachiningCode::processFlow(function<void(string, Context&)> cb) {
+    Flow flow;
+    processFunction(program.main, flow, {}, cb);
+}
 
-        //cout << "G: " << element.G << endl;
-        //cout << "d: " << element.d << endl;
-        cout << "p0: " << element.p0 << ", G: " << element.G << ", d: " << element.d << ", T: " << element.T << endl;
-        //cout << "T: " << element.T << endl;
+VRGeometryPtr VRMachiningCode::asGeometry(double t0, double t1) { // toolpath preview of the time range [t0, t1], t1 < 0 for the whole program
+    VRGeoData data;
 
-        data.pushVert(element.p0, Vec3d(0,1,0));
-        //data.pushPoint();
-        if (data.size() > 1) data.pushLine();
+    {
+        VRLock lock(mtx);
+        if (segments.size()) {
+            size_t i0 = findSegment(t0);
+            size_t i1 = t1 < 0 ? segments.size()-1 : findSegment(t1);
+            data.pushVert(Vec3d(segments[i0].p0), Vec3d(0,1,0));
+            for (size_t i = i0; i <= i1; i++) {
+                auto& s = segments[i];
+                int N = s.G == 1 ? 1 : arcSteps(s);
+                for (int k=1; k<=N; k++) {
+                    data.pushVert(evalSegment(s, double(k)/N), Vec3d(0,1,0));
+                    data.pushLine();
+                }
+            }
+        }
     }
 
     auto geo = data.asGeometry("ncCode");
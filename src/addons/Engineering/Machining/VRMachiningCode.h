@@ -3,13 +3,16 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <atomic>
 
 #include <OpenSG/OSGConfig.h>
 #include <OpenSG/OSGVector.h>
 
 #include "core/objects/geometry/VRGeoData.h"
 #include "core/objects/geometry/VRGeometry.h"
-
+#include "core/utils/VRMutex.h"
+#include "core/utils/Thread.h"
 
 #include "../VREngineeringFwd.h"
 
@@ -43,27 +46,44 @@ class VRMachiningCode : public std::enable_shared_from_this<VRMachiningCode> {
             Vec3d vec0, vec1;
         };
 
-		struct Instruction {
-			int G = -1;
-			Vec3d d;
-			Vec3d p0;
-			double T = 0;
-		};
+        struct Flow {
+            bool inIf = false;
+            bool inWhile = false;
+            bool condEval = false;
+            Context ctx; // TODO: find out which scope is correct
+        };
 
-		struct Process {
-            vector< Instruction > instructions;
-            size_t pointer = 0;
-		};
+        struct Segment { // entry of the motion table, positions in meters
+            Vec3f p0;
+            Vec3f p1;
+            Vec3f center; // arcs only
+            Vec3f axis;
+            float angle = 0; // signed arc angle
+            float duration = 0;
+            double tStart = 0;
+            int G = 1; // 1 linear, 2 and 3 arcs
+        };
 
 	private:
         Program program;
-	    Process process;
+        vector<Segment> segments; // the motion table, appended in batches while loading
+        vector<Segment> pending;
+        VRMutex mtx;
+        shared_ptr<::Thread> loader;
+        std::atomic<bool> loading{false};
+        std::atomic<bool> abortLoading{false};
 
 		int arcPrecision = 64;
-		int skippedSteps = 0;
 
 		void translate(Vec3d vec_0, Vec3d vec_1, double v);
 		void rotate(Vec3d start, Vec3d end, Vec3d center, Vec3d axis, double v_0, int mode);
+		void flush();
+		int arcSteps(const Segment& s);
+		Vec3d evalSegment(const Segment& s, double f);
+
+		bool processLine(string& line, Flow& flow, map<string, string>& params, function<void(string, Context&)>& cb);
+		void processFunction(Function& func, Flow& flow, map<string, string> params, function<void(string, Context&)>& cb);
+		void streamFile(string path, double speedMultiplier);
 
 	public:
 		VRMachiningCode();
@@ -73,11 +93,16 @@ class VRMachiningCode : public std::enable_shared_from_this<VRMachiningCode> {
 		VRMachiningCodePtr ptr();
 
 		size_t length();
-		void reset();
-		Instruction next();
+		double getDuration();
+		bool isLoading();
+		void waitForLoading();
+
+		size_t findSegment(double t);
+		Segment getSegment(size_t i);
+		Vec3d getPosition(double t);
 
 		void clear();
-		void readGCode(string path, double speedMultiplier);
+		void readGCode(string path, double speedMultiplier, bool background = false);
 		void parseFile(string path, bool onlySubroutines = false);
 		void parseFolder(string path);
 
@@ -85,7 +110,7 @@ class VRMachiningCode : public std::enable_shared_from_this<VRMachiningCode> {
 		void processFlow(function<void(string, Context&)> cb);
 		void computePaths(double speedMultiplier);
 
-		VRGeometryPtr asGeometry();
+		VRGeometryPtr asGeometry(double t0 = 0, double t1 = -1);
 };
 
 OSG_END_NAMESPACE;
@@ -42,14 +42,15 @@ void VRMachiningSimulation::start(double sM) {
 	doStop = false;
 	speedMultiplier = sM;
 	timer.reset();
-	code->reset();
-	runInstruction();
+	runFrom(0);
 }
 
-void VRMachiningSimulation::runInstruction(float delay) {
+void VRMachiningSimulation::runFrom(double t, float delay) { // one animation over the loaded part of the program
 	if (doStop) return;
+	simTime = t;
 
-	if (!code || code->length() == 0) {
+	double T = code ? code->getDuration() : 0;
+	if (!code || (T <= t && !code->isLoading())) {
 		double T = timer.stop();
 		run_time = T * speedMultiplier;
 		cout << "runGCode finished after " << T << " seconds" << endl;
@@ -57,24 +58,33 @@ void VRMachiningSimulation::runInstruction(float delay) {
 		return;
 	}
 
-	VRMachiningCode::Instruction c = code->next();
-	eeD = c.d;
-	eeP0 = c.p0;
-
+	if (anim) anim->stop();
+	animStart = t;
+	animDuration = max(0.0, T - t); // while loading this may be 0, the next frame checks again
 	anim = VRAnimation::create("MachiningAnim");
 	anim->addCallback( VRAnimCb::create( "MachiningAnim", bind(&VRMachiningSimulation::run, this, std::placeholders::_1) ) );
-	anim->setDuration(c.T);
+	anim->setDuration(animDuration);
 	anim->start(delay);
 }
 
 void VRMachiningSimulation::run(float t) {
 	if (doStop) return;
-	Vec3d ee = origin + eeP0 + eeD * t;
-	//cout << "sim run, t: " << t << ", o: " << origin << ", e: " << ee << ", d: " << eeD << ", i: " << code->length() << endl;
+	simTime = animStart + animDuration * t;
+	Vec3d ee = origin + code->getPosition(simTime);
+	//cout << "sim run, t: " << t << ", o: " << origin << ", e: " << ee << ", time: " << simTime << endl;
 	if (kinematics) kinematics->setEndEffector(Pose::create(ee));
-	if (t == 1) runInstruction();
+	if (t == 1) runFrom(simTime);
+}
+
+void VRMachiningSimulation::seek(double t) {
+	if (!code) return;
+	simTime = max(0.0, t);
+	if (kinematics) kinematics->setEndEffector(Pose::create(origin + code->getPosition(simTime)));
+	if (anim && anim->isActive()) runFrom(simTime);
 }
 
+double VRMachiningSimulation::getTime() { return simTime; }
+
 void VRMachiningSimulation::setOrigin(Vec3d O){
     cout<<"Setting Origin From VMS!"<<endl;
     origin = O;
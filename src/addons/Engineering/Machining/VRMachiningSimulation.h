@@ -22,15 +22,16 @@ class VRMachiningSimulation : public std::enable_shared_from_this<VRMachiningSim
 		double speedMultiplier = 1;
 		double start_time = 0;
 		double run_time = 0;
-		Vec3d eeD;
-		Vec3d eeP0;
+		double simTime = 0; // program time
+		double animStart = 0;
+		double animDuration = 0;
 		Vec3d origin;
 
 		VRTimer timer;
 		VRAnimationPtr anim;
 
 		void run(float t);
-		void runInstruction(float delay = 0);
+		void runFrom(double t, float delay = 0);
 
 	public:
 		VRMachiningSimulation();
@@ -48,6 +49,8 @@ class VRMachiningSimulation : public std::enable_shared_from_this<VRMachiningSim
 		void stop();
 		void pause(bool b);
 		bool isPaused();
+		void seek(double t);
+		double getTime();
 };
 
 OSG_END_NAMESPACE;
@@ -17,15 +17,21 @@ PyMethodDef VRPyMachiningSimulation::methods[] = {
     {"pause", PyWrap(MachiningSimulation, pause, "Pause/unpause simulation", void, bool) },
     {"isPaused", PyWrap(MachiningSimulation, isPaused, "Returns if sim paused", bool) },
     {"setOrigin", PyWrap(MachiningSimulation, setOrigin, "Set Origin", void, Vec3d) },
+    {"seek", PyWrap(MachiningSimulation, seek, "Jump to program time in seconds", void, double) },
+    {"getTime", PyWrap(MachiningSimulation, getTime, "Get current program time in seconds", double) },
     {NULL}  /* Sentinel */
 };
 
 PyMethodDef VRPyMachiningCode::methods[] = {
-    {"readGCode", PyWrap(MachiningCode, readGCode, "Read G code from file, appends instructions, path and speedMultiplier. ", void, string, double) },
+    {"readGCode", PyWrapOpt(MachiningCode, readGCode, "Read G code from file, appends to the motion table, path, speedMultiplier and background loading. ", "0", void, string, double, bool) },
     {"parseFile", PyWrapOpt(MachiningCode, parseFile, "parse an individual file, call before readGCode", "0", void, string, bool) },
     {"parseFolder", PyWrap(MachiningCode, parseFolder, "parse all files in a folder, call before readGCode", void, string) },
     {"clear", PyWrap(MachiningCode, clear, "Clear instructions", void) },
-    {"asGeometry", PyWrap(MachiningCode, asGeometry, "To plot the simulation of the given G Code", VRGeometryPtr) },
+    {"asGeometry", PyWrapOpt(MachiningCode, asGeometry, "To plot the simulation of the given G Code, optional time range (t0, t1), t1 < 0 for all", "0|-1", VRGeometryPtr, double, double) },
+    {"getDuration", PyWrap(MachiningCode, getDuration, "Get program duration in seconds", double) },
+    {"getPosition", PyWrap(MachiningCode, getPosition, "Get tool position at program time", Vec3d, double) },
+    {"isLoading", PyWrap(MachiningCode, isLoading, "Check if the code is still loading in the background", bool) },
+    {"waitForLoading", PyWrap(MachiningCode, waitForLoading, "Wait for background loading to finish", void) },
     {NULL}  /* Sentinel */
 };
 
@@ -12,6 +12,8 @@
 #include "core/utils/system/VRSystem.h"
 #include "core/tools/VRAnalyticGeometry.h"
 #include "core/utils/VRProfiler.h"
+#include "core/utils/VRTimer.h"
+#include "core/utils/VRThreadPool.h"
 #ifndef WITHOUT_BULLET
 #include "core/objects/geometry/VRPhysics.h"
 #endif
@@ -20,6 +22,7 @@
 #include <OpenSG/OSGGeometry.h>
 #include <OpenSG/OSGQuaternion.h>
 #include <algorithm>
+#include <cmath>
 
 using namespace OSG;
 
@@ -520,6 +523,7 @@ void MThread::updateNeighbors(vector<MPart*> parts) {
     for (auto part : parts) {
         if (!isPossibleNeighbor(part, this)) continue;
         VRPrimitive* p = part->prim;
+        if (p == 0) continue; // chain
         if (p->getType() == "Gear") {
             MRelation* rel = checkGearThread((MGear*)part, this);
             if (rel) addNeighbor(part, rel);
@@ -534,6 +538,7 @@ void VRMechanism::addCoaxialConstraint(VRTransformPtr part1, VRTransformPtr part
     auto p1 = cache[part1][0]; // TODO: how to process iv multiple parts per object?
     auto p2 = cache[part2][0];
     p1->addCoaxialNeighbor(p2);
+    graphDirty = true;
 }
 
 MObjRelation::MObjRelation() { type = "obj"; }
@@ -678,11 +683,17 @@ VRMechanism::~VRMechanism() {
 shared_ptr<VRMechanism> VRMechanism::create() { return shared_ptr<VRMechanism>(new VRMechanism()); }
 
 void VRMechanism::clear() {
+    VRLock lock(mechMtx);
     for (auto part : parts) delete part;
     for (auto motor : motors) delete motor.second;
     parts.clear();
+    chains.clear();
+    objectParts.clear();
+    subtreeParts.clear();
     cache.clear();
     motors.clear();
+    grid.clear();
+    graphDirty = true;
 }
 
 void VRMechanism::addMotor(string name, VRTransformPtr driven, float speed, int dof) {
@@ -705,10 +716,7 @@ void VRMechanism::add(VRTransformPtr part, VRTransformPtr trans) {
     if (p == 0) return;
 
     cache[part].push_back(p);
-    parts.push_back(p);
-    p->apply();
-    p->updateNeighbors(parts);
-    p->setup();
+    addPart(p);
 }
 
 void VRMechanism::addGear(VRTransformPtr part, float width, float hole, float pitch, int N_teeth, float teeth_size, float bevel, Vec3d axis, Vec3d offset) {
@@ -719,10 +727,28 @@ void VRMechanism::addGear(VRTransformPtr part, float width, float hole, float pi
     p->geo = part;
     p->trans = part;
     cache[part].push_back(p);
+    addPart(p);
+}
+
+void VRMechanism::addPart(MPart* p) {
+    VRLock lock(mechMtx); // the graph is compiled in the simulation thread
+    auto ancestry = p->trans->getAncestry();
+    vector<MPart*> related = subtreeParts[p->trans.get()];
+    for (auto a : ancestry) for (auto q : objectParts[a.get()]) related.push_back(q);
+    for (auto q : related) {
+        p->group.push_back(q);
+        q->group.push_back(p);
+    }
+    objectParts[p->trans.get()].push_back(p);
+    subtreeParts[p->trans.get()].push_back(p);
+    for (auto a : ancestry) subtreeParts[a.get()].push_back(p);
+
     parts.push_back(p);
     p->apply();
-    p->updateNeighbors(parts);
     p->setup();
+    p->updateNeighbors(getCandidates(p));
+    grid.update(p);
+    graphDirty = true;
 }
 
 void MPart::setup() {}
@@ -742,6 +768,7 @@ void MThread::setup() {
 }
 
 VRTransformPtr VRMechanism::addChain(float w, vector<VRTransformPtr> geos, string dirs) {
+    VRLock lock(mechMtx);
     MChain* c = new MChain();
     for (unsigned int i=0; i<geos.size(); i++) {
         int j = (i+1)%geos.size();
@@ -766,6 +793,8 @@ VRTransformPtr VRMechanism::addChain(float w, vector<VRTransformPtr> geos, strin
     }
     c->setDirs(dirs);
     parts.push_back(c);
+    chains.push_back(c);
+    graphDirty = true;
     return c->init();
 }
 
@@ -777,9 +806,13 @@ bool MChange::isNull() {
 MChange MPart::getChange() { return change; }
 
 void VRMechanism::updateNeighbors() {
+    VRLock lock(mechMtx);
     for (auto p : parts) p->setup(); // update rAxis
     for (auto p : parts) p->apply(); // first apply the part transformations
-    for (auto p : parts) p->updateNeighbors(parts);
+    grid.clear();
+    for (auto p : parts) grid.update(p);
+    for (auto p : parts) p->updateNeighbors(getCandidates(p));
+    graphDirty = true;
 }
 
 int VRMechanism::getNParts() { return parts.size(); }
@@ -791,6 +824,272 @@ double VRMechanism::getLastChange(VRTransformPtr part) {
     return 0;
 }
 
+Vec3d partPosition(MPart* p) {
+    Vec3d P = Vec3d(p->reference[3]);
+    if (p->type == "gear") P += ((MGear*)p)->rOffset;
+    return P;
+}
+
+double partReach(MPart* p) { // bounds the center distance to any engaging gear, see checkGearGear and checkGearThread
+    if (!p->prim || !p->geo) return 0;
+    double s = p->geo->getWorldScale()[0];
+    if (p->type == "gear") {
+        VRGear* g = (VRGear*)p->prim;
+        return (1.2*g->radius() + g->teeth_size) * s;
+    }
+    if (p->type == "thread") {
+        VRScrewThread* t = (VRScrewThread*)p->prim;
+        return (t->length + 1.2*t->radius) * s;
+    }
+    return 0;
+}
+
+void MPartGrid::clear() {
+    cells.clear();
+    entries.clear();
+    cellSize = 0;
+    maxReach = 0;
+}
+
+unsigned long long MPartGrid::getKey(int i, int j, int k) {
+    auto c = [](int x) { return (unsigned long long)(x & 0x1FFFFF); };
+    return (c(i) << 42) | (c(j) << 21) | c(k);
+}
+
+void MPartGrid::getCell(Vec3d p, int& i, int& j, int& k) {
+    i = floor(p[0]/cellSize);
+    j = floor(p[1]/cellSize);
+    k = floor(p[2]/cellSize);
+}
+
+void MPartGrid::remove(MPart* p) {
+    auto e = entries.find(p);
+    if (e == entries.end()) return;
+    auto& cell = cells[e->second.key];
+    auto it = find(cell.begin(), cell.end(), p);
+    if (it != cell.end()) { *it = cell.back(); cell.pop_back(); }
+    if (cell.empty()) cells.erase(e->second.key);
+    entries.erase(e);
+}
+
+void MPartGrid::update(MPart* p) {
+    if (!p->prim) return; // chains are checked against all parts
+    Entry e;
+    e.pos = partPosition(p);
+    e.reach = partReach(p);
+    if (cellSize <= 0) cellSize = max(2*e.reach, 1e-3);
+    maxReach = max(maxReach, e.reach);
+
+    int i, j, k;
+    getCell(e.pos, i, j, k);
+    e.key = getKey(i, j, k);
+    auto old = entries.find(p);
+    if (old != entries.end()) {
+        if (old->second.key == e.key) { old->second = e; return; }
+        remove(p);
+    }
+    entries[p] = e;
+    cells[e.key].push_back(p);
+}
+
+vector<MPart*> MPartGrid::query(MPart* p) {
+    vector<MPart*> res;
+    if (cellSize <= 0) return res;
+    Vec3d P = partPosition(p);
+    double r = partReach(p);
+
+    auto check = [&](MPart* q, Entry& e) {
+        if (q != p && (e.pos-P).length() <= r + e.reach) res.push_back(q);
+    };
+
+    double R = ceil((r + maxReach)/cellSize);
+    if (pow(2*R+1, 3) > entries.size()) { // large reach, scanning the cells is slower
+        for (auto& e : entries) check(e.first, e.second);
+        return res;
+    }
+
+    int i, j, k;
+    getCell(P, i, j, k);
+    int n = R;
+    for (int x = i-n; x <= i+n; x++) {
+        for (int y = j-n; y <= j+n; y++) {
+            for (int z = k-n; z <= k+n; z++) {
+                auto cell = cells.find(getKey(x, y, z));
+                if (cell == cells.end()) continue;
+                for (auto q : cell->second) check(q, entries[q]);
+            }
+        }
+    }
+    return res;
+}
+
+bool relationFlips(MRelation* r) {
+    if (r->type == "gear") return ((MGearGearRelation*)r)->doFlip;
+    if (r->type == "chain") return ((MChainGearRelation*)r)->dir == -1;
+    return false;
+}
+
+Vec4d relationTransfer(MRelation* r, MPart* target, bool& doMove) { // change of the target for a neighbor change (a, dx), see translateChange and move
+    double f = relationFlips(r) ? -1 : 1;
+    doMove = bool(r->type != "obj");
+    if (target->type != "gear") return Vec4d(f, 0, 0, f);
+    double R = ((MGear*)target)->gear()->radius();
+    if (!doMove) return Vec4d(f, 0, f*R, 0); // turns with the object, dx follows the angle
+    if (R <= 0) return Vec4d(0, 0, 0, f);
+    return Vec4d(0, f/R, 0, f); // rolls along, the angle follows dx
+}
+
+Vec4d mult2x2(Vec4d A, Vec4d B) {
+    return Vec4d(A[0]*B[0] + A[1]*B[2], A[0]*B[1] + A[1]*B[3],
+                 A[2]*B[0] + A[3]*B[2], A[2]*B[1] + A[3]*B[3]);
+}
+
+map<MPart*, string> relationSignature(MPart* p) {
+    map<MPart*, string> res;
+    for (auto n : p->neighbors) res[n.first] = n.second->type + (relationFlips(n.second) ? "-" : "+");
+    return res;
+}
+
+vector<MPart*> VRMechanism::getCandidates(MPart* p) { // spatial neighbors, parts on related objects and chains
+    if (!p->prim) return parts; // chains check all gears
+    vector<MPart*> res = grid.query(p);
+    res.insert(res.end(), p->group.begin(), p->group.end());
+    res.insert(res.end(), chains.begin(), chains.end());
+    sort(res.begin(), res.end());
+    res.erase(unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+void VRMechanism::updatePartNeighbors(MPart* p) { // the graph is only recompiled if the relations of p changed
+    auto signature = relationSignature(p);
+    p->updateNeighbors(getCandidates(p));
+    if (relationSignature(p) != signature) graphDirty = true;
+}
+
+void VRMechanism::compileGraph() {
+    int N = parts.size();
+    for (int i=0; i<N; i++) parts[i]->index = i;
+
+    edgesStart.assign(N+1, 0);
+    edgeTarget.clear();
+    edgeTransfer.clear();
+    edgeMoves.clear();
+    for (int i=0; i<N; i++) {
+        for (auto n : parts[i]->neighbors) {
+            int j = n.first->index;
+            if (j < 0 || j >= N || parts[j] != n.first) continue; // not in this mechanism
+            bool doMove = true;
+            edgeTransfer.push_back( relationTransfer(n.second, n.first, doMove) );
+            edgeTarget.push_back(j);
+            edgeMoves.push_back(doMove);
+        }
+        edgesStart[i+1] = edgeTarget.size();
+    }
+
+    components.assign(N, -1);
+    componentSizes.clear();
+    vector<int> queue;
+    for (int i=0; i<N; i++) {
+        if (components[i] >= 0) continue;
+        int c = componentSizes.size();
+        components[i] = c;
+        queue.assign(1, i);
+        for (size_t k=0; k<queue.size(); k++) {
+            int j = queue[k];
+            for (int e = edgesStart[j]; e < edgesStart[j+1]; e++) {
+                int t = edgeTarget[e];
+                if (components[t] >= 0) continue;
+                components[t] = c;
+                queue.push_back(t);
+            }
+        }
+        componentSizes.push_back(queue.size());
+    }
+
+    transfers.assign(N, MTransfer());
+    visited.assign(N, -1);
+    reached.assign(N, 0);
+    moveChange.assign(N, Vec2d());
+    objChange.assign(N, Vec2d());
+    graphDirty = false;
+}
+
+void VRMechanism::computeTransfer(int source) { // breadth first, each part follows the first path reaching it
+    auto& T = transfers[source];
+    T.parts.assign(1, source);
+    T.coeffs.assign(1, Vec4d(1,0,0,1));
+    T.doMove.assign(1, true);
+    visited[source] = source;
+    for (size_t k=0; k<T.parts.size(); k++) {
+        int i = T.parts[k];
+        for (int e = edgesStart[i]; e < edgesStart[i+1]; e++) {
+            int j = edgeTarget[e];
+            if (visited[j] == source) continue;
+            visited[j] = source;
+            T.parts.push_back(j);
+            T.coeffs.push_back( mult2x2(edgeTransfer[e], T.coeffs[k]) );
+            T.doMove.push_back(edgeMoves[e]);
+        }
+    }
+    T.valid = true;
+}
+
+void VRMechanism::solveComponent(vector<MPart*>& sources) { // superposes the changes of all sources, then moves each part once
+    vector<int> touched;
+    for (auto source : sources) {
+        int i = source->index;
+        if (!transfers[i].valid) computeTransfer(i);
+        auto& T = transfers[i];
+        Vec2d c(source->change.a, source->change.dx);
+        for (size_t k=1; k<T.parts.size(); k++) {
+            int j = T.parts[k];
+            Vec4d& M = T.coeffs[k];
+            Vec2d d(M[0]*c[0] + M[1]*c[1], M[2]*c[0] + M[3]*c[1]);
+            if (!reached[j]) touched.push_back(j);
+            if (T.doMove[k]) { moveChange[j] += d; reached[j] |= 2; }
+            else { objChange[j] += d; reached[j] |= 1; }
+        }
+    }
+
+    MChange origin = sources[0]->change;
+    origin.n = Vec3d();
+    auto apply = [&](MPart* part, Vec2d& d, bool doMove) {
+        part->change = origin;
+        part->change.a = d[0];
+        part->change.dx = d[1];
+        part->change.doMove = doMove;
+        part->move();
+        d = Vec2d();
+    };
+
+    for (int j : touched) {
+        if (reached[j] & 1) apply(parts[j], objChange[j], false);
+        if (reached[j] & 2) apply(parts[j], moveChange[j], true);
+        reached[j] = 0;
+    }
+}
+
+void VRMechanism::propagate() { // independent components are solved in parallel
+    if (graphDirty) compileGraph();
+
+    map<int, int> slots;
+    vector<vector<MPart*>> sources;
+    size_t work = 0;
+    for (auto part : changed_parts) {
+        if (part->getChange().isNull()) continue;
+        int c = components[part->index];
+        if (!slots.count(c)) {
+            slots[c] = sources.size();
+            sources.push_back(vector<MPart*>());
+        }
+        sources[slots[c]].push_back(part);
+        work += componentSizes[c];
+    }
+
+    if (work < 10000) { for (auto& s : sources) solveComponent(s); return; }
+    VRThreadPool::get()->run(sources.size(), [&](size_t i) { solveComponent(sources[i]); });
+}
+
 void VRMechanism::updateThread() {
     auto profiler = VRProfiler::get();
     while (doRun) {
@@ -822,14 +1121,14 @@ void VRMechanism::update(bool fromThread) {
     }
 #endif
 
+    vector<MPart*> filtered;
     if (doSG) {
         substep = 0;
         changed_parts.clear();
-        vector<MPart*> filtered;
         //for (auto& part : parts) part->change = MChange();
         for (auto& part : parts) if (part->changed()) filtered.push_back(part);
         for (auto& part : filtered) {
-            part->updateNeighbors(parts);
+            updatePartNeighbors(part);
             part->computeState();
             part->computeChange();
             if (!part->change.isNull()) changed_parts.push_back(part);
@@ -842,7 +1141,8 @@ void VRMechanism::update(bool fromThread) {
             auto mCache = cache[motor.second->driven];
             for (auto& part : mCache) {
                 part->computeState();
-                part->updateNeighbors(parts);
+                updatePartNeighbors(part);
+                filtered.push_back(part);
             }
         }
 
@@ -868,23 +1168,13 @@ void VRMechanism::update(bool fromThread) {
             }
         }
 
-        for (auto& part : changed_parts) {
-            if (part->getChange().isNull()) continue;
-            bool block = !part->propagateMovement();
-
-            if (block && 0) { // mechanism is blocked, TODO: add parameter to allow blocking or not
-                cout << "  block!" << endl;
-                for (auto part : changed_parts) {
-                    if (part->state == MPart::ENGAGED) part->setBack();
-                }
-                return;
-            }
-        }
+        propagate();
     }
 
     if (doSG) for (auto part : parts) part->updateTransform();
-    if (doSG) for (auto part : parts) if (auto c = dynamic_cast<MChain*>(part)) if (c->needsUpdate) c->updateGeo();
+    if (doSG) for (auto part : chains) if (auto c = dynamic_cast<MChain*>(part)) if (c->needsUpdate) c->updateGeo();
     if (doSG) for (auto part : parts) part->apply();
+    if (doSG) for (auto part : filtered) grid.update(part); // keep the index at the applied positions
     if (doSim) for (auto part : changed_parts) part->changed();
 }
 
@@ -1022,6 +1312,3 @@ void VRMechanism::updateVisuals() {
         //mviz->addCircle(pos1, n, r, Color3f(1,0,0));
     }
 }
-
-
-
@@ -2,6 +2,7 @@
 #define VRMECHANISM_H_INCLUDED
 
 #include <vector>
+#include <unordered_map>
 #include "core/utils/Thread.h"
 #include <OpenSG/OSGVector.h>
 #include <OpenSG/OSGMatrix.h>
@@ -105,7 +106,8 @@ class MPart {
         string type = "part";
         map<MPart*, MRelation*> neighbors;
         map<MPart*, MRelation*> forcedNeighbors;
-        vector<MPart*> group;
+        vector<MPart*> group; // parts on the same or related objects, always neighbor candidates
+        int index = -1; // in the compiled relation graph
         VRTransformPtr geo = 0;
         VRTransformPtr trans = 0;
         VRPrimitive* prim = 0;
@@ -220,13 +222,60 @@ class MMotor {
         float speed = 1.0;
 };
 
+class MPartGrid { // spatial hash over the part positions, a part reaches all parts closer than the sum of their reaches
+    private:
+        struct Entry {
+            Vec3d pos;
+            double reach = 0;
+            unsigned long long key = 0;
+        };
+
+        double cellSize = 0;
+        double maxReach = 0;
+        unordered_map<unsigned long long, vector<MPart*>> cells;
+        unordered_map<MPart*, Entry> entries;
+
+        unsigned long long getKey(int i, int j, int k);
+        void getCell(Vec3d p, int& i, int& j, int& k);
+
+    public:
+        void clear();
+        void update(MPart* p);
+        void remove(MPart* p);
+        vector<MPart*> query(MPart* p);
+};
+
+struct MTransfer { // change of every part reached from a source, linear in the (a, dx) change of the source
+    vector<int> parts; // breadth first, starting with the source
+    vector<Vec4d> coeffs; // 2x2 matrices, row major
+    vector<bool> doMove;
+    bool valid = false;
+};
+
 class VRMechanism : public VRObject {
     private:
         map<VRTransformPtr, vector<MPart*>> cache;
         vector<MPart*> parts;
         vector<MPart*> changed_parts;
+        vector<MPart*> chains;
+        map<VRObject*, vector<MPart*>> objectParts;
+        map<VRObject*, vector<MPart*>> subtreeParts; // parts on the object or below it
         map<string, MMotor*> motors;
 
+        MPartGrid grid;
+        bool graphDirty = true;
+        vector<int> edgesStart; // edges of part i are edgesStart[i] .. edgesStart[i+1]
+        vector<int> edgeTarget;
+        vector<Vec4d> edgeTransfer;
+        vector<bool> edgeMoves;
+        vector<int> components;
+        vector<int> componentSizes;
+        vector<MTransfer> transfers;
+        vector<int> visited;
+        vector<char> reached;
+        vector<Vec2d> moveChange;
+        vector<Vec2d> objChange;
+
         VRAnalyticGeometryPtr mviz;
 
         bool doRun = true;
@@ -237,6 +286,14 @@ class VRMechanism : public VRObject {
 
         void updateThread();
 
+        void addPart(MPart* p);
+        vector<MPart*> getCandidates(MPart* p);
+        void updatePartNeighbors(MPart* p);
+        void compileGraph();
+        void computeTransfer(int source);
+        void solveComponent(vector<MPart*>& sources);
+        void propagate();
+
     public:
         VRMechanism();
         ~VRMechanism();
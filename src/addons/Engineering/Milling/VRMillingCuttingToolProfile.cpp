@@ -33,6 +33,22 @@ float VRMillingCuttingToolProfile::getLength() {
     return 0;
 }
 
+float VRMillingCuttingToolProfile::getRadius(float h) {
+    if (profile.size() == 0 || h < profile[0][0] || h > profile.back()[0]) return 0;
+    for (size_t i = 1; i < profile.size(); i++) {
+        if (h > profile[i][0]) continue;
+        float dh = profile[i][0] - profile[i-1][0];
+        if (dh <= 0) return max(profile[i-1][1], profile[i][1]);
+        float t = (h - profile[i-1][0]) / dh;
+        return profile[i-1][1] * (1-t) + profile[i][1] * t;
+    }
+    return profile.back()[1];
+}
+
+float VRMillingCuttingToolProfile::getMaxRadius() {
+    return lookForMaxInList(profile);
+}
+
 float VRMillingCuttingToolProfile::maxProfile(Vec3d toolPosition, Vec3d cubePosition, Vec3d cubeSize) {
     float py = cubePosition[1];
     float sy = cubeSize[1];
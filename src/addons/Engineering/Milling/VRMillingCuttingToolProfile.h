@@ -28,6 +28,8 @@ class VRMillingCuttingToolProfile {
         void addPointProfile(Vec2d point);
         float maxProfile(Vec3d position, Vec3d cubePosition, Vec3d cubeSize);
         float getLength();
+        float getRadius(float h); // radius at height h above the tool tip
+        float getMaxRadius();
 };
 
 OSG_END_NAMESPACE;
@@ -1,6 +1,9 @@
 #include "VRMillingWorkPiece.h"
 #include "core/scene/VRScene.h"
 #include "core/math/pose.h"
+#include "core/utils/VRThreadPool.h"
+
+#include <cfloat>
 
 using namespace OSG;
 
@@ -26,6 +29,11 @@ void VRMillingWorkPiece::init(Vec3i gSize, float bSize) {
     gridSize = gSize;
     blockSize = bSize;
 
+    if (dexels) {
+        dexels->clear();
+        dexels.reset();
+    }
+
     // update the position of the workpiece
     this->getWorldPosition();
 
@@ -51,8 +59,27 @@ void VRMillingWorkPiece::init(Vec3i gSize, float bSize) {
     rootElement->build();
 }
 
+void VRMillingWorkPiece::initDexels(Vec3i gSize, float bSize, int bricks) {
+    gridSize = gSize;
+    blockSize = bSize;
+    brickSize = max(bricks, 1);
+
+    if (rootElement != nullptr) {
+        delete rootElement;
+        rootElement = nullptr;
+    }
+
+    if (dexels) dexels->clear();
+    dexels = shared_ptr<VRWorkpieceDexels>( new VRWorkpieceDexels(*this, gridSize, blockSize, brickSize) );
+    dexelsPosition = getWorldPosition();
+    hasLastToolPosition = false;
+    cycleTime = 0;
+    dexels->build();
+}
+
 void VRMillingWorkPiece::reset() {
-    init(gridSize, blockSize);
+    if (dexels) initDexels(gridSize, blockSize, brickSize);
+    else init(gridSize, blockSize);
 }
 
 void VRMillingWorkPiece::update() {
@@ -70,6 +97,13 @@ void VRMillingWorkPiece::update() {
         toolPosition = geo->getWorldPosition();
     }
 
+    if (dexels) {
+        if (!hasLastToolPosition) lastToolPosition = toolPosition;
+        cutSegment(lastToolPosition, toolPosition);
+        if (updateCount++ % geometryUpdateWait == 0) dexels->build();
+        return;
+    }
+
     if (!rootElement->collide(toolPosition)) {
         return;
     }
@@ -80,7 +114,8 @@ void VRMillingWorkPiece::update() {
 }
 
 void VRMillingWorkPiece::updateGeometry() {
-    rootElement->build();
+    if (dexels) dexels->build();
+    else if (rootElement) rootElement->build();
 }
 
 void VRMillingWorkPiece::setLevelsPerGeometry(int levels) {
@@ -95,6 +130,247 @@ void VRMillingWorkPiece::setRefreshWait(int updatesToWait) {
     }
 }
 
+void VRMillingWorkPiece::cutSegment(Vec3d p0, Vec3d p1) {
+    if (!dexels || !cuttingProfile) return;
+    dexels->cut(p0 - dexelsPosition, p1 - dexelsPosition, *cuttingProfile);
+    if (feedRate > 0) cycleTime += (p1 - p0).length() / feedRate;
+    lastToolPosition = p1;
+    hasLastToolPosition = true;
+}
+
+void VRMillingWorkPiece::setFeedRate(double f) {
+    if (f > 0) feedRate = f;
+}
+
+double VRMillingWorkPiece::getRemovedVolume() { return dexels ? dexels->getRemovedVolume() : 0; }
+double VRMillingWorkPiece::getCycleTime() { return cycleTime; }
+
+/*
+* workpiece dexel definitions
+*/
+
+VRWorkpieceDexels::VRWorkpieceDexels(VRMillingWorkPiece& workpiece, Vec3i gridSize, float blockSize, int brickSize)
+    : workpiece(workpiece), gridSize(gridSize), blockSize(blockSize), brickSize(brickSize) {
+    bricksX = (gridSize[0] + brickSize - 1) / brickSize;
+    bricksZ = (gridSize[2] + brickSize - 1) / brickSize;
+    origin = -Vec3d(gridSize) * blockSize * 0.5;
+    columns.assign(gridSize[0] * gridSize[2], vector<float>({ float(origin[1]), float(-origin[1]) }));
+    bricks.resize(bricksX * bricksZ);
+}
+
+void VRWorkpieceDexels::clear() {
+    for (auto& brick : bricks) {
+        if (brick.geometry) brick.geometry->destroy();
+        brick.geometry = 0;
+        brick.dirty = true;
+    }
+}
+
+double VRWorkpieceDexels::getRemovedVolume() { return removedVolume; }
+
+float VRWorkpieceDexels::removeInterval(vector<float>& column, float bottom, float top) {
+    if (column.size() == 0 || top <= column[0] || bottom >= column.back()) return 0;
+
+    float removed = 0;
+    vector<float> result;
+    result.reserve(column.size() + 2);
+    for (size_t n = 0; n+1 < column.size(); n += 2) {
+        float b = column[n], t = column[n+1];
+        if (t <= bottom || b >= top) {
+            result.push_back(b);
+            result.push_back(t);
+            continue;
+        }
+        removed += min(t, top) - max(b, bottom);
+        if (b < bottom) { result.push_back(b); result.push_back(bottom); }
+        if (t > top) { result.push_back(top); result.push_back(t); }
+    }
+
+    if (removed > 0) column.swap(result);
+    return removed;
+}
+
+void VRWorkpieceDexels::markDirty(int i, int k) { // bricks next to the column mesh its side faces too
+    int bi = i / brickSize, bk = k / brickSize;
+    bricks[bi + bk*bricksX].dirty = true;
+    if (i % brickSize == 0 && bi > 0) bricks[bi-1 + bk*bricksX].dirty = true;
+    if (i % brickSize == brickSize-1 && bi < bricksX-1) bricks[bi+1 + bk*bricksX].dirty = true;
+    if (k % brickSize == 0 && bk > 0) bricks[bi + (bk-1)*bricksX].dirty = true;
+    if (k % brickSize == brickSize-1 && bk < bricksZ-1) bricks[bi + (bk+1)*bricksX].dirty = true;
+}
+
+void VRWorkpieceDexels::cut(Vec3d p0, Vec3d p1, VRMillingCuttingToolProfile& profile) {
+    float R = profile.getMaxRadius();
+    float L = profile.getLength();
+    if (R <= 0 || L <= 0) return;
+
+    // height range of the tool above its tip for each radial distance bin,
+    // a column at distance d lies in bin ceil(d/R*Nbins), so the cut stays inside the tool
+    const int Nbins = 64, Nh = 256;
+    float hMin[Nbins+1], hMax[Nbins+1];
+    for (int j = 0; j <= Nbins; j++) { hMin[j] = FLT_MAX; hMax[j] = -FLT_MAX; }
+    for (int s = 0; s <= Nh; s++) {
+        float h = L * s / Nh;
+        int jMax = min(Nbins, int(profile.getRadius(h) / R * Nbins));
+        for (int j = 0; j <= jMax; j++) {
+            hMin[j] = min(hMin[j], h);
+            hMax[j] = max(hMax[j], h);
+        }
+    }
+
+    // columns touched by the swept footprint
+    auto toColumn = [&](double x, int dim) { return int(floor((x - origin[dim]) / blockSize)); };
+    int i0 = max(0, toColumn(min(p0[0], p1[0]) - R, 0));
+    int i1 = min(gridSize[0]-1, toColumn(max(p0[0], p1[0]) + R, 0));
+    int k0 = max(0, toColumn(min(p0[2], p1[2]) - R, 2));
+    int k1 = min(gridSize[2]-1, toColumn(max(p0[2], p1[2]) + R, 2));
+    if (i0 > i1 || k0 > k1) return;
+
+    int W = i1-i0+1;
+    int H = k1-k0+1;
+    lower.assign(W*H, FLT_MAX);
+    upper.assign(W*H, -FLT_MAX);
+
+    // sweep the tool along the segment in half block steps, accumulating the removed interval of each column
+    Vec3d D = p1 - p0;
+    int steps = max(1, int(ceil(D.length() / (0.5 * blockSize))));
+    float binScale = Nbins / R;
+    for (int s = 0; s <= steps; s++) {
+        Vec3d tip = p0 + D * (double(s) / steps);
+        float tipY = tip[1];
+        int a0 = max(i0, toColumn(tip[0] - R, 0));
+        int a1 = min(i1, toColumn(tip[0] + R, 0));
+        int c0 = max(k0, toColumn(tip[2] - R, 2));
+        int c1 = min(k1, toColumn(tip[2] + R, 2));
+        float x0 = origin[0] + (a0 + 0.5) * blockSize - tip[0];
+
+        for (int k = c0; k <= c1; k++) {
+            float dz = origin[2] + (k + 0.5) * blockSize - tip[2];
+            float* lo = &lower[(k-k0)*W + a0-i0];
+            float* up = &upper[(k-k0)*W + a0-i0];
+            for (int n = 0; n <= a1-a0; n++) {
+                float dx = x0 + n * blockSize;
+                int j = min(Nbins+1, int(ceil(sqrt(dx*dx + dz*dz) * binScale)));
+                if (j > Nbins || hMin[j] > hMax[j]) continue;
+                lo[n] = min(lo[n], tipY + hMin[j]);
+                up[n] = max(up[n], tipY + hMax[j]);
+            }
+        }
+    }
+
+    float area = blockSize * blockSize;
+    for (int k = k0; k <= k1; k++) {
+        for (int i = i0; i <= i1; i++) {
+            int n = (k-k0)*W + i-i0;
+            if (lower[n] >= upper[n]) continue;
+            float removed = removeInterval(columns[i + k*gridSize[0]], lower[n], upper[n]);
+            if (removed <= 0) continue;
+            removedVolume += removed * area;
+            markDirty(i, k);
+        }
+    }
+}
+
+void VRWorkpieceDexels::meshBrick(int b, Mesh& mesh) {
+    mesh.positions.clear();
+    mesh.normals.clear();
+
+    static const vector<float> noColumn;
+    auto getColumn = [&](int i, int k) -> const vector<float>& {
+        if (i < 0 || k < 0 || i >= gridSize[0] || k >= gridSize[2]) return noColumn;
+        return columns[i + k*gridSize[0]];
+    };
+
+    auto pushQuad = [&](Vec3f c, Vec3f u, Vec3f v, Vec3f n) {
+        if (u.cross(v).dot(n) < 0) swap(u, v);
+        for (auto p : { c, c+u, c+u+v, c+v }) {
+            mesh.positions.push_back(p);
+            mesh.normals.push_back(n);
+        }
+    };
+
+    const int di[4] = { 1, -1, 0, 0 };
+    const int dk[4] = { 0, 0, 1, -1 };
+    float s = blockSize;
+
+    int bi = b % bricksX, bk = b / bricksX;
+    for (int k = bk*brickSize; k < min((bk+1)*brickSize, gridSize[2]); k++) {
+        for (int i = bi*brickSize; i < min((bi+1)*brickSize, gridSize[0]); i++) {
+            auto& column = getColumn(i, k);
+            float x0 = origin[0] + i*s;
+            float z0 = origin[2] + k*s;
+
+            for (size_t n = 0; n+1 < column.size(); n += 2) {
+                float bottom = column[n], top = column[n+1];
+                pushQuad(Vec3f(x0, top, z0), Vec3f(s, 0, 0), Vec3f(0, 0, s), Vec3f(0, 1, 0));
+                pushQuad(Vec3f(x0, bottom, z0), Vec3f(s, 0, 0), Vec3f(0, 0, s), Vec3f(0, -1, 0));
+
+                for (int d = 0; d < 4; d++) { // side faces where the neighbor column does not cover [bottom, top]
+                    auto side = [&](float y0, float y1) {
+                        Vec3f u(0, y1-y0, 0);
+                        if (di[d] != 0) pushQuad(Vec3f(x0 + (di[d] > 0 ? s : 0), y0, z0), u, Vec3f(0, 0, s), Vec3f(float(di[d]), 0, 0));
+                        else pushQuad(Vec3f(x0, y0, z0 + (dk[d] > 0 ? s : 0)), u, Vec3f(s, 0, 0), Vec3f(0, 0, float(dk[d])));
+                    };
+
+                    auto& neighbor = getColumn(i+di[d], k+dk[d]);
+                    float y = bottom;
+                    for (size_t m = 0; m+1 < neighbor.size() && y < top; m += 2) {
+                        if (neighbor[m+1] <= y) continue;
+                        if (neighbor[m] >= top) break;
+                        if (neighbor[m] > y) side(y, neighbor[m]);
+                        y = max(y, neighbor[m+1]);
+                    }
+                    if (y < top) side(y, top);
+                }
+            }
+        }
+    }
+}
+
+void VRWorkpieceDexels::build() {
+    vector<int> dirty;
+    for (size_t b = 0; b < bricks.size(); b++) if (bricks[b].dirty) dirty.push_back(b);
+    if (dirty.size() == 0) return;
+
+    // the brick meshes are computed in parallel, the scene graph is only changed on this thread
+    VRThreadPool::get()->run(dirty.size(), [&](size_t n) { meshBrick(dirty[n], bricks[dirty[n]].mesh); });
+
+    for (int b : dirty) {
+        auto& brick = bricks[b];
+        auto& mesh = brick.mesh;
+        brick.dirty = false;
+
+        if (mesh.positions.size() == 0) {
+            if (brick.geometry) brick.geometry->destroy();
+            brick.geometry = 0;
+            continue;
+        }
+
+        if (brick.geometry == nullptr) {
+            brick.geometry = VRGeometry::create("wpbrick");
+            brick.geometry->setType(GL_QUADS);
+            brick.geometry->setMaterial(workpiece.getMaterial());
+            workpiece.addChild(brick.geometry);
+        }
+
+        GeoPnt3fPropertyRecPtr positions = GeoPnt3fProperty::create();
+        GeoVec3fPropertyRecPtr normals = GeoVec3fProperty::create();
+        GeoUInt32PropertyRecPtr indices = GeoUInt32Property::create();
+
+        for (size_t n = 0; n < mesh.positions.size(); n++) {
+            positions->push_back(Pnt3f(mesh.positions[n]));
+            normals->push_back(mesh.normals[n]);
+            indices->push_back(n);
+        }
+
+        brick.geometry->setPositions(positions);
+        brick.geometry->setNormals(normals);
+        brick.geometry->setIndices(indices, true);
+        brick.geometry->setPositionalTexCoords();
+        brick.mesh = Mesh();
+    }
+}
+
 /*
 * workpiece element defitions
 */
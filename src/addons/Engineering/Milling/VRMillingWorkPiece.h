@@ -69,6 +69,52 @@ public:
 
 };
 
+/*
+ * material as dexels, sorted [bottom, top] intervals along the y axis of each x/z grid column,
+ * the columns are grouped in bricks of brickSize x brickSize columns with one geometry per brick
+ */
+class VRWorkpieceDexels {
+public:
+    struct Mesh {
+        vector<Vec3f> positions;
+        vector<Vec3f> normals;
+    };
+
+    struct Brick {
+        bool dirty = true;
+        VRGeometryPtr geometry;
+        Mesh mesh;
+    };
+
+private:
+    VRMillingWorkPiece& workpiece;
+    Vec3i gridSize;
+    float blockSize;
+    int brickSize;
+    int bricksX, bricksZ;
+    Vec3d origin; // lower corner of the grid in workpiece coordinates
+    vector<vector<float>> columns; // interval bounds [bottom0, top0, bottom1, top1, ..]
+    vector<Brick> bricks;
+    vector<float> lower, upper; // per column scratch buffers of the swept volume
+    double removedVolume = 0;
+
+    float removeInterval(vector<float>& column, float bottom, float top);
+    void markDirty(int i, int k);
+    void meshBrick(int b, Mesh& mesh);
+
+public:
+    VRWorkpieceDexels(VRMillingWorkPiece& workpiece, Vec3i gridSize, float blockSize, int brickSize);
+    void clear(); // removes the brick geometries
+
+    /*
+     * subtracts the volume swept by the tool tip moving from p0 to p1,
+     * both in workpiece coordinates, the tool axis is the y axis
+     */
+    void cut(Vec3d p0, Vec3d p1, VRMillingCuttingToolProfile& profile);
+    void build(); // remeshes the dirty bricks
+    double getRemovedVolume();
+};
+
 class VRMillingWorkPiece : public VRGeometry {
     private:
         Vec3i gridSize;
@@ -82,6 +128,14 @@ class VRMillingWorkPiece : public VRGeometry {
         void update();
         VRWorkpieceElement* rootElement;
 
+        shared_ptr<VRWorkpieceDexels> dexels;
+        Vec3d dexelsPosition;
+        Vec3d lastToolPosition;
+        bool hasLastToolPosition = false;
+        double feedRate = 0.1;
+        double cycleTime = 0;
+        int brickSize = 16;
+
     public:
         float blockSize = 0.01;
         int geometryCreateLevel = 0;
@@ -92,6 +146,7 @@ class VRMillingWorkPiece : public VRGeometry {
         VRMillingWorkPiecePtr ptr();
         static VRMillingWorkPiecePtr create(string name = "millingWorkPiece");
         void init(Vec3i gSize, float bSize = 0.01);
+        void initDexels(Vec3i gSize, float bSize = 0.01, int bricks = 16);
         void reset();
 
         void setCuttingTool(VRTransformPtr geo);
@@ -101,6 +156,11 @@ class VRMillingWorkPiece : public VRGeometry {
         void setLevelsPerGeometry(int levels);  // this will take effect after the next reset
         void setRefreshWait(int updatesToWait); // this will take effect immediately
 
+        void cutSegment(Vec3d p0, Vec3d p1); // world coordinates, dexel model only
+        void setFeedRate(double f); // in units per second, used for the cycle time
+        double getRemovedVolume();
+        double getCycleTime();
+
 };
 
 OSG_END_NAMESPACE;
@@ -29,6 +29,12 @@ PyMethodDef VRPyMillingWorkPiece::methods[] = {
     "updateGeometry() - updates the geometry of the workpiece immediately." },
     {"setCuttingToolProfile", (PyCFunction)VRPyMillingWorkPiece::setCuttingToolProfile, METH_VARARGS,
     "setCuttingToolProfile() - sets the profile for the cutting tool."},
+    {"initDexels", PyWrapOpt(MillingWorkPiece, initDexels, "Init the workpiece as dexel model, material intervals along y for each x/z column,"
+        " meshed in bricks of bricksSize^2 columns - initDexels( [int] blocksPerDimension, float blockSize, int bricksSize )", "0.01|16", void, Vec3i, float, int ) },
+    {"cutSegment", PyWrap(MillingWorkPiece, cutSegment, "Subtract the volume swept by the tool moving from p0 to p1 in world coordinates, dexel model only", void, Vec3d, Vec3d ) },
+    {"setFeedRate", PyWrap(MillingWorkPiece, setFeedRate, "Set the feed rate in units per second, used for the cycle time", void, double ) },
+    {"getRemovedVolume", PyWrap(MillingWorkPiece, getRemovedVolume, "Get the removed material volume, dexel model only", double ) },
+    {"getCycleTime", PyWrap(MillingWorkPiece, getCycleTime, "Get the machining time in seconds of all cut segments", double ) },
     {NULL}  /* Sentinel */
 };
 
@@ -13,6 +13,7 @@
 
 #include <functional>
 #include <algorithm>
+#include <set>
 
 using namespace OSG;
 
@@ -455,6 +456,7 @@ void VRLADEngine::read(string tagTablePath, string modulesPath) {
         auto vars = esystem->getLADVariables();
         setupCompileUnits(vars);
 	}
+	program = 0; // compiled again on next iteration
 }
 
 VRLADEngine::CompileUnitPtr VRLADEngine::getCompileUnit(string name) {
@@ -465,6 +467,11 @@ VRLADEngine::CompileUnitPtr VRLADEngine::getCompileUnit(string name) {
 	return compileUnits[name];
 }
 
+void VRLADEngine::addCompileUnit(CompileUnitPtr cu) {
+	compileUnits[cu->ID] = cu;
+	program = 0; // compiled again on next iteration
+}
+
 void VRLADEngine::CompileUnit::setVariable(string var, string val) {
     if (!variables.count(var)) {
         cout << "WARNING in VRLADEngine::CompileUnit::setVariable, no variable found called " << var << endl;
@@ -475,7 +482,7 @@ void VRLADEngine::CompileUnit::setVariable(string var, string val) {
 	else cout << "WARNING in VRLADEngine::CompileUnit::setVariable, variable " << var << " is null" << endl;
 }
 
-void VRLADEngine::iterate() { // TODO: once the import is finished tackle this
+vector<VRLADEngine::ComponentPtr> VRLADEngine::CompileUnit::getEvalStack() {
 	auto getOutParts = [](WirePtr wire) {
 		vector<PartPtr> res;
 		for (auto ID : wire->outputs ) {
@@ -492,31 +499,14 @@ void VRLADEngine::iterate() { // TODO: once the import is finished tackle this
 		return res;
 	};
 
-	auto getPowerWires = [](CompileUnitPtr cu) {
+	auto getPowerWires = [&]() {
 		vector<WirePtr> res;
-		for (auto wireID : cu->poweredWireIDs) {
-            if (cu->wires.count(wireID)) res.push_back( cu->wires[wireID] );
+		for (auto wireID : poweredWireIDs) {
+            if (wires.count(wireID)) res.push_back( wires[wireID] );
 		}
 		return res;
 	};
 
-	auto printStack = [](vector<ComponentPtr> stack) {
-	    cout << "   stack size: " << stack.size() << endl;
-	    for (auto c : stack) {
-            auto w = dynamic_pointer_cast<Wire>(c);
-            auto p = dynamic_pointer_cast<Part>(c);
-            cout << "    (" << c->name << ", " << c->ID << ", " << c->lastComputationResult << ", cu: " << c->cu->ID << ")";
-            if (w) cout << ", wire: " << w->operand << ", " << w->accessID;
-            if (p) {
-                cout << ", part - operands: ";
-                for (auto o : p->operands) cout << ", " << o << " check wire: " << p->cu->wires.count(o);
-                cout << ", variables: ";
-                for (auto v : p->getVariables()) cout << ", (" << v.first->getName() << ", " << v.second << ") ";
-            }
-            cout << endl;
-	    }
-	};
-
 	auto getNextParts = [&](vector<WirePtr> wires) {
 		vector<PartPtr> res;
 		for (auto wire : wires) {
@@ -553,19 +543,37 @@ void VRLADEngine::iterate() { // TODO: once the import is finished tackle this
 		return stack3;
 	};
 
-	auto getCompileUnitEvalStack = [&](CompileUnitPtr cu) {
-		auto nextWires = getPowerWires(cu);
-		vector<ComponentPtr> stack;
-        for (auto w : nextWires) stack.push_back(w);
+	auto nextWires = getPowerWires();
+	vector<ComponentPtr> stack;
+	for (auto w : nextWires) stack.push_back(w);
 
-		while (nextWires.size()) {
-			auto nextParts = getNextParts(nextWires);
-			nextWires = getNextWires(nextParts);
-			for (auto p : nextParts) stack.push_back(p);
-			for (auto w : nextWires) stack.push_back(w);
-		}
+	size_t depth = 0; // feedback loops would never run out of wires
+	while (nextWires.size() && depth++ <= parts.size()) {
+		auto nextParts = getNextParts(nextWires);
+		nextWires = getNextWires(nextParts);
+		for (auto p : nextParts) stack.push_back(p);
+		for (auto w : nextWires) stack.push_back(w);
+	}
 
-		return cleanStack(stack);
+	return cleanStack(stack);
+}
+
+void VRLADEngine::interpret() { // reference interpreter, walks the components of each compile unit
+	auto printStack = [](vector<ComponentPtr> stack) {
+	    cout << "   stack size: " << stack.size() << endl;
+	    for (auto c : stack) {
+            auto w = dynamic_pointer_cast<Wire>(c);
+            auto p = dynamic_pointer_cast<Part>(c);
+            cout << "    (" << c->name << ", " << c->ID << ", " << c->lastComputationResult << ", cu: " << c->cu->ID << ")";
+            if (w) cout << ", wire: " << w->operand << ", " << w->accessID;
+            if (p) {
+                cout << ", part - operands: ";
+                for (auto o : p->operands) cout << ", " << o << " check wire: " << p->cu->wires.count(o);
+                cout << ", variables: ";
+                for (auto v : p->getVariables()) cout << ", (" << v.first->getName() << ", " << v.second << ") ";
+            }
+            cout << endl;
+	    }
 	};
 
 	auto computeWire = [](WirePtr wire) {
@@ -606,11 +614,12 @@ void VRLADEngine::iterate() { // TODO: once the import is finished tackle this
 	};
 
 	bool doContinue = true;
+	int passes = 0;
 
-	while (doContinue) {
+	while (doContinue && passes++ < maxPasses) {
 		doContinue = false;
 		for (auto cu : compileUnits) {
-			auto stack = getCompileUnitEvalStack(cu.second); // only once
+			auto stack = cu.second->getEvalStack(); // only once
 			vector<int> state1;
 			vector<int> state2;
 
@@ -646,6 +655,267 @@ void VRLADEngine::iterate() { // TODO: once the import is finished tackle this
 	//LADvizUpdate();
 }
 
+void VRLADEngine::compile() {
+    program = ProgramPtr( new Program() );
+    auto& P = *program;
+    map<Component*, int> signalSlots;
+    map<VRLADVariable*, int> variableSlots;
+    map<string, int> constantSlots; // constants are new temporary variables on each lookup, their addresses are reused
+
+    auto getSignal = [&](ComponentPtr c) {
+        if (!signalSlots.count(c.get())) {
+            signalSlots[c.get()] = P.signals.size();
+            P.signals.push_back(c->lastComputationResult);
+            P.components.push_back(c);
+        }
+        return signalSlots[c.get()];
+    };
+
+    auto addSlot = [&](VRLADVariablePtr v, bool constant) {
+        P.variables.push_back(constant ? 0 : v);
+        P.texts.push_back(v->value);
+        P.values.push_back(toFloat(v->value));
+        P.startTexts.push_back(v->startValue);
+        P.startValues.push_back(toFloat(v->startValue));
+        return int(P.values.size()-1);
+    };
+
+    auto getVariable = [&](VRLADVariablePtr v, bool constant) {
+        if (constant) {
+            if (!constantSlots.count(v->value)) constantSlots[v->value] = addSlot(v, true);
+            return constantSlots[v->value];
+        }
+        if (!variableSlots.count(v.get())) variableSlots[v.get()] = addSlot(v, false);
+        return variableSlots[v.get()];
+    };
+
+    for (auto& cu : compileUnits) {
+        for (auto c : cu.second->getEvalStack()) {
+            Program::Instruction I;
+            I.signal = getSignal(c);
+            I.argsBegin = P.args.size();
+
+            auto wire = dynamic_pointer_cast<Wire>(c);
+            if (wire) {
+                I.op = wire->powerrail ? Program::POWERRAIL : Program::WIRE;
+                if (!wire->powerrail) {
+                    for (auto ID : wire->inputs) if (wire->cu->parts.count(ID)) P.args.push_back( getSignal(wire->cu->parts[ID]) );
+                }
+            }
+
+            auto part = dynamic_pointer_cast<Part>(c);
+            if (part) {
+                for (auto ID : part->inputs) if (part->cu->wires.count(ID)) P.args.push_back( getSignal(part->cu->wires[ID]) );
+
+                // constants are temporary variables in the interpreter, writing to them has no effect
+                auto vars = part->getVariables();
+                auto& cuVars = part->cu->variables;
+                auto slot = [&](VRLADVariablePtr v) {
+                    bool constant = !cuVars.count(v->name) || cuVars[v->name] != v;
+                    return getVariable(v, constant);
+                };
+                auto target = [&](VRLADVariablePtr v) {
+                    int i = slot(v);
+                    return P.variables[i] ? i : -1;
+                };
+
+                vector<VRLADVariablePtr> inputs;
+                vector<VRLADVariablePtr> outputs;
+                for (auto v : vars) (v.second ? inputs : outputs).push_back(v.first);
+
+                if (part->isOperand() && vars.size()) {
+                    auto v = vars.back().first;
+                    I.variable = slot(v);
+                    I.negated = part->negated;
+                    if (part->name == "Coil") { I.op = Program::COIL; I.out = target(v); }
+                    else if (part->name == "RCoil") { I.op = Program::RCOIL; I.out = target(v); }
+                    else if (part->name == "Ge") {
+                        I.op = Program::GE;
+                        if (vars.size() >= 2) { I.in1 = slot(vars[0].first); I.in2 = slot(vars[1].first); }
+                    }
+                    else if (part->name == "Contact" || part->name == "PContact") I.op = Program::CONTACT;
+                    else I.op = Program::LT;
+                } else if (part->isBlock()) {
+                    I.op = (part->name == "Calc") ? Program::CALC : Program::MOVE;
+                    if (inputs.size() >= 1) I.in1 = slot(inputs[0]);
+                    if (inputs.size() >= 2) I.in2 = slot(inputs[1]);
+                    if (outputs.size() >= 1) I.out = target(outputs[0]);
+                    bool valid = (I.op == Program::CALC ? inputs.size() >= 2 : inputs.size() >= 1) && outputs.size() >= 1;
+                    if (!valid) I.in1 = -1;
+                } else I.op = Program::PART;
+            }
+
+            I.argsEnd = P.args.size();
+            P.instructions.push_back(I);
+        }
+    }
+}
+
+void VRLADEngine::Program::load() { // picks up signals and variables changed outside of the program
+    for (size_t i = 0; i < components.size(); i++) signals[i] = components[i]->lastComputationResult;
+    for (size_t i = 0; i < variables.size(); i++) {
+        if (!variables[i] || variables[i]->value == texts[i]) continue;
+        texts[i] = variables[i]->value;
+        values[i] = toFloat(texts[i]);
+    }
+}
+
+bool VRLADEngine::Program::execute() {
+    bool changed = false;
+    for (auto& I : instructions) {
+        int s = 0;
+        for (int a = I.argsBegin; a < I.argsEnd; a++) s = max(s, signals[args[a]]);
+
+        switch (I.op) {
+            case POWERRAIL: s = 1; break;
+            case WIRE: break;
+            case PART: break;
+            case COIL: // writes to variable, formatted like the interpreter
+                if (I.out >= 0 && (values[I.out] != s || texts[I.out].size() != 1)) { // else the text is that digit already
+                    values[I.out] = s;
+                    texts[I.out] = ::toString(s);
+                }
+                s = 0;
+                break;
+            case RCOIL:
+                if (I.out >= 0) {
+                    values[I.out] = startValues[I.out];
+                    texts[I.out] = startTexts[I.out];
+                }
+                s = 0;
+                break;
+            case CONTACT:
+                if (s == 0) break;
+                {
+                    int var = values[I.variable];
+                    if (I.negated && var == 0) break;
+                    if (I.negated && var == 1) s = 0;
+                    else s = var*s;
+                }
+                break;
+            case GE:
+                if (s == 0) break;
+                s = (I.in2 >= 0 && values[I.in1] >= values[I.in2]);
+                break;
+            case LT: s = 0; break;
+            case CALC: // hard coded test, see Part::computeBlockOutput
+                if (s == 0) break;
+                if (I.in1 < 0) { s = 0; break; }
+                if (I.out >= 0) {
+                    values[I.out] = values[I.in1] * values[I.in2];
+                    texts[I.out] = ::toString(values[I.out]);
+                }
+                s = 1;
+                break;
+            case MOVE:
+                if (s == 0) break;
+                if (I.in1 < 0) { s = 0; break; }
+                if (I.out >= 0) { // copies the text, non numeric values like 16#FF or T#5s stay as they are
+                    values[I.out] = values[I.in1];
+                    texts[I.out] = texts[I.in1];
+                }
+                s = 1;
+                break;
+        }
+
+        if (signals[I.signal] != s) {
+            signals[I.signal] = s;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void VRLADEngine::Program::store() {
+    for (size_t i = 0; i < components.size(); i++) components[i]->lastComputationResult = signals[i];
+    for (size_t i = 0; i < variables.size(); i++) {
+        if (variables[i] && variables[i]->value != texts[i]) variables[i]->value = texts[i];
+    }
+}
+
+void VRLADEngine::setCompiled(bool b) { useCompiled = b; }
+
+void VRLADEngine::iterate(int cycles) {
+    if (!useCompiled) {
+        for (int i=0; i<cycles; i++) interpret();
+        return;
+    }
+
+    if (!program) compile();
+    program->load();
+    for (int i=0; i<cycles; i++) {
+        for (int pass = 0; pass < maxPasses; pass++) { // until the signals are stable
+            if (!program->execute()) break;
+        }
+    }
+    program->store();
+}
+
+bool VRLADEngine::verify(int cycles) { // runs the interpreter and then the compiled program from the same state, compared after each cycle
+    vector<ComponentPtr> components;
+    vector<VRLADVariablePtr> variables;
+    set<VRLADVariable*> known;
+    for (auto& cu : compileUnits) {
+        for (auto& w : cu.second->wires) components.push_back(w.second);
+        for (auto& p : cu.second->parts) components.push_back(p.second);
+        for (auto& v : cu.second->variables) {
+            if (!v.second || known.count(v.second.get())) continue;
+            known.insert(v.second.get());
+            variables.push_back(v.second);
+        }
+    }
+
+    struct State {
+        vector<int> signals;
+        vector<string> values;
+    };
+
+    auto getState = [&]() {
+        State s;
+        for (auto& c : components) s.signals.push_back(c->lastComputationResult);
+        for (auto& v : variables) s.values.push_back(v->value);
+        return s;
+    };
+
+    auto setState = [&](const State& s) {
+        for (size_t i = 0; i < components.size(); i++) components[i]->lastComputationResult = s.signals[i];
+        for (size_t i = 0; i < variables.size(); i++) variables[i]->value = s.values[i];
+    };
+
+    bool compiled = useCompiled;
+    State start = getState();
+    vector<State> reference;
+    useCompiled = false;
+    for (int i=0; i<cycles; i++) {
+        iterate();
+        reference.push_back(getState());
+    }
+
+    setState(start);
+    useCompiled = true;
+    program = 0;
+    bool equivalent = true;
+    for (int i=0; i<cycles && equivalent; i++) {
+        iterate();
+        auto s = getState();
+        for (size_t j = 0; j < components.size() && equivalent; j++) {
+            if (s.signals[j] == reference[i].signals[j]) continue;
+            cout << "VRLADEngine::verify, cycle " << i << ", " << components[j]->cu->ID << " " << components[j]->ID
+                 << " signal " << s.signals[j] << " but interpreted " << reference[i].signals[j] << endl;
+            equivalent = false;
+        }
+        for (size_t j = 0; j < variables.size() && equivalent; j++) {
+            if (s.values[j] == reference[i].values[j]) continue;
+            cout << "VRLADEngine::verify, cycle " << i << ", variable " << variables[j]->getName()
+                 << " is '" << s.values[j] << "' but interpreted '" << reference[i].values[j] << "'" << endl;
+            equivalent = false;
+        }
+    }
+
+    useCompiled = compiled;
+    return equivalent;
+}
+
 VRTransformPtr VRLADEngine::addVisual() {
     if (ladViz) return ladViz;
 
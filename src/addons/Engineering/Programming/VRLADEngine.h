@@ -19,6 +19,7 @@ class VRLADEngine : public std::enable_shared_from_this<VRLADEngine> {
         class Wire;
         class Access;
         class Part;
+        class Program;
         typedef shared_ptr<CompileUnit> CompileUnitPtr;
         typedef shared_ptr<Component> ComponentPtr;
         typedef shared_ptr<Wire> WirePtr;
@@ -102,12 +103,55 @@ class VRLADEngine : public std::enable_shared_from_this<VRLADEngine> {
                 string toString();
 
                 void setVariable(string var, string val);
+                vector<ComponentPtr> getEvalStack();
         };
 
+        /*
+         * compile units lowered to a flat instruction list in evaluation order,
+         * signals and variables are indexed slots, variables are parsed on load,
+         * the value strings are kept next to the numbers so that moved values like 16#FF or T#5s are written back unchanged
+         */
+        class Program {
+            public:
+                enum OpCode { POWERRAIL, WIRE, PART, CONTACT, COIL, RCOIL, GE, LT, CALC, MOVE };
+
+                struct Instruction {
+                    OpCode op = PART;
+                    bool negated = false;
+                    int signal = 0; // result slot
+                    int argsBegin = 0; // input signal slots are args[argsBegin] to args[argsEnd-1]
+                    int argsEnd = 0;
+                    int variable = -1; // variable of operands
+                    int in1 = -1; // first and second input variable of blocks and Ge
+                    int in2 = -1;
+                    int out = -1; // output variable of blocks
+                };
+
+                vector<Instruction> instructions;
+                vector<int> args;
+                vector<int> signals;
+                vector<ComponentPtr> components; // per signal slot
+
+                vector<VRLADVariablePtr> variables; // per variable slot, null for constants
+                vector<string> texts; // current value strings, written back on store
+                vector<float> values;
+                vector<string> startTexts;
+                vector<float> startValues;
+
+            public:
+                void load();
+                bool execute(); // one pass over all compile units, true if any signal changed
+                void store();
+        };
+        typedef shared_ptr<Program> ProgramPtr;
+
 
 	private:
 		map<string, CompileUnitPtr> compileUnits;
 		CompileUnitPtr unit2E;
+		ProgramPtr program;
+		bool useCompiled = true;
+		int maxPasses = 1000;
 
 		VRElectricSystemPtr esystem;
 		VRTransformPtr ladViz;
@@ -121,10 +165,15 @@ class VRLADEngine : public std::enable_shared_from_this<VRLADEngine> {
 
 		void setElectricEngine(VRElectricSystemPtr esystem);
 		void read(string tagTablePath, string modulesPath);
-		void iterate();
+		void compile();
+		void interpret();
+		void iterate(int cycles = 1);
+		void setCompiled(bool b);
+		bool verify(int cycles = 10);
 
 		vector<string> getCompileUnits();
 		CompileUnitPtr getCompileUnit(string cuID);
+		void addCompileUnit(CompileUnitPtr cu);
 		vector<string> getCompileUnitWires(string cuID, bool powered = false);
 		vector<string> getCompileUnitParts(string cuID);
 		vector<string> getCompileUnitVariables(string cuID);
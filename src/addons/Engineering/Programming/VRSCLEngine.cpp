@@ -1,4 +1,7 @@
 #include "VRSCLEngine.h"
+#include "VRSCLProgram.h"
+#include "VRLADEngine.h"
+#include "core/utils/toString.h"
 #include "core/utils/system/VRSystem.h"
 
 using namespace OSG;
@@ -11,15 +14,26 @@ VRSCLScriptPtr VRSCLScript::ptr() { return static_pointer_cast<VRSCLScript>(shar
 
 string VRSCLScript::getScl() { return scl; }
 string VRSCLScript::getPython() { return python; }
+VRSCLProgramPtr VRSCLScript::getProgram() { return program; }
+string VRSCLScript::getBytecode() { return program ? program->getBytecode() : ""; }
+
+void VRSCLScript::setSCL(string s) { scl = s; }
+void VRSCLScript::setElectricSystem(VRElectricSystemPtr e) { esystem = e; }
 
 void VRSCLScript::readSCL(string path) {
     scl = readFileContent(path, false);
 }
 
-void VRSCLScript::convert() {
-    ;
+void VRSCLScript::convert() { // compiles to bytecode, global tags are bound to the electric system variables
+    program = VRSCLProgram::create();
+    if (!program->parse(scl) || !program->compile(esystem)) program = 0;
 }
 
+void VRSCLScript::run() { if (program) program->run(); }
+
+double VRSCLScript::getValue(string var) { return program ? program->getValue(var) : 0; }
+void VRSCLScript::setValue(string var, double value) { if (program) program->setValue(var, value); }
+
 
 
 
@@ -29,17 +43,38 @@ VRSCLEngine::~VRSCLEngine() {}
 VRSCLEnginePtr VRSCLEngine::create() { return VRSCLEnginePtr( new VRSCLEngine() ); }
 VRSCLEnginePtr VRSCLEngine::ptr() { return static_pointer_cast<VRSCLEngine>(shared_from_this()); }
 
-void VRSCLEngine::setElectricEngine(VRElectricSystemPtr e) { elSystem = e; }
+void VRSCLEngine::setLADEngine(VRLADEnginePtr lad) { ladEngine = lad; }
 VRSCLScriptPtr VRSCLEngine::getScript(string name) { return scripts.count(name) ? scripts[name] : 0; }
 
-VRSCLScriptPtr VRSCLEngine::readSCL(string name, string path) { // TODO
+void VRSCLEngine::setElectricEngine(VRElectricSystemPtr e) {
+    elSystem = e;
+    for (auto& s : scripts) { // rebind
+        s.second->setElectricSystem(e);
+        s.second->convert();
+    }
+}
+
+VRSCLScriptPtr VRSCLEngine::readSCL(string name, string path) {
     auto script = VRSCLScript::create();
     script->readSCL(path);
+    script->setElectricSystem(elSystem);
+    script->convert();
+    scripts[name] = script;
+    return script;
+}
+
+VRSCLScriptPtr VRSCLEngine::addSCL(string name, string scl) {
+    auto script = VRSCLScript::create();
+    script->setSCL(scl);
+    script->setElectricSystem(elSystem);
     script->convert();
     scripts[name] = script;
     return script;
 }
 
-void VRSCLEngine::iterate() { // TODO
-    ;
+void VRSCLEngine::iterate(int cycles) { // one PLC scan per cycle, LAD rungs first, then the SCL blocks
+    for (int i=0; i<cycles; i++) {
+        if (ladEngine) ladEngine->iterate();
+        for (auto& s : scripts) s.second->run();
+    }
 }
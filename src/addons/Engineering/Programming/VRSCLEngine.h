@@ -16,6 +16,8 @@ class VRSCLScript : public std::enable_shared_from_this<VRSCLScript> {
     private:
         string scl;
         string python;
+        VRSCLProgramPtr program;
+        VRElectricSystemPtr esystem;
 
     public:
 		VRSCLScript();
@@ -25,15 +27,24 @@ class VRSCLScript : public std::enable_shared_from_this<VRSCLScript> {
 		VRSCLScriptPtr ptr();
 
 		void readSCL(string path);
+		void setSCL(string scl);
+		void setElectricSystem(VRElectricSystemPtr esystem);
 		void convert();
+		void run();
+
+		double getValue(string var);
+		void setValue(string var, double value);
 
 		string getScl();
 		string getPython();
+		string getBytecode();
+		VRSCLProgramPtr getProgram();
 };
 
 class VRSCLEngine : public std::enable_shared_from_this<VRSCLEngine> {
 	private:
 		VRElectricSystemPtr elSystem;
+		VRLADEnginePtr ladEngine;
 		//VRPythonEnginePtr pyEngine; // TODO: wrap scriptmanager py engine
 
 		map<string, VRSCLScriptPtr> scripts;
@@ -46,10 +57,12 @@ class VRSCLEngine : public std::enable_shared_from_this<VRSCLEngine> {
 		VRSCLEnginePtr ptr();
 
 		void setElectricEngine(VRElectricSystemPtr esystem);
+		void setLADEngine(VRLADEnginePtr lad);
 		VRSCLScriptPtr readSCL(string name, string path);
+		VRSCLScriptPtr addSCL(string name, string scl);
 		VRSCLScriptPtr getScript(string name);
 
-		void iterate();
+		void iterate(int cycles = 1);
 };
 
 OSG_END_NAMESPACE;
@@ -0,0 +1,1192 @@
+#include "VRSCLProgram.h"
+#include "VRLADVariable.h"
+
+#include "../Wiring/VRElectricSystem.h"
+
+#include "core/utils/toString.h"
+#include "core/utils/system/VRSystem.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+
+using namespace OSG;
+
+namespace {
+    typedef VRSCLProgram::Node Node;
+    typedef VRSCLProgram::NodePtr NodePtr;
+
+    enum TokenType { T_END, T_IDENT, T_LOCAL, T_GLOBAL, T_NUMBER, T_STRING, T_OP };
+
+    struct Token {
+        TokenType type = T_END;
+        string text; // upper case for identifiers and locals
+        string raw;
+        double value = 0;
+        VRSCLProgram::DataType dataType = VRSCLProgram::INT;
+    };
+
+    string upper(string s) {
+        for (auto& c : s) c = toupper(c);
+        return s;
+    }
+
+    bool isWordChar(char c) { return isalnum((unsigned char)c) || c == '_'; }
+
+    const map<string, VRSCLProgram::DataType>& typeTable() {
+        static map<string, VRSCLProgram::DataType> types = {
+            {"BOOL", VRSCLProgram::BOOL}, {"BYTE", VRSCLProgram::BYTE}, {"USINT", VRSCLProgram::BYTE},
+            {"WORD", VRSCLProgram::WORD}, {"UINT", VRSCLProgram::WORD}, {"DWORD", VRSCLProgram::DWORD}, {"UDINT", VRSCLProgram::DWORD},
+            {"SINT", VRSCLProgram::SINT}, {"INT", VRSCLProgram::INT}, {"DINT", VRSCLProgram::DINT},
+            {"REAL", VRSCLProgram::REAL}, {"LREAL", VRSCLProgram::REAL}, {"TIME", VRSCLProgram::TIME}
+        };
+        return types;
+    }
+
+    const map<string, string>& timerTable() {
+        static map<string, string> timers = {
+            {"TON", "TON"}, {"TON_TIME", "TON"}, {"TOF", "TOF"}, {"TOF_TIME", "TOF"}, {"TP", "TP"}, {"TP_TIME", "TP"}
+        };
+        return timers;
+    }
+
+    double parseDuration(const string& s, size_t& i) { // T#1h2m3s4ms, in ms
+        static map<string, double> units = { {"D", 86400000}, {"H", 3600000}, {"M", 60000}, {"S", 1000}, {"MS", 1}, {"US", 0.001}, {"NS", 0.000001} };
+        double sign = 1, res = 0;
+        if (i < s.size() && s[i] == '-') { sign = -1; i++; }
+        while (i < s.size() && (isdigit((unsigned char)s[i]) || s[i] == '_')) {
+            string number;
+            while (i < s.size() && (isdigit((unsigned char)s[i]) || s[i] == '.' || s[i] == '_')) { if (s[i] != '_') number += s[i]; i++; }
+            string unit;
+            while (i < s.size() && isalpha((unsigned char)s[i])) unit += toupper(s[i++]);
+            if (i < s.size() && s[i] == '_') i++;
+            res += atof(number.c_str()) * (units.count(unit) ? units[unit] : 1);
+        }
+        return sign * res;
+    }
+
+    vector<Token> tokenize(const string& s) {
+        vector<Token> tokens;
+        size_t i = 0, N = s.size();
+
+        auto push = [&](TokenType type, string raw) {
+            Token t;
+            t.type = type;
+            t.raw = raw;
+            t.text = type == T_GLOBAL || type == T_STRING ? raw : upper(raw);
+            tokens.push_back(t);
+        };
+
+        auto pushNumber = [&](double v, VRSCLProgram::DataType type) {
+            Token t;
+            t.type = T_NUMBER;
+            t.value = v;
+            t.dataType = type;
+            tokens.push_back(t);
+        };
+
+        auto readQuoted = [&](char q) {
+            size_t e = s.find(q, i+1);
+            if (e == string::npos) e = N;
+            string res = s.substr(i+1, e-i-1);
+            i = min(e+1, N);
+            return res;
+        };
+
+        while (i < N) {
+            char c = s[i];
+            char n = i+1 < N ? s[i+1] : 0;
+            if (isspace((unsigned char)c)) { i++; continue; }
+            if (c == '/' && n == '/') { while (i < N && s[i] != '\n') i++; continue; }
+            if (c == '(' && n == '*') { size_t e = s.find("*)", i+2); i = e == string::npos ? N : e+2; continue; }
+            if (c == '{') { size_t e = s.find('}', i); i = e == string::npos ? N : e+1; continue; } // pragmas and attributes
+            if (c == '"') { push(T_GLOBAL, readQuoted('"')); continue; }
+            if (c == '\'') { push(T_STRING, readQuoted('\'')); continue; }
+
+            if (c == '#') {
+                i++;
+                if (i < N && s[i] == '"') { push(T_LOCAL, readQuoted('"')); continue; }
+                size_t b = i;
+                while (i < N && isWordChar(s[i])) i++;
+                push(T_LOCAL, s.substr(b, i-b));
+                continue;
+            }
+
+            if (isalpha((unsigned char)c) || c == '_') {
+                size_t b = i;
+                while (i < N && isWordChar(s[i])) i++;
+                string word = s.substr(b, i-b);
+                if (i < N && s[i] == '#') { // typed literals like T#2s or INT#5
+                    string prefix = upper(word);
+                    i++;
+                    if (prefix == "T" || prefix == "TIME") pushNumber(parseDuration(s, i), VRSCLProgram::TIME);
+                    continue; // other type prefixes are dropped, the literal follows
+                }
+                push(T_IDENT, word);
+                continue;
+            }
+
+            if (isdigit((unsigned char)c)) {
+                string number;
+                bool real = false;
+                while (i < N && (isdigit((unsigned char)s[i]) || s[i] == '_')) { if (s[i] != '_') number += s[i]; i++; }
+                if (i < N && s[i] == '#') { // 16#FF, 2#1010, 8#17
+                    int radix = atoi(number.c_str());
+                    i++;
+                    string digits;
+                    while (i < N && (isxdigit((unsigned char)s[i]) || s[i] == '_')) { if (s[i] != '_') digits += s[i]; i++; }
+                    pushNumber(strtoll(digits.c_str(), 0, radix), VRSCLProgram::DINT);
+                    continue;
+                }
+                if (i+1 < N && s[i] == '.' && isdigit((unsigned char)s[i+1])) {
+                    real = true;
+                    number += s[i++];
+                    while (i < N && (isdigit((unsigned char)s[i]) || s[i] == '_')) { if (s[i] != '_') number += s[i]; i++; }
+                }
+                if (i < N && (s[i] == 'e' || s[i] == 'E')) {
+                    size_t e = i+1;
+                    if (e < N && (s[e] == '+' || s[e] == '-')) e++;
+                    if (e < N && isdigit((unsigned char)s[e])) {
+                        real = true;
+                        number += s.substr(i, e-i);
+                        i = e;
+                        while (i < N && isdigit((unsigned char)s[i])) number += s[i++];
+                    }
+                }
+                pushNumber(atof(number.c_str()), real ? VRSCLProgram::REAL : VRSCLProgram::INT);
+                continue;
+            }
+
+            static const vector<string> ops2 = { ":=", "=>", "<=", ">=", "<>", "**", ".." };
+            string op(1, c);
+            for (auto& o : ops2) if (s.compare(i, 2, o) == 0) op = o;
+            i += op.size();
+            push(T_OP, op);
+        }
+
+        tokens.push_back(Token());
+        return tokens;
+    }
+
+    NodePtr node(string kind, string text = "") {
+        auto n = NodePtr( new Node() );
+        n->kind = kind;
+        n->text = text;
+        return n;
+    }
+
+    NodePtr node(string kind, string text, NodePtr a, NodePtr b = 0) {
+        auto n = node(kind, text);
+        n->children.push_back(a);
+        if (b) n->children.push_back(b);
+        return n;
+    }
+
+    struct Parser {
+        vector<Token> tokens;
+        size_t pos = 0;
+        bool ok = true;
+
+        const Token& peek(int o = 0) { return tokens[min(pos+o, tokens.size()-1)]; }
+        bool atEnd() { return peek().type == T_END; }
+        bool isOp(string o, int k = 0) { return peek(k).type == T_OP && peek(k).text == o; }
+        bool isKeyword(string k, int o = 0) { return peek(o).type == T_IDENT && peek(o).text == k; }
+
+        void error(string msg) {
+            if (ok) cout << "VRSCLProgram::parse, " << msg << " at token " << pos << " '" << peek().raw << "'" << endl;
+            ok = false;
+            pos = tokens.size()-1;
+        }
+
+        void expectOp(string o) { if (isOp(o)) pos++; else error("expected '"+o+"'"); }
+        void expectKeyword(string k) { if (isKeyword(k)) pos++; else error("expected "+k); }
+
+        bool isStatementEnd(const vector<string>& stops) {
+            if (atEnd()) return true;
+            for (auto& s : stops) if (isKeyword(s)) return true;
+            return false;
+        }
+
+        bool isCaseLabel() {
+            int k = isOp("-") ? 1 : 0;
+            auto t = peek(k).type;
+            if (t != T_NUMBER && t != T_IDENT && t != T_LOCAL && t != T_GLOBAL) return false;
+            return isOp(":", k+1) || isOp(",", k+1) || isOp("..", k+1);
+        }
+
+        NodePtr variable() {
+            auto t = peek();
+            if (t.type != T_LOCAL && t.type != T_GLOBAL && t.type != T_IDENT) { error("expected variable"); return node("num"); }
+            pos++;
+            auto v = node("var", t.type == T_GLOBAL ? t.raw : t.text);
+            v->value = t.type == T_LOCAL ? 0 : t.type == T_GLOBAL ? 1 : 2;
+            if (t.type == T_IDENT) v->text = t.raw;
+            while (isOp(".") && peek(1).type != T_OP && peek(1).type != T_END) { // structure members
+                pos++;
+                v->text += "." + (v->value == 0 ? peek().text : peek().raw);
+                pos++;
+            }
+            if (isOp("[") || isOp(".")) error("arrays and bit access are not supported");
+            return v;
+        }
+
+        NodePtr primary() {
+            auto t = peek();
+            if (t.type == T_NUMBER) {
+                pos++;
+                auto n = node("num");
+                n->value = t.value;
+                n->type = t.dataType;
+                return n;
+            }
+            if (isOp("(")) {
+                pos++;
+                auto e = expression();
+                expectOp(")");
+                return e;
+            }
+            if (t.type == T_IDENT && (t.text == "TRUE" || t.text == "FALSE")) {
+                pos++;
+                auto n = node("num");
+                n->value = t.text == "TRUE";
+                n->type = VRSCLProgram::BOOL;
+                return n;
+            }
+            if (t.type == T_IDENT && isOp("(", 1)) {
+                pos += 2;
+                auto c = node("call", t.text);
+                while (ok && !isOp(")")) {
+                    if (peek().type == T_IDENT && isOp(":=", 1)) pos += 2; // named parameters are taken in order
+                    c->children.push_back(expression());
+                    if (!isOp(",")) break;
+                    pos++;
+                }
+                expectOp(")");
+                return c;
+            }
+            return variable();
+        }
+
+        NodePtr unary() {
+            if (isOp("-")) { pos++; return node("unary", "-", unary()); }
+            if (isOp("+")) { pos++; return unary(); }
+            if (isKeyword("NOT")) { pos++; return node("unary", "NOT", unary()); }
+            return primary();
+        }
+
+        NodePtr power() {
+            auto e = unary();
+            while (ok && isOp("**")) { pos++; e = node("binary", "**", e, unary()); }
+            return e;
+        }
+
+        NodePtr term() {
+            auto e = power();
+            while (ok) {
+                if (isOp("*") || isOp("/")) { string o = peek().text; pos++; e = node("binary", o, e, power()); }
+                else if (isKeyword("MOD")) { pos++; e = node("binary", "MOD", e, power()); }
+                else break;
+            }
+            return e;
+        }
+
+        NodePtr sum() {
+            auto e = term();
+            while (ok && (isOp("+") || isOp("-"))) { string o = peek().text; pos++; e = node("binary", o, e, term()); }
+            return e;
+        }
+
+        NodePtr comparison() {
+            auto e = sum();
+            while (ok && (isOp("<") || isOp(">") || isOp("<=") || isOp(">=") || isOp("=") || isOp("<>"))) {
+                string o = peek().text;
+                pos++;
+                e = node("binary", o, e, sum());
+            }
+            return e;
+        }
+
+        NodePtr conjunction() {
+            auto e = comparison();
+            while (ok && (isKeyword("AND") || isOp("&"))) { pos++; e = node("binary", "AND", e, comparison()); }
+            return e;
+        }
+
+        NodePtr exclusive() {
+            auto e = conjunction();
+            while (ok && isKeyword("XOR")) { pos++; e = node("binary", "XOR", e, conjunction()); }
+            return e;
+        }
+
+        NodePtr expression() {
+            auto e = exclusive();
+            while (ok && isKeyword("OR")) { pos++; e = node("binary", "OR", e, exclusive()); }
+            return e;
+        }
+
+        NodePtr statements(vector<string> stops, bool caseBranch = false) {
+            auto block = node("block");
+            while (ok && !isStatementEnd(stops)) {
+                if (isOp(";")) { pos++; continue; }
+                if (caseBranch && isCaseLabel()) break;
+                block->children.push_back(statement());
+            }
+            return block;
+        }
+
+        NodePtr statement() {
+            auto t = peek();
+            if (t.type == T_IDENT) {
+                if (t.text == "IF") {
+                    pos++;
+                    auto n = node("if");
+                    n->children.push_back(expression());
+                    expectKeyword("THEN");
+                    n->children.push_back(statements({"ELSIF", "ELSE", "END_IF"}));
+                    while (ok && isKeyword("ELSIF")) {
+                        pos++;
+                        n->children.push_back(expression());
+                        expectKeyword("THEN");
+                        n->children.push_back(statements({"ELSIF", "ELSE", "END_IF"}));
+                    }
+                    if (isKeyword("ELSE")) { pos++; n->children.push_back(statements({"END_IF"})); }
+                    expectKeyword("END_IF");
+                    return n;
+                }
+
+                if (t.text == "CASE") {
+                    pos++;
+                    auto n = node("case");
+                    n->children.push_back(expression());
+                    expectKeyword("OF");
+                    while (ok && !isKeyword("ELSE") && !isKeyword("END_CASE") && !atEnd()) {
+                        auto label = node("label");
+                        while (ok) {
+                            auto l = sum();
+                            if (isOp("..")) { pos++; l = node("range", "", l, sum()); }
+                            label->children.push_back(l);
+                            if (!isOp(",")) break;
+                            pos++;
+                        }
+                        expectOp(":");
+                        label->children.push_back(statements({"ELSE", "END_CASE"}, true));
+                        n->children.push_back(label);
+                    }
+                    if (isKeyword("ELSE")) {
+                        pos++;
+                        if (isOp(":")) pos++;
+                        n->children.push_back(statements({"END_CASE"}));
+                    }
+                    expectKeyword("END_CASE");
+                    return n;
+                }
+
+                if (t.text == "FOR") {
+                    pos++;
+                    auto n = node("for");
+                    n->children.push_back(variable());
+                    expectOp(":=");
+                    n->children.push_back(expression());
+                    expectKeyword("TO");
+                    n->children.push_back(expression());
+                    NodePtr step;
+                    if (isKeyword("BY")) { pos++; step = expression(); }
+                    expectKeyword("DO");
+                    n->children.push_back(statements({"END_FOR"}));
+                    expectKeyword("END_FOR");
+                    if (step) n->children.push_back(step);
+                    return n;
+                }
+
+                if (t.text == "WHILE") {
+                    pos++;
+                    auto n = node("while");
+                    n->children.push_back(expression());
+                    expectKeyword("DO");
+                    n->children.push_back(statements({"END_WHILE"}));
+                    expectKeyword("END_WHILE");
+                    return n;
+                }
+
+                if (t.text == "REPEAT") {
+                    pos++;
+                    auto n = node("repeat");
+                    n->children.push_back(statements({"UNTIL"}));
+                    expectKeyword("UNTIL");
+                    n->children.push_back(expression());
+                    expectKeyword("END_REPEAT");
+                    return n;
+                }
+
+                if (t.text == "EXIT" || t.text == "CONTINUE" || t.text == "RETURN") {
+                    pos++;
+                    return node(t.text == "EXIT" ? "exit" : t.text == "CONTINUE" ? "continue" : "return");
+                }
+            }
+
+            auto target = variable();
+            if (isOp("(")) { // function block calls, IN := value for inputs and Q => variable for outputs
+                pos++;
+                auto c = node("fbcall", target->text);
+                c->value = target->value;
+                while (ok && !isOp(")")) {
+                    auto p = peek();
+                    bool output = isOp("=>", 1);
+                    if (p.type != T_IDENT || (!output && !isOp(":=", 1))) { error("expected named parameter"); break; }
+                    pos += 2;
+                    c->children.push_back(node(output ? "output" : "input", p.text, output ? variable() : expression()));
+                    if (!isOp(",")) break;
+                    pos++;
+                }
+                expectOp(")");
+                return c;
+            }
+            expectOp(":=");
+            return node("assign", "", target, expression());
+        }
+
+        NodePtr declarations(bool temporary) {
+            auto decls = node("block");
+            if (isKeyword("CONSTANT") || isKeyword("RETAIN") || isKeyword("NON_RETAIN") || isKeyword("DB_SPECIFIC")) pos++;
+            while (ok && !atEnd() && !isKeyword("END_VAR")) {
+                vector<string> names;
+                while (ok) {
+                    auto v = peek();
+                    if (v.type != T_IDENT && v.type != T_LOCAL && v.type != T_GLOBAL) { error("expected declaration"); break; }
+                    names.push_back(upper(v.raw));
+                    pos++;
+                    if (!isOp(",")) break;
+                    pos++;
+                }
+                expectOp(":");
+
+                string type = peek().text;
+                auto& types = typeTable();
+                auto& timers = timerTable();
+                if (peek().type == T_IDENT && timers.count(type)) { // timer instances
+                    pos++;
+                    if (isOp(";")) pos++;
+                    for (auto& name : names) decls->children.push_back(node("timer", name, node("type", timers.at(type))));
+                    continue;
+                }
+                if (peek().type != T_IDENT || !types.count(type)) { error("unsupported data type"); break; }
+                pos++;
+
+                NodePtr init;
+                if (isOp(":=")) { pos++; init = expression(); }
+                if (isOp(";")) pos++;
+
+                for (auto& name : names) {
+                    auto d = node("decl", name);
+                    d->type = types.at(type);
+                    d->value = temporary;
+                    if (init) d->children.push_back(init);
+                    decls->children.push_back(d);
+                }
+            }
+            expectKeyword("END_VAR");
+            return decls;
+        }
+
+        NodePtr unit() {
+            auto program = node("program");
+            auto decls = node("block");
+            bool hasBegin = false;
+            for (auto& t : tokens) if (t.type == T_IDENT && t.text == "BEGIN") hasBegin = true;
+
+            while (ok && !atEnd()) { // header and declarations
+                auto t = peek();
+                if (t.type == T_IDENT && t.text.substr(0,3) == "VAR") {
+                    pos++;
+                    auto d = declarations(t.text == "VAR_TEMP");
+                    for (auto c : d->children) decls->children.push_back(c);
+                    continue;
+                }
+                if (t.type == T_IDENT && t.text == "BEGIN") { pos++; break; }
+                if (!hasBegin) break; // plain statement list
+                pos++;
+            }
+
+            program->children.push_back(decls);
+            program->children.push_back(statements({"END_FUNCTION_BLOCK", "END_FUNCTION", "END_ORGANIZATION_BLOCK"}));
+            return program;
+        }
+    };
+
+    double constantValue(NodePtr n) { // folds declaration initializers
+        if (n->kind == "num") return n->value;
+        if (n->kind == "unary" && n->text == "-") return -constantValue(n->children[0]);
+        if (n->kind == "binary") {
+            double a = constantValue(n->children[0]);
+            double b = constantValue(n->children[1]);
+            if (n->text == "+") return a+b;
+            if (n->text == "-") return a-b;
+            if (n->text == "*") return a*b;
+            if (n->text == "/") return b != 0 ? a/b : 0;
+        }
+        cout << "VRSCLProgram::compile, initial value is no constant" << endl;
+        return 0;
+    }
+}
+
+VRSCLProgram::VRSCLProgram() {}
+VRSCLProgram::~VRSCLProgram() {}
+
+VRSCLProgramPtr VRSCLProgram::create() { return VRSCLProgramPtr( new VRSCLProgram() ); }
+VRSCLProgramPtr VRSCLProgram::ptr() { return static_pointer_cast<VRSCLProgram>(shared_from_this()); }
+
+void VRSCLProgram::setMaxSteps(int N) { maxSteps = N; }
+
+VRSCLProgram::DataType VRSCLProgram::parseType(string type) {
+    auto& types = typeTable();
+    type = upper(type);
+    return types.count(type) ? types.at(type) : REAL;
+}
+
+double VRSCLProgram::cast(double v, DataType type) {
+    switch (type) {
+        case BOOL: return v != 0;
+        case BYTE: return uint8_t(int64_t(v));
+        case WORD: return uint16_t(int64_t(v));
+        case DWORD: return uint32_t(int64_t(v));
+        case SINT: return int8_t(int64_t(v));
+        case INT: return int16_t(int64_t(v));
+        case DINT:
+        case TIME: return int32_t(int64_t(v));
+        case REAL: return v;
+    }
+    return v;
+}
+
+bool VRSCLProgram::parse(string scl) {
+    Parser parser;
+    parser.tokens = tokenize(scl);
+    ast = parser.unit();
+    if (!parser.ok) ast = 0;
+    return parser.ok;
+}
+
+int VRSCLProgram::addVariable(string name, DataType type, bool global) {
+    Variable v;
+    v.name = name;
+    v.type = type;
+    v.global = global;
+
+    if (global) { // bind to the electric system signal of the same name
+        if (esystem) {
+            auto vars = esystem->getLADVariables();
+            if (vars.count(name) && vars[name]) v.binding = vars[name];
+        }
+        if (v.binding) {
+            if (v.binding->dataType != "") v.type = parseType(v.binding->dataType);
+        } else {
+            v.binding = VRLADVariable::create();
+            v.binding->setName(name);
+            v.binding->setDataType(type == BOOL ? "Bool" : "Real");
+            if (esystem) esystem->addVariable(name, v.binding);
+        }
+    }
+
+    variables.push_back(v);
+    variablesByName[global ? "\""+name : name] = variables.size()-1;
+    return variables.size()-1;
+}
+
+int VRSCLProgram::getVariableRegister(string name) {
+    if (variablesByName.count(upper(name))) return variablesByName[upper(name)];
+    if (variablesByName.count("\""+name)) return variablesByName["\""+name];
+    return -1;
+}
+
+int VRSCLProgram::getConstant(double value) {
+    if (!constants.count(value)) {
+        int k = constants.size();
+        constants[value] = k;
+    }
+    return constants[value];
+}
+
+/**
+ * Registers are numbered in separate ranges while compiling, variables can still be added by unknown
+ * global tags and constants by literals, the ranges are packed to [variables, constants, temporaries] at the end.
+ */
+class VRSCLProgram::Compiler {
+    public:
+        static const int constantBase = 1<<20;
+        static const int tempBase = 1<<21;
+
+        VRSCLProgram& p;
+        int tempTop = 0;
+        int tempMax = 0;
+        bool ok = true;
+
+        struct Loop {
+            vector<int> exits;
+            vector<int> continues;
+        };
+
+        vector<Loop> loops;
+        vector<int> returns;
+
+        Compiler(VRSCLProgram& p) : p(p) {}
+
+        void error(string msg) {
+            if (ok) cout << "VRSCLProgram::compile, " << msg << endl;
+            ok = false;
+        }
+
+        int emit(OpCode op, int a = 0, int b = 0, int c = 0) {
+            Instruction I;
+            I.op = op;
+            I.a = a;
+            I.b = b;
+            I.c = c;
+            p.code.push_back(I);
+            return p.code.size()-1;
+        }
+
+        int here() { return p.code.size(); }
+        void patch(int i, int target) { p.code[i].a = target; }
+
+        int temp() {
+            int r = tempBase + tempTop++;
+            tempMax = max(tempMax, tempTop);
+            return r;
+        }
+
+        int constant(double v) { return constantBase + p.getConstant(v); }
+
+        static bool isInteger(DataType t) { return t != REAL && t != BOOL; }
+
+        static DataType combine(DataType a, DataType b) {
+            if (a == REAL || b == REAL) return REAL;
+            if (a == b) return a;
+            if (a == TIME || b == TIME) return TIME;
+            return DINT;
+        }
+
+        int variable(NodePtr n) {
+            string name = n->text;
+            int scope = n->value; // 0 local, 1 global tag, 2 either
+            if (scope != 1 && p.variablesByName.count(upper(name))) return p.variablesByName[upper(name)];
+            if (scope == 0 && name.find('.') != string::npos) {
+                error("unknown member #" + name);
+                return 0;
+            }
+            if (scope == 0) {
+                cout << "VRSCLProgram::compile, undeclared variable #" << name << ", assuming Real" << endl;
+                return p.addVariable(upper(name), REAL, false);
+            }
+            if (p.variablesByName.count("\""+name)) return p.variablesByName["\""+name];
+            return p.addVariable(name, REAL, true);
+        }
+
+        void store(int v, pair<int, DataType> value) {
+            bool fresh = value.first >= tempBase && !p.code.empty() && p.code.back().a == value.first && p.code.back().op != CAST && p.code.back().op < JMP;
+            if (fresh) p.code.back().a = v; // write the result directly into the variable
+            else emit(MOV, v, value.first);
+
+            DataType t = p.variables[v].type;
+            bool exact = value.second == t && (!fresh || t == BOOL);
+            if (value.first >= constantBase && value.first < tempBase) { // literals only need a cast when out of range
+                for (auto& c : p.constants) if (constantBase + c.second == value.first) exact = cast(c.first, t) == c.first;
+            }
+            if (t != REAL && !exact) emit(CAST, v, t);
+        }
+
+        pair<int, DataType> call(NodePtr n) {
+            string f = n->text;
+            vector<pair<int, DataType>> args;
+            for (auto c : n->children) args.push_back(expression(c));
+            auto needs = [&](size_t N) {
+                if (args.size() == N) return true;
+                error(f + " expects " + ::toString(int(N)) + " arguments");
+                return false;
+            };
+
+            if (f == "ABS" || f == "SQRT" || f == "TRUNC" || f == "ROUND") {
+                if (!needs(1)) return {constant(0), REAL};
+                int d = temp();
+                if (f == "ABS") { emit(ABS, d, args[0].first); return {d, args[0].second}; }
+                if (f == "SQRT") { emit(SQRT, d, args[0].first); return {d, REAL}; }
+                emit(f == "TRUNC" ? TRUNC : ROUND, d, args[0].first);
+                return {d, DINT};
+            }
+
+            if (f == "MIN" || f == "MAX") {
+                if (args.empty()) { error(f + " without arguments"); return {constant(0), REAL}; }
+                auto r = args[0];
+                for (size_t i = 1; i < args.size(); i++) {
+                    int d = temp();
+                    emit(f == "MIN" ? MIN : MAX, d, r.first, args[i].first);
+                    r = make_pair(d, combine(r.second, args[i].second));
+                }
+                return r;
+            }
+
+            if (f == "LIMIT") { // LIMIT(MN, IN, MX)
+                if (!needs(3)) return {constant(0), REAL};
+                int d = temp();
+                emit(MAX, d, args[1].first, args[0].first);
+                emit(MIN, d, d, args[2].first);
+                return {d, combine(args[1].second, combine(args[0].second, args[2].second))};
+            }
+
+            size_t k = f.find("_TO_");
+            if (k != string::npos && typeTable().count(f.substr(k+4))) { // INT_TO_REAL, REAL_TO_INT, ..
+                if (!needs(1)) return {constant(0), REAL};
+                DataType t = parseType(f.substr(k+4));
+                int d = temp();
+                if (args[0].second == REAL && isInteger(t)) emit(ROUND, d, args[0].first);
+                else emit(MOV, d, args[0].first);
+                if (t != REAL) emit(CAST, d, t);
+                return {d, t};
+            }
+
+            error("unsupported function " + f);
+            return {constant(0), REAL};
+        }
+
+        pair<int, DataType> expression(NodePtr n) {
+            if (n->kind == "num") return {constant(n->value), n->type};
+            if (n->kind == "var") {
+                int v = variable(n);
+                return {v, p.variables[v].type};
+            }
+            if (n->kind == "call") return call(n);
+
+            if (n->kind == "unary") {
+                auto a = expression(n->children[0]);
+                int d = temp();
+                if (n->text == "-") {
+                    emit(NEG, d, a.first);
+                    return {d, a.second == BOOL ? INT : a.second};
+                }
+                emit(a.second == BOOL ? LNOT : NOT, d, a.first);
+                return {d, a.second};
+            }
+
+            if (n->kind == "binary") {
+                auto a = expression(n->children[0]);
+                auto b = expression(n->children[1]);
+                string o = n->text;
+                DataType t = combine(a.second, b.second);
+                int d = temp();
+
+                static map<string, OpCode> comparisons = { {"=", EQ}, {"<>", NE}, {"<", LT}, {"<=", LE}, {">", GT}, {">=", GE} };
+                if (comparisons.count(o)) { emit(comparisons[o], d, a.first, b.first); return {d, BOOL}; }
+
+                if (o == "AND" || o == "OR" || o == "XOR") {
+                    emit(o == "AND" ? AND : o == "OR" ? OR : XOR, d, a.first, b.first);
+                    return {d, a.second == BOOL && b.second == BOOL ? BOOL : t};
+                }
+
+                if (t == BOOL) t = INT;
+                if (o == "+") emit(ADD, d, a.first, b.first);
+                else if (o == "-") emit(SUB, d, a.first, b.first);
+                else if (o == "*") emit(MUL, d, a.first, b.first);
+                else if (o == "/") emit(t == REAL ? DIV : IDIV, d, a.first, b.first);
+                else if (o == "MOD") emit(MOD, d, a.first, b.first);
+                else if (o == "**") { emit(POW, d, a.first, b.first); t = REAL; }
+                else error("unsupported operator " + o);
+                return {d, t};
+            }
+
+            error("unexpected " + n->kind + " in expression");
+            return {constant(0), REAL};
+        }
+
+        void block(NodePtr n) {
+            for (auto c : n->children) statement(c);
+        }
+
+        void statement(NodePtr n) {
+            int tempStart = tempTop; // temporaries live until the end of the statement
+            string k = n->kind;
+
+            if (k == "block") block(n);
+
+            else if (k == "assign") {
+                int v = variable(n->children[0]);
+                store(v, expression(n->children[1]));
+            }
+
+            else if (k == "if") {
+                vector<int> ends;
+                size_t N = n->children.size();
+                for (size_t i = 0; i+1 < N; i += 2) {
+                    auto c = expression(n->children[i]);
+                    int skip = emit(JZ, 0, c.first);
+                    block(n->children[i+1]);
+                    if (i+2 < N) ends.push_back(emit(JMP));
+                    patch(skip, here());
+                }
+                if (N%2 == 1) block(n->children[N-1]);
+                for (int e : ends) patch(e, here());
+            }
+
+            else if (k == "case") {
+                auto selector = expression(n->children[0]);
+                vector<int> ends;
+                for (size_t i = 1; i < n->children.size(); i++) {
+                    auto branch = n->children[i];
+                    if (branch->kind == "block") { block(branch); continue; } // ELSE
+
+                    vector<int> matches;
+                    for (size_t j = 0; j+1 < branch->children.size(); j++) {
+                        auto label = branch->children[j];
+                        int t = temp();
+                        if (label->kind == "range") {
+                            int t2 = temp();
+                            emit(GE, t, selector.first, expression(label->children[0]).first);
+                            emit(LE, t2, selector.first, expression(label->children[1]).first);
+                            emit(AND, t, t, t2);
+                        } else emit(EQ, t, selector.first, expression(label).first);
+                        matches.push_back(emit(JNZ, 0, t));
+                    }
+                    int skip = emit(JMP);
+                    for (int m : matches) patch(m, here());
+                    block(branch->children.back());
+                    ends.push_back(emit(JMP));
+                    patch(skip, here());
+                }
+                for (int e : ends) patch(e, here());
+            }
+
+            else if (k == "for") {
+                int v = variable(n->children[0]);
+                store(v, expression(n->children[1]));
+
+                auto end = expression(n->children[2]); // evaluated once
+                if (end.first < constantBase) { // the bound may be changed in the loop
+                    int e = temp();
+                    emit(MOV, e, end.first);
+                    end.first = e;
+                }
+
+                int step = constant(1);
+                bool down = false;
+                if (n->children.size() > 4) {
+                    auto s = n->children[4];
+                    if (s->kind == "num" || (s->kind == "unary" && s->children[0]->kind == "num")) {
+                        double sv = constantValue(s);
+                        step = constant(sv);
+                        down = sv < 0;
+                    } else { // runtime steps are assumed positive
+                        step = temp();
+                        emit(MOV, step, expression(s).first);
+                    }
+                }
+
+                int start = here();
+                int t = temp();
+                emit(down ? LT : GT, t, v, end.first);
+                int exit = emit(JNZ, 0, t);
+                loops.push_back(Loop());
+                block(n->children[3]);
+                int next = here();
+                emit(ADD, v, v, step);
+                if (p.variables[v].type != REAL) emit(CAST, v, p.variables[v].type);
+                emit(JMP, start);
+                patch(exit, here());
+                closeLoop(next);
+            }
+
+            else if (k == "while") {
+                int start = here();
+                auto c = expression(n->children[0]);
+                int exit = emit(JZ, 0, c.first);
+                loops.push_back(Loop());
+                block(n->children[1]);
+                emit(JMP, start);
+                patch(exit, here());
+                closeLoop(start);
+            }
+
+            else if (k == "repeat") {
+                int start = here();
+                loops.push_back(Loop());
+                block(n->children[0]);
+                int next = here();
+                tempTop = tempStart;
+                auto c = expression(n->children[1]);
+                emit(JZ, start, c.first);
+                closeLoop(next);
+            }
+
+            else if (k == "exit" || k == "continue") {
+                if (loops.empty()) error(k + " outside of a loop");
+                else if (k == "exit") loops.back().exits.push_back(emit(JMP));
+                else loops.back().continues.push_back(emit(JMP));
+            }
+
+            else if (k == "return") returns.push_back(emit(JMP));
+
+            else if (k == "fbcall") {
+                string name = upper(n->text);
+                if (n->value == 1 || !p.timersByName.count(name)) error("unsupported call of " + n->text);
+                else {
+                    int i = p.timersByName[name];
+                    Timer t = p.timers[i];
+                    for (auto c : n->children) {
+                        if (c->kind != "input") continue;
+                        if (c->text == "IN") store(t.IN, expression(c->children[0]));
+                        else if (c->text == "PT") store(t.PT, expression(c->children[0]));
+                        else error("unknown input " + c->text + " of " + t.kind);
+                    }
+                    emit(TIMER, i);
+                    for (auto c : n->children) {
+                        if (c->kind != "output") continue;
+                        if (c->text == "Q") store(variable(c->children[0]), {t.Q, BOOL});
+                        else if (c->text == "ET") store(variable(c->children[0]), {t.ET, TIME});
+                        else error("unknown output " + c->text + " of " + t.kind);
+                    }
+                }
+            }
+
+            else error("unexpected " + k);
+
+            tempTop = tempStart;
+        }
+
+        void closeLoop(int next) {
+            for (int e : loops.back().exits) patch(e, here());
+            for (int c : loops.back().continues) patch(c, next);
+            loops.pop_back();
+        }
+
+        void relocate() {
+            int Nv = p.variables.size();
+            int Nc = p.constants.size();
+            auto reg = [&](int& r) {
+                if (r >= tempBase) r = Nv + Nc + r - tempBase;
+                else if (r >= constantBase) r = Nv + r - constantBase;
+            };
+
+            for (auto& I : p.code) {
+                switch (I.op) {
+                    case JMP: case END: case TIMER: break;
+                    case JZ: case JNZ: reg(I.b); break;
+                    case CAST: reg(I.a); break;
+                    case MOV: case NEG: case NOT: case LNOT: case ABS: case SQRT: case TRUNC: case ROUND:
+                        reg(I.a); reg(I.b); break;
+                    default: reg(I.a); reg(I.b); reg(I.c); break;
+                }
+            }
+
+            p.registers.assign(Nv + Nc + tempMax, 0);
+            for (int i = 0; i < Nv; i++) p.registers[i] = p.variables[i].init;
+            for (auto& c : p.constants) p.registers[Nv + c.second] = c.first;
+        }
+};
+
+bool VRSCLProgram::compile(VRElectricSystemPtr es) {
+    esystem = es;
+    variables.clear();
+    variablesByName.clear();
+    code.clear();
+    registers.clear();
+    constants.clear();
+    timers.clear();
+    timersByName.clear();
+    clock = 0;
+    if (!ast) return false;
+
+    for (auto d : ast->children[0]->children) {
+        if (d->kind == "timer") { addTimer(d->text, d->children[0]->text); continue; }
+        int v = addVariable(d->text, d->type, false);
+        variables[v].temporary = d->value;
+        if (d->children.size()) variables[v].init = cast(constantValue(d->children[0]), d->type);
+    }
+
+    Compiler compiler(*this);
+    compiler.block(ast->children[1]);
+    for (int r : compiler.returns) compiler.patch(r, code.size());
+    compiler.emit(END);
+    compiler.relocate();
+    Nvariables = variables.size();
+
+    if (!compiler.ok) code.clear();
+    return compiler.ok;
+}
+
+void VRSCLProgram::load() { // picks up signals changed outside of the program
+    for (int i = 0; i < Nvariables; i++) {
+        auto& v = variables[i];
+        if (v.temporary) registers[i] = v.init;
+        if (!v.binding) continue;
+        if (v.binding->value != v.text) {
+            v.text = v.binding->value;
+            string t = upper(v.text);
+            registers[i] = cast(t == "TRUE" ? 1 : t == "FALSE" ? 0 : toFloat(v.text), v.type);
+        }
+        v.loaded = registers[i];
+    }
+}
+
+void VRSCLProgram::store() {
+    for (int i = 0; i < Nvariables; i++) {
+        auto& v = variables[i];
+        if (!v.binding || registers[i] == v.loaded) continue;
+        v.text = v.type == REAL ? ::toString(registers[i]) : to_string((long long)registers[i]);
+        v.binding->value = v.text;
+    }
+}
+
+void VRSCLProgram::addTimer(string name, string kind) {
+    Timer t;
+    t.name = name;
+    t.kind = kind;
+    t.IN = addVariable(name+".IN", BOOL, false);
+    t.PT = addVariable(name+".PT", TIME, false);
+    t.Q = addVariable(name+".Q", BOOL, false);
+    t.ET = addVariable(name+".ET", TIME, false);
+    timersByName[name] = timers.size();
+    timers.push_back(t);
+}
+
+void VRSCLProgram::runTimer(Timer& t) { // IEC 61131-3 semantics, times in ms
+    double* R = &registers[0];
+    bool in = R[t.IN] != 0;
+    bool rising = in && !t.last;
+    bool falling = !in && t.last;
+    double PT = R[t.PT];
+    t.last = in;
+
+    if (t.kind == "TON") { // Q is set when IN stayed set for PT
+        if (!in) { R[t.Q] = 0; R[t.ET] = 0; return; }
+        if (rising) t.start = clock;
+        R[t.ET] = min(floor(clock - t.start), PT);
+        R[t.Q] = R[t.ET] >= PT;
+    }
+
+    if (t.kind == "TOF") { // Q is reset when IN stayed reset for PT
+        if (in) { t.running = false; R[t.Q] = 1; R[t.ET] = 0; return; }
+        if (falling) { t.running = true; t.start = clock; }
+        if (!t.running) return;
+        R[t.ET] = min(floor(clock - t.start), PT);
+        if (R[t.ET] >= PT) { t.running = false; R[t.Q] = 0; }
+    }
+
+    if (t.kind == "TP") { // pulse of length PT on a rising edge, not retriggered while running
+        if (rising && !t.running) { t.running = true; t.start = clock; R[t.Q] = 1; }
+        if (t.running) {
+            R[t.ET] = min(floor(clock - t.start), PT);
+            if (R[t.ET] >= PT) { t.running = false; R[t.Q] = 0; }
+        } else if (!in) R[t.ET] = 0;
+    }
+}
+
+void VRSCLProgram::setCycleTime(double ms) { cycleTime = ms; }
+
+void VRSCLProgram::run() {
+    if (code.empty()) return;
+    clock = cycleTime > 0 ? clock + cycleTime : getTime()*1e-3;
+    load();
+
+    double* R = &registers[0];
+    const Instruction* C = &code[0];
+    int N = code.size();
+    int pc = 0;
+    int steps = 0;
+
+    while (pc < N) {
+        if (++steps > maxSteps) {
+            cout << "VRSCLProgram::run, cycle aborted by watchdog after " << maxSteps << " steps" << endl;
+            break;
+        }
+
+        const Instruction& I = C[pc++];
+        switch (I.op) {
+            case MOV: R[I.a] = R[I.b]; break;
+            case CAST: R[I.a] = cast(R[I.a], DataType(I.b)); break;
+            case ADD: R[I.a] = R[I.b] + R[I.c]; break;
+            case SUB: R[I.a] = R[I.b] - R[I.c]; break;
+            case MUL: R[I.a] = R[I.b] * R[I.c]; break;
+            case DIV: R[I.a] = R[I.c] != 0 ? R[I.b] / R[I.c] : 0; break;
+            case IDIV: { int64_t d = R[I.c]; R[I.a] = d ? double(int64_t(R[I.b]) / d) : 0; break; }
+            case MOD: { int64_t d = R[I.c]; R[I.a] = d ? double(int64_t(R[I.b]) % d) : 0; break; }
+            case POW: R[I.a] = pow(R[I.b], R[I.c]); break;
+            case NEG: R[I.a] = -R[I.b]; break;
+            case NOT: R[I.a] = double(~int64_t(R[I.b])); break;
+            case LNOT: R[I.a] = R[I.b] == 0; break;
+            case AND: R[I.a] = double(int64_t(R[I.b]) & int64_t(R[I.c])); break;
+            case OR: R[I.a] = double(int64_t(R[I.b]) | int64_t(R[I.c])); break;
+            case XOR: R[I.a] = double(int64_t(R[I.b]) ^ int64_t(R[I.c])); break;
+            case EQ: R[I.a] = R[I.b] == R[I.c]; break;
+            case NE: R[I.a] = R[I.b] != R[I.c]; break;
+            case LT: R[I.a] = R[I.b] < R[I.c]; break;
+            case LE: R[I.a] = R[I.b] <= R[I.c]; break;
+            case GT: R[I.a] = R[I.b] > R[I.c]; break;
+            case GE: R[I.a] = R[I.b] >= R[I.c]; break;
+            case ABS: R[I.a] = fabs(R[I.b]); break;
+            case SQRT: R[I.a] = R[I.b] > 0 ? sqrt(R[I.b]) : 0; break;
+            case TRUNC: R[I.a] = trunc(R[I.b]); break;
+            case ROUND: R[I.a] = round(R[I.b]); break;
+            case MIN: R[I.a] = min(R[I.b], R[I.c]); break;
+            case MAX: R[I.a] = max(R[I.b], R[I.c]); break;
+            case JMP: pc = I.a; break;
+            case JZ: if (R[I.b] == 0) pc = I.a; break;
+            case JNZ: if (R[I.b] != 0) pc = I.a; break;
+            case END: pc = N; break;
+            case TIMER: runTimer(timers[I.a]); break;
+        }
+    }
+
+    store();
+}
+
+double VRSCLProgram::getValue(string name) {
+    int r = getVariableRegister(name);
+    return r >= 0 ? registers[r] : 0;
+}
+
+void VRSCLProgram::setValue(string name, double value) {
+    int r = getVariableRegister(name);
+    if (r < 0) return;
+    registers[r] = cast(value, variables[r].type);
+    if (variables[r].binding) { // keeps the signal in sync, else the next load would overwrite it
+        variables[r].text = variables[r].type == REAL ? ::toString(registers[r]) : to_string((long long)registers[r]);
+        variables[r].binding->value = variables[r].text;
+    }
+}
+
+vector<string> VRSCLProgram::getVariables() {
+    vector<string> res;
+    for (auto& v : variables) res.push_back(v.global ? "\""+v.name+"\"" : "#"+v.name);
+    return res;
+}
+
+string VRSCLProgram::getBytecode() {
+    static const vector<string> names = { "MOV", "CAST", "ADD", "SUB", "MUL", "DIV", "IDIV", "MOD", "POW", "NEG", "NOT", "LNOT", "AND", "OR", "XOR",
+                                          "EQ", "NE", "LT", "LE", "GT", "GE", "ABS", "SQRT", "TRUNC", "ROUND", "MIN", "MAX", "JMP", "JZ", "JNZ", "END", "TIMER" };
+    static const vector<string> types = { "Bool", "Byte", "Word", "DWord", "SInt", "Int", "DInt", "Real", "Time" };
+
+    int Nv = variables.size();
+    int Nc = constants.size();
+    auto reg = [&](int r) {
+        if (r < Nv) return variables[r].global ? "\""+variables[r].name+"\"" : "#"+variables[r].name;
+        if (r < Nv + Nc) return ::toString(registers[r]);
+        return "r" + ::toString(r - Nv - Nc);
+    };
+
+    string res;
+    for (size_t i = 0; i < code.size(); i++) {
+        auto& I = code[i];
+        res += ::toString(int(i)) + "\t" + names[I.op];
+        switch (I.op) {
+            case END: break;
+            case JMP: res += " " + ::toString(I.a); break;
+            case TIMER: res += " " + timers[I.a].kind + " #" + timers[I.a].name; break;
+            case JZ: case JNZ: res += " " + ::toString(I.a) + " " + reg(I.b); break;
+            case CAST: res += " " + reg(I.a) + " " + types[I.b]; break;
+            case MOV: case NEG: case NOT: case LNOT: case ABS: case SQRT: case TRUNC: case ROUND:
+                res += " " + reg(I.a) + " " + reg(I.b); break;
+            default: res += " " + reg(I.a) + " " + reg(I.b) + " " + reg(I.c); break;
+        }
+        res += "\n";
+    }
+    return res;
+}
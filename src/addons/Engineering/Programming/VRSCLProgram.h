@@ -0,0 +1,124 @@
+#ifndef VRSCLPROGRAM_H_INCLUDED
+#define VRSCLPROGRAM_H_INCLUDED
+
+#include <OpenSG/OSGConfig.h>
+#include "addons/Engineering/VREngineeringFwd.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+OSG_BEGIN_NAMESPACE;
+
+/**
+ * SCL program, parsed into a syntax tree and compiled to register bytecode.
+ * Supported subset:
+ *  - VAR, VAR_INPUT, VAR_OUTPUT, VAR_IN_OUT, VAR_TEMP and VAR CONSTANT sections
+ *  - Bool, Byte, Word, DWord, SInt, Int, DInt, USInt, UInt, UDInt, Real, LReal and Time variables
+ *  - assignments, IF, CASE, FOR, WHILE, REPEAT, EXIT, CONTINUE and RETURN
+ *  - arithmetic, comparison and logic operators, ABS, SQRT, MIN, MAX, LIMIT, TRUNC, ROUND and X_TO_Y conversions
+ *  - TON, TOF and TP instances, called with named parameters, #timer(IN := .., PT := .., Q => ..), members read as #timer.Q
+ * Global tags ("tag") and undeclared names are bound to the LAD variables of the electric system.
+ * Other data types, function blocks and members fail the compilation instead of being skipped.
+ * Registers hold doubles, stores into variables wrap or round to the declared data type.
+ */
+class VRSCLProgram : public std::enable_shared_from_this<VRSCLProgram> {
+    public:
+        enum DataType { BOOL, BYTE, WORD, DWORD, SINT, INT, DINT, REAL, TIME };
+
+        enum OpCode { MOV, CAST, ADD, SUB, MUL, DIV, IDIV, MOD, POW, NEG, NOT, LNOT, AND, OR, XOR,
+                      EQ, NE, LT, LE, GT, GE, ABS, SQRT, TRUNC, ROUND, MIN, MAX, JMP, JZ, JNZ, END, TIMER };
+
+        struct Instruction {
+            OpCode op;
+            int a = 0; // destination register or jump target
+            int b = 0;
+            int c = 0;
+        };
+
+        struct Node;
+        typedef shared_ptr<Node> NodePtr;
+
+        struct Node {
+            string kind; // num, var, unary, binary, call, block, assign, if, case, label, for, while, repeat, exit, continue, return
+            string text; // operator, variable or function name
+            double value = 0;
+            DataType type = REAL;
+            vector<NodePtr> children;
+        };
+
+        struct Variable {
+            string name;
+            DataType type = REAL;
+            double init = 0;
+            bool temporary = false;
+            bool global = false;
+            VRLADVariablePtr binding;
+            string text; // last loaded or stored binding value
+            double loaded = 0;
+        };
+
+        struct Timer { // IEC timer instance, the parameters are variables named TIMER.IN, TIMER.PT, TIMER.Q and TIMER.ET
+            string name;
+            string kind; // TON, TOF or TP
+            int IN = 0;
+            int PT = 0;
+            int Q = 0;
+            int ET = 0;
+            double start = 0;
+            bool running = false;
+            bool last = false;
+        };
+
+    private:
+        class Compiler;
+
+        NodePtr ast;
+        vector<Variable> variables;
+        map<string, int> variablesByName;
+        vector<Timer> timers;
+        map<string, int> timersByName;
+        vector<Instruction> code;
+        vector<double> registers;
+        map<double, int> constants;
+        int Nvariables = 0;
+        int maxSteps = 1000000; // watchdog per cycle
+        double clock = 0; // PLC time in ms
+        double cycleTime = 0; // fixed scan time in ms, 0 uses the system time
+        VRElectricSystemPtr esystem;
+
+        int addVariable(string name, DataType type, bool global);
+        int getVariableRegister(string name);
+        int getConstant(double value);
+        void addTimer(string name, string kind);
+        void runTimer(Timer& t);
+
+        void load();
+        void store();
+
+    public:
+        VRSCLProgram();
+        ~VRSCLProgram();
+
+        static VRSCLProgramPtr create();
+        VRSCLProgramPtr ptr();
+
+        static DataType parseType(string type);
+        static double cast(double value, DataType type);
+
+        bool parse(string scl);
+        bool compile(VRElectricSystemPtr esystem = 0);
+        void run();
+
+        void setMaxSteps(int N);
+        void setCycleTime(double ms);
+        double getValue(string name);
+        void setValue(string name, double value);
+        vector<string> getVariables();
+        string getBytecode();
+};
+
+OSG_END_NAMESPACE;
+
+#endif // VRSCLPROGRAM_H_INCLUDED
@@ -23,6 +23,7 @@ ptrFwd(VRWiringSimulation);
 ptrFwd(VRElectricComponent);
 ptrFwd(VRSCLScript);
 ptrFwd(VRSCLEngine);
+ptrFwd(VRSCLProgram);
 ptrFwd(VRLADEngine);
 ptrFwd(VRLADVariable);
 
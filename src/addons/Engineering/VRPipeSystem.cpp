@@ -3,6 +3,8 @@
 #include "core/utils/isNan.h"
 #include "core/utils/VRFunction.h"
 #include "core/utils/system/VRSystem.h"
+#include "core/utils/VRThreadPool.h"
+#include "core/math/pose.h"
 #include "core/tools/VRAnalyticGeometry.h"
 #include "core/tools/VRAnnotationEngine.h"
 #include "core/objects/geometry/VRGeoData.h"
@@ -13,6 +15,7 @@
 #include "addons/Semantics/Reasoning/VROntology.h"
 #include "addons/Semantics/Reasoning/VREntity.h"
 #include "addons/Semantics/Reasoning/VRConcept.h"
+#include "addons/Semantics/Reasoning/VRProperty.h"
 
 using namespace OSG;
 
@@ -175,6 +178,7 @@ VREntityPtr VRPipeSystem::getNodeEntity(int nID) {
 
 int VRPipeSystem::addNode(string name, PosePtr pos, string type, map<string, string> params) {
     rebuildMesh = true;
+    invalidateState();
     auto e = ontology->addEntity(name, type);
     auto n = VRPipeNode::create(e);
     n->name = name;
@@ -187,6 +191,7 @@ int VRPipeSystem::addNode(string name, PosePtr pos, string type, map<string, str
 
 void VRPipeSystem::remNode(int nID) {
     rebuildMesh = true;
+    invalidateState();
     auto& node = nodes[nID];
     ontology->remEntity(node->entity);
     nodesByName.erase(node->name);
@@ -200,6 +205,7 @@ int VRPipeSystem::getSegment(int n1, int n2) { return graph->getEdgeID(n1, n2);
 
 int VRPipeSystem::addSegment(double radius, int n1, int n2) {
     rebuildMesh = true;
+    invalidateState();
     int sID = graph->connect(n1, n2);
     auto p1 = graph->getPosition(n1)->pos();
     auto p2 = graph->getPosition(n2)->pos();
@@ -211,6 +217,7 @@ int VRPipeSystem::addSegment(double radius, int n1, int n2) {
 
 void VRPipeSystem::remSegment(int eID) {
     rebuildMesh = true;
+    invalidateState();
     auto& e = graph->getEdge(eID);
     graph->disconnect(e.from, e.to);
     segments.erase(eID);
@@ -246,6 +253,7 @@ vector<VRPipeSegmentPtr> VRPipeSystem::getOutPipes(int nID) {
 }
 
 void VRPipeSystem::printSystem() {
+    syncToOntology();
     double totalEnergy = 0;
     for (auto n : nodes) { // print some stats
         auto entity = n.second->entity;
@@ -268,10 +276,114 @@ void VRPipeSystem::printSystem() {
     cout << " total energy: " << totalEnergy << endl;
 }
 
+void VRPipeSystem::compileState() {
+    state = State();
+    stateDirty = false;
+
+    map<int, int> segmentIndices;
+    for (auto& s : segments) {
+        auto& e = graph->getEdge(s.first);
+        segmentIndices[s.first] = state.segments.size();
+        state.segments.push_back(s.second);
+        state.segmentValid.push_back(nodes.count(e.from) && nodes.count(e.to));
+    }
+
+    for (auto& n : nodes) {
+        int nID = n.first;
+        auto entity = n.second->entity;
+
+        int type = OTHER;
+        if (entity->is_a("Tank")) type = TANK;
+        else if (entity->is_a("Junction")) type = JUNCTION;
+        else if (entity->is_a("Pump")) type = PUMP;
+        else if (entity->is_a("Valve")) type = VALVE;
+        else if (entity->is_a("Outlet")) type = OUTLET;
+
+        state.nodeIndices[nID] = state.nodeIDs.size();
+        state.nodeIDs.push_back(nID);
+        state.types.push_back(type);
+        state.pressure.push_back(entity->getValue("pressure", 1.0));
+        state.volume.push_back(entity->getValue("volume", 0.0));
+        state.density.push_back(entity->getValue("density", 1.0));
+        state.level.push_back(entity->getValue("level", 0.0));
+        state.performance.push_back(entity->getValue("performance", 0.0));
+        state.maxPressure.push_back(entity->getValue("maxPressure", 0.0));
+        state.radius.push_back(entity->getValue("radius", 0.0));
+        state.isOpen.push_back(entity->getValue("isOpen", false));
+        state.valveOpen.push_back(entity->getValue("state", false));
+        state.hasDensity.push_back(bool(entity->get("density")));
+        for (string p : {"pressure", "density", "level"}) {
+            auto v = entity->get(p);
+            state.synced.push_back(v ? v->value : "");
+        }
+
+        state.pipesStart.push_back(state.pipes.size());
+        for (auto& e : graph->getInEdges(nID)) {
+            auto s = segmentIndices.find(e.ID);
+            if (s == segmentIndices.end()) continue; // edge without segment
+            state.pipes.push_back(s->second);
+            state.pipeGoesIn.push_back(e.to == nID);
+            state.pipeGoesOut.push_back(e.from == nID);
+        }
+        state.nInPipes.push_back(state.pipes.size() - state.pipesStart.back());
+        for (auto& e : graph->getOutEdges(nID)) {
+            auto s = segmentIndices.find(e.ID);
+            if (s == segmentIndices.end()) continue;
+            state.pipes.push_back(s->second);
+            state.pipeGoesIn.push_back(e.to == nID);
+            state.pipeGoesOut.push_back(e.from == nID);
+        }
+    }
+    state.pipesStart.push_back(state.pipes.size());
+}
+
+void VRPipeSystem::invalidateState() { // keeps the simulated values when the topology changes
+    if (!stateDirty) syncToOntology();
+    stateDirty = true;
+}
+
+int VRPipeSystem::getStateIndex(string name) {
+    if (stateDirty || !nodesByName.count(name)) return -1;
+    return state.nodeIndices[nodesByName[name]];
+}
+
+void VRPipeSystem::writeTankStates(bool keepEdits) { // only tank states are changed by the simulation
+    if (stateDirty) return;
+    static const string props[3] = {"pressure", "density", "level"};
+    vector<double>* values[3] = {&state.pressure, &state.density, &state.level};
+
+    for (size_t n = 0; n < state.nodeIDs.size(); n++) {
+        if (state.types[n] != TANK) continue;
+        auto entity = nodes.at(state.nodeIDs[n])->entity;
+        for (int i=0; i<3; i++) {
+            auto& synced = state.synced[3*n+i];
+            auto v = entity->get(props[i]);
+            if (keepEdits && (v ? v->value : "") != synced) continue; // changed in the ontology since the last sync
+            entity->set(props[i], toString((*values[i])[n]));
+            v = entity->get(props[i]);
+            synced = v ? v->value : "";
+        }
+    }
+}
+
+void VRPipeSystem::syncToOntology() { writeTankStates(false); }
+
+void VRPipeSystem::syncFromOntology() { // simulated values not synced yet are kept, unless edited in the ontology
+    writeTankStates(true);
+    stateDirty = true;
+}
+void VRPipeSystem::setSyncRate(int frames) { syncRate = frames; }
+
+void VRPipeSystem::parallelSegments(function<void(size_t, size_t)> f) { // large networks are split over the thread pool
+    VRThreadPool::get()->parallelFor(state.segments.size(), 10000, f);
+}
+
 void VRPipeSystem::update() {
     //printSystem();
     //sleep(3);
 
+    if (stateDirty) compileState();
+
     int subSteps = 10;
     double dT = 1.0/60; // TODO: use animation
     double dt = dT/subSteps;
@@ -279,74 +391,63 @@ void VRPipeSystem::update() {
 
     auto clamp = [](double f, double a = -1, double b = 1) -> double { return f<a ? a : f>b ? b : f; };
 
+    auto& S = state;
+    size_t Nnodes = S.nodeIDs.size();
+    vector<int> inFlowPipeIDs;
+    vector<int> outFlowPipeIDs;
+
+    auto sortFlows = [&](size_t n) { // pipes flowing into and out of the node
+        inFlowPipeIDs.clear();
+        outFlowPipeIDs.clear();
+        int pIn = S.pipesStart[n] + S.nInPipes[n];
+        for (int j = S.pipesStart[n]; j < S.pipesStart[n+1]; j++) {
+            int p = S.pipes[j];
+            double f = S.segments[p]->flow + S.segments[p]->dFl2;
+            if (f > 0) (j < pIn ? inFlowPipeIDs : outFlowPipeIDs).push_back(p);
+            if (f < 0) (j < pIn ? outFlowPipeIDs : inFlowPipeIDs).push_back(p);
+        }
+    };
+
     for (int i=0; i<subSteps; i++) {
 
-        for (auto n : nodes) { // traverse nodes, change pressure in segments
-            int nID = n.first;
-            auto node = n.second;
-            auto entity = node->entity;
-
-            if (entity->is_a("Tank")) {
-                auto inPipes = getInPipes(nID);
-                auto outPipes = getOutPipes(nID);
-                double tankVolume = entity->getValue("volume", 0.0);
-                double tankPressure = entity->getValue("pressure", 1.0);
-                double tankDensity = entity->getValue("density", 1.0);
-                double tankOpen = entity->getValue("isOpen", false);
-
-                if (!tankOpen) {
-                    for (auto p : inPipes)  p->handleTank(tankPressure, tankVolume, tankDensity, dt, false);
-                    for (auto p : outPipes) p->handleTank(tankPressure, tankVolume, tankDensity, dt, true);
-                    entity->set("pressure", toString(tankPressure));
-                    entity->set("density", toString(tankDensity));
+        for (size_t n = 0; n < Nnodes; n++) { // traverse nodes, change pressure in segments
+            int pBegin = S.pipesStart[n];
+            int pIn = pBegin + S.nInPipes[n];
+            int pEnd = S.pipesStart[n+1];
+            int Npipes = pEnd - pBegin;
+
+            if (S.types[n] == TANK) {
+                double tankVolume = S.volume[n];
+
+                if (!S.isOpen[n]) {
+                    for (int j = pBegin; j < pEnd; j++) S.segments[S.pipes[j]]->handleTank(S.pressure[n], tankVolume, S.density[n], dt, j >= pIn);
                 } else {
                     double outletPressure = 1.0;//entity->getValue("density", pipe->density);
                     double outletDensity = 1.0;//entity->getValue("density", pipe->density);
                     double area = 100.0;
-                    for (auto pipe :  inPipes) pipe->handleOutlet(area, outletPressure, outletDensity, dt, false);
-                    for (auto pipe : outPipes) pipe->handleOutlet(area, outletPressure, outletDensity, dt, true);
+                    for (int j = pBegin; j < pEnd; j++) S.segments[S.pipes[j]]->handleOutlet(area, outletPressure, outletDensity, dt, j >= pIn);
                 }
 
                 // update level
                 double k = 10.0; // TODO
-                double tankLevel = entity->getValue("level", 0.0);
+                double& tankLevel = S.level[n];
                 if (tankVolume > 1e-3) {
-                    vector<int> inFlowPipeIDs;
-                    vector<int> outFlowPipeIDs;
-                    for (auto e : graph->getInEdges(nID) ) {
-                        auto pipe = segments[e.ID];
-                        if (pipe->flow + pipe->dFl2 > 0) inFlowPipeIDs.push_back(e.ID);
-                        if (pipe->flow + pipe->dFl2 < 0) outFlowPipeIDs.push_back(e.ID);
-                    }
-                    for (auto e : graph->getOutEdges(nID) ) {
-                        auto pipe = segments[e.ID];
-                        if (pipe->flow + pipe->dFl2 > 0) outFlowPipeIDs.push_back(e.ID);
-                        if (pipe->flow + pipe->dFl2 < 0) inFlowPipeIDs.push_back(e.ID);
-                    }
-
-                    for (auto p : inFlowPipeIDs)  tankLevel += dt * segments[p]->flow * k / tankVolume;
-                    for (auto p : outFlowPipeIDs) tankLevel -= dt * segments[p]->flow * k / tankVolume;
+                    sortFlows(n);
+                    for (auto p : inFlowPipeIDs)  tankLevel += dt * S.segments[p]->flow * k / tankVolume;
+                    for (auto p : outFlowPipeIDs) tankLevel -= dt * S.segments[p]->flow * k / tankVolume;
                     tankLevel = clamp(tankLevel, 0.0, 1.0);
                 }
-                //cout << "level: " << nID << ", " << tankLevel << endl;
-                entity->set("level", toString(tankLevel));
                 continue;
             }
 
-            if (entity->is_a("Junction")) { // just averages pressures, TODO: compute energy exchange with timestep
-                auto inPipes = getInPipes(nID);
-                auto outPipes = getOutPipes(nID);
+            if (S.types[n] == JUNCTION) { // just averages pressures, TODO: compute energy exchange with timestep
                 double commonEnergy = 0;
                 double commonVolume = 0;
                 double commonDensity = 0;
 
-                for (auto p : inPipes) {
-                    commonEnergy += p->pressure2*p->volume*0.5;
-                    commonVolume += p->volume*0.5;
-                    commonDensity += p->density*p->volume*0.5;
-                }
-                for (auto p : outPipes) {
-                    commonEnergy += p->pressure1*p->volume*0.5;
+                for (int j = pBegin; j < pEnd; j++) {
+                    auto& p = S.segments[S.pipes[j]];
+                    commonEnergy += (j < pIn ? p->pressure2 : p->pressure1)*p->volume*0.5;
                     commonVolume += p->volume*0.5;
                     commonDensity += p->density*p->volume*0.5;
                 }
@@ -354,122 +455,89 @@ void VRPipeSystem::update() {
                 double avrgPressure = commonEnergy/commonVolume;
                 double avrgDensity = commonDensity/commonVolume;
 
-                for (auto p : inPipes) {
-                    //p->pressure1 = avrgPressure; // test
-                    p->pressure2 = avrgPressure;
-                    p->density = avrgDensity;
-                }
-                for (auto p : outPipes) {
-                    //p->pressure2 = avrgPressure; // test
-                    p->pressure1 = avrgPressure;
+                for (int j = pBegin; j < pEnd; j++) {
+                    auto& p = S.segments[S.pipes[j]];
+                    if (j < pIn) p->pressure2 = avrgPressure;
+                    else p->pressure1 = avrgPressure;
                     p->density = avrgDensity;
                 }
 
                 continue;
             }
 
-            if (entity->is_a("Pump")) {
-                double pumpPerformance = entity->getValue("performance", 0.0);
-                double pumpMaxPressure = entity->getValue("maxPressure", 0.0);
-                bool pumpIsOpen = entity->getValue("isOpen", false);
-
-                auto pipes = getPipes(nID);
-                if (pipes.size() != 2) continue;
-                auto pipe1 = pipes[0];
-                auto pipe2 = pipes[1];
-                pipe1->handlePump(pumpPerformance, pumpMaxPressure, pumpIsOpen, pipe2, dt, !goesIn(pipe1, nID), goesOut(pipe2, nID));
+            if (S.types[n] == PUMP) {
+                if (Npipes != 2) continue;
+                auto& pipe1 = S.segments[S.pipes[pBegin]];
+                auto& pipe2 = S.segments[S.pipes[pBegin+1]];
+                pipe1->handlePump(S.performance[n], S.maxPressure[n], S.isOpen[n], pipe2, dt, !S.pipeGoesIn[pBegin], S.pipeGoesOut[pBegin+1]);
                 continue;
             }
 
-            if (entity->is_a("Valve")) {
-                bool valveState = entity->getValue("state", false);
-                double valveRadius = entity->getValue("radius", 0.0);
-                if (valveState == 0) continue; // valve closed
-
-                auto pipes = getPipes(nID);
-                if (pipes.size() != 2) continue;
-                auto pipe1 = pipes[0];
-                auto pipe2 = pipes[1];
-                double area = valveRadius*valveRadius*Pi;
-                pipe1->handleValve(area, pipe2, dt, !goesIn(pipe1, nID), goesOut(pipe2, nID));
+            if (S.types[n] == VALVE) {
+                if (!S.valveOpen[n]) continue; // valve closed
+                if (Npipes != 2) continue;
+                auto& pipe1 = S.segments[S.pipes[pBegin]];
+                auto& pipe2 = S.segments[S.pipes[pBegin+1]];
+                double area = S.radius[n]*S.radius[n]*Pi;
+                pipe1->handleValve(area, pipe2, dt, !S.pipeGoesIn[pBegin], S.pipeGoesOut[pBegin+1]);
                 continue;
             }
 
-            if (entity->is_a("Outlet")) {
-                double outletRadius = entity->getValue("radius", 0.0);
-                double outletPressure = entity->getValue("pressure", 1.0);
-                auto pipes = getPipes(nID);
-                if (pipes.size() != 1) continue;
-                auto pipe = pipes[0];
-                double outletDensity = entity->getValue("density", pipe->density);
-                double area = outletRadius*outletRadius*Pi;
-                pipe->handleOutlet(area, outletPressure, outletDensity, dt, goesOut(pipe, nID));
+            if (S.types[n] == OUTLET) {
+                if (Npipes != 1) continue;
+                auto& pipe = S.segments[S.pipes[pBegin]];
+                double outletDensity = S.hasDensity[n] ? S.density[n] : pipe->density;
+                double area = S.radius[n]*S.radius[n]*Pi;
+                pipe->handleOutlet(area, S.pressure[n], outletDensity, dt, S.pipeGoesOut[pBegin]);
                 continue;
             }
         }
 
-        for (auto s : segments) { // compute pressure relaxation
-            double dP = s.second->pressure2 - s.second->pressure1; // compute pressure gradient
-            double kmax = dP*0.5;
-            double k = kmax/(1.0+s.second->length)*min(1.0, dt*gasSpeed);
-            s.second->pressure1 += k;
-            s.second->pressure2 -= k;
-
-            if (s.second->pressure1 < -1e-6 || s.second->pressure2 < -1e-6)
-                cout << "compute pressure relaxation, p1: " << s.second->pressure1 << " p2: " << s.second->pressure1 << " k: " << k << endl;
-        }
-
-        for (auto s : segments) { // compute flows accelerations
-            double m = max(s.second->volume*s.second->density, 0.001); // make sure m doesnt drop to 0
-            double dP = s.second->pressure2 - s.second->pressure1; // compute pressure gradient
-            double F = dP*s.second->area;
-            double R = s.second->density * s.second->flow ; // friction
-            double a = (F-R)/m; // accelleration
-            s.second->dFl1 = a*dt*s.second->area;  // pipe flow change in m³ / s
-            s.second->flowBlocked = false;
-            //if (isNan(s.second->dFl1)) cout << "dFl1 is NaN! m: " << m << " dP: " << dP << " F: " << F << " A: " << s.second->area << " R: " << R << " a: " << a << endl;
-        }
-
-        for (auto n : nodes) { // check for closed nodes
-            int nID = n.first;
-            auto entity = n.second->entity;
-
-            if (entity->is_a("Pump") || entity->is_a("Valve")) {
-                auto pipes = getPipes(nID);
-                if (pipes.size() != 2) continue;
-                auto pipe1 = pipes[0];
-                auto pipe2 = pipes[1];
-
-                bool closed = false;
-                if (entity->is_a("Pump")) {
-                    double pumpPerformance = entity->getValue("performance", 0.0);
-                    bool pumpIsOpen = entity->getValue("isOpen", false);
-                    closed = (pumpPerformance < 1e-3 && !pumpIsOpen);
-                }
-                if (entity->is_a("Valve")) {
-                    bool valveState = entity->getValue("state", false);
-                    closed = (valveState == 0);
+        parallelSegments([&](size_t i0, size_t i1) {
+            for (size_t j = i0; j < i1; j++) {
+                auto& s = *S.segments[j];
+
+                // compute pressure relaxation
+                double dP = s.pressure2 - s.pressure1; // compute pressure gradient
+                double kmax = dP*0.5;
+                double k = kmax/(1.0+s.length)*min(1.0, dt*gasSpeed);
+                s.pressure1 += k;
+                s.pressure2 -= k;
+
+                // compute flows accelerations
+                double m = max(s.volume*s.density, 0.001); // make sure m doesnt drop to 0
+                dP = s.pressure2 - s.pressure1;
+                double F = dP*s.area;
+                double R = s.density * s.flow ; // friction
+                double a = (F-R)/m; // accelleration
+                s.dFl1 = a*dt*s.area;  // pipe flow change in m³ / s
+                s.flowBlocked = false;
+
+                if (s.area < 1e-8) { // closed pipe
+                    s.dFl1 = -s.flow*latency;
+                    s.flowBlocked = true;
                 }
 
-                if (closed) {
-                    pipe1->dFl1 = -pipe1->flow*latency;
-                    pipe2->dFl1 = -pipe2->flow*latency;
-                    pipe1->flowBlocked = true;
-                    pipe2->flowBlocked = true;
-                }
+                s.dFl2 = s.dFl1;
             }
-        }
-
-        for (auto s : segments) { // check for closed pipes
-            double a = s.second->area;
-            if (a < 1e-8) {
-                s.second->dFl1 = -s.second->flow*latency;
-                s.second->flowBlocked = true;
+        });
+
+        for (size_t n = 0; n < Nnodes; n++) { // check for closed nodes
+            bool closed = false;
+            if (S.types[n] == PUMP) closed = (S.performance[n] < 1e-3 && !S.isOpen[n]);
+            else if (S.types[n] == VALVE) closed = !S.valveOpen[n];
+            if (!closed) continue;
+
+            int pBegin = S.pipesStart[n];
+            if (S.pipesStart[n+1] - pBegin != 2) continue;
+            for (int j = pBegin; j < pBegin+2; j++) {
+                auto& pipe = S.segments[S.pipes[j]];
+                pipe->dFl1 = -pipe->flow*latency;
+                pipe->dFl2 = pipe->dFl1;
+                pipe->flowBlocked = true;
             }
         }
 
-        for (auto s : segments) s.second->dFl2 = s.second->dFl1;
-
         //cout << "nodes" << endl;
         int itr = 0;
         bool flowCheck = true;
@@ -477,101 +545,74 @@ void VRPipeSystem::update() {
             itr++;
             if (itr > 10) break;
             flowCheck = false;
-            for (auto n : nodes) { // traverse nodes, change pressure in segments
-                int nID = n.first;
-                auto node = n.second;
-                auto entity = node->entity;
-                if (entity->is_a("Outlet")) continue; // does nothing to a flow
-
-                vector<int> inFlowPipeIDs;
-                vector<int> outFlowPipeIDs;
-                for (auto e : graph->getInEdges(nID) ) {
-                    auto pipe = segments[e.ID];
-                    if (pipe->flow + pipe->dFl2 > 0) inFlowPipeIDs.push_back(e.ID);
-                    if (pipe->flow + pipe->dFl2 < 0) outFlowPipeIDs.push_back(e.ID);
-                }
-                for (auto e : graph->getOutEdges(nID) ) {
-                    auto pipe = segments[e.ID];
-                    if (pipe->flow + pipe->dFl2 > 0) outFlowPipeIDs.push_back(e.ID);
-                    if (pipe->flow + pipe->dFl2 < 0) inFlowPipeIDs.push_back(e.ID);
-                }
+            for (size_t n = 0; n < Nnodes; n++) { // traverse nodes, change pressure in segments
+                if (S.types[n] == OUTLET) continue; // does nothing to a flow
+
+                sortFlows(n);
 
                 double maxInFlow = 0;
                 double maxOutFlow = 0;
-                for (auto eID : inFlowPipeIDs  ) maxInFlow  += abs(segments[eID]->flow + segments[eID]->dFl2);
-                for (auto eID : outFlowPipeIDs ) maxOutFlow += abs(segments[eID]->flow + segments[eID]->dFl2);
+                for (auto p : inFlowPipeIDs  ) maxInFlow  += abs(S.segments[p]->flow + S.segments[p]->dFl2);
+                for (auto p : outFlowPipeIDs ) maxOutFlow += abs(S.segments[p]->flow + S.segments[p]->dFl2);
                 double maxFlow = min(maxInFlow, maxOutFlow);
 
-                if (entity->is_a("Tank")) { // only changes the flow if full or empty!
-                    double tankLevel = entity->getValue("level", 0.0);
+                if (S.types[n] == TANK) { // only changes the flow if full or empty!
+                    double tankLevel = S.level[n];
                     bool empty = bool(tankLevel <= 1e-3);
                     bool full  = bool(tankLevel >= 1.0-1e-3);
                     //cout << " tank, level: " << tankLevel << ", empty? " << empty << ", full? " << full << endl;
                     if (!empty && !full) continue;
 
-                    //if (maxFlow > 1e-6 && maxInFlow > 1e-6 && maxOutFlow > 1e-6) {
-                        if (full) { // if empty the flow out is reduced, but not the flow in!
-                            double outPart = maxFlow/maxOutFlow;
-                            for (auto eID : outFlowPipeIDs ) segments[eID]->dFl2 = (segments[eID]->flow*latency + segments[eID]->dFl2)*outPart - segments[eID]->flow*latency;
-                            if (abs(outPart-1.0) > 1e-3) flowCheck = true;
-                        }
-                        if (empty) { // if full the flow in is reduced, but not the flow out!
-                            double inPart  = maxFlow/maxInFlow;
-                            for (auto eID :  inFlowPipeIDs ) segments[eID]->dFl2 = (segments[eID]->flow*latency + segments[eID]->dFl2)*inPart  - segments[eID]->flow*latency;
-                            if (abs(inPart-1.0) > 1e-3) flowCheck = true;
-                        }
-                    /*} else { // no flow
-                        for (auto eID :  inFlowPipeIDs ) segments[eID]->dFl2 = -segments[eID]->flow*latency;
-                        for (auto eID : outFlowPipeIDs ) segments[eID]->dFl2 = -segments[eID]->flow*latency;
-                        flowCheck = true;
-                    }*/
+                    if (full) { // if empty the flow out is reduced, but not the flow in!
+                        double outPart = maxFlow/maxOutFlow;
+                        for (auto p : outFlowPipeIDs ) S.segments[p]->dFl2 = (S.segments[p]->flow*latency + S.segments[p]->dFl2)*outPart - S.segments[p]->flow*latency;
+                        if (abs(outPart-1.0) > 1e-3) flowCheck = true;
+                    }
+                    if (empty) { // if full the flow in is reduced, but not the flow out!
+                        double inPart  = maxFlow/maxInFlow;
+                        for (auto p :  inFlowPipeIDs ) S.segments[p]->dFl2 = (S.segments[p]->flow*latency + S.segments[p]->dFl2)*inPart  - S.segments[p]->flow*latency;
+                        if (abs(inPart-1.0) > 1e-3) flowCheck = true;
+                    }
                     continue;
                 }
 
                 if (maxFlow > 1e-6 && maxInFlow > 1e-6 && maxOutFlow > 1e-6) {
                     double inPart  = maxFlow/maxInFlow;
                     double outPart = maxFlow/maxOutFlow;
-                    for (auto eID :  inFlowPipeIDs ) segments[eID]->dFl2 = (segments[eID]->flow*latency + segments[eID]->dFl2)*inPart  - segments[eID]->flow*latency;
-                    for (auto eID : outFlowPipeIDs ) segments[eID]->dFl2 = (segments[eID]->flow*latency + segments[eID]->dFl2)*outPart - segments[eID]->flow*latency;
+                    for (auto p :  inFlowPipeIDs ) S.segments[p]->dFl2 = (S.segments[p]->flow*latency + S.segments[p]->dFl2)*inPart  - S.segments[p]->flow*latency;
+                    for (auto p : outFlowPipeIDs ) S.segments[p]->dFl2 = (S.segments[p]->flow*latency + S.segments[p]->dFl2)*outPart - S.segments[p]->flow*latency;
                     if (abs(inPart-1.0) > 1e-3 || abs(outPart-1.0) > 1e-3) flowCheck = true;
                 } else { // no flow
-                    for (auto eID :  inFlowPipeIDs ) segments[eID]->dFl2 = -segments[eID]->flow*latency;
-                    for (auto eID : outFlowPipeIDs ) segments[eID]->dFl2 = -segments[eID]->flow*latency;
+                    for (auto p :  inFlowPipeIDs ) S.segments[p]->dFl2 = -S.segments[p]->flow*latency;
+                    for (auto p : outFlowPipeIDs ) S.segments[p]->dFl2 = -S.segments[p]->flow*latency;
                     flowCheck = true;
                 }
-
-                /*cout << " node " << entity->getName() << " Npipes: " << getPipes(nID).size();
-                for (auto p : getPipes(nID)) cout << ", " << p->eID << " flow: " << p->flow << "+" << p->dFl2;
-                for (auto eID : inFlowPipeIDs) cout << ", in " << eID ;
-                for (auto eID : outFlowPipeIDs) cout << ", out " << eID ;
-                cout << endl;
-                cout << "  node " << entity->getName() << " Npipes: " << getPipes(nID).size() << ", Nin: " << inFlowPipeIDs.size() << ", Nout: " << outFlowPipeIDs.size();
-                cout << ", flow in: " << maxInFlow << ", flow out: " << maxOutFlow << endl;*/
             }
             //break; // TODO: for testing!
         }
 
         //cout << "flows" << endl;
-        for (auto s : segments) { // add final flow accelerations
-            auto& e = graph->getEdge(s.first);
-            if (!nodes.count(e.from) || !nodes.count(e.to)) continue;
-
-            string n1 = nodes[e.from]->name;
-            string n2 = nodes[e.to]->name;
-
-            if (isNan(s.second->dFl2)) {
-                s.second->dFl2 = 0;
-                cout << "Warning in Pipe simulation! dFL is NaN!" << endl;
-                cout << " pipe: " << s.first << ", nodes: " << n1 << " -> " << n2 << endl;
-                cout << " flow: " << s.second->flow << ", dF1: " << s.second->dFl1 << endl;
-            }
-
+        parallelSegments([&](size_t i0, size_t i1) {
+            for (size_t j = i0; j < i1; j++) { // add final flow accelerations
+                if (!S.segmentValid[j]) continue;
+                auto& s = *S.segments[j];
+
+                if (isNan(s.dFl2)) {
+                    auto& e = graph->getEdge(s.eID);
+                    s.dFl2 = 0;
+                    cout << "Warning in Pipe simulation! dFL is NaN!" << endl;
+                    cout << " pipe: " << s.eID << ", nodes: " << nodes.at(e.from)->name << " -> " << nodes.at(e.to)->name << endl;
+                    cout << " flow: " << s.flow << ", dF1: " << s.dFl1 << endl;
+                }
 
-            s.second->flow += s.second->dFl2;  // pipe flow change in m³ / s
+                s.flow += s.dFl2;  // pipe flow change in m³ / s
+            }
+        });
+    }
 
-            //if (abs(s.second->dFl2) > 1e-9 || 1)
-            //    cout << " flow +" << s.second->dFl1 << "/" << s.second->dFl2 << " -> " << s.second->flow << " (" << n1 << "->" << n2 << ") blocked? " << s.second->flowBlocked << endl;
-        }
+    if (syncRate > 0 && ++syncCount >= syncRate) {
+        syncCount = 0;
+        syncToOntology();
     }
 
     //printSystem();
@@ -627,6 +668,7 @@ int VRPipeSystem::insertSegment(int nID, int sID, float radius) {
 
 int VRPipeSystem::disconnect(int nID, int sID) {
     rebuildMesh = true;
+    invalidateState();
     int cID = graph->split(nID, sID);
     auto e = ontology->addEntity("junction", "Junction");
     auto n = VRPipeNode::create(e);
@@ -652,18 +694,18 @@ Vec2d VRPipeSystem::getSegmentGradient(int i) { return Vec2d(segments[i]->pressu
 double VRPipeSystem::getSegmentDensity(int i) { return segments[i]->density; }
 double VRPipeSystem::getSegmentFlow(int i) { return segments[i]->flow; }
 Vec2d VRPipeSystem::getSegmentFlowAccelleration(int i) { return Vec2d(segments[i]->dFl1, segments[i]->dFl2); }
-double VRPipeSystem::getTankPressure(string n) { auto e = getEntity(n); return e ? e->getValue("pressure", 1.0) : 0.0; }
-double VRPipeSystem::getTankDensity(string n) { auto e = getEntity(n); return e ? e->getValue("density", 1.0) : 0.0; }
+double VRPipeSystem::getTankPressure(string n) { int i = getStateIndex(n); if (i >= 0) return state.pressure[i]; auto e = getEntity(n); return e ? e->getValue("pressure", 1.0) : 0.0; }
+double VRPipeSystem::getTankDensity(string n) { int i = getStateIndex(n); if (i >= 0) return state.density[i]; auto e = getEntity(n); return e ? e->getValue("density", 1.0) : 0.0; }
 double VRPipeSystem::getTankVolume(string n) { auto e = getEntity(n); return e ? e->getValue("volume", 1.0) : 0.0; }
 double VRPipeSystem::getPump(string n) { auto e = getEntity(n); return e ? e->getValue("performance", 0.0) : 0.0; }
 bool VRPipeSystem::getValveState(string n) { auto e = getEntity(n); return e ? e->getValue("state", false) : false; }
 
-void VRPipeSystem::setValve(string n, bool b)  { auto e = getEntity(n); if (e) e->set("state", toString(b)); }
-void VRPipeSystem::setTankPressure(string n, double p) { auto e = getEntity(n); if (e) e->set("pressure", toString(p)); }
-void VRPipeSystem::setTankDensity(string n, double p) { auto e = getEntity(n); if (e) e->set("density", toString(p)); }
+void VRPipeSystem::setValve(string n, bool b)  { auto e = getEntity(n); if (e) e->set("state", toString(b)); int i = getStateIndex(n); if (i >= 0) state.valveOpen[i] = b; }
+void VRPipeSystem::setTankPressure(string n, double p) { auto e = getEntity(n); if (e) e->set("pressure", toString(p)); int i = getStateIndex(n); if (i >= 0) state.pressure[i] = p; }
+void VRPipeSystem::setTankDensity(string n, double p) { auto e = getEntity(n); if (e) e->set("density", toString(p)); int i = getStateIndex(n); if (i >= 0) state.density[i] = p; }
 void VRPipeSystem::setPipeRadius(int i, double r) { segments[i]->radius = r; segments[i]->computeGeometry(); }
-void VRPipeSystem::setOutletDensity(string n, double p) { auto e = getEntity(n); if (e) e->set("density", toString(p)); }
-void VRPipeSystem::setOutletPressure(string n, double p) { auto e = getEntity(n); if (e) e->set("pressure", toString(p)); }
+void VRPipeSystem::setOutletDensity(string n, double p) { auto e = getEntity(n); if (e) e->set("density", toString(p)); int i = getStateIndex(n); if (i >= 0) { state.density[i] = p; state.hasDensity[i] = true; } }
+void VRPipeSystem::setOutletPressure(string n, double p) { auto e = getEntity(n); if (e) e->set("pressure", toString(p)); int i = getStateIndex(n); if (i >= 0) state.pressure[i] = p; }
 
 void VRPipeSystem::setPipePressure(int i, double p1, double p2) {
     segments[i]->pressure1 = p1;
@@ -676,6 +718,12 @@ void VRPipeSystem::setPump(string n, double p, double pmax) {
         e->set("performance", toString(p));
         e->set("maxPressure", toString(pmax));
     }
+
+    int i = getStateIndex(n);
+    if (i >= 0) {
+        state.performance[i] = p;
+        state.maxPressure[i] = pmax;
+    }
 }
 
 void VRPipeSystem::setFlowParameters(float l) {
@@ -731,6 +779,7 @@ void VRPipeSystem::updateInspection(int nID) {
 
 void VRPipeSystem::updateVisual() {
     if (!doVisual) return;
+    if (stateDirty) compileState();
 
     VRGeoData data(ptr());
 
@@ -844,9 +893,10 @@ void VRPipeSystem::updateVisual() {
         //cout << "flow " << s.first << " " << f << endl;
     }
 
-    for (auto& n : nodes) {
-        if (n.second->entity->is_a("Tank")) {
-            double l = n.second->entity->getValue("level", 0.0);
+    for (size_t n = 0; n < state.nodeIDs.size(); n++) {
+        int type = state.types[n];
+        if (type == TANK) {
+            double l = state.level[n];
             double A = 3*spread;
             //c = s ? Color3f(0,1,0) : Color3f(1,0,0);
             Pnt3d pwRef1 = data.getPosition(i+3);
@@ -860,16 +910,16 @@ void VRPipeSystem::updateVisual() {
             i += 8;
         } else {
             Color3f c(0.4,0.4,0.4);
-            if (n.second->entity->is_a("Valve")) {
-                bool s = n.second->entity->getValue("state", false);
+            if (type == VALVE) {
+                bool s = state.valveOpen[n];
                 c = s ? Color3f(0,1,0) : Color3f(1,0,0);
             }
 
-            if (n.second->entity->is_a("Junction")) c = Color3f(0.2,0.4,1);
-            if (n.second->entity->is_a("Outlet"))   c = Color3f(0.1,0.2,0.8);
+            if (type == JUNCTION) c = Color3f(0.2,0.4,1);
+            if (type == OUTLET)   c = Color3f(0.1,0.2,0.8);
 
-            if (n.second->entity->is_a("Pump")) {
-                double p = n.second->entity->getValue("performance", 0.0);
+            if (type == PUMP) {
+                double p = state.performance[n];
                 c = p>1e-3 ? Color3f(1,1,0) : Color3f(1,0.5,0);
             }
 
@@ -877,4 +927,3 @@ void VRPipeSystem::updateVisual() {
         }
     }
 }
-
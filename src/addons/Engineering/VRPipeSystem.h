@@ -3,6 +3,7 @@
 
 #include <map>
 #include <vector>
+#include <functional>
 #include <OpenSG/OSGConfig.h>
 #include "VREngineeringFwd.h"
 #include "core/math/VRMathFwd.h"
@@ -61,6 +62,39 @@ class VRPipeNode {
 };
 
 class VRPipeSystem : public VRGeometry {
+    public:
+        enum NodeType { OTHER = 0, TANK, JUNCTION, PUMP, VALVE, OUTLET };
+
+        /*
+         * flat simulation state, compiled from the graph and the ontology when the topology changes,
+         * pipes of node n are pipes[pipesStart[n]] to pipes[pipesStart[n+1]-1], the first nInPipes[n] are in pipes
+         */
+        struct State {
+            vector<int> nodeIDs;
+            map<int, int> nodeIndices;
+            vector<int> types;
+            vector<double> pressure;
+            vector<double> volume;
+            vector<double> density;
+            vector<double> level;
+            vector<double> performance;
+            vector<double> maxPressure;
+            vector<double> radius;
+            vector<char> isOpen;
+            vector<char> valveOpen;
+            vector<char> hasDensity;
+            vector<string> synced; // pressure, density and level of each node as last read from or written to the ontology
+
+            vector<int> pipesStart;
+            vector<int> nInPipes;
+            vector<int> pipes;
+            vector<char> pipeGoesIn;
+            vector<char> pipeGoesOut;
+
+            vector<VRPipeSegmentPtr> segments;
+            vector<char> segmentValid;
+        };
+
 	private:
         GraphPtr graph;
         VROntologyPtr ontology;
@@ -78,7 +112,17 @@ class VRPipeSystem : public VRGeometry {
         map<string, int> nodesByName;
         map<int, VRPipeSegmentPtr> segments;
 
+        State state;
+        bool stateDirty = true;
+        int syncRate = 1;
+        int syncCount = 0;
+
         void initOntology();
+        void compileState();
+        void invalidateState();
+        void writeTankStates(bool keepEdits);
+        int getStateIndex(string name);
+        void parallelSegments(function<void(size_t, size_t)> f);
 
         vector<VRPipeSegmentPtr> getPipes(int nID);
         vector<VRPipeSegmentPtr> getInPipes(int nID);
@@ -113,6 +157,9 @@ class VRPipeSystem : public VRGeometry {
         int insertSegment(int nID, int sID, float radius);
 		void setFlowParameters(float latency);
 		void setDoVisual(bool b, float spread = 0.1);
+		void setSyncRate(int frames);
+		void syncToOntology();
+		void syncFromOntology();
 
 		void update();
 		void updateVisual();
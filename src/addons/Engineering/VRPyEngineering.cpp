@@ -69,6 +69,9 @@ PyMethodDef VRPyPipeSystem::methods[] = {
     {"setOutletDensity", PyWrap( PipeSystem, setOutletDensity, "Set outlet exterior density", void, string, double ) },
     {"setOutletPressure", PyWrap( PipeSystem, setOutletPressure, "Set outlet exterior pressure", void, string, double ) },
     {"printSystem", PyWrap( PipeSystem, printSystem, "Print system state to console", void ) },
+    {"setSyncRate", PyWrap( PipeSystem, setSyncRate, "Write the simulated tank states to the ontology every n frames, 0 to only sync with syncToOntology", void, int ) },
+    {"syncToOntology", PyWrap( PipeSystem, syncToOntology, "Write the simulated tank states to the ontology", void ) },
+    {"syncFromOntology", PyWrap( PipeSystem, syncFromOntology, "Reload the simulation state from the ontology, use after changing node entities directly", void ) },
     {"updateInspection", PyWrap( PipeSystem, updateInspection, "Visualize node information", void, int ) },
     {NULL}
 };
@@ -86,6 +89,8 @@ PyMethodDef VRPyElectricSystem::methods[] = {
     {"getLADVariables", PyWrap( ElectricSystem, getLADVariables, "Get LAD variables", strLadMap ) },
     {"getObjectsByName", PyWrap( ElectricSystem, getObjectsByName, "Get objects map", strObjMap ) },
     {"simECAD", PyWrap( ElectricSystem, simECAD, "Do simulation step", void ) },
+    {"getSimulation", PyWrap( ElectricSystem, getSimulation, "Get wiring simulation", VRWiringSimulationPtr ) },
+    {"invalidateSimulation", PyWrap( ElectricSystem, invalidateSimulation, "Recompile the wiring netlist on the next simulation step, needed after changing wires", void ) },
     {"getRegistred", PyWrap( ElectricSystem, getRegistred, "Get components", vector<VRElectricComponentPtr>, string ) },
     {"getComponents", PyWrap( ElectricSystem, getComponents, "Get components", intECompMap ) },
     {"getComponentsByEGraphID", PyWrap( ElectricSystem, getComponentsByEGraphID, "Get components", intECompMap ) },
@@ -115,6 +120,10 @@ PyMethodDef VRPyWire::methods[] = {
 };
 
 PyMethodDef VRPyWiringSimulation::methods[] = {
+    {"setSource", PyWrapOpt( WiringSimulation, setSource, "Set powered component and port (ecadID, port)", "0", void, string, string ) },
+    {"invalidate", PyWrap( WiringSimulation, invalidate, "Recompile the netlist on the next step", void ) },
+    {"iterate", PyWrap( WiringSimulation, iterate, "Do simulation step, only parts downstream of changed switches are updated", void ) },
+    {"iterateReference", PyWrap( WiringSimulation, iterateReference, "Do full simulation step, resets and propagates all currents", void ) },
     {NULL}
 };
 
@@ -152,7 +161,10 @@ PyMethodDef VRPyElectricComponent::methods[] = {
 PyMethodDef VRPyLADEngine::methods[] = {
     {"setElectricEngine", PyWrap( LADEngine, setElectricEngine, "Set electric system", void, VRElectricSystemPtr ) },
     {"read", PyWrap( LADEngine, read, "Read data, first path is full path to tag table 'Default tag table.xml', second path is path to modules folder '../Programmbausteine'", void, string, string ) },
-    {"iterate", PyWrap( LADEngine, iterate, "Run iteration", void ) },
+    {"iterate", PyWrapOpt( LADEngine, iterate, "Run scan cycles, each until the signals are stable, (cycles)", "1", void, int ) },
+    {"compile", PyWrap( LADEngine, compile, "Compile the LAD program, done automatically on first iteration", void ) },
+    {"setCompiled", PyWrap( LADEngine, setCompiled, "Use the compiled program or the interpreter, for comparison", void, bool ) },
+    {"verify", PyWrapOpt( LADEngine, verify, "Run cycles with the interpreter, then with the compiled program from the same state, returns false on the first difference, (cycles)", "10", bool, int ) },
     {"getCompileUnits", PyWrap( LADEngine, getCompileUnits, "Return IDs of compile units", vector<string> ) },
     {"getCompileUnitWires", PyWrapOpt( LADEngine, getCompileUnitWires, "Return IDs of compile unit wires, optional pnly powered wired", "0", vector<string>, string, bool ) },
     {"getCompileUnitParts", PyWrap( LADEngine, getCompileUnitParts, "Return IDs of compile unit parts", vector<string>, string ) },
@@ -187,9 +199,14 @@ PyMethodDef VRPyLADVariable::methods[] = {
 
 PyMethodDef VRPySCLScript::methods[] = {
     {"readSCL", PyWrap( SCLScript, readSCL, "read a scl script", void, string ) },
-    {"convert", PyWrap( SCLScript, convert, "convert the scl script to python", void ) },
+    {"setSCL", PyWrap( SCLScript, setSCL, "set the scl source", void, string ) },
+    {"convert", PyWrap( SCLScript, convert, "compile the scl script to bytecode, global tags are bound to the electric system variables", void ) },
+    {"run", PyWrap( SCLScript, run, "run one cycle of the compiled script", void ) },
+    {"getValue", PyWrap( SCLScript, getValue, "get the value of a variable", double, string ) },
+    {"setValue", PyWrap( SCLScript, setValue, "set the value of a variable", void, string, double ) },
     {"getScl", PyWrap( SCLScript, getScl, "get the scl script", string ) },
     {"getPython", PyWrap( SCLScript, getPython, "get the python script", string ) },
+    {"getBytecode", PyWrap( SCLScript, getBytecode, "get the compiled bytecode", string ) },
     {NULL}
 };
 
@@ -197,7 +214,9 @@ PyMethodDef VRPySCLEngine::methods[] = {
     {"setElectricEngine", PyWrap( SCLEngine, setElectricEngine, "set the electric system", void, VRElectricSystemPtr ) },
     {"readSCL", PyWrap( SCLEngine, readSCL, "read an scl script and name it, returns the scl script", VRSCLScriptPtr, string, string ) },
     {"getScript", PyWrap( SCLEngine, getScript, "return scl script by name", VRSCLScriptPtr, string ) },
-    {"iterate", PyWrap( SCLEngine, iterate, "run tick", void ) },
+    {"setLADEngine", PyWrap( SCLEngine, setLADEngine, "set a LAD engine, cycled before the scl scripts", void, VRLADEnginePtr ) },
+    {"addSCL", PyWrap( SCLEngine, addSCL, "add an scl script from source and name it, returns the scl script", VRSCLScriptPtr, string, string ) },
+    {"iterate", PyWrapOpt( SCLEngine, iterate, "run ticks, each runs the LAD engine and then all scl scripts", "1", void, int ) },
     {NULL}
 };
 
@@ -239,6 +258,15 @@ PyMethodDef VRPyRobotArm::methods[] = {
     {"moveOnPath", PyWrapOpt(RobotArm, moveOnPath, "Move robot on internal path - moveOnPath(t0, t1, doLoop=0, durationMultiplier=1, local=0)", "0|1|0", void, float, float, bool, float, bool) },
     {"isMoving", PyWrap(RobotArm, isMoving, "Get animation status", bool) },
     {"setEventCallback", PyWrap(RobotArm, setEventCallback, "Set callback for move and stop events", void, VRMessageCbPtr) },
+    {"setJointLimits", PyWrap(RobotArm, setJointLimits, "Set joint angle ranges [min, max] for each joint, used by checkPoses", void, vector<Vec2d>) },
+    {"getJointLimits", PyWrap(RobotArm, getJointLimits, "Get joint angle ranges", vector<Vec2d>) },
+    {"setReachTolerance", PyWrap(RobotArm, setReachTolerance, "Set position and direction tolerance for reachability checks, default 1e-3", void, float) },
+    {"setSingularityThreshold", PyWrap(RobotArm, setSingularityThreshold, "Set conditioning below which poses are flagged as near a singularity, default 1e-2", void, float) },
+    {"setRefineSteps", PyWrap(RobotArm, setRefineSteps, "Set number of numeric refinement steps for poses missed by the analytic model, default 0", void, int) },
+    {"calcReverseKinematicsBatch", PyWrapOpt(RobotArm, calcReverseKinematicsBatch, "Compute joint angles for a list of poses on worker threads - calcReverseKinematicsBatch(poses | local)", "0", vector<vector<float>>, vector<PosePtr>, bool) },
+    {"calcForwardKinematicsBatch", PyWrap(RobotArm, calcForwardKinematicsBatch, "Compute end effector poses in robot coords for a list of joint angles", vector<PosePtr>, vector<vector<float>>) },
+    {"checkPoses", PyWrapOpt(RobotArm, checkPoses, "Check a list of poses, returns flags per pose, 1: reachable, 2: in joint limits, 4: near singularity, empty for the aubo type - checkPoses(poses | local)", "0", vector<int>, vector<PosePtr>, bool) },
+    {"getConditioning", PyWrap(RobotArm, getConditioning, "Get the jacobian conditioning for a list of joint angles, 0 at singularities, 1 for isotropic configurations", vector<float>, vector<vector<float>>) },
     {NULL}  /* Sentinel */
 };
 
@@ -7,6 +7,7 @@
 #include "core/utils/toString.h"
 #include "core/utils/isNan.h"
 #include "core/tools/VRAnalyticGeometry.h"
+#include "core/utils/VRThreadPool.h"
 #include <OpenSG/OSGQuaternion.h>
 
 using namespace OSG;
@@ -27,7 +28,7 @@ VRRobotArm::System::System() {
 
 VRRobotArm::System::~System() {}
 
-double VRRobotArm::System::convertAngle(double a, int i) {
+double VRRobotArm::System::convertAngle(double a, int i) const {
     if (i >= angle_directions.size() || i >= angle_offsets.size()) return 0;
     return angle_directions[i]*a + angle_offsets[i]*Pi;
 }
@@ -118,48 +119,54 @@ struct SystemKuka : VRRobotArm::System {
         updateSystem();
     }
 
-    vector<float> calcReverseKinematics(PosePtr p) { // kuka
-        eePose = Pose::create( *p );
-        Vec3d pos = p->pos();
-        Vec3d dir = p->dir();
-        Vec3d up  = p->up();
+    struct Joints { // intermediate results, shown by the analytics
+        double ang_f = 0;
+        double ang_a = 0;
+        double ang_b = 0;
+        Vec3d edge0;
+        Vec3d edge1;
+        Vec3d avec;
+    };
+
+    vector<float> solve(Pose p, vector<float> resultingAngles, Joints& J) const { // kuka
+        Vec3d pos = p.pos();
+        Vec3d dir = p.dir();
+        Vec3d up  = p.up();
         dir.normalize();
         up.normalize();
         pos -= dir* lengths[3];
 
-        vector<float> resultingAngles = angle_targets;
-
         pos[1] -= lengths[0];
 
-        ang_f = atan2(pos[0], pos[2]);
-        resultingAngles[0] = ang_f;
-        edge0 = Vec3d(cos(-ang_f),0,sin(-ang_f));
+        J.ang_f = atan2(pos[0], pos[2]);
+        resultingAngles[0] = J.ang_f;
+        J.edge0 = Vec3d(cos(-J.ang_f),0,sin(-J.ang_f));
 
-        Vec3d aD = Vec3d(sin(ang_f), 0, cos(ang_f));
+        Vec3d aD = Vec3d(sin(J.ang_f), 0, cos(J.ang_f));
         pos -= aD * axis_offsets[0];
 
         float r1 = lengths[1];
         float L = pos.length();
-        ang_b = acos( clamp( (L*L-r1*r1-dist2*dist2)/(-2*r1*dist2) ) );
-        resultingAngles[2] = -ang_b + Pi + ang_ba;
+        J.ang_b = acos( clamp( (L*L-r1*r1-dist2*dist2)/(-2*r1*dist2) ) );
+        resultingAngles[2] = -J.ang_b + Pi + ang_ba;
 
-        ang_a = asin( clamp( dist2*sin(ang_b)/L ) ) + asin( clamp( pos[1]/L ) );
-        resultingAngles[1] = ang_a - Pi*0.5;
+        J.ang_a = asin( clamp( dist2*sin(J.ang_b)/L ) ) + asin( clamp( pos[1]/L ) );
+        resultingAngles[1] = J.ang_a - Pi*0.5;
 
         // end effector
-        float e = ang_a+ang_b-ang_ba; // counter angle
-        avec = Vec3d(-cos(e)*sin(ang_f), -sin(e), -cos(e)*cos(ang_f));
-        edge1 = dir.cross(avec);
-        edge1.normalize();
+        float e = J.ang_a+J.ang_b-ang_ba; // counter angle
+        J.avec = Vec3d(-cos(e)*sin(J.ang_f), -sin(e), -cos(e)*cos(J.ang_f));
+        J.edge1 = dir.cross(J.avec);
+        J.edge1.normalize();
 
-        float det = avec.dot( edge1.cross(edge0) );
-        float g = clamp( -edge1.dot(edge0) );
+        float det = J.avec.dot( J.edge1.cross(J.edge0) );
+        float g = clamp( -J.edge1.dot(J.edge0) );
         resultingAngles[3] = det < 0 ? -acos(g) : acos(g);
-        resultingAngles[4] = acos( avec.dot(dir) );
+        resultingAngles[4] = acos( J.avec.dot(dir) );
 
         if (resultingAngles.size() > 4) {
-            float det = dir.dot( edge1.cross(up) );
-            resultingAngles[5] = det < 0 ? -acos( edge1.dot(up) ) : acos( edge1.dot(up) );
+            float det = dir.dot( J.edge1.cross(up) );
+            resultingAngles[5] = det < 0 ? -acos( J.edge1.dot(up) ) : acos( J.edge1.dot(up) );
         }
 
         //calcForwardKinematicsKuka(resultingAngles); // temp, remove once debugged!
@@ -167,7 +174,25 @@ struct SystemKuka : VRRobotArm::System {
         return resultingAngles;
     }
 
-    PosePtr calcForwardKinematics(vector<float> angles) { // kuka
+    vector<float> solveReverseKinematics(Pose p, vector<float> seed) const { // kuka
+        Joints J;
+        return solve(p, seed, J);
+    }
+
+    vector<float> calcReverseKinematics(PosePtr p) { // kuka
+        eePose = Pose::create( *p );
+        Joints J;
+        auto resultingAngles = solve(*p, angle_targets, J);
+        ang_f = J.ang_f;
+        ang_a = J.ang_a;
+        ang_b = J.ang_b;
+        edge0 = J.edge0;
+        edge1 = J.edge1;
+        avec = J.avec;
+        return resultingAngles;
+    }
+
+    PosePtr calcForwardKinematics(vector<float> angles) const { // kuka
         float r1 = lengths[1];
         float r2 = lengths[2];
         //float b = Pi-angles[2];
@@ -283,15 +308,43 @@ struct SystemAubo : VRRobotArm::System {
         //parts = base->getChildren(true, "", true);
     }
 
+    struct Joints { // intermediate results, shown by the analytics
+        Vec3d pJ0;
+        Vec3d pJ1;
+        Vec3d pJ2;
+        Vec3d edge0;
+        Vec3d nplane;
+        Vec3d posXZ;
+    };
+
+    vector<float> solveReverseKinematics(Pose p, vector<float> seed) const { // aubo
+        Joints J;
+        return solve(p, seed, J);
+    }
+
     vector<float> calcReverseKinematics(PosePtr p) { // aubo
         eePose = Pose::create( *p );
-        Vec3d pos = p->pos();
-        Vec3d dir = p->dir();
-        Vec3d up  = p->up();
+        Joints J;
+        auto resultingAngles = solve(*p, angle_targets, J);
+        pJ0 = J.pJ0;
+        pJ1 = J.pJ1;
+        pJ2 = J.pJ2;
+        edge0 = J.edge0;
+        nplane = J.nplane;
+        posXZ = J.posXZ;
+        return resultingAngles;
+    }
+
+    vector<float> solve(Pose p, vector<float> resultingAngles, Joints& J) const { // aubo
+        Vec3d pos = p.pos();
+        Vec3d dir = p.dir();
+        Vec3d up  = p.up();
 
         // front kinematics
         pos -= dir* lengths[3]; // yield space for tool
 
+        Vec3d& posXZ = J.posXZ;
+        Vec3d& nplane = J.nplane;
         posXZ = Vec3d(pos[0], 0, pos[2]);
         float w = acos(lengths[6]/posXZ.length());
         nplane = posXZ;
@@ -303,12 +356,10 @@ struct SystemAubo : VRRobotArm::System {
         Vec3d e = dir.cross(nplane); // TODO: handle n // d
         e.normalize();
 
-        Vec3d Pnt1 = p->pos()-dir*lengths[3];
+        Vec3d Pnt1 = p.pos()-dir*lengths[3];
         Vec3d Pnt2 = Pnt1-e*lengths[5];
         Vec3d Pnt3 = Pnt2-nplane*lengths[6];
 
-        vector<float> resultingAngles = angle_targets;
-
         // main arm
         pos = Pnt3;
         pos[1] -= lengths[0]; // substract base offset
@@ -325,10 +376,13 @@ struct SystemAubo : VRRobotArm::System {
         float f = atan2(pos[0], pos[2]);
         resultingAngles[0] = f;
 
-        edge0 = Vec3d(cos(-f),0,sin(-f));
+        J.edge0 = Vec3d(cos(-f),0,sin(-f));
 
 
         // last angle connecting both subsystems
+        Vec3d& pJ0 = J.pJ0;
+        Vec3d& pJ1 = J.pJ1;
+        Vec3d& pJ2 = J.pJ2;
         pJ0 = Vec3d(0,lengths[0],0); // base joint
         pJ1 = pJ0 + Vec3d(cos(a)*sin(f), sin(a), cos(a)*cos(f)) * lengths[1]; // elbow joint
         pJ2 = pJ1 - Vec3d(cos(a+b)*sin(f), sin(a+b), cos(a+b)*cos(f)) * lengths[2]; // wrist joint (P3)
@@ -348,7 +402,9 @@ struct SystemAubo : VRRobotArm::System {
         return resultingAngles;
     }
 
-    PosePtr calcForwardKinematics(vector<float> angles) { // aubo
+    bool hasForwardKinematics() const { return false; } // aubo
+
+    PosePtr calcForwardKinematics(vector<float> angles) const { // aubo
         return 0;//getLastPose();
         /*if (parts.size() < 5) return 0;
         auto pose = parts[4]->getWorldPose();
@@ -523,11 +579,21 @@ struct SystemDelta : VRRobotArm::System {
         updateSystem();
     }
 
+    vector<float> solveReverseKinematics(Pose p, vector<float> seed) const { // delta
+        Pose ee;
+        return solve(p, seed, ee);
+    }
+
     vector<float> calcReverseKinematics(PosePtr p) { // delta
         eePose = Pose::create( *p );
-        Vec3d pos = p->pos();
-        Vec3d dir = p->dir();
-        Vec3d up  = p->up();
+        return solve(*p, angle_targets, *eePose);
+    }
+
+    vector<float> solve(Pose p, vector<float> resultingAngles, Pose& ee) const { // delta, ee is the reachable pose
+        ee = p;
+        Vec3d pos = p.pos();
+        Vec3d dir = p.dir();
+        Vec3d up  = p.up();
         float L = pos.length();
 
         double baseOffset = lengths[0];
@@ -552,7 +618,7 @@ struct SystemDelta : VRRobotArm::System {
 
         if (Lk < 1.0) {
             pos *= Lk;
-            eePose->setPos(pos);
+            ee.setPos(pos);
             L = pos.length();
         }
 
@@ -565,7 +631,6 @@ struct SystemDelta : VRRobotArm::System {
         auto sign = [](float a) { return a >= 0 ? 1 : -1; };
         auto toDeg = [](float a) { return int(a/Pi*180); };
 
-        vector<float> resultingAngles = angle_targets;
         for (int i=0; i<3; i++) {
             // upper arm circle
             Vec3d O = armRoots[i];
@@ -630,7 +695,7 @@ struct SystemDelta : VRRobotArm::System {
         return resultingAngles;
     }
 
-    PosePtr calcForwardKinematics(vector<float> angles) { // delta
+    PosePtr calcForwardKinematics(vector<float> angles) const { // delta
         double baseOffset = lengths[0];
         double arm1Length = lengths[1];
         double arm2Length = lengths[2];
@@ -797,7 +862,7 @@ VRRobotArm::VRRobotArm(string type) : type(type) {
     anim->addCallback(animPtr);
 
     updatePtr = VRUpdateCb::create("run engines", bind(&VRRobotArm::update, this) );
-    VRScene::getCurrent()->addUpdateFkt(updatePtr, 999);
+    if (auto scene = VRScene::getCurrent()) scene->addUpdateFkt(updatePtr, 999);
 }
 
 VRRobotArm::~VRRobotArm() {
@@ -1077,3 +1142,260 @@ void VRRobotArm::setPath(PathPtr p, PathPtr po) {
 PathPtr VRRobotArm::getPath() { return robotPath; }
 PathPtr VRRobotArm::getOrientationPath() { return orientationPath; }
 
+
+
+/*
+
+Batched Kinematics
+
+- samples are independent, each worker thread solves a contiguous range of poses
+- systems without forward kinematics (aubo) are rejected, only calcReverseKinematicsBatch works for them
+- the analytic solution is verified with the forward kinematics, same tolerances as canReach
+- optional damped least squares refinement for poses the analytic model misses
+- joint limits are checked on the joint angles, see getTargetAngles
+- the jacobian is computed by finite differences over position, direction and up vector
+
+*/
+
+void VRRobotArm::setJointLimits(vector<Vec2d> limits) { system->limits = limits; }
+vector<Vec2d> VRRobotArm::getJointLimits() { return system->limits; }
+void VRRobotArm::setReachTolerance(float t) { reachTolerance = t; }
+void VRRobotArm::setSingularityThreshold(float t) { singularityThreshold = t; }
+void VRRobotArm::setRefineSteps(int N) { refineSteps = N; }
+
+void VRRobotArm::parallelSamples(size_t N, function<void(size_t, size_t)> f) const {
+    VRThreadPool::get()->parallelFor(N, 64, f);
+}
+
+bool VRRobotArm::canBatch(string method) const {
+    if (system->hasForwardKinematics()) return true;
+    cout << "Error in VRRobotArm::" << method << ": no forward kinematics for type " << type << ", the samples can not be verified!" << endl;
+    return false;
+}
+
+vector<PosePtr> VRRobotArm::toLocal(vector<PosePtr> poses, bool local) {
+    if (local) return poses;
+    updateLGTransforms();
+    for (auto& p : poses) if (p) p = p->multLeft(gToL);
+    return poses;
+}
+
+bool VRRobotArm::reaches(Pose target, PosePtr p) const {
+    if (!p) return false;
+    if (p->pos().dist( target.pos() ) > reachTolerance) return false;
+    auto d = target.dir();
+    auto d2 = p->dir();
+    d.normalize();
+    d2.normalize();
+    return d2.dot(d) >= 1.0-reachTolerance;
+}
+
+vector<double> VRRobotArm::calcJacobian(const vector<float>& angles, PosePtr p) const { // 9 x N, row major
+    size_t N = angles.size();
+    vector<double> J(9*N, 0);
+    if (!p) return J;
+
+    double h = 1e-4;
+    Vec3d P[3] = { p->pos(), p->dir(), p->up() };
+    vector<float> a = angles;
+    for (size_t j=0; j<N; j++) {
+        a[j] = angles[j] + h;
+        auto pj = system->calcForwardKinematics(a);
+        a[j] = angles[j];
+        if (!pj) continue;
+        Vec3d Pj[3] = { pj->pos(), pj->dir(), pj->up() };
+        for (int k=0; k<3; k++) {
+            Vec3d D = (Pj[k] - P[k]) * (1.0/h);
+            for (int l=0; l<3; l++) J[(k*3+l)*N + j] = D[l];
+        }
+    }
+    return J;
+}
+
+bool solveLinear(vector<double>& A, vector<double>& b, size_t N) { // gaussian elimination with partial pivoting, solution in b
+    for (size_t c=0; c<N; c++) {
+        size_t p = c;
+        for (size_t r=c+1; r<N; r++) if (abs(A[r*N+c]) > abs(A[p*N+c])) p = r;
+        if (abs(A[p*N+c]) < 1e-12) return false;
+        if (p != c) {
+            for (size_t k=0; k<N; k++) swap(A[c*N+k], A[p*N+k]);
+            swap(b[c], b[p]);
+        }
+        for (size_t r=c+1; r<N; r++) {
+            double f = A[r*N+c] / A[c*N+c];
+            for (size_t k=c; k<N; k++) A[r*N+k] -= f*A[c*N+k];
+            b[r] -= f*b[c];
+        }
+    }
+    for (size_t c=N; c-- > 0;) {
+        for (size_t k=c+1; k<N; k++) b[c] -= A[c*N+k]*b[k];
+        b[c] /= A[c*N+c];
+    }
+    return true;
+}
+
+vector<double> symmetricEigenvalues(vector<double> A, size_t N) { // cyclic jacobi rotations
+    for (int sweep=0; sweep<50; sweep++) {
+        double off = 0;
+        for (size_t i=0; i<N; i++) for (size_t j=i+1; j<N; j++) off += A[i*N+j]*A[i*N+j];
+        if (off < 1e-20) break;
+
+        for (size_t p=0; p<N; p++) {
+            for (size_t q=p+1; q<N; q++) {
+                double apq = A[p*N+q];
+                if (abs(apq) < 1e-30) continue;
+                double theta = (A[q*N+q] - A[p*N+p]) / (2*apq);
+                double t = (theta >= 0 ? 1 : -1) / (abs(theta) + sqrt(theta*theta + 1));
+                double c = 1.0 / sqrt(t*t + 1);
+                double s = t*c;
+                for (size_t k=0; k<N; k++) { // rotate columns
+                    double akp = A[k*N+p];
+                    double akq = A[k*N+q];
+                    A[k*N+p] = c*akp - s*akq;
+                    A[k*N+q] = s*akp + c*akq;
+                }
+                for (size_t k=0; k<N; k++) { // rotate rows
+                    double apk = A[p*N+k];
+                    double aqk = A[q*N+k];
+                    A[p*N+k] = c*apk - s*aqk;
+                    A[q*N+k] = s*apk + c*aqk;
+                }
+            }
+        }
+    }
+
+    vector<double> res(N);
+    for (size_t i=0; i<N; i++) res[i] = A[i*N+i];
+    return res;
+}
+
+double jacobianConditioning(const vector<double>& J, size_t N) { // sqrt of smallest over largest eigenvalue of JtJ
+    vector<double> JtJ(N*N, 0);
+    for (size_t i=0; i<N; i++) {
+        for (size_t j=i; j<N; j++) {
+            double v = 0;
+            for (int r=0; r<9; r++) v += J[r*N+i]*J[r*N+j];
+            JtJ[i*N+j] = JtJ[j*N+i] = v;
+        }
+    }
+
+    auto ev = symmetricEigenvalues(JtJ, N);
+    double emin = ev[0];
+    double emax = ev[0];
+    for (auto e : ev) { emin = min(emin, e); emax = max(emax, e); }
+    if (emax <= 0) return 0;
+    return sqrt(max(0.0, emin) / emax);
+}
+
+void VRRobotArm::refineSample(Pose target, Sample& s) const { // damped least squares on position and direction
+    size_t N = s.angles.size();
+    double lambda2 = 1e-4;
+    Vec3d tp = target.pos();
+    Vec3d td = target.dir();
+    td.normalize();
+
+    for (int k=0; k<refineSteps; k++) {
+        if (reaches(target, s.pose)) return;
+
+        auto J = calcJacobian(s.angles, s.pose);
+        Vec3d dp = tp - s.pose->pos();
+        Vec3d dd = td - s.pose->dir();
+        double r[6] = { dp[0], dp[1], dp[2], dd[0], dd[1], dd[2] };
+
+        vector<double> A(N*N, 0);
+        vector<double> b(N, 0);
+        for (size_t i=0; i<N; i++) {
+            for (size_t j=0; j<N; j++) {
+                for (int l=0; l<6; l++) A[i*N+j] += J[l*N+i]*J[l*N+j];
+            }
+            A[i*N+i] += lambda2;
+            for (int l=0; l<6; l++) b[i] += J[l*N+i]*r[l];
+        }
+        if (!solveLinear(A, b, N)) return;
+
+        for (size_t i=0; i<N; i++) s.angles[i] += b[i];
+        s.pose = system->calcForwardKinematics(s.angles);
+        if (!s.pose) return;
+    }
+}
+
+void VRRobotArm::checkSample(Pose target, Sample& s) const {
+    s.flags = 0;
+    for (auto a : s.angles) if (isNan(a)) return;
+
+    s.pose = system->calcForwardKinematics(s.angles);
+    if (!s.pose) return;
+    if (refineSteps > 0) refineSample(target, s);
+    s.error = s.pose->pos().dist( target.pos() );
+    if (reaches(target, s.pose)) s.flags |= REACHABLE;
+
+    bool inLimits = true;
+    for (size_t i=0; i<s.angles.size() && i<system->limits.size(); i++) {
+        Vec2d l = system->limits[i];
+        double a = system->convertAngle(s.angles[i], i);
+        while (a < l[0]) a += 2*Pi;
+        while (a >= l[0]+2*Pi) a -= 2*Pi;
+        if (a > l[1]) inLimits = false;
+    }
+    if (inLimits) s.flags |= IN_LIMITS;
+
+    s.conditioning = jacobianConditioning(calcJacobian(s.angles, s.pose), s.angles.size());
+    if (s.conditioning < singularityThreshold) s.flags |= SINGULAR;
+}
+
+vector<VRRobotArm::Sample> VRRobotArm::solveBatch(vector<PosePtr> poses, bool local) {
+    if (!canBatch("solveBatch")) return {};
+    poses = toLocal(poses, local);
+    vector<Sample> samples(poses.size());
+    auto seed = system->angle_targets;
+
+    parallelSamples(poses.size(), [&](size_t i0, size_t i1) {
+        for (size_t i=i0; i<i1; i++) {
+            if (!poses[i]) continue;
+            samples[i].angles = system->solveReverseKinematics(*poses[i], seed);
+            checkSample(*poses[i], samples[i]);
+        }
+    });
+    return samples;
+}
+
+vector<vector<float>> VRRobotArm::calcReverseKinematicsBatch(vector<PosePtr> poses, bool local) {
+    poses = toLocal(poses, local);
+    vector<vector<float>> res(poses.size());
+    auto seed = system->angle_targets;
+
+    parallelSamples(poses.size(), [&](size_t i0, size_t i1) {
+        for (size_t i=i0; i<i1; i++) {
+            if (poses[i]) res[i] = system->solveReverseKinematics(*poses[i], seed);
+        }
+    });
+    return res;
+}
+
+vector<PosePtr> VRRobotArm::calcForwardKinematicsBatch(vector<vector<float>> angles) {
+    if (!canBatch("calcForwardKinematicsBatch")) return {};
+    vector<PosePtr> res(angles.size());
+    parallelSamples(angles.size(), [&](size_t i0, size_t i1) {
+        for (size_t i=i0; i<i1; i++) res[i] = system->calcForwardKinematics(angles[i]);
+    });
+    return res;
+}
+
+vector<int> VRRobotArm::checkPoses(vector<PosePtr> poses, bool local) {
+    if (!canBatch("checkPoses")) return {};
+    vector<int> res;
+    for (auto& s : solveBatch(poses, local)) res.push_back(s.flags);
+    return res;
+}
+
+vector<float> VRRobotArm::getConditioning(vector<vector<float>> angles) {
+    if (!canBatch("getConditioning")) return {};
+    vector<float> res(angles.size(), 0);
+    parallelSamples(angles.size(), [&](size_t i0, size_t i1) {
+        for (size_t i=i0; i<i1; i++) {
+            auto p = system->calcForwardKinematics(angles[i]);
+            if (p) res[i] = jacobianConditioning(calcJacobian(angles[i], p), angles[i].size());
+        }
+    });
+    return res;
+}
@@ -9,6 +9,7 @@
 
 #include <list>
 #include <vector>
+#include <functional>
 
 OSG_BEGIN_NAMESPACE;
 using namespace std;
@@ -27,6 +28,7 @@ class VRRobotArm {
             vector<float> lengths = {0,0,0,0,0};
             vector<float> axis_offsets = {0,0};
             vector<int> axis = {1,0,0,2,0,2};
+            vector<Vec2d> limits; // joint angle ranges, empty for unlimited joints
 
             System();
             virtual ~System();
@@ -35,11 +37,23 @@ class VRRobotArm {
             virtual void updateSystem() = 0;
             virtual void genKinematics() = 0;
             virtual vector<float> calcReverseKinematics(PosePtr p) = 0;
-            virtual PosePtr calcForwardKinematics(vector<float> angles) = 0;
+            virtual vector<float> solveReverseKinematics(Pose p, vector<float> seed) const = 0; // no side effects, safe to call from worker threads
+            virtual PosePtr calcForwardKinematics(vector<float> angles) const = 0;
+            virtual bool hasForwardKinematics() const { return true; } // the batched checks verify with it
             virtual void updateAnalytics() = 0;
             virtual void applyAngles() = 0;
 
-            double convertAngle(double a, int i);
+            double convertAngle(double a, int i) const;
+        };
+
+        enum SampleFlag { REACHABLE = 1, IN_LIMITS = 2, SINGULAR = 4 };
+
+        struct Sample {
+            vector<float> angles;
+            PosePtr pose; // forward kinematics of the solution
+            int flags = 0;
+            double error = 0; // position error of the solution
+            double conditioning = 0; // ratio of smallest to largest singular value of the jacobian, 0 at singularities
         };
 
         struct job {
@@ -76,6 +90,9 @@ class VRRobotArm {
         float animSpeed = 1;
         float maxSpeed = 0.01;
         string type = "kuka";
+        float reachTolerance = 1e-3;
+        float singularityThreshold = 1e-2;
+        int refineSteps = 0;
 
         VRTransformPtr dragged = 0;
 
@@ -88,6 +105,14 @@ class VRRobotArm {
         void animOnPath(float t);
         void addJob(job j);
 
+        bool reaches(Pose target, PosePtr p) const;
+        vector<double> calcJacobian(const vector<float>& angles, PosePtr p) const;
+        void refineSample(Pose target, Sample& s) const;
+        void checkSample(Pose target, Sample& s) const;
+        void parallelSamples(size_t N, function<void(size_t, size_t)> f) const;
+        bool canBatch(string method) const;
+        vector<PosePtr> toLocal(vector<PosePtr> poses, bool local);
+
     public:
         VRRobotArm(string type);
         ~VRRobotArm();
@@ -129,6 +154,18 @@ class VRRobotArm {
         PathPtr getPath();
         PathPtr getOrientationPath();
         void moveOnPath(float t0, float t1, bool loop = false, float durationMultiplier = 1, bool local = false);
+
+        void setJointLimits(vector<Vec2d> limits);
+        vector<Vec2d> getJointLimits();
+        void setReachTolerance(float t);
+        void setSingularityThreshold(float t);
+        void setRefineSteps(int N);
+
+        vector<Sample> solveBatch(vector<PosePtr> poses, bool local = false);
+        vector<vector<float>> calcReverseKinematicsBatch(vector<PosePtr> poses, bool local = false);
+        vector<PosePtr> calcForwardKinematicsBatch(vector<vector<float>> angles);
+        vector<int> checkPoses(vector<PosePtr> poses, bool local = false);
+        vector<float> getConditioning(vector<vector<float>> angles);
 };
 
 typedef shared_ptr<VRRobotArm> VRRobotArmPtr;
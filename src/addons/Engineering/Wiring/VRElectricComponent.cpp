@@ -45,10 +45,14 @@ vector<string> VRElectricComponent::getPorts() {
 }
 
 void VRElectricComponent::setGeometry(VRObjectPtr obj) { geometry = obj; }
-void VRElectricComponent::setEntity(VREntityPtr e) { entity = e; }
+void VRElectricComponent::setEntity(VREntityPtr e) { entity = e; invalidate(); }
 void VRElectricComponent::setEGraphID(int ID) { egraphID = ID; }
 void VRElectricComponent::setPGraphID(int ID) { pgraphID = ID; }
-void VRElectricComponent::setPortEntity(string port, VREntityPtr e) { ports[port].entity = e; }
+void VRElectricComponent::setPortEntity(string port, VREntityPtr e) { ports[port].entity = e; invalidate(); }
+
+void VRElectricComponent::invalidate() {
+    if (auto sys = system.lock()) sys->invalidateSimulation();
+}
 
 void VRElectricComponent::addPort(string port, string ladHWaddr, string ecadHWaddr, string socket) {
     ports[port] = Port();
@@ -56,6 +60,7 @@ void VRElectricComponent::addPort(string port, string ladHWaddr, string ecadHWad
     ports[port].ladHWaddr = ladHWaddr;
     ports[port].ecadHWaddr = ecadHWaddr;
     ports[port].socket = socket;
+    invalidate();
 }
 
 bool VRElectricComponent::hasAddress() { return bool(address.address != ""); }
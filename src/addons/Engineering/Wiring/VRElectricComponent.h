@@ -82,6 +82,7 @@ class VRElectricComponent : public std::enable_shared_from_this<VRElectricCompon
 
         void addPort(string port, string ladHWaddr, string ecadHWaddr, string socket);
         void setPortEntity(string port, VREntityPtr e);
+        void invalidate();
 
         string getName();
         string getEcadID();
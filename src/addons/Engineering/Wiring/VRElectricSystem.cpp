@@ -35,6 +35,12 @@ void VRElectricSystem::addVariable(string v, VRLADVariablePtr var) {
     profinetVariables[v] = var;
 }
 
+VRWiringSimulationPtr VRElectricSystem::getSimulation() { return simulation; }
+
+void VRElectricSystem::invalidateSimulation() { // the netlist is recompiled on the next step
+    if (simulation) simulation->invalidate();
+}
+
 void VRElectricSystem::simECAD() {
     simulation->iterate();
 }
@@ -42,6 +48,7 @@ void VRElectricSystem::simECAD() {
 VRElectricComponentPtr VRElectricSystem::newComponent(string name, string eID, string mID) {
     auto c = VRElectricComponent::create(ptr(), name, eID, mID);
     components[c->vrID] = c;
+    invalidateSimulation();
     return c;
 }
 
@@ -52,6 +59,16 @@ void VRElectricSystem::setVariable(string HWaddr, string ci) {
     }
 }
 
+void VRElectricSystem::setVariables(map<string, string> values) { // one pass over the variables for a batch of addresses
+    if (values.size() == 0) return;
+    for (auto& var : profinetVariables) {
+        auto& v = var.second;
+        if (!v) continue;
+        auto ci = values.find(v->logicalAddress);
+        if (ci != values.end() && v->value != ci->second) v->value = ci->second;
+    }
+}
+
 GraphPtr VRElectricSystem::getElectricGraph() { return electricGraph; }
 GraphPtr VRElectricSystem::getProfinetGraph() { return profinetGraph; }
 map<size_t, VRElectricComponentPtr> VRElectricSystem::getComponentsByEGraphID() { return componentsByEGraphID; }
@@ -85,6 +102,7 @@ vector<VRElectricComponentPtr> VRElectricSystem::getElectricRoute(string ecadID1
 }
 
 void VRElectricSystem::buildECADgraph() {
+    invalidateSimulation();
     electricGraph = Graph::create();
     profinetGraph = Graph::create();
     componentsByEGraphID.clear();
@@ -430,4 +448,6 @@ void VRElectricSystem::importEPLAN(string epjPath, string bmkPath, string edcPat
             handleAddress(component, connection, connection->target);
 		}
 	}
+
+	invalidateSimulation();
 }
@@ -52,6 +52,7 @@ class VRElectricSystem : public std::enable_shared_from_this<VRElectricSystem> {
 		GraphPtr getProfinetGraph();
 
 		void setVariable(string HWaddr, string c);
+		void setVariables(map<string, string> values);
 		void registerID(string ID, VRElectricComponentPtr c);
 
 		void importEPLAN(string epj, string bmk, string edc);
@@ -60,6 +61,8 @@ class VRElectricSystem : public std::enable_shared_from_this<VRElectricSystem> {
 		vector<VRElectricComponentPtr> getBusRoute(string ecadID1, string ecadID2);
         vector<VRElectricComponentPtr> getElectricRoute(string ecadID1, string ecadID2);
 
+		VRWiringSimulationPtr getSimulation();
+		void invalidateSimulation();
 		void simECAD();
 };
 
@@ -3,8 +3,14 @@
 #include "VRElectricSystem.h"
 #include "VRWire.h"
 #include "addons/Semantics/Reasoning/VREntity.h"
+#include "addons/Semantics/Reasoning/VRProperty.h"
+#include "addons/Semantics/Reasoning/VROntology.h"
+#include "core/utils/toString.h"
 
+#include <iostream>
 #include <list>
+#include <set>
+#include <algorithm>
 
 using namespace OSG;
 
@@ -14,7 +20,316 @@ VRWiringSimulation::~VRWiringSimulation() {}
 VRWiringSimulationPtr VRWiringSimulation::create(VRElectricSystemPtr s) { return VRWiringSimulationPtr( new VRWiringSimulation(s) ); }
 VRWiringSimulationPtr VRWiringSimulation::ptr() { return static_pointer_cast<VRWiringSimulation>(shared_from_this()); }
 
+void VRWiringSimulation::setSource(string ecadID, string port) { sourceID = ecadID; sourcePort = port; invalidate(); }
+void VRWiringSimulation::invalidate() { compiled = false; }
+
+int VRWiringSimulation::getGroups(int i) {
+    auto e = net.components[i]->entity;
+    if (!e) return 0;
+
+    auto state = [&](int pos) {
+        auto p = e->get("state", pos);
+        return p ? p->getValue() : string();
+    };
+
+    int k = net.kinds[i];
+    int g = 0;
+    if (k & CONNECTOR) g |= ALL;
+    if (k & DOUBLE_PUSHBUTTON) { // reversed switch
+        if (state(0) == "unpressed") g |= FIRST;
+        if (state(1) == "pressed") g |= SECOND;
+        return g;
+    }
+    if ((k & FUSE) && state(0) == "closed") g |= ALL;
+    if ((k & SWITCH) && state(0) == "pressed") g |= ALL;
+    return g;
+}
+
+void VRWiringSimulation::compile() {
+    net = Netlist();
+    compiled = true;
+
+    map<VRElectricComponent*, int> componentIndices;
+    map<pair<int, string>, int> portIndices;
+    map<VRWire*, int> wireIndices;
+    map<string, int> addressIndices;
+
+    for (auto& c : system->getComponents()) {
+        auto component = c.second;
+        int i = net.components.size();
+        componentIndices[component.get()] = i;
+        net.components.push_back(component);
+
+        int kind = 0;
+        if (auto e = component->entity) {
+            if (e->is_a("ConnectorComponent")) kind |= CONNECTOR;
+            if (e->is_a("DoublePushbutton")) kind |= DOUBLE_PUSHBUTTON;
+            if (e->is_a("Fuse")) kind |= FUSE;
+            if (e->is_a("Switch")) kind |= SWITCH;
+        }
+        net.kinds.push_back(kind);
+        if (kind & (DOUBLE_PUSHBUTTON | FUSE | SWITCH)) net.switches.push_back(i);
+
+        for (auto& p : component->ports) {
+            portIndices[make_pair(i, p.first)] = net.portEntities.size();
+            net.portEntities.push_back(p.second.entity);
+            int a = -1;
+            if (p.second.ladHWaddr != "") {
+                if (!addressIndices.count(p.second.ladHWaddr)) {
+                    addressIndices[p.second.ladHWaddr] = net.addresses.size();
+                    net.addresses.push_back(p.second.ladHWaddr);
+                }
+                a = addressIndices[p.second.ladHWaddr];
+            }
+            net.portAddress.push_back(a);
+        }
+    }
+
+    int N = net.components.size();
+    for (int i = 0; i < N; i++) {
+        auto component = net.components[i];
+        net.linksStart.push_back(net.linkSource.size());
+
+        auto addLink = [&](VRWirePtr wire, int group) {
+            if (!wire) return;
+            if (!wireIndices.count(wire.get())) {
+                wireIndices[wire.get()] = net.wireEntities.size();
+                net.wireEntities.push_back(wire->entity);
+            }
+            net.linkSource.push_back(i);
+            net.linkGroup.push_back(group);
+            net.linkWire.push_back(wireIndices[wire.get()]);
+            net.targetsStart.push_back(net.targetComponent.size());
+
+            auto target = wire->getOther(component);
+            for (auto t : system->getRegistred(target.ecadID)) {
+                int c = componentIndices.count(t.get()) ? componentIndices[t.get()] : -1;
+                auto pk = make_pair(c, target.port);
+                net.targetComponent.push_back(c);
+                net.targetPort.push_back(portIndices.count(pk) ? portIndices[pk] : -1);
+            }
+        };
+
+        int kind = net.kinds[i];
+        if (kind & DOUBLE_PUSHBUTTON) {
+            addLink(component->getConnection("1"), FIRST);
+            addLink(component->getConnection("2"), FIRST);
+            addLink(component->getConnection("3"), SECOND);
+            addLink(component->getConnection("4"), SECOND);
+        }
+        if (kind & (CONNECTOR | FUSE | SWITCH)) {
+            for (auto& wire : component->connections) addLink(wire, ALL);
+        }
+    }
+    int L = net.linkSource.size();
+    net.linksStart.push_back(L);
+    net.targetsStart.push_back(net.targetComponent.size());
+
+    vector<int> Nincoming(N+1, 0);
+    for (int c : net.targetComponent) if (c >= 0) Nincoming[c+1]++;
+    for (int i = 0; i < N; i++) Nincoming[i+1] += Nincoming[i];
+    net.incomingStart = Nincoming;
+    net.incoming.resize(Nincoming[N]);
+    for (int l = 0; l < L; l++) {
+        for (int t = net.targetsStart[l]; t < net.targetsStart[l+1]; t++) {
+            int c = net.targetComponent[t];
+            if (c >= 0) net.incoming[Nincoming[c]++] = l;
+        }
+    }
+
+    int Np = net.portEntities.size();
+    int Nw = net.wireEntities.size();
+    int Na = net.addresses.size();
+    net.groups.resize(N);
+    for (int i = 0; i < N; i++) net.groups[i] = getGroups(i);
+    net.reached.assign(N, false);
+    net.marked.assign(N, false);
+    net.linkActive.assign(L, false);
+    net.portCount.assign(Np, 0);
+    net.wireCount.assign(Nw, 0);
+    net.addressCount.assign(Na, 0);
+    net.portCurrent.assign(Np, false);
+    net.wireCurrent.assign(Nw, false);
+    net.addressCurrent.assign(Na, false);
+    net.portDirty.assign(Np, false);
+    net.wireDirty.assign(Nw, false);
+
+    // reset current
+    for (auto e : net.portEntities) if (e) e->set("current", "0");
+    for (auto e : net.wireEntities) if (e) e->set("current", "0");
+    map<string, string> values;
+    for (auto& a : net.addresses) values[a] = "0";
+    system->setVariables(values);
+
+    auto sources = system->getRegistred(sourceID);
+    if (sources.size() == 0 || !componentIndices.count(sources[0].get())) return;
+    net.root = componentIndices[sources[0].get()];
+    auto rootPort = make_pair(net.root, sourcePort);
+    if (portIndices.count(rootPort)) { // the source port is always powered
+        int p = portIndices[rootPort];
+        net.portCount[p]++;
+        net.portDirty[p] = true;
+        net.dirtyPorts.push_back(p);
+    }
+
+    net.reached[net.root] = true;
+    vector<int> queue = {net.root};
+    propagate(queue);
+}
+
+void VRWiringSimulation::activate(int l) {
+    if (net.linkActive[l]) return;
+    net.linkActive[l] = true;
+
+    int w = net.linkWire[l];
+    if (w >= 0 && net.wireCount[w]++ == 0 && !net.wireDirty[w]) {
+        net.wireDirty[w] = true;
+        net.dirtyWires.push_back(w);
+    }
+
+    for (int t = net.targetsStart[l]; t < net.targetsStart[l+1]; t++) {
+        int p = net.targetPort[t];
+        if (p >= 0 && net.portCount[p]++ == 0 && !net.portDirty[p]) {
+            net.portDirty[p] = true;
+            net.dirtyPorts.push_back(p);
+        }
+    }
+}
+
+void VRWiringSimulation::deactivate(int l, vector<int>& candidates) {
+    if (!net.linkActive[l]) return;
+    net.linkActive[l] = false;
+
+    int w = net.linkWire[l];
+    if (w >= 0 && --net.wireCount[w] == 0 && !net.wireDirty[w]) {
+        net.wireDirty[w] = true;
+        net.dirtyWires.push_back(w);
+    }
+
+    for (int t = net.targetsStart[l]; t < net.targetsStart[l+1]; t++) {
+        int p = net.targetPort[t];
+        if (p >= 0 && --net.portCount[p] == 0 && !net.portDirty[p]) {
+            net.portDirty[p] = true;
+            net.dirtyPorts.push_back(p);
+        }
+        if (net.targetComponent[t] >= 0) candidates.push_back(net.targetComponent[t]);
+    }
+}
+
+void VRWiringSimulation::propagate(vector<int>& queue) {
+    while (queue.size() > 0) {
+        int n = queue.back();
+        queue.pop_back();
+
+        for (int l = net.linksStart[n]; l < net.linksStart[n+1]; l++) {
+            if (!(net.groups[n] & net.linkGroup[l])) continue;
+            activate(l);
+            for (int t = net.targetsStart[l]; t < net.targetsStart[l+1]; t++) {
+                int c = net.targetComponent[t];
+                if (c < 0 || net.reached[c]) continue;
+                net.reached[c] = true;
+                queue.push_back(c);
+            }
+        }
+    }
+}
+
+void VRWiringSimulation::retract(vector<int>& candidates) { // unpowers everything downstream, then repowers what is still fed from outside
+    vector<int> region;
+    auto mark = [&](int c) {
+        if (c < 0 || c == net.root || !net.reached[c] || net.marked[c]) return;
+        net.marked[c] = true;
+        region.push_back(c);
+    };
+
+    for (int c : candidates) mark(c);
+    for (size_t k = 0; k < region.size(); k++) {
+        int n = region[k];
+        for (int l = net.linksStart[n]; l < net.linksStart[n+1]; l++) {
+            if (!net.linkActive[l]) continue;
+            for (int t = net.targetsStart[l]; t < net.targetsStart[l+1]; t++) mark(net.targetComponent[t]);
+        }
+    }
+
+    vector<int> ignored;
+    for (int n : region) {
+        net.reached[n] = false;
+        for (int l = net.linksStart[n]; l < net.linksStart[n+1]; l++) deactivate(l, ignored);
+    }
+
+    vector<int> queue;
+    for (int n : region) {
+        net.marked[n] = false;
+        for (int k = net.incomingStart[n]; k < net.incomingStart[n+1]; k++) {
+            if (!net.linkActive[net.incoming[k]]) continue;
+            net.reached[n] = true;
+            queue.push_back(n);
+            break;
+        }
+    }
+    propagate(queue);
+}
+
+void VRWiringSimulation::flush() { // writes the changed currents in one batch
+    set<int> touchedAddresses;
+    for (int p : net.dirtyPorts) {
+        net.portDirty[p] = false;
+        bool c = net.portCount[p] > 0;
+        if (c == net.portCurrent[p]) continue;
+        net.portCurrent[p] = c;
+        if (auto e = net.portEntities[p]) e->set("current", c ? "1" : "0");
+        int a = net.portAddress[p];
+        if (a < 0) continue;
+        net.addressCount[a] += c ? 1 : -1;
+        touchedAddresses.insert(a);
+    }
+    net.dirtyPorts.clear();
+
+    for (int w : net.dirtyWires) {
+        net.wireDirty[w] = false;
+        bool c = net.wireCount[w] > 0;
+        if (c == net.wireCurrent[w]) continue;
+        net.wireCurrent[w] = c;
+        if (auto e = net.wireEntities[w]) e->set("current", c ? "1" : "0");
+    }
+    net.dirtyWires.clear();
+
+    map<string, string> values;
+    for (int a : touchedAddresses) {
+        bool c = net.addressCount[a] > 0;
+        if (c == net.addressCurrent[a]) continue;
+        net.addressCurrent[a] = c;
+        values[net.addresses[a]] = c ? "1" : "0";
+    }
+    system->setVariables(values);
+}
+
 void VRWiringSimulation::iterate() {
+    if (!compiled) compile();
+
+    vector<int> candidates;
+    vector<int> queue;
+    for (int i : net.switches) {
+        int g = getGroups(i);
+        int old = net.groups[i];
+        if (g == old) continue;
+        net.groups[i] = g;
+        if (!net.reached[i]) continue;
+
+        for (int l = net.linksStart[i]; l < net.linksStart[i+1]; l++) {
+            if (net.linkGroup[l] & old & ~g) deactivate(l, candidates);
+        }
+        if (g & ~old) queue.push_back(i);
+    }
+
+    if (candidates.size() > 0) retract(candidates);
+    for (auto& i : queue) if (!net.reached[i]) i = -1;
+    queue.erase(remove(queue.begin(), queue.end(), -1), queue.end());
+    propagate(queue);
+    flush();
+}
+
+void VRWiringSimulation::iterateReference() {
 	for (auto& c : system->getComponents()) { // reset current;
         auto component = c.second;
 		for (auto& p : component->ports) component->setCurrent("0", p.first);
@@ -39,8 +354,8 @@ void VRWiringSimulation::iterate() {
 		}
 	};
 
-	VRElectricComponentPtr L = system->getRegistred("=KVE120+-XPWR")[0];
-	L->setCurrent("1", "0");
+	VRElectricComponentPtr L = system->getRegistred(sourceID)[0];
+	L->setCurrent("1", sourcePort);
 	list<VRElectricComponentPtr> stack = {L};
 	auto R = rand();
 
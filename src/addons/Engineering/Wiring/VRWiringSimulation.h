@@ -2,17 +2,80 @@
 #define VRWIRINGSIMULATION_H_INCLUDED
 
 #include <OpenSG/OSGConfig.h>
+#include "addons/Semantics/VRSemanticsFwd.h"
 #include "addons/Engineering/VREngineeringFwd.h"
 
 #include <map>
+#include <vector>
 #include <string>
 
 using namespace std;
 OSG_BEGIN_NAMESPACE;
 
+/**
+ * Current propagation from a source component through the wiring.
+ * The system is compiled to an integer indexed netlist, components conduct over groups of links:
+ *  - connectors, closed fuses and pressed switches over all their connections
+ *  - double pushbuttons over ports 1 and 2 while the first is unpressed, over 3 and 4 while the second is pressed
+ * Each iteration polls the switch states, only the parts downstream of changed switches are re-evaluated.
+ * Active links are counted per port and wire, changed currents are written to the ontology in one batch.
+ */
 class VRWiringSimulation : public std::enable_shared_from_this<VRWiringSimulation> {
+    public:
+        enum Kind { CONNECTOR = 1, DOUBLE_PUSHBUTTON = 2, FUSE = 4, SWITCH = 8 };
+        enum Group { ALL = 1, FIRST = 2, SECOND = 4 };
+
+        struct Netlist {
+            vector<VRElectricComponentPtr> components;
+            vector<int> kinds;
+            vector<int> groups; // conducting link groups
+            vector<int> switches; // components with states to poll
+
+            vector<int> linksStart; // links of component i are linksStart[i] .. linksStart[i+1]
+            vector<int> linkSource;
+            vector<int> linkGroup;
+            vector<int> linkWire;
+            vector<int> targetsStart;
+            vector<int> targetComponent;
+            vector<int> targetPort;
+            vector<int> incomingStart; // links targeting component i
+            vector<int> incoming;
+
+            vector<VREntityPtr> portEntities;
+            vector<int> portAddress;
+            vector<string> addresses; // LAD hardware addresses
+            vector<VREntityPtr> wireEntities;
+
+            vector<bool> reached;
+            vector<bool> linkActive;
+            vector<int> portCount;
+            vector<int> wireCount;
+            vector<int> addressCount;
+            vector<bool> portCurrent; // last written
+            vector<bool> wireCurrent;
+            vector<bool> addressCurrent;
+            vector<bool> marked; // scratch for retracting
+            vector<bool> portDirty;
+            vector<bool> wireDirty;
+            vector<int> dirtyPorts;
+            vector<int> dirtyWires;
+            int root = -1;
+        };
+
 	private:
 	    VRElectricSystemPtr system;
+	    string sourceID = "=KVE120+-XPWR";
+	    string sourcePort = "0";
+	    Netlist net;
+	    bool compiled = false;
+
+	    int getGroups(int i);
+	    void compile();
+	    void activate(int link);
+	    void deactivate(int link, vector<int>& candidates);
+	    void propagate(vector<int>& queue);
+	    void retract(vector<int>& candidates);
+	    void flush();
 
 	public:
 		VRWiringSimulation(VRElectricSystemPtr s);
@@ -21,7 +84,10 @@ class VRWiringSimulation : public std::enable_shared_from_this<VRWiringSimulatio
 		static VRWiringSimulationPtr create(VRElectricSystemPtr s);
 		VRWiringSimulationPtr ptr();
 
+	    void setSource(string ecadID, string port = "0");
+	    void invalidate();
 	    void iterate();
+	    void iterateReference();
 };
 
 OSG_END_NAMESPACE;
@@ -1,9 +1,11 @@
 #include "VRConcept.h"
 #include "VRProperty.h"
+#include "VROntology.h"
 #include "core/utils/toString.h"
 #include "core/utils/VRStorage_template.h"
 
 #include <iostream>
+#include <algorithm>
 
 using namespace OSG;
 
@@ -56,11 +58,24 @@ void VRConcept::setup(VRStorageContextPtr context) {
 void VRConcept::removeChild(VRConceptPtr c) {
     //if (children.count(c->ID)) children.erase(c->ID);
     if (c->parents.count(ID)) c->parents.erase(ID);
+    c->changedTaxonomy();
 }
 
 void VRConcept::removeParent(VRConceptPtr c) {
     //if (c->children.count(ID)) c->children.erase(ID);
     if (parents.count(c->ID)) parents.erase(c->ID);
+    changedTaxonomy();
+}
+
+void VRConcept::addOntology(VROntologyPtr o) { // the ancestors are registered too, their parents are part of the closure of o's entities
+    ontologies.erase(remove_if(ontologies.begin(), ontologies.end(), [](VROntologyWeakPtr& w) { return w.expired(); }), ontologies.end());
+    for (auto& w : ontologies) if (w.lock() == o) return;
+    ontologies.push_back(o);
+    for (auto& p : parents) p.second->addOntology(o);
+}
+
+void VRConcept::changedTaxonomy() {
+    for (auto& w : ontologies) if (auto o = w.lock()) o->changedTaxonomy();
 }
 
 void VRConcept::remProperty(VRPropertyPtr p) { if (properties.count(p->ID)) properties.erase(p->ID); }
@@ -77,6 +92,8 @@ void VRConcept::append(VRConceptPtr c, bool link) {
     //cout << "VRConcept::append " << c->getName() << " to " << getName() << " ID " << c->ID << " " << ID << endl;
     //children[c->ID] = c;
     c->parents[ID] = ptr();
+    for (auto& w : c->ontologies) if (auto o = w.lock()) addOntology(o);
+    c->changedTaxonomy();
     if (!link) return;
     //link[c->ID] = ; // TODO
 }
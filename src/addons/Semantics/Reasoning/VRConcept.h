@@ -36,6 +36,7 @@ struct VRConcept : public std::enable_shared_from_this<VRConcept>, public VROnto
     map<int, VRPropertyPtr> annotations;
     map<int, VROntologyLinkPtr> links;
     vector<VROntologyRule*> rules;
+    vector<VROntologyWeakPtr> ontologies; // listing this concept or a descendant, told about changes of the parent relations
 
     VRConcept(string name, VROntologyPtr o);
     ~VRConcept();
@@ -49,6 +50,8 @@ struct VRConcept : public std::enable_shared_from_this<VRConcept>, public VROnto
     void append(VRConceptPtr c, bool link = false);
     void removeChild(VRConceptPtr c);
     void removeParent(VRConceptPtr c);
+    void addOntology(VROntologyPtr o);
+    void changedTaxonomy();
 
     VRPropertyPtr addProperty(string name, string type);
     VRPropertyPtr addProperty(string name, VRConceptPtr c);
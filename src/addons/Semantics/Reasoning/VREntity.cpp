@@ -39,7 +39,10 @@ VREntityPtr VREntity::create(string name, VROntologyPtr o, VRConceptPtr c) { ret
 void VREntity::setSGObject(VRObjectPtr o) { sgObject = o; }
 VRObjectPtr VREntity::getSGObject() { return sgObject.lock(); }
 
-void VREntity::addConcept(VRConceptPtr c) { concepts.push_back(c); }
+void VREntity::addConcept(VRConceptPtr c) {
+    concepts.push_back(c);
+    if (auto o = ontology.lock()) o->updateIndex(ID);
+}
 
 VRConceptPtr VREntity::getConcept() {
     for (auto cw : concepts) if (auto c = cw.lock()) return c;
@@ -81,6 +84,7 @@ vector<VRPropertyPtr> VREntity::getProperties() {
 void VREntity::addProperty(VRPropertyPtr prop, string name, string value, int pos) {
     if (!properties[name].count(pos)) properties[name][pos] = prop;
     properties[name][pos]->setValue( value );
+    if (auto o = ontology.lock()) o->updateIndex(ID, name);
 }
 
 void VREntity::set(string name, string value, int pos) {
@@ -103,12 +107,14 @@ void VREntity::add(string name, string value) {
     prop->setValue( value );
     int i = properties[name].size();
     properties[name][i] = prop;
+    if (auto o = ontology.lock()) o->updateIndex(ID, name);
 }
 
 void VREntity::clear(string name) {
     auto prop = getProperty(name, true);
     if (!prop) { WARN("Warning (clear): Entity " + this->name + " has no property " + name); return; }
     properties[name].clear();
+    if (auto o = ontology.lock()) o->updateIndex(ID, name);
 }
 
 void VREntity::rem(VRPropertyPtr p) {
@@ -118,6 +124,17 @@ void VREntity::rem(VRPropertyPtr p) {
         vector<int> keys;
         for (auto k : m) if (k.second == p) keys.push_back(k.first);
         for (auto k : keys) m.erase(k);
+        if (auto o = ontology.lock()) o->updateIndex(ID, name);
+    }
+}
+
+void VREntity::updateIndex(VRProperty* p) { // a property value was changed directly
+    auto o = ontology.lock();
+    if (!o) return;
+    for (auto& m : properties) {
+        for (auto& k : m.second) {
+            if (k.second.get() == p) { o->updateIndex(ID, m.first); return; }
+        }
     }
 }
 
@@ -251,14 +268,13 @@ string VREntity::asVectorString() {
 VREntityPtr VREntity::copy() {
     auto o = ontology.lock();
     auto e = create(getBaseName(), o);
-    o->addEntity(e);
     for (auto wc : concepts) if (auto c = wc.lock()) e->addConcept(c);
     e->conceptNames = conceptNames;
     for (auto pv : properties) {
         e->properties[pv.first] = map<int, VRPropertyPtr>();
         for (auto k : pv.second) e->properties[pv.first][k.first] = k.second->copy();
     }
-    map<string, vector<VRPropertyPtr> > properties;
+    o->addEntity(e); // after copying the properties to index them
     return e;
 }
 
@@ -36,6 +36,7 @@ struct VREntity : public VROntoID, public VRName {
     VRPropertyPtr getProperty(string p, bool warn = true);
     vector<VRPropertyPtr> getProperties();
     void rem(VRPropertyPtr);
+    void updateIndex(VRProperty* p);
     string getConceptList();
 
     void setSGObject(VRObjectPtr o);
@@ -1,28 +1,69 @@
 #include "VROWLExport.h"
 #include "VROntology.h"
-#include "core/utils/xml.h"
 #include "core/utils/system/VRSystem.h"
 
 #include <iostream>
+#include <fstream>
 
 using namespace OSG;
 
 
 VROWLExport::VROWLExport() {}
 
+namespace {
+    struct OWLWriter { // writes RDF/XML directly to the file, no document tree
+        ofstream& stream;
+
+        OWLWriter(ofstream& s) : stream(s) {}
+
+        void escaped(const string& str) {
+            for (char c : str) {
+                switch (c) {
+                    case '&': stream << "&amp;"; break;
+                    case '<': stream << "&lt;"; break;
+                    case '>': stream << "&gt;"; break;
+                    case '"': stream << "&quot;"; break;
+                    default: stream << c;
+                }
+            }
+        }
+
+        void open(const string& tag, const string& attr = "", const string& value = "", bool close = false, string indent = "  ") {
+            stream << indent << "<" << tag;
+            if (attr != "") { stream << " " << attr << "=\""; escaped(value); stream << "\""; }
+            stream << (close ? "/>\n" : ">\n");
+        }
+
+        void leaf(const string& tag, const string& attr, const string& value) { open(tag, attr, value, true, "    "); }
+
+        void text(const string& tag, const string& attr, const string& value, const string& txt) {
+            stream << "    <" << tag << " " << attr << "=\""; escaped(value); stream << "\">";
+            escaped(txt);
+            stream << "</" << tag << ">\n";
+        }
+
+        void close(const string& tag) { stream << "  </" << tag << ">\n"; }
+    };
+}
+
 void VROWLExport::write(VROntologyPtr o, string path) {
-    XML xml;
-    XMLElementPtr root = xml.newRoot("rdf:RDF", "", "rdf"); // name, ns_uri, ns_prefix
+    if (exists(path)) path = canonical(path);
+    cout << "VROWLExport::write to " << path << endl;
+    ofstream stream(path);
+    if (!stream) { cout << "VROWLExport::write failed to open " << path << endl; return; }
+    OWLWriter w(stream);
 
     string ontology_ns = "http://www.semanticweb.org/ontologies/2012/9/"+o->getName()+".owl#";
     string dp_ns = "http://www.w3.org/2001/XMLSchema#";
 
     map<string, VRPropertyPtr> properties;
-    map<string, XMLElementPtr> propertyNodes;
+    map<string, vector<string>> domains; // written with the property, before the classes
     for (auto c : o->getConcepts()) {
         for (auto p : c->getProperties()) {
             properties[p->getName()] = p;
         }
+        if (c->getName() == "Thing") continue;
+        for (auto p : c->getProperties(false)) domains[p->getName()].push_back(c->getName());
     }
 
     auto isDataProperty = [](string type) {
@@ -33,20 +74,23 @@ void VROWLExport::write(VROntologyPtr o, string path) {
     };
 
     auto writeHeader = [&]() {
-        root->setAttribute("xmlns", ontology_ns);
-        root->setAttribute("xmlns:base", ontology_ns);
-        root->setAttribute("xmlns:"+o->getName(), ontology_ns);
-        root->setAttribute("xmlns:rdf", "http://www.w3.org/1999/02/22-rdf-syntax-ns#");
-        root->setAttribute("xmlns:rdfs", "http://www.w3.org/2000/01/rdf-schema#");
-        root->setAttribute("xmlns:xsd", "http://www.w3.org/2001/XMLSchema#");
-        root->setAttribute("xmlns:owl", "http://www.w3.org/2002/07/owl#");
-        root->setAttribute("xmlns:swrl", "http://www.w3.org/2003/11/swrl#");
-        root->setAttribute("xmlns:protege", "http://protege.stanford.edu/plugins/owl/protege#");
-        root->setAttribute("xmlns:xsp", "http://www.owl-ontologies.com/2005/08/07/xsp.owl#");
-        root->setAttribute("xmlns:swrlb", "http://www.w3.org/2003/11/swrlb#");
-
-        auto o = root->addChild("owl:Ontology");
-        o->setAttribute("rdf:about", ontology_ns);
+        stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+        stream << "<rdf:RDF";
+        auto ns = [&](string n, string uri) { stream << " " << n << "=\""; w.escaped(uri); stream << "\""; };
+        ns("xmlns", ontology_ns);
+        ns("xmlns:base", ontology_ns);
+        ns("xmlns:"+o->getName(), ontology_ns);
+        ns("xmlns:rdf", "http://www.w3.org/1999/02/22-rdf-syntax-ns#");
+        ns("xmlns:rdfs", "http://www.w3.org/2000/01/rdf-schema#");
+        ns("xmlns:xsd", "http://www.w3.org/2001/XMLSchema#");
+        ns("xmlns:owl", "http://www.w3.org/2002/07/owl#");
+        ns("xmlns:swrl", "http://www.w3.org/2003/11/swrl#");
+        ns("xmlns:protege", "http://protege.stanford.edu/plugins/owl/protege#");
+        ns("xmlns:xsp", "http://www.owl-ontologies.com/2005/08/07/xsp.owl#");
+        ns("xmlns:swrlb", "http://www.w3.org/2003/11/swrlb#");
+        stream << ">\n";
+
+        w.open("owl:Ontology", "rdf:about", ontology_ns, true);
     };
 
     auto writeProperties = [&]() {
@@ -59,29 +103,22 @@ void VROWLExport::write(VROntologyPtr o, string path) {
                 pns = dp_ns;
             }
 
-            auto a = root->addChild(ptag);
-            a->setAttribute("rdf:about", ontology_ns + prop.first);
-            auto r = a->addChild("rdfs:range");
-            r->setAttribute("rdf:resource", pns + prop.second->type);
-            propertyNodes[prop.first] = a;
+            w.open(ptag, "rdf:about", ontology_ns + prop.first);
+            w.leaf("rdfs:range", "rdf:resource", pns + prop.second->type);
+            for (auto& d : domains[prop.first]) w.leaf("rdfs:domain", "rdf:resource", ontology_ns + d);
+            w.close(ptag);
         }
     };
 
     auto writeClasses = [&]() {
         for (auto concept : o->getConcepts()) {
             if (concept->getName() == "Thing") continue;
-            auto a = root->addChild("owl:Class");
-            a->setAttribute("rdf:about", ontology_ns + concept->getName());    // concept name
+            w.open("owl:Class", "rdf:about", ontology_ns + concept->getName());    // concept name
             for (auto cp : concept->getParents()) {                             // concept parents
                 if (cp->getName() == "Thing") continue;
-                auto p = a->addChild("rdfs:subClassOf");
-                p->setAttribute("rdf:resource", ontology_ns + cp->getName());
-            }
-
-            for (auto p : concept->getProperties(false)) {
-                auto d = propertyNodes[p->getName()]->addChild("rdfs:domain");
-                d->setAttribute("rdf:resource", ontology_ns + concept->getName());
+                w.leaf("rdfs:subClassOf", "rdf:resource", ontology_ns + cp->getName());
             }
+            w.close("owl:Class");
         }
     };
 
@@ -91,19 +128,16 @@ void VROWLExport::write(VROntologyPtr o, string path) {
 
     auto writeInstances = [&]() {
         for (auto entity : o->entitiesByName) {
-            auto e = root->addChild("owl:NamedIndividual");
-            e->setAttribute("rdf:about", ontology_ns + entity.first);
-            auto t = e->addChild("rdf:type");
-            t->setAttribute("rdf:resource", ontology_ns + entity.second->getConcept()->getName());
+            w.open("owl:NamedIndividual", "rdf:about", ontology_ns + entity.first);
+            if (auto c = entity.second->getConcept()) w.leaf("rdf:type", "rdf:resource", ontology_ns + c->getName());
             for (auto prop : entity.second->getAll()) {
-                auto p = e->addChild(prop->getName());
                 if (isDataProperty(prop->type)) {
-                    p->setText(prop->getValue());
-                    p->setAttribute("rdf:datatype", dp_ns + prop->getType());
+                    w.text(prop->getName(), "rdf:datatype", dp_ns + prop->getType(), prop->getValue());
                 } else {
-                    p->setAttribute("rdf:resource", ontology_ns + prop->getValue());
+                    w.leaf(prop->getName(), "rdf:resource", ontology_ns + prop->getValue());
                 }
             }
+            w.close("owl:NamedIndividual");
         }
     };
 
@@ -112,8 +146,5 @@ void VROWLExport::write(VROntologyPtr o, string path) {
     writeClasses();
     writeRules();
     writeInstances();
-
-    if (exists(path)) path = canonical(path);
-    cout << "VROWLExport::write to " << path << endl;
-    xml.write(path);
+    stream << "</rdf:RDF>\n";
 }
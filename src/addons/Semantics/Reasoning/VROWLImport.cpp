@@ -9,15 +9,6 @@
 
 using namespace OSG;
 
-VROWLImport::RDFStatement::RDFStatement(raptor_statement* s) {
-    graph = toString(s->graph);
-    object = toString(s->object);
-    predicate = toString(s->predicate);
-    subject = toString(s->subject);
-    if (s->subject) RDFsubject = (s->subject->type == RAPTOR_TERM_TYPE_BLANK);
-    if (s->object) RDFobject = (s->object->type == RAPTOR_TERM_TYPE_BLANK);
-}
-
 VROWLImport::RDFStatement::RDFStatement(string g, string o, string p, string s, string t) {
     graph = g;
     object = o;
@@ -26,7 +17,11 @@ VROWLImport::RDFStatement::RDFStatement(string g, string o, string p, string s,
     type = t;
 }
 
-string VROWLImport::RDFStatement::toString(raptor_term* t) {
+string VROWLImport::RDFStatement::toString() {
+    return "Statement: type "+type+"  predicate "+predicate+"  subject "+subject+"  object "+object+" RDFsub "+::toString(RDFsubject)+" RDFobj "+::toString(RDFobject);
+}
+
+string VROWLImport::toString(raptor_term* t) {
     if (t == 0) return "";
     switch(t->type) {
         case RAPTOR_TERM_TYPE_LITERAL:
@@ -39,18 +34,18 @@ string VROWLImport::RDFStatement::toString(raptor_term* t) {
             auto uri = raptor_uri_as_string( t->value.uri );
             if (!uri) return "";
             string s( (const char*)uri );
+            auto it = localNames.find(s); // the same IRIs occur in most triples
+            if (it != localNames.end()) return it->second;
             auto ss = splitString(s, '#');
             if (ss.size() == 1) ss = splitString(s, '/');
             //raptor_free_memory(uri);
-            return ss[ss.size()-1];
+            string name = ss.size() ? ss[ss.size()-1] : "";
+            localNames[s] = name;
+            return name;
     }
     return "";
 }
 
-string VROWLImport::RDFStatement::toString() {
-    return "Statement: type "+type+"  predicate "+predicate+"  subject "+subject+"  object "+object+" RDFsub "+::toString(RDFsubject)+" RDFobj "+::toString(RDFobject);
-}
-
 VROWLImport::VROWLImport() {
     predicate_blacklist["imports"] = 1;
     predicate_blacklist["implements"] = 1;
@@ -79,7 +74,8 @@ VROWLImport::VROWLImport() {
 
 void VROWLImport::clear() {
     subjects.clear();
-    objects.clear();
+    localNames.clear();
+    propertyDomains.clear();
     concepts.clear();
     entities.clear();
     datproperties.clear();
@@ -279,10 +275,10 @@ bool VROWLImport::ProcessSubject(RDFStatement& statement, vector<RDFStatement>&
         if (object == "DatatypeProperty") { datproperties[subject] = VRProperty::create(subject); return 0; }
         if (object == "AnnotationProperty") { annproperties[subject] = VRProperty::create(subject); return 0; }
         if (object == "ObjectProperty") {
+            if (streaming) return 1; // the domain is only known once the whole file is parsed
             objproperties[subject] = VRProperty::create(subject);
              // fix missing domain of properties
-            bool hasDomain = 0;
-            for (auto s : statements) if (s.predicate == "domain") hasDomain = 1;
+            bool hasDomain = propertyDomains.count(subject);
             if (!hasDomain) { statement = RDFStatement(statement.graph, "Thing", "domain", subject, type); return 1; }
             return 0;
         }
@@ -414,13 +410,14 @@ VROntologyRulePtr VROWLImport::getRule(string rule) {
 
 void VROWLImport::AgglomerateData() {
     map<string, vector<RDFStatement> > tmp;
-    map<string, vector<RDFStatement> > stack = subjects;
+    map<string, vector<RDFStatement> > stack;
+    stack.swap(subjects); // only the triples not resolved while parsing
 
     concepts["Thing"] = onto->getConcept("Thing");
 
     auto jobSize = [&]() {
         int i=0;
-        for (auto s : stack) i += s.second.size();
+        for (auto& s : stack) i += s.second.size();
         return i;
     };
 
@@ -434,7 +431,7 @@ void VROWLImport::AgglomerateData() {
                     tmp[statement.subject].push_back(statement);
             }
         }
-        stack = tmp;
+        stack.swap(tmp);
         tmp.clear();
         int jobs = jobSize();
         cout << "RDF parser: iteration: " << i << " with " << jobs << " triplets remaining" << endl;
@@ -470,11 +467,16 @@ void processTriple(void* mgr, raptor_statement* rs) {
     m->processTriple(rs);
 }
 
-void VROWLImport::processTriple(raptor_statement* rs) {
-    auto s = RDFStatement(rs);
+void VROWLImport::processTriple(raptor_statement* rs) { // resolve triples while parsing, keep the rest for AgglomerateData
+    RDFStatement s(toString(rs->graph), toString(rs->object), toString(rs->predicate), toString(rs->subject), "");
+    if (rs->subject) s.RDFsubject = (rs->subject->type == RAPTOR_TERM_TYPE_BLANK);
+    if (rs->object) s.RDFobject = (rs->object->type == RAPTOR_TERM_TYPE_BLANK);
     //if (s.predicate == "hasRelative2D_PosX") cout << "RDF statement: " << s.toString() << endl;
-    subjects[s.subject].push_back(s);
-    objects[s.subject][s.object] = s.predicate;
+    if (s.predicate == "domain") propertyDomains[s.subject] = true;
+
+    auto& statements = subjects[s.subject];
+    if (ProcessSubject(s, statements, subjects)) statements.push_back(s);
+    else if (statements.empty()) subjects.erase(s.subject);
 }
 
 void VROWLImport::read(VROntologyPtr o, string path) {
@@ -489,9 +491,11 @@ void VROWLImport::read(VROntologyPtr o, string path) {
     raptor_uri* base_uri = raptor_uri_copy(uri);
 
     cout << "  Crunch triples" << endl;
+    streaming = true;
     raptor_parser_set_statement_handler(rdf_parser, this, ::processTriple);
     raptor_parser_parse_file(rdf_parser, uri, base_uri);
     raptor_free_parser(rdf_parser);
+    streaming = false;
 
     cout << "  Free raptor" << endl;
     raptor_free_uri(base_uri);
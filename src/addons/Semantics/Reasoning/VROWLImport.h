@@ -26,14 +26,8 @@ class VROWLImport {
             bool RDFsubject = false;
             bool RDFobject = false;
 
-#ifndef WITHOUT_RAPTOR
-            RDFStatement(raptor_statement* s);
-#endif
             RDFStatement(string g, string o, string p, string s, string t);
 
-#ifndef WITHOUT_RAPTOR
-            string toString(raptor_term* t);
-#endif
             string toString();
         };
 
@@ -71,8 +65,10 @@ class VROWLImport {
         map<string, bool> list_types;
         map<string, string> labels;
 
-        map<string, vector<RDFStatement> > subjects;
-        map<string, map<string, string> > objects;
+        map<string, vector<RDFStatement> > subjects; // unresolved triples, mostly forward references
+        map<string, string> localNames; // interned IRIs, full IRI to local name
+        map<string, bool> propertyDomains; // properties with an explicit domain
+        bool streaming = false;
         map<string, OWLList> lists;
         map<string, string> list_ends;
         map<string, OWLRestriction> restrictions;
@@ -100,6 +96,10 @@ class VROWLImport {
         void AgglomerateData();
         bool ProcessSubject(RDFStatement& s, vector<RDFStatement>& statements, map<string, vector<RDFStatement> >& stack);
 
+#ifndef WITHOUT_RAPTOR
+        string toString(raptor_term* t);
+#endif
+
         string whereIs(string s);
         void printState(RDFStatement& s, string ID = "");
         void printTripleStore();
@@ -1,10 +1,12 @@
 #include "VROntology.h"
+#include "VROntologyIndex.h"
 #include "VRReasoner.h"
 #include "VRProperty.h"
 #ifndef WITHOUT_RAPTOR
 #include "VROWLImport.h"
 #endif
 #include "VROWLExport.h"
+#include "VROntologySnapshot.h"
 #include "core/utils/toString.h"
 #include "core/utils/VRStorage_template.h"
 #include "core/utils/system/VRSystem.h"
@@ -15,6 +17,8 @@
 #include "core/gui/VRGuiConsole.h"
 #endif
 #include <iostream>
+#include <algorithm>
+#include <climits>
 
 #ifndef WITHOUT_IMGUI
 #define WARN(x) \
@@ -31,6 +35,7 @@ VROntology::VROntology(string name) {
     setPersistency(0);
     setNameSpace("Ontology");
     setName(name);
+    index = VROntologyIndex::create();
 
     storeMap("Entities", &entities, true);
     storeMap("Rules", &rules, true);
@@ -65,7 +70,10 @@ void VROntology::setup(VRStorageContextPtr context) {
     for (auto& i : insts) {
         for (auto c : i.second->conceptNames) i.second->addConcept( concepts[c].lock() ); // update concept
         entities[i.second->ID] = i.second; // update ID mapping
+        entitiesByName[i.second->getName()] = i.second;
     }
+    rebuildIndex();
+    changedSchema(); // all entities were replaced
 
     auto rls = rules;
     rules.clear();
@@ -137,8 +145,10 @@ VRConceptPtr VROntology::addConcept(string concept, string parents, map<string,
     //cout << "VROntology::addConcept " << concept << " " << parents << " " << Concept->getName() << " " << Concept->ID << endl;
     for (unsigned int i=1; i<Parents.size(); i++) Parents[i]->append(Concept);
     Concept->addAnnotation(comment, "comment");
-    addConcept(Concept);
+    concepts[Concept->getName()] = Concept;
+    Concept->addOntology(ptr()); // after appending, a new leaf concept leaves the entity index valid
     for (auto p : props) Concept->addProperty(p.first, p.second);
+    changedSchema();
     return Concept;
 }
 
@@ -147,6 +157,9 @@ void VROntology::addConcept(VRConceptPtr c) {
     if (c == thing) return;
     concepts[c->getName()] = c;
     if (!c->hasParent()) thing->append(c);
+    c->addOntology(ptr());
+    index->invalidateTaxonomy();
+    changedSchema();
 }
 
 void VROntology::addProperty(VRPropertyPtr p) {
@@ -159,12 +172,16 @@ void VROntology::remConcept(VRConceptPtr c) {
     if (!concepts.count(c->getName())) return;
     c->detach();
     concepts.erase(c->getName());
+    recentConcepts.erase(c->getName());
+    index->invalidateTaxonomy();
+    changedSchema();
 }
 
 void VROntology::renameConcept(VRConceptPtr c, string newName) {
     if (c == thing) return;
     if (!concepts.count(c->getName())) return;
     concepts.erase(c->getName());
+    recentConcepts.erase(c->getName());
     c->setName(newName);
     addConcept(c);
 }
@@ -173,6 +190,11 @@ void VROntology::remEntity(VREntityPtr e) {
     if (!e) return;
     if (!entities.count(e->ID)) return;
     entities.erase(e->ID);
+    auto n = entitiesByName.find(e->getName());
+    if (n != entitiesByName.end() && n->second == e) entitiesByName.erase(n);
+    auto eConcepts = index->getConcepts(e->ID);
+    index->remEntity(e);
+    changed(eConcepts, e->getName(), e->ID);
 }
 
 void VROntology::remEntity(string name) {
@@ -186,11 +208,17 @@ void VROntology::remEntities(string concept) {
 void VROntology::remRule(VROntologyRulePtr r) {
     if (!rules.count(r->ID)) return;
     rules.erase(r->ID);
+    changedSchema();
 }
 
 void VROntology::renameEntity(VREntityPtr e, string s) {
     if (!entities.count(e->ID)) return;
+    auto n = entitiesByName.find(e->getName());
+    if (n != entitiesByName.end() && n->second == e) entitiesByName.erase(n);
+    changed(index->getConcepts(e->ID), e->getName(), e->ID);
     e->setName(s);
+    entitiesByName[e->getName()] = e;
+    nameVersions[e->getName()] = version;
 }
 
 void VROntology::merge(VROntologyPtr o) { // Todo: check it well!
@@ -198,8 +226,12 @@ void VROntology::merge(VROntologyPtr o) { // Todo: check it well!
     for (auto b : o->builtins) builtins[b.first] = b.second;
     for (auto c : o->concepts) {
         auto cn = c.second.lock();
-        if (cn) concepts[cn->getName()] = cn;
+        if (!cn) continue;
+        concepts[cn->getName()] = cn;
+        cn->addOntology(ptr());
     }
+    index->invalidateTaxonomy();
+    changedSchema();
 }
 
 map<int, vector<VRConceptPtr>> VROntology::getChildrenMap() {
@@ -227,6 +259,7 @@ VROntologyRulePtr VROntology::addRule(string rule, string ac) {
     for (auto r : rules) if (r.second->rule == rule) return r.second;
     VROntologyRulePtr r = VROntologyRule::create(rule, ac);
     rules[r->ID] = r;
+    changedSchema();
     return r;
 }
 
@@ -253,6 +286,8 @@ void VROntology::addEntity(VREntityPtr& e) {
     //p2.first->second = e;
     entities[e->ID] = e;
     entitiesByName[e->getName()] = e;
+    index->addEntity(e);
+    changed(index->getConcepts(e->ID), e->getName(), e->ID);
 
     //cout << "VROntology::addEntity " << entities.size() << " " << entities[e->ID] << endl;
 }
@@ -280,13 +315,74 @@ VREntityPtr VROntology::getEntity(string e) {
 }
 
 vector<VREntityPtr> VROntology::getEntities(string concept) {
-    vector<VREntityPtr> res;
     if (concept != "") {
-        for (auto i : entities) if (i.second->is_a(concept)) res.push_back(i.second);
-    } else for (auto i : entities) res.push_back(i.second);
+        if (index->needsRebuild()) rebuildIndex();
+        return index->getEntities(concept);
+    }
+
+    vector<VREntityPtr> res;
+    res.reserve(entities.size());
+    for (auto& i : entities) res.push_back(i.second);
     return res;
 }
 
+vector<VREntityPtr> VROntology::getEntitiesByValue(string prop, string value) { return index->getEntities(prop, value); }
+
+vector<VREntityPtr> VROntology::getReferencing(VREntityPtr e) {
+    if (!e) return vector<VREntityPtr>();
+    return index->getReferencing(e->getName());
+}
+
+void VROntology::updateIndex(int ID, const string& prop) { // called by entities on change
+    auto it = entities.find(ID);
+    if (it == entities.end()) return;
+    auto eConcepts = index->getConcepts(ID);
+    if (prop == "") index->updateConcepts(it->second);
+    else index->updateProperty(it->second, prop);
+    if (prop == "") for (auto& c : index->getConcepts(ID)) eConcepts.push_back(c); // old and new concepts
+    changed(eConcepts, "", ID);
+}
+
+void VROntology::rebuildIndex() { index->build(ptr()); }
+
+void VROntology::changed(const vector<string>& concepts, const string& name, int entityID) {
+    version++;
+    for (auto& c : concepts) conceptVersions[c] = version;
+    if (name != "") nameVersions[name] = version;
+    if (entityID < 0) return;
+    changeLog.push_back(make_pair(version, entityID));
+    if (changeLog.size() > 100000) {
+        changeLogBegin = changeLog.front().first;
+        changeLog.pop_front();
+    }
+}
+
+bool VROntology::getChanges(size_t since, vector<int>& IDs) { // IDs of the entities changed after that version
+    if (since < changeLogBegin) return false;
+    auto it = upper_bound(changeLog.begin(), changeLog.end(), make_pair(since, INT_MAX));
+    for (; it != changeLog.end(); it++) IDs.push_back(it->second);
+    return true;
+}
+
+void VROntology::changedSchema() { schemaVersion = ++version; }
+
+void VROntology::changedTaxonomy() { // called by the concepts of this ontology
+    index->invalidateTaxonomy();
+    changedSchema();
+}
+
+size_t VROntology::getVersion() { return version; }
+
+size_t VROntology::getConceptVersion(const string& concept) {
+    auto it = conceptVersions.find(concept);
+    return it == conceptVersions.end() ? 0 : it->second;
+}
+
+size_t VROntology::getNameVersion(const string& name) {
+    auto it = nameVersions.find(name);
+    return it == nameVersions.end() ? 0 : it->second;
+}
+
 string VROntology::toString() {
     string res = "Taxonomy:\n";
     auto cMap = getChildrenMap();
@@ -299,6 +395,7 @@ string VROntology::toString() {
 }
 
 void VROntology::openOWL(string path) {
+    if (VROntologySnapshot::isSnapshot(path)) { VROntologySnapshot::read(shared_from_this(), path); return; }
 #ifndef WITHOUT_RAPTOR
     if (!exists(path)) WARN("WARNING in VROntology::openOWL, " + path + " not found!");
     VROWLImport importer;
@@ -311,6 +408,8 @@ void VROntology::saveOWL(string path) {
     exporter.write(shared_from_this(), path);
 }
 
+void VROntology::saveSnapshot(string path) { VROntologySnapshot::write(shared_from_this(), path); }
+
 void VROntology::addModule(VROntologyPtr onto) {
     string mod = onto->getBaseName();
     if (!onto) { cout << "VROntology::addModule Error: Ontology " << mod << " not found" << endl; return; }
@@ -348,9 +447,9 @@ void VROntology::setFlag(string f) { flag = f; }
 string VROntology::getFlag() { return flag; }
 
 vector<VREntityPtr> VROntology::process(string query, bool allowAssumptions) {
-    auto r = VRReasoner::create();
-    r->setOption("allowAssumptions", allowAssumptions);
-    return r->process(query, ptr());
+    if (!reasoner) reasoner = VRReasoner::create();
+    reasoner->setOption("allowAssumptions", allowAssumptions);
+    return reasoner->process(query, ptr());
 }
 
 VREntityPtr VROntology::addVec3Entity(string name, string concept, Vec3d v) {
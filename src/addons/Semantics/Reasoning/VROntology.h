@@ -12,6 +12,7 @@
 #include <map>
 #include <unordered_map>
 #include <vector>
+#include <deque>
 #include <memory>
 
 using namespace std;
@@ -33,6 +34,15 @@ struct VROntology : public std::enable_shared_from_this<VROntology>, public VRNa
     map<string, VRCallbackStrWrapperPtr> builtins;
     map<string, VROntologyWeakPtr> modules;
     map<string, VRConceptPtr> recentConcepts; // performance optimization
+    VROntologyIndexPtr index; // concept, value and reference lookups
+    VRReasonerPtr reasoner; // keeps compiled queries between calls of process
+
+    size_t version = 0; // incremented on every change
+    size_t schemaVersion = 0; // version of the last taxonomy or rule change
+    map<string, size_t> conceptVersions; // version of the last change of an entity of that concept
+    map<string, size_t> nameVersions; // version of the last add, remove or rename of an entity with that name
+    deque<pair<size_t, int>> changeLog; // version and ID of the last entity changes
+    size_t changeLogBegin = 0; // older changes are no longer logged
 
     VROntology(string name);
     static VROntologyPtr create(string name = "");
@@ -75,15 +85,29 @@ struct VROntology : public std::enable_shared_from_this<VROntology>, public VRNa
     VREntityPtr getEntity(string instance);
     VRPropertyPtr getProperty(string prop);
     vector<VREntityPtr> getEntities(string concept);
+    vector<VREntityPtr> getEntitiesByValue(string prop, string value);
+    vector<VREntityPtr> getReferencing(VREntityPtr e);
     vector<VROntologyRulePtr> getRules();
 
     void openOWL(string path);
     void saveOWL(string path);
+    void saveSnapshot(string path);
     string toString();
 
     void setFlag(string f);
     string getFlag();
 
+    void updateIndex(int entityID, const string& prop = "");
+    void rebuildIndex();
+
+    void changed(const vector<string>& concepts, const string& name = "", int entityID = -1);
+    void changedSchema();
+    void changedTaxonomy();
+    size_t getVersion();
+    size_t getConceptVersion(const string& concept);
+    size_t getNameVersion(const string& name);
+    bool getChanges(size_t since, vector<int>& IDs);
+
     vector<VREntityPtr> process(string query, bool allowAssumptions = false);
 };
 
@@ -0,0 +1,182 @@
+#include "VROntologyIndex.h"
+#include "VROntology.h"
+#include "VRConcept.h"
+#include "VREntity.h"
+#include "VRProperty.h"
+
+#include <set>
+
+using namespace OSG;
+
+VROntologyIndex::VROntologyIndex() {}
+VROntologyIndex::~VROntologyIndex() {}
+
+VROntologyIndexPtr VROntologyIndex::create() { return VROntologyIndexPtr( new VROntologyIndex() ); }
+
+void VROntologyIndex::insert(EntityMap& m, VREntityPtr e) { m[e->ID] = e; }
+
+void VROntologyIndex::erase(map<string, EntityMap>& m, const string& key, int ID) {
+    auto it = m.find(key);
+    if (it == m.end()) return;
+    it->second.erase(ID);
+    if (it->second.empty()) m.erase(it);
+}
+
+void VROntologyIndex::addReference(const string& value, VREntityPtr e) {
+    auto& r = byReference[value][e->ID];
+    r.first = e;
+    r.second++;
+}
+
+void VROntologyIndex::remReference(const string& value, int ID) {
+    auto it = byReference.find(value);
+    if (it == byReference.end()) return;
+    auto rit = it->second.find(ID);
+    if (rit == it->second.end()) return;
+    rit->second.second--;
+    if (rit->second.second <= 0) it->second.erase(rit);
+    if (it->second.empty()) byReference.erase(it);
+}
+
+void VROntologyIndex::clear() {
+    byConcept.clear();
+    byValue.clear();
+    byReference.clear();
+    entityConcepts.clear();
+    entityValues.clear();
+    taxonomyChanged = false;
+}
+
+void VROntologyIndex::build(VROntologyPtr o) {
+    clear();
+    for (auto& e : o->entities) addEntity(e.second);
+}
+
+void VROntologyIndex::indexConcepts(VREntityPtr e) {
+    set<string> names; // subsumption closure of all concepts of e
+    vector<VRConceptPtr> stack = e->getConcepts();
+    while (stack.size()) {
+        auto c = stack.back();
+        stack.pop_back();
+        if (!c || names.count(c->getName())) continue;
+        names.insert(c->getName());
+        for (auto& p : c->parents) stack.push_back(p.second);
+    }
+
+    auto& known = entityConcepts[e->ID];
+    for (auto& n : names) {
+        insert(byConcept[n], e);
+        known.push_back(n);
+    }
+}
+
+void VROntologyIndex::unindexConcepts(int ID) {
+    auto it = entityConcepts.find(ID);
+    if (it == entityConcepts.end()) return;
+    for (auto& n : it->second) erase(byConcept, n, ID);
+    entityConcepts.erase(it);
+}
+
+void VROntologyIndex::indexValues(VREntityPtr e, const string& prop) {
+    auto pit = e->properties.find(prop);
+    if (pit == e->properties.end()) return;
+
+    auto& known = entityValues[e->ID][prop];
+    for (auto& p : pit->second) {
+        if (!p.second) continue;
+        const string& value = p.second->value;
+        p.second->entity = e;
+        insert(byValue[prop][value], e);
+        addReference(value, e);
+        known.push_back(value);
+    }
+}
+
+void VROntologyIndex::unindexValues(int ID, const string& prop) {
+    auto eit = entityValues.find(ID);
+    if (eit == entityValues.end()) return;
+    auto pit = eit->second.find(prop);
+    if (pit == eit->second.end()) return;
+
+    auto vit = byValue.find(prop);
+    for (auto& value : pit->second) {
+        if (vit != byValue.end()) erase(vit->second, value, ID);
+        remReference(value, ID);
+    }
+    if (vit != byValue.end() && vit->second.empty()) byValue.erase(vit);
+    eit->second.erase(pit);
+}
+
+void VROntologyIndex::addEntity(VREntityPtr e) {
+    if (!e) return;
+    remEntity(e);
+    indexConcepts(e);
+    for (auto& p : e->properties) indexValues(e, p.first);
+}
+
+void VROntologyIndex::remEntity(VREntityPtr e) {
+    if (!e) return;
+    unindexConcepts(e->ID);
+    auto it = entityValues.find(e->ID);
+    if (it == entityValues.end()) return;
+    vector<string> props;
+    for (auto& p : it->second) props.push_back(p.first);
+    for (auto& p : props) unindexValues(e->ID, p);
+    entityValues.erase(e->ID);
+}
+
+void VROntologyIndex::updateConcepts(VREntityPtr e) {
+    if (!e) return;
+    unindexConcepts(e->ID);
+    indexConcepts(e);
+}
+
+void VROntologyIndex::updateProperty(VREntityPtr e, const string& prop) {
+    if (!e) return;
+    unindexValues(e->ID, prop);
+    indexValues(e, prop);
+}
+
+void VROntologyIndex::invalidateTaxonomy() { taxonomyChanged = true; }
+bool VROntologyIndex::needsRebuild() { return taxonomyChanged; }
+
+vector<VREntityPtr> VROntologyIndex::getEntities(const string& concept) {
+    vector<VREntityPtr> res;
+    auto it = byConcept.find(concept);
+    if (it == byConcept.end()) return res;
+    res.reserve(it->second.size());
+    for (auto& e : it->second) res.push_back(e.second);
+    return res;
+}
+
+vector<VREntityPtr> VROntologyIndex::getEntities(const string& prop, const string& value) {
+    vector<VREntityPtr> res;
+    auto pit = byValue.find(prop);
+    if (pit == byValue.end()) return res;
+    auto vit = pit->second.find(value);
+    if (vit == pit->second.end()) return res;
+    res.reserve(vit->second.size());
+    for (auto& e : vit->second) res.push_back(e.second);
+    return res;
+}
+
+vector<VREntityPtr> VROntologyIndex::getReferencing(const string& name) {
+    vector<VREntityPtr> res;
+    auto it = byReference.find(name);
+    if (it == byReference.end()) return res;
+    res.reserve(it->second.size());
+    for (auto& e : it->second) res.push_back(e.second.first);
+    return res;
+}
+
+size_t VROntologyIndex::countEntities(const string& concept) {
+    auto it = byConcept.find(concept);
+    if (it == byConcept.end()) return 0;
+    return it->second.size();
+}
+
+vector<string> VROntologyIndex::getConcepts(int ID) {
+    auto it = entityConcepts.find(ID);
+    if (it == entityConcepts.end()) return vector<string>();
+    return it->second;
+}
@@ -0,0 +1,70 @@
+#ifndef VRONTOLOGYINDEX_H_INCLUDED
+#define VRONTOLOGYINDEX_H_INCLUDED
+
+#include "../VRSemanticsFwd.h"
+
+#include <string>
+#include <map>
+#include <vector>
+#include <OpenSG/OSGConfig.h>
+
+using namespace std;
+OSG_BEGIN_NAMESPACE;
+
+/**
+ * Secondary indices of an ontology, kept up to date by VROntology and VREntity:
+ *  - concept name to entities, each entity is listed under all concepts it is_a
+ *  - property name and value to entities
+ *  - value to entities, used to find the entities referencing another entity by name
+ * Entity maps are keyed by ID to return entities in the same order as VROntology::entities.
+ */
+class VROntologyIndex {
+    private:
+        typedef map<int, VREntityPtr> EntityMap;
+        typedef map<int, pair<VREntityPtr, int>> CountedEntityMap; // an entity may use a value in several properties
+
+        map<string, EntityMap> byConcept;
+        map<string, map<string, EntityMap>> byValue;
+        map<string, CountedEntityMap> byReference;
+
+        map<int, vector<string>> entityConcepts;
+        map<int, map<string, vector<string>>> entityValues;
+
+        bool taxonomyChanged = false; // set by the ontology when a parent relation of its concepts changed
+
+        static void insert(EntityMap& m, VREntityPtr e);
+        static void erase(map<string, EntityMap>& m, const string& key, int ID);
+        void addReference(const string& value, VREntityPtr e);
+        void remReference(const string& value, int ID);
+
+        void indexConcepts(VREntityPtr e);
+        void unindexConcepts(int ID);
+        void indexValues(VREntityPtr e, const string& prop);
+        void unindexValues(int ID, const string& prop);
+
+    public:
+        VROntologyIndex();
+        ~VROntologyIndex();
+
+        static VROntologyIndexPtr create();
+
+        void clear();
+        void build(VROntologyPtr o);
+
+        void addEntity(VREntityPtr e);
+        void remEntity(VREntityPtr e);
+        void updateConcepts(VREntityPtr e);
+        void updateProperty(VREntityPtr e, const string& prop);
+        void invalidateTaxonomy();
+        bool needsRebuild();
+
+        vector<VREntityPtr> getEntities(const string& concept);
+        vector<VREntityPtr> getEntities(const string& prop, const string& value);
+        vector<VREntityPtr> getReferencing(const string& name);
+        size_t countEntities(const string& concept);
+        vector<string> getConcepts(int ID);
+};
+
+OSG_END_NAMESPACE;
+
+#endif // VRONTOLOGYINDEX_H_INCLUDED
@@ -0,0 +1,218 @@
+#include "VROntologySnapshot.h"
+#include "VROntology.h"
+#include "VRProperty.h"
+
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <cstring>
+#include <stdint.h>
+
+using namespace OSG;
+
+namespace {
+    const char snapshotMagic[8] = {'P','V','R','O','N','T','O','1'};
+
+    void writeCount(ostream& s, size_t n) {
+        uint32_t N = n;
+        s.write((const char*)&N, sizeof(N));
+    }
+
+    void writeString(ostream& s, const string& str) {
+        writeCount(s, str.size());
+        s.write(str.data(), str.size());
+    }
+
+    struct Reader { // checks every length against the rest of the stream, fails for good on the first bad read
+        istream& s;
+        size_t left = 0;
+        bool ok = true;
+
+        Reader(istream& s) : s(s) {
+            auto p = s.tellg();
+            s.seekg(0, ios::end);
+            auto e = s.tellg();
+            s.seekg(p);
+            ok = bool(s.good() && p >= 0 && e >= p);
+            if (ok) left = e - p;
+        }
+
+        bool readBytes(char* data, size_t N) {
+            if (!ok || N > left) { ok = false; return false; }
+            s.read(data, N);
+            ok = s.good();
+            if (ok) left -= N;
+            return ok;
+        }
+
+        size_t readCount(size_t elementSize = 0) { // elementSize is the least number of bytes each element takes
+            uint32_t N = 0;
+            if (!readBytes((char*)&N, sizeof(N))) return 0;
+            if (elementSize && N > left / elementSize) { ok = false; return 0; }
+            return N;
+        }
+
+        string readString() {
+            size_t N = readCount(1);
+            string str(N, '\0');
+            if (N && !readBytes(&str[0], N)) return "";
+            return str;
+        }
+    };
+}
+
+bool VROntologySnapshot::isSnapshot(string path) {
+    ifstream stream(path, ios::binary);
+    char magic[8];
+    if (!stream.read(magic, 8)) return false;
+    return memcmp(magic, snapshotMagic, 8) == 0;
+}
+
+void VROntologySnapshot::write(VROntologyPtr o, string path) {
+    ofstream stream(path, ios::binary);
+    if (!stream) { cout << "VROntologySnapshot::write failed to open " << path << endl; return; }
+    stream.write(snapshotMagic, 8);
+
+    vector<VRConceptPtr> concepts; // parents first
+    map<int, bool> visited;
+    function<void(VRConceptPtr)> visit = [&](VRConceptPtr c) {
+        if (!c || visited.count(c->ID)) return;
+        visited[c->ID] = true;
+        for (auto p : c->getParents()) visit(p);
+        if (c->getName() != "Thing") concepts.push_back(c);
+    };
+    for (auto c : o->getConcepts()) visit(c);
+
+    writeCount(stream, concepts.size());
+    for (auto c : concepts) {
+        vector<string> parents;
+        for (auto p : c->getParents()) if (p->getName() != "Thing") parents.push_back(p->getName());
+        writeString(stream, c->getName());
+        writeCount(stream, parents.size());
+        for (auto& p : parents) writeString(stream, p);
+        writeCount(stream, c->properties.size());
+        for (auto& p : c->properties) {
+            writeString(stream, p.second->getName());
+            writeString(stream, p.second->type);
+        }
+        writeCount(stream, c->annotations.size());
+        for (auto& a : c->annotations) {
+            writeString(stream, a.second->getName());
+            writeString(stream, a.second->type);
+            writeString(stream, a.second->value);
+        }
+    }
+
+    writeCount(stream, o->properties.size());
+    for (auto& p : o->properties) {
+        writeString(stream, p.second->getName());
+        writeString(stream, p.second->type);
+        writeCount(stream, p.second->parents.size());
+        for (auto& pp : p.second->parents) writeString(stream, pp);
+    }
+
+    writeCount(stream, o->entities.size());
+    for (auto& ei : o->entities) {
+        auto e = ei.second;
+        auto eConcepts = e->getConcepts();
+        writeString(stream, e->getName());
+        writeCount(stream, eConcepts.size());
+        for (auto c : eConcepts) writeString(stream, c->getName());
+        writeCount(stream, e->properties.size());
+        for (auto& p : e->properties) {
+            writeString(stream, p.first);
+            writeCount(stream, p.second.size());
+            for (auto& v : p.second) {
+                writeCount(stream, v.first);
+                writeString(stream, v.second->getName());
+                writeString(stream, v.second->type);
+                writeString(stream, v.second->value);
+            }
+        }
+    }
+
+    writeCount(stream, o->rules.size());
+    for (auto& r : o->rules) {
+        writeString(stream, r.second->rule);
+        writeString(stream, r.second->associatedConcept);
+    }
+}
+
+void VROntologySnapshot::read(VROntologyPtr o, string path) {
+    ifstream stream(path, ios::binary);
+    char magic[8];
+    if (!stream.read(magic, 8) || memcmp(magic, snapshotMagic, 8) != 0) { cout << "VROntologySnapshot::read, " << path << " is no ontology snapshot" << endl; return; }
+    Reader r(stream);
+    const size_t S = sizeof(uint32_t); // least size of a count or a string
+
+    size_t Nc = r.readCount(3*S);
+    for (size_t i=0; i<Nc && r.ok; i++) {
+        string name = r.readString();
+        vector<string> parents(r.readCount(S));
+        for (auto& p : parents) p = r.readString();
+
+        vector<pair<string, string>> props(r.readCount(2*S));
+        for (auto& p : props) { p.first = r.readString(); p.second = r.readString(); }
+
+        vector<VRPropertyPtr> annotations(r.readCount(3*S));
+        for (auto& a : annotations) {
+            a = VRProperty::create(r.readString());
+            a->type = r.readString();
+            a->value = r.readString();
+        }
+        if (!r.ok) break;
+
+        if (o->getConcept(name)) continue;
+        auto c = VRConcept::create(name, o);
+        for (auto& p : parents) if (auto pc = o->getConcept(p)) pc->append(c);
+        for (auto& p : props) c->addProperty(p.first, p.second);
+        for (auto& a : annotations) c->addAnnotation(a);
+        o->addConcept(c);
+    }
+
+    size_t Np = r.readCount(3*S);
+    for (size_t i=0; i<Np && r.ok; i++) {
+        auto p = VRProperty::create(r.readString());
+        p->type = r.readString();
+        p->parents.resize(r.readCount(S));
+        for (auto& pp : p->parents) pp = r.readString();
+        if (!r.ok) break;
+        if (!o->properties.count(p->getName())) o->addProperty(p);
+    }
+
+    size_t Ne = r.readCount(3*S);
+    for (size_t i=0; i<Ne && r.ok; i++) {
+        string name = r.readString();
+        vector<string> cNames(r.readCount(S));
+        for (auto& c : cNames) c = r.readString();
+
+        auto e = VREntity::create(name, o);
+        for (auto& c : cNames) if (auto C = o->getConcept(c)) e->concepts.push_back(C);
+
+        size_t Nk = r.readCount(2*S);
+        for (size_t j=0; j<Nk && r.ok; j++) {
+            string key = r.readString();
+            auto& values = e->properties[key];
+            size_t Nv = r.readCount(4*S);
+            for (size_t k=0; k<Nv && r.ok; k++) {
+                int pos = r.readCount();
+                auto p = VRProperty::create(r.readString());
+                p->type = r.readString();
+                p->value = r.readString();
+                if (r.ok) values[pos] = p;
+            }
+        }
+        if (!r.ok) break;
+
+        o->addEntity(e); // indexed once with all concepts and properties
+    }
+
+    size_t Nr = r.readCount(2*S);
+    for (size_t i=0; i<Nr && r.ok; i++) {
+        string rule = r.readString();
+        string ac = r.readString();
+        if (r.ok) o->addRule(rule, ac);
+    }
+
+    if (!r.ok) cout << "VROntologySnapshot::read, " << path << " is truncated or corrupt" << endl;
+}
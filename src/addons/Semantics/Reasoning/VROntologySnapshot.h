@@ -0,0 +1,30 @@
+#ifndef VRONTOLOGYSNAPSHOT_H_INCLUDED
+#define VRONTOLOGYSNAPSHOT_H_INCLUDED
+
+#include "../VRSemanticsFwd.h"
+
+#include <string>
+#include <OpenSG/OSGConfig.h>
+
+using namespace std;
+OSG_BEGIN_NAMESPACE;
+
+/**
+ * Compact binary ontology file, loads without RDF parsing:
+ *  - magic "PVRONTO1"
+ *  - concepts, parents before children: name, parent names, properties (name, type), annotations (name, type, value)
+ *  - properties: name, type, parent names
+ *  - entities: name, concept names, properties (key, then position, name, type and value of each value)
+ *  - rules: rule, associated concept
+ * Strings are stored as uint32 length followed by the characters, counts as uint32.
+ */
+class VROntologySnapshot {
+    public:
+        static bool isSnapshot(string path);
+        static void write(VROntologyPtr o, string path);
+        static void read(VROntologyPtr o, string path);
+};
+
+OSG_END_NAMESPACE;
+
+#endif // VRONTOLOGYSNAPSHOT_H_INCLUDED
@@ -1,4 +1,5 @@
 #include "VRProperty.h"
+#include "VREntity.h"
 #include "core/utils/toString.h"
 #include "core/utils/VRFunction.h"
 
@@ -30,6 +31,7 @@ void VRProperty::setValue(string value) {
     if (!isNumber(value)) for (char c : string(".,")) replace(value.begin(), value.end(),c,'_');
     if (this->value != value) {
         this->value = value;
+        if (auto e = entity.lock()) e->updateIndex(this);
         if (onChangeCb) (*onChangeCb)(value);
     }
 }
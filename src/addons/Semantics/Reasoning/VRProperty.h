@@ -15,6 +15,7 @@ struct VRProperty : public VROntoID, public VRName {
     string value;
     vector<string> parents;
     VRMessageCbPtr onChangeCb;
+    VREntityWeakPtr entity; // set while the value is indexed, to keep the ontology index up to date
 
     VRProperty(string name, string type = "");
     static VRPropertyPtr create(string name = "none", string type = "");
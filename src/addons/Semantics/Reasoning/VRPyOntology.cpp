@@ -92,10 +92,14 @@ typedef map<string, VROntologyPtr> ontoMap;
 PyMethodDef VRPyOntology::methods[] = {
     {"open", PyWrap(Ontology, openOWL, "Open OWL file", void, string) },
     {"save", PyWrap(Ontology, saveOWL, "Write to OWL file", void, string) },
+    {"saveSnapshot", PyWrap(Ontology, saveSnapshot, "Write to binary snapshot file, loads faster than OWL with open", void, string) },
     {"toString", PyWrap(Ontology, toString, "Return the full ontology as string - str toString()", string ) },
     {"getConcept", PyWrap(Ontology, getConcept, "Return a concept by name - concept getConcept( str name )\n\tThe first concept is named 'Thing'", VRConceptPtr, string ) },
     {"getConcepts", PyWrap(Ontology, getConcepts, "Return all concepts - [concept] getConcepts()", vector<VRConceptPtr> ) },
     {"getEntities", PyWrapOpt(Ontology, getEntities, "Return all entities by concept name - [entity] getEntities( str concept )", "", vector<VREntityPtr>, string ) },
+    {"getEntitiesByValue", PyWrap(Ontology, getEntitiesByValue, "Return all entities with a property value - [entity] getEntitiesByValue( str property, str value )", vector<VREntityPtr>, string, string ) },
+    {"getReferencing", PyWrap(Ontology, getReferencing, "Return all entities with a property refering to the entity - [entity] getReferencing( entity )", vector<VREntityPtr>, VREntityPtr ) },
+    {"rebuildIndex", PyWrap(Ontology, rebuildIndex, "Rebuild the lookup indices, they are kept up to date on changes", void ) },
     {"addConcept", PyWrapOpt(Ontology, addConcept, "Add a new concept, (concept, parent, properties, comment )", "||", VRConceptPtr, string, string, map<string, string>, string ) },
     {"addEntity", PyWrapOpt(Ontology, addEntity, "Add a new entity, str name, str concept", "|", VREntityPtr, string, string, map<string, string>) },
     {"addVectorEntity", PyWrapOpt(Ontology, addVec3Entity, "Add a new entity, str name, str concept", "|", VREntityPtr, string, string, Vec3d) },
@@ -118,6 +122,8 @@ PyMethodDef VRPyOntology::methods[] = {
 
 PyMethodDef VRPyReasoner::methods[] = {
     {"process", PyWrap(Reasoner, process, "Process query - process( str query, ontology )", vector<VREntityPtr>, string, VROntologyPtr ) },
+    {"setOption", PyWrap(Reasoner, setOption, "Set option, 'allowAssumptions' or 'incremental' (default True, reuse results while the ontology did not change)", void, string, bool ) },
+    {"clearCache", PyWrap(Reasoner, clearCache, "Forget cached query results", void ) },
     {NULL}  /* Sentinel */
 };
 
@@ -1,9 +1,11 @@
 #include "VRReasoner.h"
 #include "VROntology.h"
+#include "VROntologyIndex.h"
 #include "VRProperty.h"
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include <list>
 #include "core/utils/toString.h"
 #include "core/utils/VRCallbackWrapper.h"
@@ -507,7 +509,392 @@ bool VRReasoner::processQuery(Query& query, VRSemanticContextPtr context) {
     return true;
 }
 
+VRReasoner::Step::Step(OP op, string concept, string left, string right) : op(op), concept(concept), left(left), right(right) {}
+
+void VRReasoner::parseRules(VROntologyPtr onto) { // once per taxonomy or rule change
+    if (rulesParsed && rulesVersion == onto->schemaVersion) return;
+    rules.clear();
+    for (auto r : onto->getRules()) {
+        Query q(r->toString());
+        if (!q.request) continue;
+
+        Rule rule;
+        rule.rule = r->rule;
+        rule.verb = q.request->verb;
+        for (auto& t : q.request->terms) {
+            string concept = "var";
+            for (auto& s : q.statements) {
+                if (s->isSimpleVerb() || s->terms.size() == 0) continue;
+                if (s->terms[0].path.root != t.path.root) continue;
+                concept = s->verb;
+                break;
+            }
+            rule.params.push_back(t.path.root);
+            rule.concepts.push_back(concept);
+        }
+
+        for (auto& s : q.statements) {
+            vector<string> terms;
+            for (auto& t : s->terms) terms.push_back(t.str);
+            rule.statements.push_back(make_pair(s->verb, terms));
+        }
+        rules.push_back(rule);
+    }
+    rulesVersion = onto->schemaVersion;
+    rulesParsed = true;
+}
+
+void VRReasoner::compile(CompiledQuery& cq, string strQuery, VROntologyPtr onto) {
+    parseRules(onto);
+    cq = CompiledQuery();
+    cq.valid = true;
+    cq.schemaVersion = onto->schemaVersion;
+    cq.options = options;
+
+    // collect what the query and the rules it may fire depend on
+    Query query(strQuery);
+    if (!query.request) return;
+    vector<pair<string, vector<string>>> todo;
+    for (auto s : query.statements) {
+        vector<string> terms;
+        for (auto& t : s->terms) terms.push_back(t.str);
+        todo.push_back(make_pair(s->verb, terms));
+    }
+    todo.push_back(make_pair(query.request->verb, vector<string>()));
+    for (auto& t : query.request->terms) todo.back().second.push_back(t.str);
+
+    map<string, bool> verbs;
+    while (todo.size()) {
+        auto s = todo.back();
+        todo.pop_back();
+
+        if (s.first == "builtin") cq.global = true; // callbacks may read anything
+        if (s.first == "has") cq.global = true; // matches follow references recursively
+        if (onto->getConcept(s.first)) cq.concepts[s.first] = 0;
+        for (auto& str : s.second) {
+            VPath path(str);
+            if (path.size() > 2) cq.global = true; // follows references to other entities
+            cq.names[path.root] = 0;
+            if (auto e = onto->getEntity(path.root)) {
+                for (auto c : e->getConcepts()) cq.concepts[c->getName()] = 0;
+            }
+        }
+
+        if (verbs.count(s.first)) continue;
+        verbs[s.first] = true;
+        for (auto& r : rules) {
+            if (r.verb != s.first) continue;
+            for (auto& rs : r.statements) todo.push_back(rs);
+            todo.push_back(make_pair(r.verb, r.params));
+        }
+    }
+
+    for (auto& n : cq.names) n.second = onto->getNameVersion(n.first);
+    plan(cq, query, onto);
+    print(strQuery + (cq.planned ? " compiled to " + toString(cq.steps.size()) + " steps" : " is interpreted"));
+}
+
+void VRReasoner::plan(CompiledQuery& cq, Query& query, VROntologyPtr onto) { // replays run without entities to get the order of the statements
+    struct Atom {
+        string verb;
+        vector<string> terms;
+        bool done = false;
+    };
+
+    struct Frame {
+        int ID = 0;
+        vector<int> atoms;
+        int request = -1; // the statement calling the rule, -1 for the query
+    };
+
+    vector<Atom> atoms;
+    map<int, vector<int>> ruleAtoms; // the statements of a rule are shared by all its calls, see findRule
+    map<string, string> declared;
+    bool failed = false;
+
+    auto constant = [&](const string& name) -> string { // entities are variables of their first concept
+        auto e = onto->getEntity(name);
+        if (!e || e->getConcepts().size() == 0) return "";
+        return e->getConcepts()[0]->getName();
+    };
+
+    auto known = [&](const string& name) { return declared.count(name) || constant(name) != ""; };
+
+    auto conceptOf = [&](const string& name) -> string {
+        if (declared.count(name)) return declared[name];
+        string c = constant(name);
+        return c != "" ? c : "var";
+    };
+
+    auto isRule = [&](const string& verb) {
+        for (auto& r : rules) if (r.verb == verb) return true;
+        return false;
+    };
+
+    auto addAtom = [&](const string& verb, const vector<string>& terms) {
+        Atom a;
+        a.verb = verb;
+        a.terms = terms;
+        for (auto& t : terms) if (Term(t).isMathExpression()) failed = true;
+        atoms.push_back(a);
+        return int(atoms.size()-1);
+    };
+
+    auto evaluable = [&](Atom& a) -> bool { // mirrors evaluate
+        if (a.verb == "is" || a.verb == "has") {
+            if (a.terms.size() != 2) { failed = true; return false; }
+            VPath l(a.terms[0]);
+            VPath r(a.terms[1]);
+            if (a.verb == "is") {
+                if (!known(l.root)) return false;
+                Step s(Step::IS, "", a.terms[0], a.terms[1]);
+                s.literal = !known(r.root);
+                cq.steps.push_back(s);
+                return true;
+            }
+            if (!known(l.root) || !known(r.root)) { failed = true; return false; } // has would invalidate the entities of the other side
+            cq.steps.push_back(Step(Step::HAS, "", a.terms[0], a.terms[1]));
+            return true;
+        }
+
+        if (a.verb == "q" || a.verb == "set" || a.verb == "builtin") { failed = true; return false; }
+
+        if (a.terms.size() == 1 && onto->getConcept(a.verb)) {
+            if (isRule(a.verb)) { failed = true; return false; } // constructor rules add entities
+            string name = VPath(a.terms[0]).root;
+            if (!known(name)) declared[name] = a.verb;
+            cq.steps.push_back(Step(Step::DECLARE, a.verb, name));
+            return true;
+        }
+        return false;
+    };
+
+    auto findRule = [&](Atom& a) -> int { // mirrors findRule and VRStatement::match
+        for (size_t i=0; i<rules.size(); i++) {
+            auto& r = rules[i];
+            if (r.verb != a.verb || r.params.size() != a.terms.size()) continue;
+            bool match = true;
+            for (size_t j=0; j<a.terms.size(); j++) {
+                auto cS = onto->getConcept(r.concepts[j]);
+                auto cR = onto->getConcept(conceptOf(VPath(a.terms[j]).root));
+                if (cS && cR && !cS->is_a(cR) && !cR->is_a(cS)) match = false;
+            }
+            if (!match) continue;
+            if (a.verb == "is" || a.verb == "has" || a.verb == "set" || onto->getConcept(a.verb)) failed = true; // rules changing or adding entities
+            return i;
+        }
+        return -1;
+    };
+
+    auto callRule = [&](int i, vector<string> args) { // mirrors Query::substituteRequest
+        auto& r = rules[i];
+        if (!ruleAtoms.count(i)) for (auto& s : r.statements) ruleAtoms[i].push_back( addAtom(s.first, s.second) );
+        map<string, string> substitutes;
+        for (size_t j=0; j<r.params.size(); j++) substitutes[r.params[j]] = args[j];
+        for (int k : ruleAtoms[i]) {
+            for (auto& t : atoms[k].terms) {
+                VPath path(t);
+                if (!substitutes.count(path.root)) continue;
+                path.nodes[0] = substitutes[path.root];
+                t = path.toString();
+            }
+        }
+        return ruleAtoms[i];
+    };
+
+    list<Frame> frames;
+    int frameID = 0;
+    Frame main;
+    main.ID = frameID++;
+    for (auto s : query.statements) {
+        vector<string> terms;
+        for (auto& t : s->terms) terms.push_back(t.str);
+        main.atoms.push_back( addAtom(s->verb, terms) );
+    }
+    frames.push_back(main);
+
+    bool solved = false;
+    vector<int> hash;
+    int itr = 0;
+    int itr_stale = 0;
+    VRSemanticContext limits; // iteration limits of run
+
+    while (frames.size() && !failed) {
+        Frame& frame = frames.back();
+        bool done = true;
+        for (int a : frame.atoms) if (!atoms[a].done) done = false;
+        if (done) {
+            if (frame.request < 0) solved = true;
+            else atoms[frame.request].done = true;
+            frames.pop_back();
+            continue;
+        }
+
+        for (int a : frame.atoms) {
+            if (atoms[a].done) continue;
+            if (evaluable(atoms[a])) { atoms[a].done = true; continue; }
+            int r = findRule(atoms[a]);
+            if (failed) break;
+            if (r < 0) continue; // applying statements that can not be evaluated yet has no effect
+
+            Frame call;
+            call.ID = frameID++;
+            call.request = a;
+            call.atoms = callRule(r, atoms[a].terms);
+            frames.push_back(call);
+        }
+
+        vector<int> newHash;
+        for (auto& f : frames) newHash.push_back(f.ID);
+        if (newHash == hash) itr_stale++;
+        hash = newHash;
+        if (itr_stale >= limits.itr_max_stale) break;
+        if (++itr >= limits.itr_max) break;
+    }
+
+    auto request = query.request;
+    if (failed || !solved || request->verb != "q" || request->terms.size() == 0) { cq.steps.clear(); return; }
+    cq.result = request->terms[0].path.root;
+    if (!known(cq.result)) { cq.steps.clear(); return; }
+    cq.planned = true;
+
+    // a single variable filtered by literal values of its own properties
+    cq.unary = (declared.size() == 1 && declared.count(cq.result));
+    for (auto& s : cq.steps) {
+        if (s.op == Step::HAS || s.left.root != cq.result) cq.unary = false;
+        if (s.op == Step::IS && (!s.literal || s.left.size() > 2)) cq.unary = false;
+    }
+}
+
+bool VRReasoner::evaluatePlan(CompiledQuery& cq, VROntologyPtr onto) {
+    auto setResults = [&]() {
+        cq.results.clear();
+        for (auto& m : cq.matches) cq.results.push_back(m.second);
+        cq.matchVersion = onto->getVersion();
+        cq.matched = (cq.results.size() > 0);
+        return cq.matched; // else the interpreter decides on assumptions and side effects
+    };
+
+    vector<int> changes;
+    if (cq.unary && cq.matched && !onto->index->needsRebuild() && onto->getChanges(cq.matchVersion, changes)) {
+        auto test = [&](VREntityPtr e) {
+            auto concepts = onto->index->getConcepts(e->ID);
+            if (find(concepts.begin(), concepts.end(), cq.steps[0].concept) == concepts.end()) return false;
+            for (auto& s : cq.steps) {
+                if (s.op != Step::IS) continue;
+                auto values = s.left.getValue(e);
+                if (find(values.begin(), values.end(), s.right.root) == values.end()) return false;
+            }
+            return true;
+        };
+
+        for (int ID : changes) {
+            auto e = onto->getEntity(ID);
+            if (e && test(e)) cq.matches[ID] = e;
+            else cq.matches.erase(ID);
+        }
+        print("  tested " + toString(changes.size()) + " changed entities");
+        return setResults();
+    }
+
+    map<string, VariablePtr> vars;
+    auto getVariable = [&](const string& name) -> VariablePtr {
+        auto v = vars.find(name);
+        if (v != vars.end()) return v->second;
+        auto e = onto->getEntity(name); // entities are variables of their first concept, see VRSemanticContext::init
+        if (!e || e->getConcepts().size() == 0) return 0;
+        auto var = Variable::create(onto, {name});
+        var->concept = e->getConcepts()[0]->getName();
+        var->addEntity(e);
+        var->isAnonymous = false;
+        vars[name] = var;
+        return var;
+    };
+
+    cq.matched = false;
+    for (auto& s : cq.steps) {
+        if (s.op == Step::DECLARE) {
+            if (getVariable(s.left.root)) continue; // reuse variable
+            auto var = Variable::create(onto, {s.left.root});
+            var->concept = s.concept;
+            for (auto e : onto->getEntities(s.concept)) var->addEntity(e);
+            if (var->entities.size() == 0) return false;
+            vars[s.left.root] = var;
+            continue;
+        }
+
+        auto left = getVariable(s.left.root);
+        auto right = getVariable(s.right.root);
+        if (!left) return false;
+        if (!right) right = Variable::create(onto, {s.right.root});
+
+        bool b = false;
+        if (s.op == Step::HAS) b = left->has(right, s.left, s.right, onto);
+        else if (s.literal && s.left.size() == 2 && s.left.first.find('[') == string::npos) { // only entities in the value index can match
+            map<int, bool> candidates;
+            for (auto e : onto->getEntitiesByValue(s.left.first, s.right.root)) candidates[e->ID] = true;
+            for (auto& e : left->entities) {
+                auto& eval = left->evaluations[e.first];
+                if (eval.state == Evaluation::INVALID) continue;
+                bool r = false;
+                if (candidates.count(e.first)) {
+                    auto values = s.left.getValue(e.second);
+                    r = (find(values.begin(), values.end(), s.right.root) != values.end());
+                }
+                if (!r) eval.state = Evaluation::INVALID;
+                b = b || r;
+            }
+        } else b = left->is(right, s.left, s.right);
+        if (!b) return false; // the interpreter would apply the statement
+    }
+
+    auto var = getVariable(cq.result);
+    if (!var) return false;
+    cq.matches.clear();
+    for (auto& e : var->entities) {
+        if (var->evaluations[e.first].state == Evaluation::VALID) cq.matches[e.first] = e.second;
+    }
+    return setResults();
+}
+
+bool VRReasoner::isCompiled(CompiledQuery& cq, VROntologyPtr onto) {
+    if (!cq.valid || cq.options != options) return false;
+    if (cq.schemaVersion != onto->schemaVersion) return false;
+    for (auto& n : cq.names) if (onto->getNameVersion(n.first) != n.second) return false; // terms may name entities
+    return true;
+}
+
+bool VRReasoner::upToDate(CompiledQuery& cq, VROntologyPtr onto) {
+    if (!cq.cached) return false;
+    if (cq.global) return cq.version == onto->getVersion();
+    for (auto& c : cq.concepts) if (onto->getConceptVersion(c.first) != c.second) return false;
+    return true;
+}
+
+void VRReasoner::clearCache() { compiled.clear(); rulesParsed = false; }
+
 vector<VREntityPtr> VRReasoner::process(string strQuery, VROntologyPtr onto) {
+    bool incremental = !options.count("incremental") || options["incremental"];
+    if (!onto || !incremental) return run(strQuery, onto);
+
+    if (compiledOnto.lock() != onto) { clearCache(); compiledOnto = onto; }
+    if (compiled.size() > 1000 && !compiled.count(strQuery)) compiled.clear(); // queries with generated names
+    auto& cq = compiled[strQuery];
+    if (!isCompiled(cq, onto)) compile(cq, strQuery, onto);
+    if (upToDate(cq, onto)) {
+        print(strQuery + " (unchanged)");
+        return cq.results;
+    }
+
+    size_t v0 = onto->getVersion();
+    if (!cq.planned || !evaluatePlan(cq, onto)) cq.results = run(strQuery, onto);
+    cq.cached = bool(onto->getVersion() == v0); // queries changing the ontology are always reprocessed
+    cq.version = v0;
+    for (auto& c : cq.concepts) c.second = onto->getConceptVersion(c.first);
+    return cq.results;
+}
+
+vector<VREntityPtr> VRReasoner::run(string strQuery, VROntologyPtr onto) {
     print(strQuery);
 
     auto context = VRSemanticContext::create(onto); // create context
@@ -557,3 +944,11 @@ vector<VREntityPtr> VRReasoner::process(string strQuery, VROntologyPtr onto) {
 VRReasonerPtr VRReasoner::create() { return VRReasonerPtr( new VRReasoner() ); }
 
 void VRReasoner::setVerbose(bool gui, bool console) { verbGui = gui; verbConsole = console; }
+
+string VRReasoner::getMode(string query) {
+    auto q = compiled.find(query);
+    if (q == compiled.end() || !q->second.valid) return "";
+    if (!q->second.planned) return "interpreted";
+    if (q->second.unary && q->second.matched) return "incremental";
+    return "compiled";
+}
@@ -43,7 +43,67 @@ class VRReasoner {
         static bool startswith(string s, string subs);
 
     private:
+        /**
+         * A step of a compiled query, the rules are expanded in the order the interpreter would fire them:
+         *  - DECLARE binds a variable to the entities of a concept, taken from the concept index
+         *  - IS filters the entities of a variable by a value, literals are looked up in the value index
+         *  - HAS filters two variables by the references between their entities
+         */
+        struct Step {
+            enum OP { DECLARE, IS, HAS };
+            OP op;
+            string concept;
+            VPath left;
+            VPath right;
+            bool literal = false; // the right side of IS is no variable
+
+            Step(OP op, string concept, string left, string right = "");
+        };
+
+        /**
+         * A query compiled against the taxonomy, the rules and the entity names of the ontology.
+         * Queries of a single variable with literal filters are updated incrementally, only the
+         * entities changed since the last evaluation are tested again.
+         * Queries the plan can not express, or that fail and would make the interpreter change
+         * the ontology, are passed to the interpreter, its results are cached until an entity
+         * of a concept the query or one of its rules refers to changes.
+         * Queries following references (paths like a.b.c) or calling builtins depend on the whole ontology.
+         */
+        struct CompiledQuery {
+            bool valid = false;
+            size_t schemaVersion = 0;
+            map<string, bool> options;
+            map<string, size_t> names;
+
+            bool planned = false;
+            vector<Step> steps;
+            string result;
+            bool unary = false;
+            bool matched = false;
+            size_t matchVersion = 0;
+            map<int, VREntityPtr> matches;
+
+            bool cached = false;
+            bool global = false;
+            size_t version = 0;
+            map<string, size_t> concepts;
+            vector<VREntityPtr> results;
+        };
+
+        struct Rule {
+            string rule;
+            string verb;
+            vector<string> params;
+            vector<string> concepts; // as in VRSemanticContext::init
+            vector<pair<string, vector<string>>> statements;
+        };
+
         map<string, bool> options;
+        map<string, CompiledQuery> compiled;
+        VROntologyWeakPtr compiledOnto;
+        vector<Rule> rules;
+        size_t rulesVersion = 0;
+        bool rulesParsed = false;
 
         VRReasoner();
 
@@ -55,13 +115,23 @@ class VRReasoner {
         bool has(VRStatementPtr s, VRSemanticContextPtr c);
         bool findRule(VRStatementPtr s, VRSemanticContextPtr c);
         bool processQuery(Query& query, VRSemanticContextPtr c);
+        vector<VREntityPtr> run(string query, VROntologyPtr onto);
+
+        void parseRules(VROntologyPtr onto);
+        void compile(CompiledQuery& cq, string query, VROntologyPtr onto);
+        void plan(CompiledQuery& cq, Query& query, VROntologyPtr onto);
+        bool evaluatePlan(CompiledQuery& cq, VROntologyPtr onto);
+        bool isCompiled(CompiledQuery& cq, VROntologyPtr onto);
+        bool upToDate(CompiledQuery& cq, VROntologyPtr onto);
 
     public:
         static VRReasonerPtr create();
 
         void setOption(string option, bool b);
         vector<VREntityPtr> process(string query, VROntologyPtr onto);
+        void clearCache();
         void setVerbose(bool gui, bool console);
+        string getMode(string query); // how the cached query is answered, interpreted, compiled or incremental
 };
 
 OSG_END_NAMESPACE;
@@ -381,6 +381,7 @@ void VPath::setValue(string v, VREntityPtr e) {
         if (!prop) return;
         if (!e->properties.count(prop->getName())) e->set(prop->getName(), "");
         for (auto p : e->properties[prop->getName()]) p.second->setValue( v );
+        if (auto o = e->ontology.lock()) o->updateIndex(e->ID, prop->getName());
     }
 }
 
@@ -8,6 +8,7 @@ namespace OSG {
 ptrFwd(VRConcept);
 ptrFwd(VRProperty);
 ptrFwd(VROntology);
+ptrFwd(VROntologyIndex);
 ptrFwd(VREntity);
 ptrFwd(VROntologyRule);
 ptrFwd(VROntologyLink);
@@ -11,6 +11,8 @@
 #include "core/math/path.h"
 #include "core/math/pose.h"
 
+#include <random>
+
 using namespace OSG;
 
 VRBuilding::VRBuilding() {
@@ -18,6 +20,7 @@ VRBuilding::VRBuilding() {
     windowType = rand();
     doorType = rand();
     roofType = rand();
+    facadeSeed = rand();
 }
 
 VRBuilding::~VRBuilding() {}
@@ -66,14 +69,23 @@ void VRBuilding::addRoof(VRPolygon polygon) { roof = polygon; }
 void VRBuilding::setType(string t) { type = t; }
 
 void VRBuilding::computeGeometry(VRGeometryPtr walls, VRGeometryPtr roofs, VRDistrictPtr district) {
+    vector<VRGeoData::Builder> parts(1, VRGeoData::Builder(true, true, 2));
+    computeFacades(parts[0], district);
+    VRGeoData geo;
+    geo.concat(parts);
+    if (geo.size()) walls->merge( geo.asGeometry("facade") );
+    computeRoof(roofs, district);
+}
+
+void VRBuilding::computeFacades(VRGeoData::Builder& geo, VRDistrictPtr district) {
     height = 0;
+    minstd_rand random(facadeSeed); // rand() is not thread safe and would depend on the thread order
 
     // foundations
     for (auto foundation : foundations) {
         float H = foundation.first;
         auto& polygon = foundation.second;
 
-        VRGeoData geo;
         for (int i=0; i<polygon.size(); i++) {
             auto pos1 = polygon.getPoint(i);
             auto pos2 = polygon.getPoint((i+1)%polygon.size());
@@ -100,16 +112,15 @@ void VRBuilding::computeGeometry(VRGeometryPtr walls, VRGeometryPtr roofs, VRDis
                 Vec2d w1 = pos1 + (wallDir * (i*wall_segment));
                 Vec2d w2 = pos1 + (wallDir * ((i+1)*wall_segment));
                 Vec2d wallVector = w2-w1;
-                Vec3d n = Vec3d(-wallVector[1], 0, wallVector[0]);
+                Vec3f n = Vec3f(-wallVector[1], 0, wallVector[0]);
                 Color4f c = Color4f(UV[0], UV[1], 0, 0.25);
-                geo.pushVert(Vec3d(w1[0], low, w1[1]), n, c, Vec2d(UV[0], UV[1]), Vec2d(0, 0.25));
-                geo.pushVert(Vec3d(w2[0], low, w2[1]), n, c, Vec2d(UV[2], UV[1]), Vec2d(0, 0.25));
-                geo.pushVert(Vec3d(w2[0], high, w2[1]), n, c, Vec2d(UV[2], UV[3]), Vec2d(0, 0.5));
-                geo.pushVert(Vec3d(w1[0], high, w1[1]), n, c, Vec2d(UV[0], UV[3]), Vec2d(0, 0.5));
+                geo.pushVert(Pnt3f(w1[0], low, w1[1]), n, c, Vec2f(UV[0], UV[1]), Vec2f(0, 0.25));
+                geo.pushVert(Pnt3f(w2[0], low, w2[1]), n, c, Vec2f(UV[2], UV[1]), Vec2f(0, 0.25));
+                geo.pushVert(Pnt3f(w2[0], high, w2[1]), n, c, Vec2f(UV[2], UV[3]), Vec2f(0, 0.5));
+                geo.pushVert(Pnt3f(w1[0], high, w1[1]), n, c, Vec2f(UV[0], UV[3]), Vec2f(0, 0.5));
                 geo.pushQuad();
             }
         }
-        walls->merge( geo.asGeometry("foundation") );
     }
 
     // stories
@@ -117,7 +128,6 @@ void VRBuilding::computeGeometry(VRGeometryPtr walls, VRGeometryPtr roofs, VRDis
         float H = story.first;
         if (type == "shopping" && height == 0) H += 1;
         auto& polygon = story.second;
-        VRGeoData geo;
         for (int i=0; i<polygon.size(); i++) {
             auto pos1 = polygon.getPoint(i);
             auto pos2 = polygon.getPoint((i+1)%polygon.size());
@@ -140,7 +150,7 @@ void VRBuilding::computeGeometry(VRGeometryPtr walls, VRGeometryPtr roofs, VRDis
             vector<int> doors;
             if (height == 0) { // compute door layouts
                 // special cases
-                if (segN == 4) doors.push_back(1+rand()%2);
+                if (segN == 4) doors.push_back(1+random()%2);
 
                 // case 1: segN is multiple of 3
                 else if (segN >= 3 && segN%3 == 0) {
@@ -191,37 +201,37 @@ void VRBuilding::computeGeometry(VRGeometryPtr walls, VRGeometryPtr roofs, VRDis
                 Vec2d w2 = pos1 + (wallDir * ((i+1)*wall_segment));
 
                 Vec2d wallVector = w2-w1;
-                Vec3d n = Vec3d(-wallVector[1], 0, wallVector[0]);
+                Vec3f n = Vec3f(-wallVector[1], 0, wallVector[0]);
 
                 if (type == "shopping" && height == 0) {
-                    int si = N*float(rand()) / RAND_MAX;
+                    int si = random()%N;
                     dUV = district->getChunkUV("shops", si);
                     wUV = district->getChunkUV("shops", si);
                 }
 
                 if (isDoor(i)) { // door
                     Color4f c = Color4f(fUV[0], fUV[1], dUV[0], dUV[1]);
-                    geo.pushVert(Vec3d(w1[0], low, w1[1]), n, c, Vec2d(fUV[0], fUV[1]), Vec2d(dUV[0], dUV[1]));
-                    geo.pushVert(Vec3d(w2[0], low, w2[1]), n, c, Vec2d(fUV[2], fUV[1]), Vec2d(dUV[2], dUV[1]));
-                    geo.pushVert(Vec3d(w2[0], high, w2[1]), n, c, Vec2d(fUV[2], fUV[3]), Vec2d(dUV[2], dUV[3]));
-                    geo.pushVert(Vec3d(w1[0], high, w1[1]), n, c, Vec2d(fUV[0], fUV[3]), Vec2d(dUV[0], dUV[3]));
+                    geo.pushVert(Pnt3f(w1[0], low, w1[1]), n, c, Vec2f(fUV[0], fUV[1]), Vec2f(dUV[0], dUV[1]));
+                    geo.pushVert(Pnt3f(w2[0], low, w2[1]), n, c, Vec2f(fUV[2], fUV[1]), Vec2f(dUV[2], dUV[1]));
+                    geo.pushVert(Pnt3f(w2[0], high, w2[1]), n, c, Vec2f(fUV[2], fUV[3]), Vec2f(dUV[2], dUV[3]));
+                    geo.pushVert(Pnt3f(w1[0], high, w1[1]), n, c, Vec2f(fUV[0], fUV[3]), Vec2f(dUV[0], dUV[3]));
                     geo.pushQuad();
                 } else { // window
                     Color4f c = Color4f(fUV[0], fUV[1], wUV[0], wUV[1]);
-                    geo.pushVert(Vec3d(w1[0], low, w1[1]), n, c, Vec2d(fUV[0], fUV[1]), Vec2d(wUV[0], wUV[1]));
-                    geo.pushVert(Vec3d(w2[0], low, w2[1]), n, c, Vec2d(fUV[2], fUV[1]), Vec2d(wUV[2], wUV[1]));
-                    geo.pushVert(Vec3d(w2[0], high, w2[1]), n, c, Vec2d(fUV[2], fUV[3]), Vec2d(wUV[2], wUV[3]));
-                    geo.pushVert(Vec3d(w1[0], high, w1[1]), n, c, Vec2d(fUV[0], fUV[3]), Vec2d(wUV[0], wUV[3]));
+                    geo.pushVert(Pnt3f(w1[0], low, w1[1]), n, c, Vec2f(fUV[0], fUV[1]), Vec2f(wUV[0], wUV[1]));
+                    geo.pushVert(Pnt3f(w2[0], low, w2[1]), n, c, Vec2f(fUV[2], fUV[1]), Vec2f(wUV[2], wUV[1]));
+                    geo.pushVert(Pnt3f(w2[0], high, w2[1]), n, c, Vec2f(fUV[2], fUV[3]), Vec2f(wUV[2], wUV[3]));
+                    geo.pushVert(Pnt3f(w1[0], high, w1[1]), n, c, Vec2f(fUV[0], fUV[3]), Vec2f(wUV[0], wUV[3]));
                     geo.pushQuad();
                 }
 
             }
         }
         height += H;
-        walls->merge( geo.asGeometry("facade") );
     }
+}
 
-
+void VRBuilding::computeRoof(VRGeometryPtr roofs, VRDistrictPtr district) {
     int N = 4;
     //float _N = 1./N;
     int ri = N*float(roofType) / RAND_MAX;
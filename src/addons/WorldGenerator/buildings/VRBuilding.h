@@ -4,6 +4,7 @@
 #include "../VRWorldGeneratorFwd.h"
 #include "../VRWorldModule.h"
 #include "core/math/polygon.h"
+#include "core/objects/geometry/VRGeoData.h"
 
 OSG_BEGIN_NAMESPACE;
 using namespace std;
@@ -20,6 +21,7 @@ class VRBuilding : public VRWorldModule {
         int windowType = 0;
         int doorType = 0;
         int roofType = 0;
+        unsigned int facadeSeed = 0; // doors and shop fronts, the facades are computed in parallel
         float height = 0;
         float ground = 0;
 
@@ -40,6 +42,8 @@ class VRBuilding : public VRWorldModule {
         void addRoof(VRPolygon polygon);
 
         void computeGeometry(VRGeometryPtr walls, VRGeometryPtr roofs, VRDistrictPtr district);
+        void computeFacades(VRGeoData::Builder& walls, VRDistrictPtr district);
+        void computeRoof(VRGeometryPtr roofs, VRDistrictPtr district);
         VRGeometryPtr getCollisionShape();
 };
 
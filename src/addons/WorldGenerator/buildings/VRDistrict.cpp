@@ -87,6 +87,7 @@ void VRDistrict::addTextures(string folder, string type) {
 }
 
 VRTextureMosaicPtr VRDistrict::getTexture() { return texture; }
+VRGeometryPtr VRDistrict::getFacades() { return facades; }
 
 void VRDistrict::addBuilding( VRPolygonPtr p, int stories, string housenumber, string street, string type ) {
     p->removeDoubles(0.1);
@@ -149,7 +150,17 @@ void VRDistrict::addBuilding( VRPolygonPtr p, int stories, string housenumber, s
 
 void VRDistrict::computeGeometry() {
     init();
-    for (auto b : buildings) b.second->computeGeometry(facades, roofs, ptr());
+    vector<VRBuildingPtr> blds;
+    for (auto b : buildings) blds.push_back(b.second);
+
+    // facades are generated in parallel and applied once, roofs need the triangulator and stay on this thread
+    auto district = ptr();
+    VRGeoData walls;
+    walls.buildParallel(blds.size(), VRGeoData::Builder(true, true, 2), [&](VRGeoData::Builder& geo, size_t i) {
+        blds[i]->computeFacades(geo, district);
+    });
+    if (walls.size()) walls.apply(facades);
+    for (auto b : blds) b->computeRoof(roofs, district);
     roofs->updateNormals(true);
 }
 
@@ -24,7 +24,6 @@ class VRDistrict : public VRObject, public VRWorldModule {
         map<string, vector<Vec2i>> chunkIDs;
         VRMaterialPtr b_mat;
 
-        void computeGeometry();
         void init();
 
     public:
@@ -37,12 +36,14 @@ class VRDistrict : public VRObject, public VRWorldModule {
         void addTexture(VRTexturePtr tex, string type);
         void addTextures(string folder, string type);
         VRTextureMosaicPtr getTexture();
+        VRGeometryPtr getFacades();
 
         Vec4d getChunkUV(string type, int i);
 
         void addBuilding( VRPolygonPtr p, int stories, string housenumber, string street, string type );
         void remBuilding( string street, string housenumber );
         void clear();
+        void computeGeometry(); // all buildings, the facades in parallel
 };
 
 OSG_END_NAMESPACE;
@@ -425,10 +425,7 @@ void VRRoadNetwork::addGuardRail( PathPtr path, float height ) {
 	//rail->physicalize(true,false,false);
 	//rail.showGeometricData("Normals", True);
 
-	// add poles
-	auto pole = VRGeometry::create("pole");
-	pole->setPrimitive("Box 0.02 "+toString(height)+" "+toString(poleWidth)+" 1 1 1");
-	for (auto p : poles) guardRailPoles->merge(pole, p);
+	addGuardRailPoles(poles, height, poleWidth);
     guardRailPoles->setMaterial( w->getMaterial("guardrail") );
 
 	// physics
@@ -441,6 +438,34 @@ void VRRoadNetwork::addGuardRail( PathPtr path, float height ) {
 #endif
 }
 
+void VRRoadNetwork::addGuardRailPoles(const vector<PosePtr>& poles, float height, float width) {
+    Vec3d s = Vec3d(0.02, height, width)*0.5;
+    Vec2f T[4] = { Vec2f(0,0), Vec2f(1,0), Vec2f(1,1), Vec2f(0,1) };
+    VRGeoData data(guardRailPoles);
+    data.buildParallel(poles.size(), VRGeoData::Builder(true, false, 1), [&](VRGeoData::Builder& geo, size_t i) {
+        Matrix4d m = poles[i]->asMatrix();
+        for (int a=0; a<3; a++) { // one quad per box side
+            Vec3d u, v, n;
+            u[(a+1)%3] = s[(a+1)%3];
+            v[(a+2)%3] = s[(a+2)%3];
+            n[a] = 1;
+            for (int side : {1, -1}) {
+                Vec3d N = n*side;
+                Vec3d c = N*s[a];
+                Pnt3d P[4] = { Pnt3d(c-u-v), Pnt3d(c+u*side-v*side), Pnt3d(c+u+v), Pnt3d(c-u*side+v*side) };
+                m.mult(N, N);
+                int k0 = geo.size();
+                for (int k=0; k<4; k++) {
+                    m.mult(P[k], P[k]);
+                    geo.pushVert(Pnt3f(P[k]), Vec3f(N), Color4f(), T[k]);
+                }
+                geo.pushQuad(k0, k0+1, k0+2, k0+3);
+            }
+        }
+    });
+    if (data.size()) data.apply(guardRailPoles);
+}
+
 void VRRoadNetwork::addKirb( VRPolygonPtr perimeter, float h ) {
     auto w = world.lock();
     auto path = Path::create();
@@ -972,6 +997,7 @@ VRRoadIntersectionPtr VRRoadNetwork::getIntersection(VREntityPtr intersection) {
 
 VRGeometryPtr VRRoadNetwork::getTrafficSignalsGeo() { return trafficSignalsGeo; }
 VRGeometryPtr VRRoadNetwork::getTrafficSignalsPolesGeo() { return trafficSignalsPolesGeo; }
+VRGeometryPtr VRRoadNetwork::getGuardRailPolesGeo() { return guardRailPoles; }
 
 vector<VREntityPtr> VRRoadNetwork::getPreviousRoads(VREntityPtr road) {
 	auto getPreviousPaths = [](VREntityPtr path) {
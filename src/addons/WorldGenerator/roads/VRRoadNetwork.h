@@ -118,6 +118,7 @@ class VRRoadNetwork : public VRRoadBase {
 
         void addKirb( VRPolygonPtr p, float height );
         void addGuardRail( PathPtr p, float height );
+        void addGuardRailPoles(const vector<PosePtr>& poles, float height, float width);
         void addFence( PathPtr p, float height );
 
         void computeLanePaths( VREntityPtr road );
@@ -146,6 +147,7 @@ class VRRoadNetwork : public VRRoadBase {
         VRGeometryPtr getAssetCollisionObject();
         VRGeometryPtr getTrafficSignalsGeo();
         VRGeometryPtr getTrafficSignalsPolesGeo();
+        VRGeometryPtr getGuardRailPolesGeo();
 };
 
 OSG_END_NAMESPACE;
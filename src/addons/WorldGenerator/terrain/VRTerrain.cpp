@@ -547,6 +547,8 @@ void VRTerrain::setupMat() {
     mat->setZOffset(1,1);
 }
 
+TriangleBVHPtr VRTerrain::getBVH() { return 0; } // hits are refined against the heightmap by applyIntersectionAction
+
 bool VRTerrain::applyIntersectionAction(Action* action) {
     if (!mesh || !mesh->geo) return false;
 
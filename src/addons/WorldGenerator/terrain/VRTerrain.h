@@ -131,6 +131,7 @@ class VRTerrain : public VRGeometry, public VRWorldModule {
         Vec2d fromUVSpace(Vec2d uv);
 
         virtual bool applyIntersectionAction(Action* ia) override;
+        virtual TriangleBVHPtr getBVH() override;
 
         void physicalize(bool b);
 
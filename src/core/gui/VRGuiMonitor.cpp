@@ -3,6 +3,8 @@
 #include "core/utils/VRGlobals.h"
 #include "core/scene/VRScene.h"
 #include "core/scene/rendering/VRRenderManager.h"
+#include "core/setup/VRSetup.h"
+#include "core/setup/windows/VRMultiWindow.h"
 #include "core/objects/object/VRObject.h"
 #include "core/objects/geometry/VRGeometry.h"
 #include "core/gui/VRGuiManager.h"
@@ -18,6 +20,7 @@ VRGuiMonitor::VRGuiMonitor() {
     mgr->addCallback("profiler_update_scene", [&](OSG::VRGuiSignals::Options o){ updateSceneInfo(); return true; }, true );
     mgr->addCallback("profiler_update_performance", [&](OSG::VRGuiSignals::Options o){ updatePerformanceInfo(); return true; }, true );
     mgr->addCallback("profiler_update_frame", [&](OSG::VRGuiSignals::Options o){ updatePerformanceFrameInfo(toInt(o["frame"])); return true; }, true );
+    mgr->addCallback("profiler_update_cluster", [&](OSG::VRGuiSignals::Options o){ updateClusterInfo(); return true; }, true );
 
     updateSystemInfo();
 }
@@ -120,6 +123,25 @@ void VRGuiMonitor::updatePerformanceFrameInfo(int frameID) {
     uiSignal("set_profiler_frame", data);
 }
 
+void VRGuiMonitor::updateClusterInfo() { // per distributed window: connection, change list bytes and frame time breakdown in ms
+    map<string, string> data;
+    auto setup = VRSetup::getCurrent();
+    if (setup) {
+        auto main = setup->getStats();
+        data["|main"] = toString(main["pipelined"]) + " " + toString(main["simTime"]) + " " + toString(main["commitTime"]) + " " + toString(main["waitTime"]) + " " + toString(main["skippedFrames"]);
+
+        for (auto w : setup->getWindows()) {
+            auto win = dynamic_pointer_cast<VRMultiWindow>(w.second);
+            if (!win) continue;
+            auto stats = win->getStats();
+            data[w.first] = win->getConnectionType() + " " + win->getStateString();
+            data[w.first+"|stats"] = toString(stats["servers"]) + " " + toString(stats["frameBytes"]) + " " + toString(stats["totalBytes"]) + " " + toString(stats["syncTime"]) + " " + toString(stats["syncTimeMax"]) + " " + toString(stats["swapTime"]) + " " + toString(stats["applyTime"]) + " " + toString(stats["barrierTime"]) + " " + toString(stats["pipelined"]);
+        }
+    }
+
+    uiSignal("set_profiler_cluster", data);
+}
+
 bool VRGuiMonitor::on_button() {
     //int state = 1;
     //if (event->type == GDK_BUTTON_PRESS) state = 0;
@@ -29,6 +29,7 @@ class VRGuiMonitor {
         void updateSceneInfo();
         void updatePerformanceInfo();
         void updatePerformanceFrameInfo(int frame);
+        void updateClusterInfo();
 
     public:
         VRGuiMonitor();
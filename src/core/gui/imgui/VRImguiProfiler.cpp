@@ -15,6 +15,7 @@ ImProfiler::ImProfiler() : ImWidget("Profiler") {
     mgr->addCallback("set_profiler_scene", [&](OSG::VRGuiSignals::Options o){ updateScene(o); return true; }, true );
     mgr->addCallback("set_profiler_performance", [&](OSG::VRGuiSignals::Options o){ updatePerformance(o); return true; }, true );
     mgr->addCallback("set_profiler_frame", [&](OSG::VRGuiSignals::Options o){ updateFrame(o); return true; }, true );
+    mgr->addCallback("set_profiler_cluster", [&](OSG::VRGuiSignals::Options o){ updateCluster(o); return true; }, true );
 }
 
 void ImProfiler::updateSystem(OSG::VRGuiSignals::Options& o) {
@@ -46,6 +47,17 @@ void ImProfiler::updateFrame(OSG::VRGuiSignals::Options& o) {
     toValue(o["calls"], frameCalls);
 }
 
+void ImProfiler::updateCluster(OSG::VRGuiSignals::Options& o) {
+    clusterWindows.clear();
+    clusterStats.clear();
+    clusterMain.clear();
+    for (auto& d : o) {
+        if (d.first == "|main") toValue(d.second, clusterMain);
+        else if (endsWith(d.first, "|stats")) toValue(d.second, clusterStats[subString(d.first, 0, d.first.size()-6)]);
+        else clusterWindows[d.first] = d.second;
+    }
+}
+
 void ImProfiler::begin() {
     auto setCurrentTab = [&](string t) {
         if (t != currentTab) {
@@ -57,6 +69,7 @@ void ImProfiler::begin() {
     ImGuiTabItemFlags flags1 = (selected == "System") ? ImGuiTabItemFlags_SetSelected : 0;
     ImGuiTabItemFlags flags2 = (selected == "Scene") ? ImGuiTabItemFlags_SetSelected : 0;
     ImGuiTabItemFlags flags3 = (selected == "Performance") ? ImGuiTabItemFlags_SetSelected : 0;
+    ImGuiTabItemFlags flags4 = (selected == "Cluster") ? ImGuiTabItemFlags_SetSelected : 0;
     selected = "";
 
     if (ImGui::BeginTabBar("ProfilerTabBar", ImGuiTabBarFlags_None)) {
@@ -89,6 +102,15 @@ void ImProfiler::begin() {
             setCurrentTab("Scenegraph");
         }
 
+        if (ImGui::BeginTabItem("Cluster", NULL, flags4)) {
+            ImGui::Spacing();
+            ImGui::BeginChild("ProfCluster", ImGui::GetContentRegionAvail(), false, flags);
+            renderTabCluster();
+            ImGui::EndChild();
+            ImGui::EndTabItem();
+            setCurrentTab("Cluster");
+        }
+
         ImGui::EndTabBar();
     }
 }
@@ -211,4 +233,33 @@ void ImProfiler::renderTabPerformance() {
     ImGui::EndChild();
 }
 
+void ImProfiler::renderTabCluster() {
+    ImGuiIO& io = ImGui::GetIO();
 
+    ImGui::Text("Distributed windows:");
+    ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - 50*io.FontGlobalScale);
+    if (ImGui::Button("update##profClu")) uiSignal("profiler_update_cluster");
+
+    ImGui::Indent(10);
+    if (clusterMain.size() >= 5) {
+        string mode = clusterMain[0] ? "pipelined" : "synchronous";
+        ImGui::Text(("Main thread (" + mode + "):").c_str());
+        ImGui::Indent(10);
+            ImGui::Text(("Simulation: " + toString(clusterMain[1], 2) + " ms, commit: " + toString(clusterMain[2], 2) + " ms").c_str());
+            ImGui::Text(("Barriers: " + toString(clusterMain[3], 2) + " ms, skipped frames: " + toString(int(clusterMain[4]))).c_str());
+        ImGui::Unindent(10);
+    }
+
+    for (auto& w : clusterWindows) {
+        ImGui::Text((w.first + ": " + w.second).c_str());
+        auto& s = clusterStats[w.first];
+        if (s.size() < 9) continue;
+        ImGui::Indent(10);
+            ImGui::Text(("Servers: " + toString(int(s[0])) + (s[8] ? ", pipelined" : "")).c_str());
+            ImGui::Text(("Change list: " + toString(s[1]*1e-3, 1) + " kB last frame, " + toString(s[2]*1e-6, 1) + " MB total").c_str());
+            ImGui::Text(("Apply: " + toString(s[6], 2) + " ms, sync: " + toString(s[3], 2) + " ms, max " + toString(s[4], 2) + " ms").c_str());
+            ImGui::Text(("Swap: " + toString(s[5], 2) + " ms, barriers: " + toString(s[7], 2) + " ms").c_str());
+        ImGui::Unindent(10);
+    }
+    ImGui::Unindent(10);
+}
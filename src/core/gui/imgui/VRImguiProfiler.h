@@ -33,14 +33,20 @@ class ImProfiler : public ImWidget {
         int frameNThreads = 0;
         map<string, vector<OSG::Vec3i>> frameCalls;
 
+        map<string, string> clusterWindows;
+        map<string, vector<double>> clusterStats; // servers, frame bytes, total bytes, sync ms, max sync ms, swap ms, apply ms, barrier ms, pipelined
+        vector<double> clusterMain; // pipelined, simulation ms, commit ms, barrier ms, skipped frames
+
         void updateSystem(OSG::VRGuiSignals::Options& o);
         void updateScene(OSG::VRGuiSignals::Options& o);
         void updatePerformance(OSG::VRGuiSignals::Options& o);
         void updateFrame(OSG::VRGuiSignals::Options& o);
+        void updateCluster(OSG::VRGuiSignals::Options& o);
 
         void renderTabSystem();
         void renderTabScene();
         void renderTabPerformance();
+        void renderTabCluster();
 
     public:
         ImProfiler();
@@ -34,8 +34,7 @@ ImSetupManager::ImSetupManager() : ImWidget("SetupManager"),
     windowMSAA.setList({"none", "x2", "x4", "x8", "x16"});
     slaveSystemScreens.setList({":0.0", ":0.1", ":1.0", ":1.1"});
 
-    //vector<string> ctypes = {"Multicast", "SockPipeline", "StreamSock"};
-    vector<string> ctypes = {"Multicast", "StreamSock"};
+    vector<string> ctypes = {"Multicast", "SockPipeline", "StreamSock"};
     slaveConnectionType.setList(ctypes);
     winConnectionType.setList(ctypes);
 
@@ -30,6 +30,7 @@ ptrFwd(FABRIK);
 ptrFwd(Expression);
 ptrFwd(MathExpression);
 ptrFwd(TSDF);
+ptrFwd(TriangleBVH);
 ptrFwd(PCA);
 ptrFwd(PID);
 ptrFwd(SineFit);
@@ -0,0 +1,344 @@
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace OSG;
+
+namespace {
+    const int Nbins = 16;
+    const int maxLeafSize = 8; // two packets
+    const int maxSAHDepth = 96; // deeper nodes are split at the median, keeps the traversal stack bounded
+    const int maxStack = 160;
+    const float inf = 1e30;
+
+    float area(const float* b) {
+        float dx = max(b[3]-b[0], 0.f);
+        float dy = max(b[4]-b[1], 0.f);
+        float dz = max(b[5]-b[2], 0.f);
+        return dx*dy + dy*dz + dz*dx;
+    }
+
+    void clearBox(float* b) {
+        b[0] = b[1] = b[2] = inf;
+        b[3] = b[4] = b[5] = -inf;
+    }
+
+    void extendBox(float* b, const float* o) {
+        for (int i=0; i<3; i++) {
+            b[i] = min(b[i], o[i]);
+            b[i+3] = max(b[i+3], o[i+3]);
+        }
+    }
+}
+
+TriangleBVH::TriangleBVH() {}
+TriangleBVH::~TriangleBVH() {}
+
+TriangleBVHPtr TriangleBVH::create() { return TriangleBVHPtr( new TriangleBVH() ); }
+
+size_t TriangleBVH::size() const { return Ntriangles; }
+size_t TriangleBVH::getNodeCount() const { return nodes.size(); }
+
+void TriangleBVH::clear() {
+    nodes.clear();
+    packets.clear();
+    vertices.clear();
+    Ntriangles = 0;
+    Npositions = 0;
+}
+
+void TriangleBVH::build(const vector<float>& positions, const vector<int>& triangles) {
+    clear();
+    Npositions = positions.size()/3;
+    Ntriangles = triangles.size()/3;
+
+    vector<int> order;
+    vector<float> centroids(Ntriangles*3, 0);
+    vector<float> bounds(Ntriangles*6, 0);
+    order.reserve(Ntriangles);
+
+    for (size_t i=0; i<Ntriangles; i++) {
+        const int* t = &triangles[i*3];
+        bool valid = true;
+        for (int j=0; j<3; j++) if (t[j] < 0 || size_t(t[j]) >= Npositions) valid = false;
+        if (!valid) continue;
+
+        float* b = &bounds[i*6];
+        clearBox(b);
+        for (int j=0; j<3; j++) {
+            const float* p = &positions[t[j]*3];
+            for (int k=0; k<3; k++) {
+                b[k] = min(b[k], p[k]);
+                b[k+3] = max(b[k+3], p[k]);
+            }
+        }
+        for (int k=0; k<3; k++) centroids[i*3+k] = (b[k]+b[k+3])*0.5;
+        order.push_back(i);
+    }
+
+    if (order.size() == 0) return;
+    nodes.reserve(order.size()/2+1);
+    packets.reserve(order.size()/4+1);
+    vertices.reserve(order.size()*3+12);
+    nodes.push_back(Node());
+    buildNode(0, 0, order, 0, order.size(), centroids, bounds, triangles);
+    updatePackets(positions);
+    updateBounds();
+}
+
+void TriangleBVH::makeLeaf(int n, vector<int>& order, int begin, int end, const vector<int>& triangles) {
+    int N = end-begin;
+    nodes[n].first = packets.size();
+    nodes[n].count = (N+3)/4;
+
+    for (int i=begin; i<end; i+=4) {
+        Packet p;
+        for (int l=0; l<4; l++) {
+            int t = i+l < end ? order[i+l] : -1;
+            p.triangle[l] = t;
+            for (int j=0; j<3; j++) vertices.push_back(t >= 0 ? triangles[t*3+j] : -1);
+        }
+        packets.push_back(p);
+    }
+}
+
+void TriangleBVH::buildNode(int n, int depth, vector<int>& order, int begin, int end, const vector<float>& centroids, const vector<float>& bounds, const vector<int>& triangles) {
+    int N = end-begin;
+    if (N <= 4) { makeLeaf(n, order, begin, end, triangles); return; }
+
+    float box[6];
+    float cbox[6]; // bounds of the centroids
+    clearBox(box);
+    clearBox(cbox);
+    for (int i=begin; i<end; i++) {
+        int t = order[i];
+        extendBox(box, &bounds[t*6]);
+        const float* c = &centroids[t*3];
+        for (int k=0; k<3; k++) {
+            cbox[k] = min(cbox[k], c[k]);
+            cbox[k+3] = max(cbox[k+3], c[k]);
+        }
+    }
+
+    int bestAxis = -1;
+    int bestBin = 0;
+    float bestCost = inf;
+
+    if (depth < maxSAHDepth) {
+        for (int axis=0; axis<3; axis++) {
+            float extent = cbox[axis+3]-cbox[axis];
+            if (extent <= 1e-12) continue;
+            float scale = Nbins/extent;
+
+            int counts[Nbins] = {0};
+            float binBoxes[Nbins][6];
+            for (int b=0; b<Nbins; b++) clearBox(binBoxes[b]);
+            for (int i=begin; i<end; i++) {
+                int t = order[i];
+                int b = min(Nbins-1, int((centroids[t*3+axis]-cbox[axis])*scale));
+                counts[b]++;
+                extendBox(binBoxes[b], &bounds[t*6]);
+            }
+
+            float rightAreas[Nbins];
+            int rightCounts[Nbins];
+            float acc[6];
+            clearBox(acc);
+            int cnt = 0;
+            for (int b=Nbins-1; b>0; b--) {
+                extendBox(acc, binBoxes[b]);
+                cnt += counts[b];
+                rightAreas[b] = area(acc);
+                rightCounts[b] = cnt;
+            }
+
+            clearBox(acc);
+            cnt = 0;
+            for (int b=0; b<Nbins-1; b++) { // split between bin b and b+1
+                extendBox(acc, binBoxes[b]);
+                cnt += counts[b];
+                if (cnt == 0 || rightCounts[b+1] == 0) continue;
+                float cost = area(acc)*((cnt+3)/4) + rightAreas[b+1]*((rightCounts[b+1]+3)/4);
+                if (cost < bestCost) { bestCost = cost; bestAxis = axis; bestBin = b; }
+            }
+        }
+
+        float leafCost = area(box)*((N+3)/4);
+        if (N <= maxLeafSize && (bestAxis < 0 || bestCost >= leafCost)) { makeLeaf(n, order, begin, end, triangles); return; }
+    }
+
+    int mid = begin + N/2;
+    if (bestAxis >= 0) {
+        float extent = cbox[bestAxis+3]-cbox[bestAxis];
+        float scale = Nbins/extent;
+        float cmin = cbox[bestAxis];
+        auto it = partition(order.begin()+begin, order.begin()+end, [&](int t) {
+            return min(Nbins-1, int((centroids[t*3+bestAxis]-cmin)*scale)) <= bestBin;
+        });
+        mid = it - order.begin();
+        if (mid == begin || mid == end) mid = begin + N/2;
+    } else { // coincident centroids or too deep, median split along the largest extent
+        int axis = 0;
+        for (int k=1; k<3; k++) if (cbox[k+3]-cbox[k] > cbox[axis+3]-cbox[axis]) axis = k;
+        nth_element(order.begin()+begin, order.begin()+mid, order.begin()+end, [&](int a, int b) {
+            return centroids[a*3+axis] < centroids[b*3+axis];
+        });
+    }
+
+    int l = nodes.size();
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    nodes[n].first = l;
+    nodes[n].count = 0;
+    buildNode(l, depth+1, order, begin, mid, centroids, bounds, triangles);
+    buildNode(l+1, depth+1, order, mid, end, centroids, bounds, triangles);
+}
+
+void TriangleBVH::setLane(Packet& p, int l, const float* a, const float* b, const float* c) {
+    for (int k=0; k<3; k++) {
+        p.v0[k][l] = a[k];
+        p.e1[k][l] = b[k]-a[k];
+        p.e2[k][l] = c[k]-a[k];
+    }
+}
+
+void TriangleBVH::updatePackets(const vector<float>& positions) {
+    const float zero[3] = {0,0,0};
+    for (size_t i=0; i<packets.size(); i++) {
+        Packet& p = packets[i];
+        for (int l=0; l<4; l++) {
+            const int* v = &vertices[i*12+l*3];
+            if (v[0] < 0) setLane(p, l, zero, zero, zero); // degenerate, never hit
+            else setLane(p, l, &positions[v[0]*3], &positions[v[1]*3], &positions[v[2]*3]);
+        }
+    }
+}
+
+void TriangleBVH::updateBounds() { // children are always stored after their parent
+    for (int n = int(nodes.size())-1; n >= 0; n--) {
+        Node& node = nodes[n];
+        float b[6];
+        clearBox(b);
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first+node.count; i++) {
+                const Packet& p = packets[i];
+                for (int l=0; l<4; l++) {
+                    if (p.triangle[l] < 0) continue;
+                    for (int k=0; k<3; k++) {
+                        float v0 = p.v0[k][l];
+                        float v1 = v0 + p.e1[k][l];
+                        float v2 = v0 + p.e2[k][l];
+                        b[k] = min(b[k], min(v0, min(v1, v2)));
+                        b[k+3] = max(b[k+3], max(v0, max(v1, v2)));
+                    }
+                }
+            }
+        } else {
+            const Node& c1 = nodes[node.first];
+            const Node& c2 = nodes[node.first+1];
+            for (int k=0; k<3; k++) {
+                b[k] = min(c1.bmin[k], c2.bmin[k]);
+                b[k+3] = max(c1.bmax[k], c2.bmax[k]);
+            }
+        }
+
+        for (int k=0; k<3; k++) {
+            node.bmin[k] = b[k];
+            node.bmax[k] = b[k+3];
+        }
+    }
+}
+
+bool TriangleBVH::refit(const vector<float>& positions) {
+    if (positions.size()/3 != Npositions) return false;
+    updatePackets(positions);
+    updateBounds();
+    return true;
+}
+
+TriangleBVH::Hit TriangleBVH::intersect(Pnt3f origin, Vec3f dir, float tmax) const {
+    Hit res;
+    if (nodes.size() == 0) return res;
+
+    const float o[3] = { origin[0], origin[1], origin[2] };
+    const float d[3] = { dir[0], dir[1], dir[2] };
+    const float inv[3] = { 1.f/d[0], 1.f/d[1], 1.f/d[2] };
+    float best = tmax;
+    int bestPacket = -1;
+    int bestLane = -1;
+
+    auto slab = [&](const Node& node, float& tnear) {
+        float t0 = 0, t1 = best;
+        for (int k=0; k<3; k++) {
+            float a = (node.bmin[k]-o[k])*inv[k];
+            float b = (node.bmax[k]-o[k])*inv[k];
+            if (a > b) swap(a,b);
+            if (a > t0) t0 = a;
+            if (b < t1) t1 = b;
+        }
+        tnear = t0;
+        return t0 <= t1;
+    };
+
+    auto testPacket = [&](int i) { // one ray against four triangles, Moeller-Trumbore, written branch free for vectorization
+        const Packet& p = packets[i];
+        float ts[4];
+        for (int l=0; l<4; l++) {
+            float px = d[1]*p.e2[2][l] - d[2]*p.e2[1][l];
+            float py = d[2]*p.e2[0][l] - d[0]*p.e2[2][l];
+            float pz = d[0]*p.e2[1][l] - d[1]*p.e2[0][l];
+            float det = p.e1[0][l]*px + p.e1[1][l]*py + p.e1[2][l]*pz;
+            float sx = o[0]-p.v0[0][l];
+            float sy = o[1]-p.v0[1][l];
+            float sz = o[2]-p.v0[2][l];
+            float qx = sy*p.e1[2][l] - sz*p.e1[1][l];
+            float qy = sz*p.e1[0][l] - sx*p.e1[2][l];
+            float qz = sx*p.e1[1][l] - sy*p.e1[0][l];
+            float idet = 1.f/det;
+            float u = (sx*px + sy*py + sz*pz)*idet;
+            float v = (d[0]*qx + d[1]*qy + d[2]*qz)*idet;
+            float t = (p.e2[0][l]*qx + p.e2[1][l]*qy + p.e2[2][l]*qz)*idet;
+            bool ok = det != 0 && u >= 0 && v >= 0 && u+v <= 1 && t >= 0 && t < best;
+            ts[l] = ok ? t : inf;
+        }
+        for (int l=0; l<4; l++) {
+            if (ts[l] < best) { best = ts[l]; bestPacket = i; bestLane = l; }
+        }
+    };
+
+    float tnear;
+    if (!slab(nodes[0], tnear)) return res;
+
+    int stack[maxStack];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const Node& node = nodes[stack[--sp]];
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first+node.count; i++) testPacket(i);
+            continue;
+        }
+
+        float t1, t2;
+        bool h1 = slab(nodes[node.first], t1);
+        bool h2 = slab(nodes[node.first+1], t2);
+        if (h1 && h2) { // visit the nearer child first
+            if (t1 <= t2) { stack[sp++] = node.first+1; stack[sp++] = node.first; }
+            else { stack[sp++] = node.first; stack[sp++] = node.first+1; }
+        } else if (h1) stack[sp++] = node.first;
+        else if (h2) stack[sp++] = node.first+1;
+    }
+
+    if (bestPacket < 0) return res;
+    const Packet& p = packets[bestPacket];
+    Vec3f e1(p.e1[0][bestLane], p.e1[1][bestLane], p.e1[2][bestLane]);
+    Vec3f e2(p.e2[0][bestLane], p.e2[1][bestLane], p.e2[2][bestLane]);
+    res.hit = true;
+    res.t = best;
+    res.triangle = p.triangle[bestLane];
+    res.normal = e1.cross(e2);
+    res.normal.normalize();
+    return res;
+}
@@ -0,0 +1,71 @@
+#ifndef TRIANGLEBVH_H_INCLUDED
+#define TRIANGLEBVH_H_INCLUDED
+
+#include <OpenSG/OSGVector.h>
+#include "core/math/VRMathFwd.h"
+#include <vector>
+
+using namespace std;
+OSG_BEGIN_NAMESPACE;
+
+/**
+ * Bounding volume hierarchy over the triangles of a mesh, used for ray queries.
+ * Built with a binned surface area heuristic, leafs store their triangles in packets of four.
+ * The packets are laid out as structure of arrays, one ray is tested against four triangles at once.
+ * Refitting keeps the topology and only updates the vertices and bounds, for deforming meshes.
+ */
+class TriangleBVH {
+    public:
+        struct Hit {
+            bool hit = false;
+            float t = 0;
+            int triangle = -1;
+            Vec3f normal;
+        };
+
+    private:
+        struct Node {
+            float bmin[3] = {0,0,0};
+            float bmax[3] = {0,0,0};
+            int first = 0; // left child, right child is first+1, or first packet of a leaf
+            int count = 0; // packets of a leaf, 0 for inner nodes
+        };
+
+        struct Packet {
+            float v0[3][4];
+            float e1[3][4];
+            float e2[3][4];
+            int triangle[4];
+        };
+
+        vector<Node> nodes;
+        vector<Packet> packets;
+        vector<int> vertices; // position indices, three per packet lane, -1 for empty lanes
+        size_t Ntriangles = 0;
+        size_t Npositions = 0;
+
+        void buildNode(int node, int depth, vector<int>& order, int begin, int end, const vector<float>& centroids, const vector<float>& bounds, const vector<int>& triangles);
+        void makeLeaf(int node, vector<int>& order, int begin, int end, const vector<int>& triangles);
+        void setLane(Packet& p, int lane, const float* a, const float* b, const float* c);
+        void updatePackets(const vector<float>& positions);
+        void updateBounds();
+
+    public:
+        TriangleBVH();
+        ~TriangleBVH();
+
+        static TriangleBVHPtr create();
+
+        void build(const vector<float>& positions, const vector<int>& triangles);
+        bool refit(const vector<float>& positions);
+        void clear();
+
+        Hit intersect(Pnt3f origin, Vec3f dir, float tmax = 1e30) const;
+
+        size_t size() const;
+        size_t getNodeCount() const;
+};
+
+OSG_END_NAMESPACE;
+
+#endif // TRIANGLEBVH_H_INCLUDED
@@ -7,8 +7,11 @@
 #include <cstdlib>
 #include <iostream>
 #include "core/utils/Thread.h"
+#include "core/utils/VRMutex.h"
 #include <string>
 #include <memory>
+#include <deque>
+#include <atomic>
 
 //#ifdef _WINDOWS // TODO
 //#include <ws2tcpip.h>
@@ -19,6 +22,11 @@ using namespace OSG;
 using namespace boost::asio;
 using ip::tcp;
 
+static size_t newSessionID() {
+    static atomic<size_t> uIDcounter(0);
+    return uIDcounter++;
+}
+
 
 class Session {
     public:
@@ -34,8 +42,7 @@ class Session {
     public:
         Session(boost::asio::io_service& io, string g, function<string (string, size_t)> cb, VRTCPServer* p)
             : parent(p), socket(io), guard(g), onMessageCb(cb) {
-            static size_t uIDcounter = 0;
-            uID = uIDcounter++;
+            uID = newSessionID();
         }
 
         ~Session() {
@@ -102,17 +109,116 @@ class Session {
 };
 
 
+/**
+ * Recycles the receive buffers of the framed sessions,
+ * large buffers are not kept to bound the memory of the pool.
+ */
+class TCPBufferPool {
+    private:
+        VRMutex mtx;
+        vector<vector<char>> buffers;
+        size_t maxBuffers = 64;
+        size_t maxBufferSize = 1<<20;
+
+    public:
+        vector<char> acquire(size_t N) {
+            vector<char> b;
+            {
+                VRLock lock(mtx);
+                if (buffers.size() > 0) {
+                    b = move(buffers.back());
+                    buffers.pop_back();
+                }
+            }
+            if (b.size() < N) b.resize(N);
+            return b;
+        }
+
+        void release(vector<char>& b) {
+            if (b.capacity() > maxBufferSize) { b = vector<char>(); return; }
+            VRLock lock(mtx);
+            if (buffers.size() < maxBuffers) buffers.push_back(move(b));
+            b = vector<char>();
+        }
+};
+
+struct TCPServerStats {
+    atomic<size_t> connections;
+    atomic<size_t> accepted;
+    atomic<size_t> closed;
+    atomic<size_t> messagesIn;
+    atomic<size_t> messagesOut;
+    atomic<size_t> bytesIn;
+    atomic<size_t> bytesOut;
+    atomic<size_t> dropped;
+    atomic<size_t> stalls;
+
+    TCPServerStats() : connections(0), accepted(0), closed(0), messagesIn(0), messagesOut(0), bytesIn(0), bytesOut(0), dropped(0), stalls(0) {}
+};
+
+/**
+ * Session with length prefixed binary framing (4 bytes little endian size + payload),
+ * all handlers of a session are serialized on its strand so the server can run several io threads.
+ */
+class FramedSession : public std::enable_shared_from_this<FramedSession> {
+    public:
+        TCPServer* server = 0;
+        tcp::socket socket;
+        boost::asio::io_service::strand strand;
+        size_t uID = 0;
+
+        unsigned char header[4];
+        vector<char> payload;
+
+        deque<shared_ptr<string>> outQueue;
+        vector<shared_ptr<string>> writing;
+        VRMutex queueMtx; // guards the check and update of queuedBytes
+        atomic<size_t> queuedBytes;
+        bool writeInProgress = false;
+        bool readPaused = false;
+        atomic<bool> closed;
+
+    public:
+        FramedSession(boost::asio::io_service& io, TCPServer* s)
+            : server(s), socket(io), strand(io), queuedBytes(0), closed(false) {
+            uID = newSessionID();
+        }
+
+        ~FramedSession() {
+            boost::system::error_code ec;
+            socket.close(ec);
+        }
+
+        void start();
+        void readHeader();
+        void onHeader(const boost::system::error_code& ec);
+        void onPayload(const boost::system::error_code& ec, size_t N);
+        void dispatch(size_t N);
+
+        bool send(shared_ptr<string> msg);
+        void flush();
+        void onWritten(const boost::system::error_code& ec, size_t N);
+        void shutdown();
+};
+
+
 class TCPServer {
     private:
         VRTCPServer* parent = 0;
-        boost::asio::io_service io_service;
-        boost::asio::io_service::work worker;
+        unique_ptr<boost::asio::io_service> io; // recreated after close, its pending handlers die with it
+        unique_ptr<boost::asio::io_service::work> worker;
+        size_t Nthreads = 1;
         vector<Session*> sessions;
         unique_ptr<tcp::acceptor> acceptor;
-        Thread* service = 0;
+        vector<::Thread*> services;
         string guard;
 
+        VRMutex framedMtx;
+        VRMutex flowMtx;
+        map<size_t, weak_ptr<FramedSession>> framedSessions;
+
         function<string (string, size_t)> onMessageCb;
+        function<void (const VRTCPFrame&, size_t)> onFrameCb;
 
         template <typename Itr, typename Out>
         void copy_n(Itr it, size_t count, Out out) {
@@ -120,20 +226,46 @@ class TCPServer {
         }
 
         void waitFor() {
-            Session* s = new Session(io_service, guard, onMessageCb, parent);
+            Session* s = new Session(*io, guard, onMessageCb, parent);
             sessions.push_back(s);
             acceptor->async_accept(s->socket, [this,s](boost::system::error_code ec) { if (!ec) { s->start(); waitFor(); } });
         }
 
+        void waitForFramed() {
+            auto s = make_shared<FramedSession>(*io, this);
+            acceptor->async_accept(s->socket, [this,s](boost::system::error_code ec) {
+                if (ec) return; // acceptor closed
+                {
+                    VRLock lock(framedMtx);
+                    framedSessions[s->uID] = s;
+                }
+                stats.accepted++;
+                stats.connections++;
+                s->start();
+                waitForFramed();
+            });
+        }
+
 		void run() {
-			io_service.run();
+			io->run();
 		}
 
-    public:
-        TCPServer(VRTCPServer* p) : parent(p), worker(io_service) {
-            service = new ::Thread("TCPServer_service", [this](){ run(); });
+        void startServices() {
+            if (!io) {
+                io = unique_ptr<boost::asio::io_service>( new boost::asio::io_service() );
+                worker = unique_ptr<boost::asio::io_service::work>( new boost::asio::io_service::work(*io) );
+            }
+            while (services.size() < Nthreads) services.push_back( new ::Thread("TCPServer_service", [this](){ run(); }) );
         }
 
+    public:
+        TCPBufferPool pool;
+        TCPServerStats stats;
+        size_t maxQueue = 1<<22;
+        size_t maxFrame = 1<<26;
+
+        TCPServer(VRTCPServer* p) : parent(p) { startServices(); }
+
         ~TCPServer() { close(); }
 
         void onMessage( function<string (string, size_t)> f ) {
@@ -141,22 +273,223 @@ class TCPServer {
             for (auto s : sessions) s->onMessageCb = f;
         }
 
+        void onFrame( function<void (const VRTCPFrame&, size_t)> f ) { onFrameCb = f; }
+
+        void setThreads(int N) {
+            Nthreads = max(N, 1);
+            startServices();
+        }
+
         void listen(int port, string guard) {
             cout << "TCPServer listen on port " << port << ", guard: " << guard << endl;
             this->guard = guard;
-            if (!acceptor) acceptor = unique_ptr<tcp::acceptor>( new tcp::acceptor(io_service, tcp::endpoint(tcp::v4(), port)) );
+            startServices();
+            if (!acceptor) acceptor = unique_ptr<tcp::acceptor>( new tcp::acceptor(*io, tcp::endpoint(tcp::v4(), port)) );
             waitFor();
         }
 
-        void close() {
-            io_service.stop();
+        void listenFramed(int port) {
+            startServices();
+            cout << "TCPServer listen on port " << port << ", framed, " << services.size() << " io threads" << endl;
+            if (!acceptor) acceptor = unique_ptr<tcp::acceptor>( new tcp::acceptor(*io, tcp::endpoint(tcp::v4(), port)) );
+            waitForFramed();
+        }
+
+        void close() { // the server can listen again afterwards
+            if (io) io->stop();
+            for (auto service : services) {
+                if (service->joinable()) service->join();
+                delete service;
+            }
+            services.clear();
             for (auto s : sessions) delete s;
-            if (service->joinable()) service->join();
-            delete service;
-            service = 0;
+            sessions.clear();
+            {
+                VRLock lock(framedMtx);
+                framedSessions.clear();
+            }
+            acceptor.reset();
+            worker.reset();
+            io.reset(); // a stopped service would still run the handlers of the deleted sessions on restart
+        }
+
+        void handleFrame(const VRTCPFrame& frame, size_t uID) {
+            stats.messagesIn++;
+            stats.bytesIn += frame.size;
+            if (parent) {
+                VRLock lock(flowMtx);
+                parent->getInFlow().logFlow(frame.size*0.001);
+            }
+
+            if (onFrameCb) { onFrameCb(frame, uID); return; }
+            if (onMessageCb) {
+                string answer = onMessageCb(frame.str(), uID);
+                if (answer.size() > 0) send(uID, answer);
+            }
+        }
+
+        void logOutFlow(size_t N) {
+            stats.bytesOut += N;
+            if (parent) {
+                VRLock lock(flowMtx);
+                parent->getOutFlow().logFlow(N*0.001);
+            }
+        }
+
+        void removeSession(size_t uID) {
+            VRLock lock(framedMtx);
+            if (framedSessions.erase(uID)) {
+                stats.connections--;
+                stats.closed++;
+            }
+        }
+
+        shared_ptr<FramedSession> getSession(size_t uID) {
+            VRLock lock(framedMtx);
+            auto i = framedSessions.find(uID);
+            if (i == framedSessions.end()) return 0;
+            return i->second.lock();
+        }
+
+        bool send(size_t uID, const string& data) {
+            auto s = getSession(uID);
+            if (!s) return false;
+            return s->send( make_shared<string>(VRTCPUtils::frame(data)) );
+        }
+
+        void broadcast(const string& data) {
+            vector<shared_ptr<FramedSession>> targets;
+            {
+                VRLock lock(framedMtx);
+                for (auto& s : framedSessions) if (auto sp = s.second.lock()) targets.push_back(sp);
+            }
+            auto msg = make_shared<string>(VRTCPUtils::frame(data)); // shared by all sessions
+            for (auto s : targets) s->send(msg);
+        }
+
+        map<string, double> getStats() {
+            map<string, double> res;
+            res["threads"] = services.size();
+            res["connections"] = stats.connections;
+            res["accepted"] = stats.accepted;
+            res["closed"] = stats.closed;
+            res["messagesIn"] = stats.messagesIn;
+            res["messagesOut"] = stats.messagesOut;
+            res["bytesIn"] = stats.bytesIn;
+            res["bytesOut"] = stats.bytesOut;
+            res["dropped"] = stats.dropped;
+            res["stalls"] = stats.stalls;
+            return res;
         }
 };
 
+void FramedSession::start() {
+    boost::system::error_code ec;
+    socket.set_option(tcp::no_delay(true), ec);
+    readHeader();
+}
+
+void FramedSession::readHeader() {
+    auto self = shared_from_this();
+    boost::asio::async_read(socket, boost::asio::buffer(header, 4), strand.wrap([self](const boost::system::error_code& ec, size_t N) { self->onHeader(ec); }));
+}
+
+void FramedSession::onHeader(const boost::system::error_code& ec) {
+    if (ec) { shutdown(); return; }
+    size_t N = size_t(header[0]) | size_t(header[1])<<8 | size_t(header[2])<<16 | size_t(header[3])<<24;
+    if (N > server->maxFrame) {
+        cout << "FramedSession, frame of " << N << " bytes exceeds limit, close session " << uID << endl;
+        shutdown();
+        return;
+    }
+
+    payload = server->pool.acquire(N);
+    if (N == 0) { dispatch(0); return; }
+    auto self = shared_from_this();
+    boost::asio::async_read(socket, boost::asio::buffer(&payload[0], N), strand.wrap([self](const boost::system::error_code& ec, size_t N) { self->onPayload(ec, N); }));
+}
+
+void FramedSession::onPayload(const boost::system::error_code& ec, size_t N) {
+    if (ec) { server->pool.release(payload); shutdown(); return; }
+    dispatch(N);
+}
+
+void FramedSession::dispatch(size_t N) {
+    server->handleFrame(VRTCPFrame(payload.data(), N), uID);
+    server->pool.release(payload);
+    if (closed) return;
+    if (queuedBytes > server->maxQueue) { // backpressure, stop reading until the client consumed our answers
+        readPaused = true;
+        server->stats.stalls++;
+        return;
+    }
+    readHeader();
+}
+
+bool FramedSession::send(shared_ptr<string> msg) {
+    if (closed) return false;
+    {
+        VRLock lock(queueMtx);
+        if (queuedBytes + msg->size() > 2*server->maxQueue) {
+            server->stats.dropped++;
+            return false;
+        }
+        queuedBytes += msg->size();
+    }
+    auto self = shared_from_this();
+    strand.post([self, msg]() {
+        self->outQueue.push_back(msg);
+        self->flush();
+    });
+    return true;
+}
+
+void FramedSession::flush() { // batch all pending messages in one gather write
+    if (writeInProgress || outQueue.empty() || closed) return;
+    vector<boost::asio::const_buffer> buffers;
+    while (!outQueue.empty() && writing.size() < 64) {
+        writing.push_back(outQueue.front());
+        buffers.push_back(boost::asio::buffer(*outQueue.front()));
+        outQueue.pop_front();
+    }
+    writeInProgress = true;
+    auto self = shared_from_this();
+    boost::asio::async_write(socket, buffers, strand.wrap([self](const boost::system::error_code& ec, size_t N) { self->onWritten(ec, N); }));
+}
+
+void FramedSession::onWritten(const boost::system::error_code& ec, size_t N) {
+    writeInProgress = false;
+    server->stats.messagesOut += writing.size();
+    server->logOutFlow(N);
+    size_t S = 0;
+    for (auto& w : writing) S += w->size();
+    {
+        VRLock lock(queueMtx);
+        queuedBytes -= S;
+    }
+    writing.clear();
+    if (ec) { shutdown(); return; }
+    flush();
+    if (readPaused && queuedBytes <= server->maxQueue/2) {
+        readPaused = false;
+        readHeader();
+    }
+}
+
+void FramedSession::shutdown() {
+    if (closed.exchange(true)) return;
+    boost::system::error_code ec;
+    socket.shutdown(tcp::socket::shutdown_both, ec);
+    socket.close(ec);
+    outQueue.clear();
+    server->removeSession(uID);
+}
+
+
+VRTCPFrame::VRTCPFrame() {}
+VRTCPFrame::VRTCPFrame(const char* d, size_t s) : data(d), size(s) {}
+string VRTCPFrame::str() const { return data ? string(data, size) : string(); }
+
 VRTCPServer::VRTCPServer(string n) : VRNetworkServer(n) { protocol = "tcp"; server = new TCPServer(this); }
 VRTCPServer::~VRTCPServer() { delete server; }
 
@@ -167,9 +500,16 @@ VRTCPServerPtr VRTCPServer::create(string name) {
 }
 
 void VRTCPServer::onMessage( function<string(string, size_t)> f ) { server->onMessage(f); }
+void VRTCPServer::onFrame( function<void(const VRTCPFrame&, size_t)> f ) { server->onFrame(f); }
+void VRTCPServer::setThreads(int N) { server->setThreads(N); }
+void VRTCPServer::setMaxQueue(size_t bytes) { server->maxQueue = bytes; }
 void VRTCPServer::listen(int port, string guard) { this->port = port; server->listen(port, guard); }
+void VRTCPServer::listenFramed(int port) { this->port = port; server->listenFramed(port); }
 void VRTCPServer::close() { server->close(); }
+bool VRTCPServer::send(size_t uID, const string& data) { return server->send(uID, data); }
+void VRTCPServer::broadcast(const string& data) { server->broadcast(data); }
 int VRTCPServer::getPort() { return port; }
+map<string, double> VRTCPServer::getStats() { return server->getStats(); }
 
 string VRTCPServer::getPublicIP() {
     if (publicIP != "") return publicIP;
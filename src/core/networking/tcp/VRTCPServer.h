@@ -4,6 +4,7 @@
 #include "../VRNetworkServer.h"
 
 #include <string>
+#include <map>
 #include <functional>
 
 class TCPServer;
@@ -11,6 +12,20 @@ class TCPServer;
 using namespace std;
 namespace OSG {
 
+/**
+ * Non owning view on a received binary frame,
+ * the data is only valid during the callback, copy it with str() if needed.
+ */
+struct VRTCPFrame {
+    const char* data = 0;
+    size_t size = 0;
+
+    VRTCPFrame();
+    VRTCPFrame(const char* data, size_t size);
+
+    string str() const;
+};
+
 class VRTCPServer : public VRNetworkServer {
     private:
         TCPServer* server = 0;
@@ -23,12 +38,21 @@ class VRTCPServer : public VRNetworkServer {
         static VRTCPServerPtr create(string name = "none");
 
         void onMessage( function<string(string, size_t)> f );
+        void onFrame( function<void(const VRTCPFrame&, size_t)> f );
+
+        void setThreads(int N);
+        void setMaxQueue(size_t bytes);
 
         void listen(int port, string guard = "");
+        void listenFramed(int port);
         void close();
 
+        bool send(size_t uID, const string& data);
+        void broadcast(const string& data);
+
         string getPublicIP();
         int getPort();
+        map<string, double> getStats();
 };
 
 }
@@ -93,3 +93,10 @@ string VRTCPUtils::getPublicIP(bool cached) {
 
     return string(addressBuffer);*/
 }
+
+string VRTCPUtils::frame(const string& payload) { // length prefix used by VRTCPServer::listenFramed
+    size_t N = payload.size();
+    string res(4, 0);
+    for (int i=0; i<4; i++) res[i] = char((N >> (8*i)) & 0xFF);
+    return res + payload;
+}
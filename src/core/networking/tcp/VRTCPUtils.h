@@ -15,6 +15,8 @@ class VRTCPUtils {
         static string getPublicIP(bool cached = false);
         static string getHostName(string uri);
         static string getHostIP(string host);
+
+        static string frame(const string& payload);
 };
 
 }
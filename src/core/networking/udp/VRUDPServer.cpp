@@ -6,8 +6,19 @@
 #include <cstdlib>
 #include <iostream>
 #include "core/utils/Thread.h"
+#include "core/utils/VRMutex.h"
 #include <string>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
 
 #include "core/scene/VRSceneManager.h"
 #include "core/scene/VRScene.h"
@@ -22,6 +33,60 @@ using namespace boost::asio;
 using ip::address;
 using ip::udp;
 
+static long long udpNow() { // microseconds since epoch, comparable between processes on the same host
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Preallocated packet ring between the receive thread (producer)
+ * and the frame loop (consumer), the handoff is lock free.
+ */
+class UDPPacketRing {
+    public:
+        struct Slot {
+            size_t size = 0;
+            size_t source = 0;
+            long long time = 0;
+        };
+
+        size_t N = 0;
+        size_t S = 0;
+        vector<char> storage;
+        vector<Slot> slots;
+        atomic<size_t> head;
+        atomic<size_t> tail;
+
+    public:
+        UDPPacketRing() : head(0), tail(0) {}
+
+        void init(size_t n, size_t s) {
+            N = n;
+            S = s;
+            storage = vector<char>(N*S);
+            slots = vector<Slot>(N);
+            head = 0;
+            tail = 0;
+        }
+
+        size_t freeSlots() { return N - (head.load(memory_order_relaxed) - tail.load(memory_order_acquire)); }
+        char* data(size_t i) { return &storage[(i%N)*S]; }
+        Slot& slot(size_t i) { return slots[i%N]; }
+};
+
+struct UDPSourceStats {
+    bool init = false;
+    unsigned int lastSeq = 0;
+    size_t received = 0;
+    size_t lost = 0;
+    size_t reordered = 0;
+    long long lastArrival = 0;
+    long long lastTransit = 0;
+    double interval = 0;
+    double jitter = 0; // RFC 3550 estimator, in microseconds
+    double latencySum = 0;
+    size_t latencyN = 0;
+};
+
 class UDPServer {
     private:
         VRUDPServer* parent = 0;
@@ -35,8 +100,33 @@ class UDPServer {
         udp::endpoint remote_endpoint;
 
         function<string (string)> onMessageCb;
+        function<void (const vector<VRUDPPacket>&)> onPacketsCb;
         bool deferredMessaging = false;
 
+        // batched mode
+        ::Thread* batchService = 0;
+        atomic<bool> stopBatch;
+        UDPPacketRing ring;
+        udp::endpoint batchEndpoint;
+        vector<char> scratch;
+        VRUpdateCbPtr updateCb;
+        bool coalescing = false;
+        bool stamped = false;
+        vector<VRUDPPacket> batch;
+        unordered_map<size_t, size_t> latest;
+
+        VRMutex statsMtx;
+        map<size_t, UDPSourceStats> sources;
+        atomic<size_t> received;
+        atomic<size_t> overflow;
+        atomic<size_t> truncated;
+        size_t delivered = 0;
+        size_t batches = 0;
+        size_t coalesced = 0;
+        size_t malformed = 0;
+        double queueLatencySum = 0;
+        size_t queueLatencyN = 0;
+
         void wait() {
             auto cb = boost::bind(&UDPServer::read_handler, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred);
             socket.async_receive_from(boost::asio::buffer(buffer), remote_endpoint, cb);
@@ -70,15 +160,129 @@ class UDPServer {
                     }
                 } else {
                     auto scene = VRScene::getCurrent();
-                    auto cb = VRUpdateCb::create("udpDeferred", [&](){onMessageCb(msg);});
+                    auto cb = VRUpdateCb::create("udpDeferred", [this, msg](){onMessageCb(msg);});
                     scene->queueJob(cb);
                 }
             }
             wait();
         }
 
+        static size_t sourceKey(unsigned long addr, unsigned short port) { return (size_t(addr) << 16) | port; }
+
+        void receiveBatched() {
+#ifdef __linux__
+            int fd = socket.native_handle();
+            timeval tv;
+            tv.tv_sec = 0;
+            tv.tv_usec = 100000; // wake up regularly to check stopBatch
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+            const size_t B = 64;
+            vector<mmsghdr> msgs(B);
+            vector<iovec> iovs(B);
+            vector<sockaddr_in> addrs(B);
+            vector<char> scratch(ring.S);
+
+            while (!stopBatch) {
+                size_t h = ring.head.load(memory_order_relaxed);
+                size_t n = min(B, ring.freeSlots());
+                if (n == 0) { // frame loop is behind, drop the datagram
+                    if (recv(fd, &scratch[0], scratch.size(), 0) > 0) overflow++;
+                    continue;
+                }
+
+                for (size_t i=0; i<n; i++) {
+                    iovs[i].iov_base = ring.data(h+i);
+                    iovs[i].iov_len = ring.S;
+                    memset(&msgs[i].msg_hdr, 0, sizeof(msghdr));
+                    msgs[i].msg_hdr.msg_name = &addrs[i];
+                    msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                    msgs[i].msg_hdr.msg_iov = &iovs[i];
+                    msgs[i].msg_hdr.msg_iovlen = 1;
+                }
+
+                int r = recvmmsg(fd, &msgs[0], n, MSG_WAITFORONE, 0);
+                if (r <= 0) continue;
+
+                long long now = udpNow();
+                for (int i=0; i<r; i++) {
+                    auto& slot = ring.slot(h+i);
+                    slot.size = msgs[i].msg_len;
+                    slot.source = sourceKey(ntohl(addrs[i].sin_addr.s_addr), ntohs(addrs[i].sin_port));
+                    slot.time = now;
+                    if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) truncated++;
+                }
+                received += r;
+                ring.head.store(h+r, memory_order_release);
+            }
+#endif
+        }
+
+        void receiveAsync() { // fallback without recvmmsg, runs on the io service so close() can cancel it
+            if (stopBatch) return;
+            if (ring.freeSlots() == 0) { // frame loop is behind, drop the datagram
+                socket.async_receive_from(boost::asio::buffer(scratch), batchEndpoint, [this](const boost::system::error_code& ec, size_t N) {
+                    if (ec == boost::asio::error::operation_aborted) return;
+                    if (!ec) overflow++;
+                    receiveAsync();
+                });
+                return;
+            }
+
+            size_t h = ring.head.load(memory_order_relaxed);
+            socket.async_receive_from(boost::asio::buffer(ring.data(h), ring.S), batchEndpoint, [this, h](const boost::system::error_code& ec, size_t N) {
+                if (ec == boost::asio::error::operation_aborted) return;
+                if (!ec) {
+                    auto& slot = ring.slot(h);
+                    slot.size = N;
+                    slot.source = sourceKey(batchEndpoint.address().to_v4().to_ulong(), batchEndpoint.port());
+                    slot.time = udpNow();
+                    received++;
+                    ring.head.store(h+1, memory_order_release);
+                }
+                receiveAsync();
+            });
+        }
+
+        static unsigned long long readLE(const char* d, int n) {
+            unsigned long long v = 0;
+            for (int i=0; i<n; i++) v |= (unsigned long long)(unsigned char)d[i] << (8*i);
+            return v;
+        }
+
+        void account(size_t source, long long arrival, bool hasStamp, unsigned int seq, long long sent) {
+            auto& st = sources[source];
+            st.received++;
+
+            if (hasStamp) {
+                long long transit = arrival - sent;
+                st.latencySum += transit;
+                st.latencyN++;
+                if (st.init) {
+                    double D = double(transit - st.lastTransit);
+                    st.jitter += (abs(D) - st.jitter)/16.0;
+                    int gap = int(seq - st.lastSeq);
+                    if (gap > 1) st.lost += gap-1;
+                    if (gap <= 0) {
+                        st.reordered++;
+                        if (st.lost > 0) st.lost--; // late arrival was counted as lost
+                    }
+                }
+                st.lastTransit = transit;
+                if (!st.init || int(seq - st.lastSeq) > 0) st.lastSeq = seq;
+            } else if (st.init) { // no sender time, use the variation of the arrival interval
+                double dt = double(arrival - st.lastArrival);
+                if (st.received == 2) st.interval = dt;
+                st.jitter += (abs(dt - st.interval) - st.jitter)/16.0;
+                st.interval += (dt - st.interval)/16.0;
+            }
+
+            st.lastArrival = arrival;
+            st.init = true;
+        }
+
     public:
-        UDPServer(VRUDPServer* s) : parent(s), worker(io_service), socket(io_service) {
+        UDPServer(VRUDPServer* s) : parent(s), worker(io_service), socket(io_service), stopBatch(false), received(0), overflow(0), truncated(0) {
             service = new ::Thread("UDPServer_service", [this](){ run(); });
         }
 
@@ -88,6 +292,114 @@ class UDPServer {
         }
 
         void onMessage( function<string (string)> f, bool b ) { onMessageCb = f; deferredMessaging = b; }
+        void onPackets( function<void (const vector<VRUDPPacket>&)> f ) { onPacketsCb = f; }
+        void setCoalescing(bool b) { coalescing = b; }
+        void setStamped(bool b) { stamped = b; }
+
+        void listenBatched(int port, int ringSize, int slotSize) {
+            cout << "UDPServer listen on port " << port << ", batched, ring of " << ringSize << " x " << slotSize << " bytes" << endl;
+            ring.init(max(ringSize, 2), max(slotSize, 16));
+            socket.open(udp::v4());
+            boost::system::error_code ec;
+            socket.set_option(boost::asio::socket_base::receive_buffer_size(1<<22), ec);
+            socket.bind(udp::endpoint(udp::v4(), port));
+            stopBatch = false;
+#ifdef __linux__
+            batchService = new ::Thread("UDPServer_batch", [this](){ receiveBatched(); });
+#else
+            scratch.resize(ring.S);
+            receiveAsync();
+#endif
+
+            updateCb = VRUpdateCb::create("udpBatch", bind(&UDPServer::update, this));
+            if (auto sm = VRSceneManager::get()) sm->addUpdateFkt(updateCb); // not bound to a scene, headless callers call update themselves
+        }
+
+        void update() { // drain the ring, called once per frame
+            if (ring.N == 0) return;
+            size_t t = ring.tail.load(memory_order_relaxed);
+            size_t h = ring.head.load(memory_order_acquire);
+            if (t == h) return;
+
+            long long now = udpNow();
+            size_t bytes = 0;
+            batch.clear();
+            latest.clear();
+
+            {
+                VRLock lock(statsMtx);
+                for (size_t i = t; i < h; i++) {
+                    auto& slot = ring.slot(i);
+                    const char* d = ring.data(i);
+                    size_t N = min(slot.size, ring.S);
+                    bytes += N;
+
+                    if (stamped) {
+                        if (N < 12) { malformed++; continue; }
+                        account(slot.source, slot.time, true, readLE(d, 4), readLE(d+4, 8));
+                        d += 12;
+                        N -= 12;
+                    } else account(slot.source, slot.time, false, 0, 0);
+
+                    queueLatencySum += now - slot.time;
+                    queueLatencyN++;
+
+                    VRUDPPacket p;
+                    p.data = d;
+                    p.size = N;
+                    p.source = slot.source;
+                    p.time = slot.time;
+
+                    if (coalescing) { // latest value wins
+                        auto it = latest.find(slot.source);
+                        if (it != latest.end()) { batch[it->second] = p; coalesced++; continue; }
+                        latest[slot.source] = batch.size();
+                    }
+                    batch.push_back(p);
+                }
+                delivered += batch.size();
+                batches++;
+            }
+
+            if (parent) parent->getInFlow().logFlow(bytes*0.001);
+
+            if (onPacketsCb) onPacketsCb(batch);
+            else if (onMessageCb) {
+                for (auto& p : batch) onMessageCb( string(p.data, p.size) );
+            }
+
+            ring.tail.store(h, memory_order_release);
+        }
+
+        map<string, double> getStats() {
+            VRLock lock(statsMtx);
+            map<string, double> res;
+            double lost = 0, jitter = 0, latency = 0, reordered = 0;
+            size_t latencyN = 0;
+            for (auto& s : sources) {
+                lost += s.second.lost;
+                reordered += s.second.reordered;
+                jitter += s.second.jitter;
+                latency += s.second.latencySum;
+                latencyN += s.second.latencyN;
+            }
+
+            res["sources"] = sources.size();
+            res["received"] = received;
+            res["delivered"] = delivered;
+            res["batches"] = batches;
+            res["coalesced"] = coalesced;
+            res["overflow"] = overflow;
+            res["truncated"] = truncated;
+            res["malformed"] = malformed;
+            res["lost"] = lost;
+            res["reordered"] = reordered;
+            res["lossRatio"] = lost > 0 ? lost / (lost + received) : 0.0;
+            res["jitter_ms"] = sources.size() > 0 ? jitter * 0.001 / sources.size() : 0.0;
+            res["latency_ms"] = latencyN > 0 ? latency * 0.001 / latencyN : 0.0;
+            res["handoff_ms"] = queueLatencyN > 0 ? queueLatencySum * 0.001 / queueLatencyN : 0.0;
+            return res;
+        }
 
         void listen(int port) {
             cout << "UDPServer listen on port " << port << endl;
@@ -98,11 +410,18 @@ class UDPServer {
         }
 
         void close() {
+            updateCb = 0;
+            stopBatch = true;
             io_service.stop();
             socket.cancel();
             boost::system::error_code _error_code;
             socket.shutdown(udp::socket::shutdown_both, _error_code);
             if (service->joinable()) service->join();
+            if (batchService) {
+                if (batchService->joinable()) batchService->join();
+                delete batchService;
+                batchService = 0;
+            }
         }
 };
 
@@ -121,6 +440,24 @@ VRUDPServerPtr VRUDPServer::create(string name) {
 }
 
 void VRUDPServer::onMessage( function<string(string)> f, bool b ) { server->onMessage(f, b); }
+void VRUDPServer::onPackets( function<void(const vector<VRUDPPacket>&)> f ) { server->onPackets(f); }
 void VRUDPServer::listen(int port) { this->port = port; server->listen(port); }
+void VRUDPServer::listenBatched(int port, int ringSize, int slotSize) { this->port = port; server->listenBatched(port, ringSize, slotSize); }
 void VRUDPServer::close() { server->close(); }
+void VRUDPServer::setCoalescing(bool b) { server->setCoalescing(b); }
+void VRUDPServer::setStamped(bool b) { server->setStamped(b); }
+void VRUDPServer::update() { server->update(); }
 int VRUDPServer::getPort() { return port; }
+string VRUDPServer::getSourceName(size_t source) {
+    auto addr = boost::asio::ip::address_v4( (unsigned long)(source >> 16) );
+    return addr.to_string() + ":" + to_string(source & 0xFFFF);
+}
+map<string, double> VRUDPServer::getStats() { return server->getStats(); }
+
+string VRUDPServer::stamp(const string& payload, unsigned int sequence) { // 4 bytes sequence + 8 bytes send time, little endian
+    string header(12, 0);
+    unsigned long long t = udpNow();
+    for (int i=0; i<4; i++) header[i] = char((sequence >> (8*i)) & 0xFF);
+    for (int i=0; i<8; i++) header[4+i] = char((t >> (8*i)) & 0xFF);
+    return header + payload;
+}
@@ -5,6 +5,8 @@
 #include "../VRNetworkServer.h"
 
 #include <string>
+#include <vector>
+#include <map>
 #include <functional>
 
 class UDPServer;
@@ -12,6 +14,17 @@ class UDPServer;
 using namespace std;
 OSG_BEGIN_NAMESPACE;
 
+/**
+ * View on a datagram in the receive ring of a batched server,
+ * only valid during the onPackets callback.
+ */
+struct VRUDPPacket {
+    const char* data = 0;
+    size_t size = 0;
+    size_t source = 0; // sender address and port, see VRUDPServer::getSourceName
+    long long time = 0; // receive time in microseconds since epoch
+};
+
 class VRUDPServer : public VRNetworkServer {
 	private:
         UDPServer* server = 0;
@@ -23,11 +36,21 @@ class VRUDPServer : public VRNetworkServer {
 		static VRUDPServerPtr create(string name = "none");
 
         void onMessage( function<string(string)> f, bool deferred = false );
+        void onPackets( function<void(const vector<VRUDPPacket>&)> f );
 
 		void listen(int port);
+		void listenBatched(int port, int ringSize = 4096, int slotSize = 2048);
         void close();
 
+        void setCoalescing(bool b);
+        void setStamped(bool b);
+        void update();
+
         int getPort();
+        static string getSourceName(size_t source);
+        map<string, double> getStats();
+
+        static string stamp(const string& payload, unsigned int sequence);
 };
 
 OSG_END_NAMESPACE;
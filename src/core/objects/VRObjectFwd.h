@@ -58,4 +58,6 @@ ptrFwd(VRLODSpace);
 
 }
 
+ptrFctFwd( VRObject, OSG::VRObjectPtr );
+
 #endif // VROBJECTFWD_H_INCLUDED
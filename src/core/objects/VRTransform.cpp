@@ -10,6 +10,7 @@
 #include "core/utils/VRStorage_template.h"
 #include "core/utils/VRUndoInterfaceT.h"
 #include "core/utils/VRProfiler.h"
+#include "core/utils/VRThreadPool.h"
 #include "core/objects/OSGTransform.h"
 #include "core/objects/OSGObject.h"
 #include "core/objects/object/OSGCore.h"
@@ -177,9 +178,12 @@ void VRTransform::updateChange() {
 #endif
 }
 
+thread_local bool deferChanges = false; // set while solving constraints, see updateConstraints
+
 void VRTransform::reg_change() {
     change_time_stamp = VRGlobals::CURRENT_FRAME;
     noBlt = true;
+    if (deferChanges) { computeMatrix4d(); return; }
     updateChange();
 }
 
@@ -838,6 +842,17 @@ VRIntersectionPtr VRTransform::intersect(VRObjectPtr obj, Vec3d dir) {
     return in.intersect(obj, false, ptr(), dir);
 }
 
+vector<VRIntersectionPtr> VRTransform::intersectRays(VRObjectPtr obj, vector<Vec3d> dirs) { // one ray per local direction, cast from the world position
+    Matrix4d m = getWorldMatrix();
+    Pnt3d p0 = Vec3d(m[3]);
+    vector<Line> rays;
+    for (auto d : dirs) {
+        m.mult(d,d); d.normalize();
+        rays.push_back( Line(Pnt3f(p0), Vec3f(d)) );
+    }
+    return VRIntersect::intersectRays(obj, rays);
+}
+
 void VRTransform::printPos() {
     Matrix4d wm, wm_osg, lm;
     getWorldMatrix(wm);
@@ -865,14 +880,188 @@ void VRTransform::printTransformationTree(int indent) {
     if (indent == 0) cout << "\n";
 }
 
+/**
+
+constrained objects are solved in dependency levels
+- an object depends on its constrained ancestors, its joint parents and the referential of its constraint
+- objects of one level are independent of each other, large levels are split over the thread pool
+- the graph is rebuilt when constraints change or a subtree with a graph object or dependency is moved
+- reg_change is deferred on the solver threads, only the matrices are computed
+- the scene graph and physics of the changed objects are updated afterwards on the main thread
+- objects are skipped when neither they nor one of their dependencies changed
+- held, physicalized and derived objects are solved on the main thread, as before
+
+*/
+
+struct VRConstraintGraph {
+    vector<VRTransformWeakPtr> objects;
+    vector<vector<int>> dependencies; // indices of constrained objects
+    vector<vector<VRTransformWeakPtr>> external; // dependencies without constraints
+    vector<bool> plain; // transforms and geometries, solved in parallel
+    vector<VRTransform*> referentials;
+    vector<VRObjectWeakPtr> dependents; // counted in their ancestors, moving them changes the graph
+    vector<int> order; // objects sorted by level
+    vector<int> levels; // level l is order[levels[l]] .. order[levels[l+1]]
+
+    vector<bool> dirty;
+    vector<char> updated; // written by the solver threads
+
+    size_t version = 0;
+    size_t graphVersion = 0;
+    bool valid = false;
+};
+
 map<VRTransform*, VRTransformWeakPtr> constrainedObjects;
+VRConstraintGraph constraintGraph;
+size_t constraintsVersion = 0;
+
+void VRTransform::buildConstraintGraph() {
+    auto& g = constraintGraph;
+    for (auto& d : g.dependents) if (auto o = d.lock()) o->addGraphDependent(-1);
+    g = VRConstraintGraph();
+    g.version = constraintsVersion;
+    g.valid = true;
+
+    map<VRTransform*, int> indices;
+    for (auto& c : constrainedObjects) {
+        auto obj = c.second.lock();
+        if (!obj) continue;
+        indices[obj.get()] = g.objects.size();
+        g.objects.push_back(obj);
+    }
+
+    size_t N = g.objects.size();
+    g.dependencies.resize(N);
+    g.external.resize(N);
+    g.plain.resize(N);
+    g.referentials.resize(N, 0);
+
+    for (size_t i=0; i<N; i++) {
+        auto obj = g.objects[i].lock();
+#ifndef WITHOUT_BULLET
+        obj->getPhysics(); // created here, the solver threads only query it
+#endif
+        string type = obj->getType();
+        g.plain[i] = (type == "Transform" || type == "Geometry");
+
+        auto addAncestors = [&](VRObjectPtr o) {
+            for (; o; o = o->getParent()) {
+                auto t = dynamic_pointer_cast<VRTransform>(o);
+                if (!t || !indices.count(t.get())) continue;
+                int j = indices[t.get()];
+                if (j != int(i)) g.dependencies[i].push_back(j);
+            }
+        };
+
+        auto addDependency = [&](VRTransformPtr d) {
+            if (!d || d == obj) return;
+            if (!indices.count(d.get())) g.external[i].push_back(d);
+            addAncestors(d);
+        };
+
+        addAncestors(obj->getParent());
+        for (auto& j : obj->aJoints) addDependency(j.second.second.lock());
+        if (obj->constraint) {
+            auto r = obj->constraint->getReferential();
+            g.referentials[i] = r.get();
+            addDependency(r);
+        }
+    }
+
+    vector<int> level(N, -1);
+    function<int(int)> getLevel = [&](int i) {
+        if (level[i] >= 0) return level[i];
+        if (level[i] == -2) return -1; // joint loop, the back edge is ignored
+        level[i] = -2;
+        int l = 0;
+        for (int d : g.dependencies[i]) l = max(l, getLevel(d)+1);
+        level[i] = l;
+        return l;
+    };
+
+    int Nlevels = 0;
+    for (size_t i=0; i<N; i++) Nlevels = max(Nlevels, getLevel(i)+1);
+    g.levels.assign(Nlevels+1, 0);
+    for (size_t i=0; i<N; i++) g.levels[level[i]+1]++;
+    for (int l=0; l<Nlevels; l++) g.levels[l+1] += g.levels[l];
+    g.order.resize(N);
+    vector<int> cursor(g.levels.begin(), g.levels.end()-1);
+    for (size_t i=0; i<N; i++) g.order[cursor[level[i]]++] = i;
+
+    map<VRObject*, VRObjectPtr> dependents; // the constrained objects and the objects they depend on
+    for (size_t i=0; i<N; i++) {
+        auto obj = g.objects[i].lock();
+        dependents[obj.get()] = obj;
+        for (auto& e : g.external[i]) if (auto t = e.lock()) dependents[t.get()] = t;
+    }
+    for (auto& d : dependents) {
+        d.second->addGraphDependent(1);
+        g.dependents.push_back(d.second);
+    }
+    g.graphVersion = VRObject::getGraphVersion();
+}
 
-// TODO: revisit all that update constraints/transform/physics crap!
 void VRTransform::updateConstraints() { // global updater
-    //cout << VRGlobals::CURRENT_FRAME << " VRTransform::updateConstraints " << constrainedObjects.size() << endl;
-    for (auto wc : constrainedObjects) {
-        if (VRTransformPtr obj = wc.second.lock()) {
-            if (!obj->constraint || !obj->constraint->isActive()) continue;
+    auto& g = constraintGraph;
+    bool rebuild = !g.valid || g.version != constraintsVersion || g.graphVersion != VRObject::getGraphVersion();
+    for (size_t i=0; i<g.objects.size() && !rebuild; i++) { // referentials are set on the constraint itself
+        auto obj = g.objects[i].lock();
+        if (obj && obj->constraint && obj->constraint->getReferential().get() != g.referentials[i]) rebuild = true;
+    }
+    if (rebuild) buildConstraintGraph();
+
+    size_t N = g.objects.size();
+    vector<VRTransformPtr> objects(N);
+    for (size_t i=0; i<N; i++) objects[i] = g.objects[i].lock();
+    g.dirty.assign(N, false);
+    g.updated.assign(N, 0);
+
+    auto isActive = [](VRTransformPtr& obj) {
+        return obj && obj->constraint && obj->constraint->isActive();
+    };
+
+    for (size_t i=0; i<N; i++) { // changes from outside the solver
+        auto& obj = objects[i];
+        if (!obj) continue;
+        bool changed = obj->checkWorldChange();
+        for (auto& e : g.external[i]) {
+            auto t = e.lock();
+            if (t && t->checkWorldChange()) changed = true;
+        }
+        g.dirty[i] = changed;
+    }
+
+    vector<int> batch;
+    auto solve = [&](size_t i0, size_t i1) {
+        deferChanges = true;
+        for (size_t k = i0; k < i1; k++) {
+            int i = batch[k];
+            auto& obj = objects[i];
+            Matrix4d m0 = obj->matrix;
+            obj->apply_constraints();
+            g.updated[i] = !(obj->matrix == m0);
+        }
+        deferChanges = false;
+    };
+
+    for (size_t l=0; l+1 < g.levels.size(); l++) {
+        batch.clear();
+        for (int k = g.levels[l]; k < g.levels[l+1]; k++) {
+            int i = g.order[k];
+            for (int d : g.dependencies[i]) if (g.dirty[d]) g.dirty[i] = true;
+            auto& obj = objects[i];
+            if (!isActive(obj)) continue;
+
+            bool serial = !g.plain[i] || obj->held;
+#ifndef WITHOUT_BULLET
+            if (obj->physics && obj->physics->isPhysicalized()) serial = true;
+#endif
+            if (!serial) {
+                if (g.dirty[i]) batch.push_back(i);
+                continue;
+            }
+
+            Matrix4d m0 = obj->matrix;
             obj->apply_constraints();
 #ifndef WITHOUT_BULLET
             if (obj->held) obj->updatePhysics();
@@ -883,19 +1072,32 @@ void VRTransform::updateConstraints() { // global updater
             obj->noBlt = obj->getPhysicsDynamic();
             obj->updatePhysics();
 #endif
+            if (!(obj->matrix == m0)) g.dirty[i] = true;
         }
 
-        //if (VRTransformPtr obj = wc.second.lock()) obj->updateChange();
+        VRThreadPool::get()->parallelFor(batch.size(), 256, solve);
+    }
+
+    for (int i : g.order) { // write back in level order
+        if (!g.updated[i]) continue;
+        auto& obj = objects[i];
+        obj->updateTransformation();
+#ifndef WITHOUT_BULLET
+        obj->noBlt = obj->getPhysicsDynamic();
+        obj->updatePhysics();
+#endif
     }
 }
 
 void VRTransform::setConstraint(VRConstraintPtr c) {
+    if (c != constraint || bool(c) != bool(constrainedObjects.count(this))) constraintsVersion++;
     constraint = c;
     if (c) constrainedObjects[this] = ptr();
     else constrainedObjects.erase(this);
 }
 
 VRConstraintPtr VRTransform::getConstraint() { setConstraint(constraint); return constraint; }
+bool VRTransform::isConstrained() { return (constraint && constraint->isActive()) || aJoints.size() > 0; }
 
 void VRTransform::apply_constraints(bool force) {
     if (constraint && constraint->isActive()) {
@@ -1032,6 +1234,7 @@ void VRTransform::applyTransformation(PosePtr po) {
 
 void VRTransform::attach(VRTransformPtr b, VRConstraintPtr c, VRConstraintPtr cs, bool disableCollisions) {
     VRTransformPtr a = ptr();
+    constraintsVersion++;
     if (!c) { constrainedObjects.erase(b.get()); return; }
     constrainedObjects[b.get()] = b;
     a->bJoints[b.get()] = make_pair(c, VRTransformWeakPtr(b)); // children
@@ -1147,6 +1350,7 @@ void VRTransform::setConvexDecompositionParameters(float cw, float vw, float nc,
 }
 
 bool VRTransform::getPhysicsDynamic() { return getPhysics()->isDynamic(); }
+bool VRTransform::hasDynamicPhysics() { return physics && physics->isPhysicalized() && physics->isDynamic(); }
 void VRTransform::setPhysicsDynamic(bool b) { getPhysics()->setDynamic(b,true); }
 void VRTransform::setNoBltFlag() { noBlt = true; }
 void VRTransform::setBltOverrideFlag() { bltOverride = true; }
@@ -68,6 +68,7 @@ class VRTransform : public VRObject {
         virtual void updateTransformation();
         void reg_change();
         bool checkWorldChange();
+        static void buildConstraintGraph();
 
         void printInformation() override;
         void initCoords();
@@ -185,6 +186,7 @@ class VRTransform : public VRObject {
         // Cast a ray in world coordinates from the object in its local coordinates, -z axis defaults
         Line castRay(VRObjectPtr obj = 0, Vec3d dir = Vec3d(0,0,-1));
         VRIntersectionPtr intersect(VRObjectPtr obj, Vec3d dir = Vec3d(0,0,-1));
+        vector<VRIntersectionPtr> intersectRays(VRObjectPtr obj, vector<Vec3d> dirs);
 
         map<string, VRAnimationPtr> animations;
         void addAnimation(VRAnimationPtr animation);
@@ -197,6 +199,7 @@ class VRTransform : public VRObject {
 
         void setConstraint(VRConstraintPtr c);
         VRConstraintPtr getConstraint();
+        bool isConstrained(); // active constraint or joint parents
 
         void apply_constraints(bool force = false);
         static void updateConstraints();
@@ -242,6 +245,7 @@ class VRTransform : public VRObject {
 
         void resetForces();
         bool getPhysicsDynamic();
+        bool hasDynamicPhysics(); // without creating the physics
         void setPhysicsDynamic(bool b);
 
         Vec3d getForce();
@@ -3,6 +3,7 @@
 #include "core/objects/material/VRMaterial.h"
 #include "OSGGeometry.h"
 #include "core/utils/toString.h"
+#include "core/utils/VRThreadPool.h"
 
 #include <OpenSG/OSGGeoProperties.h>
 #include <OpenSG/OSGGeometry.h>
@@ -941,6 +942,179 @@ void VRGeoData::makeSingleIndex() {
     if (!geo->getMesh()->geo->isSingleIndex()) cout << "VRGeoData::makeSingleIndex FAILED!! probably needs to set more indices!" << endl;
 }
 
+VRGeoData::Builder::Builder(bool normals, bool colors, int texChannels) : useNormals(normals), useColors(colors) { texCoords.resize(texChannels); }
+
+size_t VRGeoData::Builder::size() const { return positions.size(); }
+
+void VRGeoData::Builder::reserve(size_t Nvertices, size_t Nindices) {
+    positions.reserve(Nvertices);
+    if (useNormals) normals.reserve(Nvertices);
+    if (useColors) colors.reserve(Nvertices);
+    for (auto& t : texCoords) t.reserve(Nvertices);
+    indices.reserve(Nindices);
+}
+
+size_t VRGeoData::Builder::addVertices(size_t N) {
+    size_t i0 = positions.size();
+    positions.resize(i0+N);
+    if (useNormals) normals.resize(i0+N);
+    if (useColors) colors.resize(i0+N);
+    for (auto& t : texCoords) t.resize(i0+N);
+    return i0;
+}
+
+unsigned int* VRGeoData::Builder::addIndices(int type, size_t N) {
+    bool list = (type == GL_POINTS || type == GL_LINES || type == GL_TRIANGLES || type == GL_QUADS);
+    if (list && primitives.size() && primitives.back().first == type) primitives.back().second += N;
+    else primitives.push_back( make_pair(type, int(N)) );
+    size_t i0 = indices.size();
+    indices.resize(i0+N);
+    return N ? &indices[i0] : 0;
+}
+
+int VRGeoData::Builder::pushVert(Pnt3f p, Vec3f n, Color4f c, Vec2f t, Vec2f t2) {
+    positions.push_back(p);
+    if (useNormals) normals.push_back(n);
+    if (useColors) colors.push_back(c);
+    for (size_t j=0; j<texCoords.size(); j++) texCoords[j].push_back(j == 0 ? t : j == 1 ? t2 : Vec2f());
+    return positions.size()-1;
+}
+
+void VRGeoData::Builder::pushTri(int i, int j, int k) {
+    int N = size();
+    unsigned int* I = addIndices(GL_TRIANGLES, 3);
+    I[0] = i < 0 ? i+N : i;
+    I[1] = j < 0 ? j+N : j;
+    I[2] = k < 0 ? k+N : k;
+}
+
+void VRGeoData::Builder::pushQuad(int i, int j, int k, int l) {
+#ifdef WASM
+    pushTri(i,j,k);
+    pushTri(i,k,l);
+#else
+    int N = size();
+    unsigned int* I = addIndices(GL_QUADS, 4);
+    I[0] = i < 0 ? i+N : i;
+    I[1] = j < 0 ? j+N : j;
+    I[2] = k < 0 ? k+N : k;
+    I[3] = l < 0 ? l+N : l;
+#endif
+}
+
+void VRGeoData::reserve(int Nvertices, int Nindices, bool normals, bool colors, int texChannels) {
+    int N = size();
+    data->pos->editField().reserve(N+Nvertices);
+    if (normals) data->norms->editField().reserve(N+Nvertices);
+    if (colors) data->cols4->editField().reserve(N+Nvertices);
+    for (int i=0; i<texChannels && i<7; i++) data->texs[i]->editField().reserve(N+Nvertices);
+    data->indices->editField().reserve(data->indices->size()+Nindices);
+}
+
+void VRGeoData::concat(const vector<Builder>& parts) {
+    if (data->indicesNormals->size() || data->indicesColors->size() || data->indicesTexCoords->size()) {
+        cout << "VRGeoData::concat failed: separate attribute indices are not supported!" << endl;
+        return;
+    }
+
+    size_t N0 = size();
+    size_t Nv = N0;
+    size_t Ni = data->indices->size();
+    bool normals = data->norms->size() > 0;
+    bool colors = data->cols3->size() > 0 || data->cols4->size() > 0;
+    size_t Ntc = 0;
+    for (int j=0; j<7; j++) if (data->texs[j]->size() > 0) Ntc = j+1;
+
+    vector<size_t> vOffsets;
+    vector<size_t> iOffsets;
+    for (auto& p : parts) {
+        vOffsets.push_back(Nv);
+        iOffsets.push_back(Ni);
+        Nv += p.positions.size();
+        Ni += p.indices.size();
+        normals = normals || p.useNormals;
+        colors = colors || p.useColors;
+        Ntc = max(Ntc, min(p.texCoords.size(), size_t(7)));
+    }
+    if (Nv == N0) return;
+
+    // resize once, the parts are then copied into disjoint ranges, attributes a part lacks stay zero
+    auto& P = data->pos->editField();
+    P.resize(Nv);
+    Pnt3f* pos = &P[0];
+
+    Vec3f* norms = 0;
+    if (normals) {
+        auto& F = data->norms->editField();
+        F.resize(Nv);
+        norms = &F[0];
+    }
+
+    Vec3f* cols3 = 0;
+    Vec4f* cols4 = 0;
+    if (colors && data->cols3->size() > 0) {
+        auto& F = data->cols3->editField();
+        F.resize(Nv);
+        cols3 = &F[0];
+    } else if (colors) {
+        auto& F = data->cols4->editField();
+        F.resize(Nv);
+        cols4 = &F[0];
+    }
+
+    vector<Vec2f*> texs(Ntc, 0);
+    for (size_t j=0; j<Ntc; j++) {
+        auto& F = data->texs[j]->editField();
+        F.resize(Nv);
+        texs[j] = &F[0];
+    }
+
+    auto& I = data->indices->editField();
+    I.resize(Ni);
+    UInt32* inds = Ni ? &I[0] : 0;
+
+    auto copy = [&](size_t k0, size_t k1) {
+        for (size_t k = k0; k < k1; k++) {
+            auto& p = parts[k];
+            size_t v0 = vOffsets[k];
+            size_t Np = p.positions.size();
+            std::copy(p.positions.begin(), p.positions.end(), pos+v0);
+            if (norms && p.normals.size() == Np) std::copy(p.normals.begin(), p.normals.end(), norms+v0);
+            if (p.colors.size() == Np) {
+                for (size_t i=0; i<Np && cols3; i++) { auto& c = p.colors[i]; cols3[v0+i] = Vec3f(c[0], c[1], c[2]); }
+                for (size_t i=0; i<Np && cols4; i++) { auto& c = p.colors[i]; cols4[v0+i] = Vec4f(c[0], c[1], c[2], c[3]); }
+            }
+            for (size_t j=0; j<Ntc && j<p.texCoords.size(); j++) {
+                if (p.texCoords[j].size() == Np) std::copy(p.texCoords[j].begin(), p.texCoords[j].end(), texs[j]+v0);
+            }
+            size_t i0 = iOffsets[k];
+            for (size_t i=0; i<p.indices.size(); i++) inds[i0+i] = p.indices[i] + v0;
+        }
+    };
+
+    size_t Nparts = parts.size();
+    if (Nv-N0 < 65536) copy(0, Nparts); // small copies are not worth the wakeup
+    else VRThreadPool::get()->run(Nparts, [&](size_t k) { copy(k, k+1); });
+
+    for (auto& p : parts) {
+        for (auto& prim : p.primitives) {
+            if (isStripOrFan(prim.first)) data->lastPrim = -1;
+            updateType(prim.first, prim.second);
+        }
+    }
+}
+
+void VRGeoData::buildParallel(size_t N, const Builder& layout, function<void(Builder&, size_t)> f) {
+    size_t Nparts = min(VRThreadPool::get()->size(), N/64 + 1);
+    vector<Builder> parts(Nparts, layout);
+    size_t chunk = (N + Nparts - 1) / Nparts;
+
+    VRThreadPool::get()->run(Nparts, [&](size_t t) { // contiguous ranges keep the serial order of the items
+        for (size_t i = min(N, t*chunk); i < min(N, (t+1)*chunk); i++) f(parts[t], i);
+    });
+    concat(parts);
+}
+
 vector<VRGeometryPtr> VRGeoData::split(int N) {
     vector<VRGeometryPtr> res;
     map<size_t, VRGeoData> geos;
@@ -1031,3 +1205,4 @@ vector<VRGeometryPtr> VRGeoData::splitByVertexColors(const Matrix4d& m) {
 
 
 
+
@@ -20,6 +20,8 @@ static const int TexCoords7Index      = 15;
 #include <OpenSG/OSGConfig.h>
 #include <OpenSG/OSGColor.h>
 
+#include <vector>
+#include <functional>
 #include <iterator>     // iterator
 #include <type_traits>  // remove_cv
 #include <utility>      // swap
@@ -143,6 +145,37 @@ class VRGeoData {
         void append(const VRGeoData& geo, const Matrix4d& m = Matrix4d());
         void makeSingleIndex();
 
+        /**
+         * Plain arrays for bulk mesh generation, without any OpenSG property.
+         * Builders can be filled on worker threads, concat appends them and rebases their indices.
+         */
+        struct Builder {
+            vector<Pnt3f> positions;
+            vector<Vec3f> normals;
+            vector<Color4f> colors;
+            vector<vector<Vec2f>> texCoords;
+            vector<unsigned int> indices;
+            vector<pair<int, int>> primitives; // GL type and index count
+
+            bool useNormals = true;
+            bool useColors = false;
+
+            Builder(bool normals = true, bool colors = false, int texChannels = 0);
+
+            size_t size() const;
+            void reserve(size_t Nvertices, size_t Nindices);
+            size_t addVertices(size_t N);
+            unsigned int* addIndices(int type, size_t N);
+
+            int pushVert(Pnt3f p, Vec3f n = Vec3f(), Color4f c = Color4f(), Vec2f t = Vec2f(), Vec2f t2 = Vec2f());
+            void pushTri(int i = -3, int j = -2, int k = -1);
+            void pushQuad(int i = -4, int j = -3, int k = -2, int l = -1);
+        };
+
+        void reserve(int Nvertices, int Nindices, bool normals = true, bool colors = false, int texChannels = 0);
+        void concat(const vector<Builder>& parts);
+        void buildParallel(size_t N, const Builder& layout, function<void(Builder&, size_t)> f);
+
         // primitive iterator
         struct Primitive {
             int type = 0;
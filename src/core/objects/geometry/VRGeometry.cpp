@@ -1,6 +1,7 @@
 #include "VRGeometry.h"
 #include "VRGeoData.h"
 #include <sstream>
+#include <algorithm>
 #include "core/utils/Thread.h"
 
 #include <OpenSG/OSGSimpleMaterial.h>
@@ -28,6 +29,7 @@
 #include "core/objects/OSGObject.h"
 #include "core/objects/VRPointCloud.h"
 #include "core/math/partitioning/Octree.h"
+#include "core/math/partitioning/TriangleBVH.h"
 #include "core/tools/selection/VRSelection.h"
 #ifndef WITHOUT_SHARED_MEMORY
 #include "core/networking/VRSharedMemory.h"
@@ -349,7 +351,101 @@ void VRGeometry::setMesh(OSGGeometryPtr g) {
     setMesh(g, ref);
 }
 
-void VRGeometry::meshChanged() { lastMeshChange = VRGlobals::CURRENT_FRAME; }
+void VRGeometry::meshChanged() { lastMeshChange = VRGlobals::CURRENT_FRAME; bvhDirty = true; }
+
+namespace {
+    struct BVHEditCounter { // changed functor, comparable to remove it again
+        weak_ptr<size_t> edits;
+        size_t* ID = 0;
+
+        BVHEditCounter(shared_ptr<size_t> e) : edits(e), ID(e.get()) {}
+        void operator()(FieldContainer*, ConstFieldMaskArg, UInt32) { if (auto n = edits.lock()) (*n)++; }
+        bool operator==(const BVHEditCounter& o) const { return ID == o.ID; }
+    };
+}
+
+struct VRGeometry::BVHWatch {
+    shared_ptr<size_t> edits = make_shared<size_t>(0);
+    vector<FieldContainerRecPtr> props;
+
+    void watch(vector<FieldContainer*> newProps) { // one functor per property, removed from replaced properties
+        BVHEditCounter counter(edits);
+        auto has = [](vector<FieldContainer*>& v, FieldContainer* p) { return find(v.begin(), v.end(), p) != v.end(); };
+        vector<FieldContainer*> old;
+        for (auto& p : props) {
+            old.push_back(p.get());
+            if (!has(newProps, p.get())) p->subChangedFunctor(counter);
+        }
+
+        props.clear();
+        for (auto p : newProps) {
+            if (!p) continue;
+            if (!has(old, p)) p->addChangedFunctor(counter, "");
+            props.push_back(p);
+        }
+    }
+
+    ~BVHWatch() { watch({}); }
+};
+
+/** BVH of the mesh triangles for ray queries, built on first use.
+    Changed positions refit the BVH, changed primitives rebuild it.
+    In place edits of the mesh properties are seen once the change list is committed, call updateBVH to query right after an edit.
+    Returns 0 for meshes with points, lines or patches, those use the intersect action. **/
+TriangleBVHPtr VRGeometry::getBVH() {
+    if (!mesh || !mesh->geo) return 0;
+    Geometry* geo = mesh->geo;
+    GeoVectorProperty* pos = geo->getPositions();
+    GeoIntegralProperty* types = geo->getTypes();
+    GeoIntegralProperty* lengths = geo->getLengths();
+    GeoIntegralProperty* inds = geo->getIndex(Geometry::PositionsIndex);
+    if (!pos || !types) return 0;
+
+    size_t key[8] = { size_t(pos), pos->size(), size_t(types), types->size(), size_t(lengths), lengths ? lengths->size() : 0, size_t(inds), inds ? inds->size() : 0 };
+    if (bvhKey.size() != 8 || !equal(key, key+8, bvhKey.begin())) {
+        bvhKey.assign(key, key+8);
+        bvhDirty = true;
+        if (!bvhWatch) bvhWatch = make_shared<BVHWatch>();
+        bvhWatch->watch({ pos, types, lengths, inds });
+    }
+    if (*bvhWatch->edits != bvhEditsSeen) { bvhEditsSeen = *bvhWatch->edits; bvhDirty = true; }
+    if (!bvhDirty) return bvh;
+    bvhDirty = false;
+
+    size_t topology = 14695981039346656037ull;
+    auto hash = [&](size_t v) { topology = (topology ^ v) * 1099511628211ull; };
+    for (unsigned int i=0; i<types->size(); i++) {
+        int t = types->getValue(i);
+        if (t == GL_POINTS || t == GL_LINES || t == GL_LINE_STRIP || t == GL_LINE_LOOP || t == GL_PATCHES) { bvh = 0; return 0; }
+        hash(t);
+    }
+    if (lengths) for (unsigned int i=0; i<lengths->size(); i++) hash(lengths->getValue(i));
+    if (inds) for (unsigned int i=0; i<inds->size(); i++) hash(inds->getValue(i));
+
+    vector<float> positions(pos->size()*3);
+    for (unsigned int i=0; i<pos->size(); i++) {
+        Pnt3f p = pos->getValue<Pnt3f>(i);
+        for (int k=0; k<3; k++) positions[i*3+k] = p[k];
+    }
+
+    if (bvh && topology == bvhTopology && bvh->refit(positions)) return bvh;
+
+    vector<int> triangles; // in triangle iterator order, the BVH hits match the indices of the intersect action
+    for (TriangleIterator it = geo->beginTriangles(); it != geo->endTriangles(); ++it) {
+        for (int j=0; j<3; j++) triangles.push_back(it.getPositionIndex(j));
+    }
+
+    bvh = TriangleBVH::create();
+    bvh->build(positions, triangles);
+    bvhTopology = topology;
+    return bvh;
+}
+
+/** Call after changing mesh data in place, refits or rebuilds the BVH on the next ray query **/
+void VRGeometry::updateBVH(bool rebuild) {
+    bvhDirty = true;
+    if (rebuild) bvh = 0;
+}
 
 void VRGeometry::setPrimitive(string parameters) {
     stringstream ss(parameters);
@@ -6,6 +6,7 @@
 #include "core/objects/VRObjectFwd.h"
 #include "core/objects/material/VRMaterialFwd.h"
 #include "core/tools/selection/VRSelectionFwd.h"
+#include "core/math/VRMathFwd.h"
 #include "../VRTransform.h"
 
 #include <OpenSG/OSGSField.h>
@@ -19,6 +20,7 @@ class VRMaterial;
 class GeoVectorProperty;
 class GeoIntegralProperty;
 class Action;
+class Geometry;
 
 class VRGeometry : public VRTransform {
     public:
@@ -38,6 +40,14 @@ class VRGeometry : public VRTransform {
         bool meshSet = false;
         int lastMeshChange = 0;
 
+        TriangleBVHPtr bvh;
+        vector<size_t> bvhKey; // mesh properties and sizes the BVH was made for
+        size_t bvhTopology = 0; // checksum of the primitives, refit if unchanged
+        bool bvhDirty = true;
+        struct BVHWatch;
+        shared_ptr<BVHWatch> bvhWatch; // changed functors on the mesh properties, count their in place edits
+        size_t bvhEditsSeen = 0;
+
         map<string, VRGeometryPtr> dataLayer;
 
         Reference source;
@@ -82,6 +92,8 @@ class VRGeometry : public VRTransform {
         bool getMeshVisibility();
 
         virtual bool applyIntersectionAction(Action* ia);
+        virtual TriangleBVHPtr getBVH();
+        void updateBVH(bool rebuild = false);
         virtual void setPrimitive(string parameters);
 
         vector<int> intersectEdges(Line ray, double threshold = 1e-5);
@@ -150,6 +162,8 @@ class VRGeometry : public VRTransform {
         void readSharedMemory(string segment, string object);
 };
 
+const VRGeometryPtr getGeometryAttachment(Geometry* g);
+
 OSG_END_NAMESPACE;
 
 #endif // VRGEOMETRY_H_INCLUDED
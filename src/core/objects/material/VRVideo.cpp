@@ -18,6 +18,8 @@ extern "C" {
 }
 
 #include <string>
+#include <cmath>
+#include <algorithm>
 #include "core/utils/Thread.h"
 #include "core/utils/VRMutex.h"
 
@@ -40,7 +42,6 @@ VRVideo::~VRVideo() {
     if (anim) anim->stop();
     if (wThreadID >= 0) VRScene::getCurrent()->stopThread(wThreadID, 1000);
     if (vFrame) av_frame_free(&vFrame);
-    if (nFrame) av_frame_free(&nFrame);
     if (vFile) avformat_close_input(&vFile); // Close the video file
     //if (avMutex) delete avMutex;
     cout << " VRVideo::~VRVideo done" << endl;
@@ -52,9 +53,45 @@ VRVideo::~VRVideo() {
 VRVideo::VStream::~VStream() {
     cout << " VRVideo::VStream::~VStream " << endl;
     if (vCodec) avcodec_close(vCodec); // Close the codec
+    if (swsContext) sws_freeContext(swsContext);
     vCodec = 0;
+    swsContext = 0;
 }
 
+int VRVideo::VStream::toFrame(int64_t pts) { return int(floor((pts - startPts) * timeBase * fps + 0.5)); }
+int64_t VRVideo::VStream::toPts(int frame) { return startPts + int64_t(frame / (fps * timeBase)); }
+
+/**
+ * Number of the next decoded frame, counted on from the last keyframe.
+ * Keyframes take their number from the keyframe index, frames running into the next keyframe number keep the number before it.
+ * Rounding timestamps of every frame would leave gaps on variable frame rate or jittered files.
+ */
+int VRVideo::VStream::nextFrame(int64_t pts) {
+    int seq = decodedFrame+1;
+    if (pts == AV_NOPTS_VALUE) return seq;
+    if (keyPts.size() == 0 || binary_search(keyPts.begin(), keyPts.end(), pts)) return toFrame(pts);
+    size_t k = findKey(decodedFrame) + 1;
+    if (k < keyFrames.size() && seq >= keyFrames[k]) return keyFrames[k]-1;
+    return seq;
+}
+
+int VRVideo::VStream::findKey(int frame) { // index of the last keyframe at or before the frame, -1 if none
+    auto it = upper_bound(keyFrames.begin(), keyFrames.end(), frame);
+    return int(it - keyFrames.begin()) - 1;
+}
+
+int VRVideo::VStream::cachedSlot(int frame) { // slot of the frame or of the frame shown for a gap, -1 if not cached
+    if (pool.size() == 0 || frame < 0) return -1;
+    int slot = frame % pool.size();
+    if (poolFrames[slot] == frame) return slot;
+    auto g = gaps.find(frame);
+    if (g == gaps.end()) return -1;
+    slot = g->second % pool.size();
+    return (poolFrames[slot] == g->second) ? slot : -1;
+}
+
+bool VRVideo::VStream::isCached(int frame) { return cachedSlot(frame) >= 0; }
+
 VRVideo::AStream::~AStream() {
     cout << " VRVideo::AStream::~AStream " << endl;
     if (audio) audio->close(); // Close the codec
@@ -107,71 +144,107 @@ int getNColors(AVPixelFormat pfmt) {
     return 3;
 }
 
-#if defined(_WIN32) || defined(__APPLE__)
-int avcodec_decode_video2(AVCodecContext* video_ctx, AVFrame* frame, int* got_frame, AVPacket* pkt) {
-    int used = 0;
-    if (video_ctx->codec_type == AVMEDIA_TYPE_VIDEO || video_ctx->codec_type == AVMEDIA_TYPE_AUDIO) {
-        used = avcodec_send_packet(video_ctx, pkt);
-        if (used < 0 && used != AVERROR(EAGAIN) && used != AVERROR_EOF) {
+void VRVideo::initPool(VStream& s, int w, int h, int Ncols) { // bounded by frame count and memory
+    size_t frameBytes = size_t(w) * h * Ncols;
+    int N = cacheSize;
+    if (frameBytes > 0) N = min(N, int(cacheMemory * 1048576.0 / frameBytes));
+    N = max(N, 4);
 
-        } else {
-            if (used >= 0) pkt->size = 0;
-            used = avcodec_receive_frame(video_ctx, frame);
-            if (used >= 0) *got_frame = 1;
-        }
-    }
-    return used;
+    VRLock lock(osgMutex);
+    s.pool = vector<VRTexturePtr>(N, 0);
+    s.poolFrames = vector<int>(N, -1);
 }
-#endif
-
-VRTexturePtr VRVideo::convertFrame(int stream, AVPacket* packet) {
-    if (!vStreams.count(stream)) { cout << " unknown stream " << stream << endl; return 0; }
-    int valid = 0;
-    auto vCodec = vStreams[stream].vCodec;
-    int r = avcodec_decode_video2(vCodec, vFrame, &valid, packet); // Decode video frame
-
-    if (valid == 0 || r < 0) {
-        cout << " avcodec_decode_video2 failed with " << r << endl;
-        // TODO: print packet data
-        return 0;
-    }
 
+void VRVideo::convertFrame(VStream& s, int frame) { // writes the decoded frame into its pool slot
     FlipFrame(vFrame);
     int width = vFrame->width;
     int height = vFrame->height;
     AVPixelFormat pf = AVPixelFormat(vFrame->format);
 
     int Ncols = getNColors(pf);
-    if (Ncols == 0) { cout << "ERROR: stream has no colors!" << endl; return 0; }
+    if (Ncols == 0) { cout << "ERROR: stream has no colors!" << endl; return; }
 
-    if (swsContext == 0) {
-        if (Ncols == 1) nFrame->format = AV_PIX_FMT_GRAY8;
-        if (Ncols == 3) nFrame->format = AV_PIX_FMT_RGB24;
+    if (s.swsContext == 0) {
+        AVPixelFormat target = Ncols == 1 ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_RGB24;
+        s.swsContext = sws_getContext(width, height, pf, width, height, target, SWS_BILINEAR, NULL, NULL, NULL);
+        if (!s.swsContext) { cout << "  Error in VRVideo, sws_getContext failed!" << endl; return; }
+    }
 
-        swsContext = sws_getContext(width, height, pf, width, height, AVPixelFormat(nFrame->format), SWS_BILINEAR, NULL, NULL, NULL);
-        nFrame->width = width;
-        nFrame->height = height;
-        if (av_frame_get_buffer(nFrame, 0) < 0) { cout << "  Error in VRVideo, av_frame_get_buffer failed!" << endl; return 0; }
+    if (s.pool.size() == 0) initPool(s, width, height, Ncols);
+    int slot = frame % s.pool.size();
+    {
+        VRLock lock(osgMutex);
+        s.poolFrames[slot] = -1; // not available while overwritten
     }
 
-    int rgbH = sws_scale(swsContext, vFrame->data, vFrame->linesize, 0, height, nFrame->data, nFrame->linesize);
-    if (rgbH < 0) { cout << "  Error in VRVideo, sws_scale failed!" << endl; return 0; }
-    int rgbW = nFrame->linesize[0]/Ncols;
+    auto& tex = s.pool[slot];
+    if (!tex || tex->getImage()->getWidth() != width || tex->getImage()->getHeight() != height) {
+        tex = VRTexture::create();
+        if (Ncols == 1) tex->getImage()->set(Image::OSG_L_PF, width, height, 1, 1, 1, 0.0, 0, Image::OSG_UINT8_IMAGEDATA, true, 1);
+        if (Ncols == 3) tex->getImage()->set(Image::OSG_RGB_PF, width, height, 1, 1, 1, 0.0, 0, Image::OSG_UINT8_IMAGEDATA, true, 1);
+    }
+
+    uint8_t* dst[4] = { tex->getImage()->editData(), 0, 0, 0 };
+    int dstLinesize[4] = { width*Ncols, 0, 0, 0 };
+    int rgbH = sws_scale(s.swsContext, vFrame->data, vFrame->linesize, 0, height, dst, dstLinesize);
+    if (rgbH < 0) { cout << "  Error in VRVideo, sws_scale failed!" << endl; return; }
+
+    VRLock lock(osgMutex);
+    s.poolFrames[slot] = frame;
+}
 
-    osgFrame.resize(width*height*3, 0);
+void VRVideo::decodePacket(int stream, AVPacket* packet, int w0, int w1) { // only frames in [w0, w1[ are converted
+    auto& s = vStreams[stream];
+    if (avcodec_send_packet(s.vCodec, packet) < 0) return;
 
-    auto data1 = (uint8_t*)nFrame->data[0];
-    auto data2 = (uint8_t*)&osgFrame[0];
-    for (int y = 0; y<height; y++) {
-        int k1 = y*width*Ncols;
-        int k2 = y*rgbW*Ncols;
-        memcpy(&data2[k1], &data1[k2], width*Ncols);
+    while (avcodec_receive_frame(s.vCodec, vFrame) >= 0) {
+        int frame = s.nextFrame(vFrame->best_effort_timestamp);
+        if (s.decodedFrame >= 0 && frame > s.decodedFrame+1) { // no frame will ever fill these numbers
+            VRLock lock(osgMutex);
+            for (int g = s.decodedFrame+1; g < frame; g++) s.gaps[g] = s.decodedFrame;
+        }
+        s.decodedFrame = max(s.decodedFrame, frame);
+        if (frame < w0 || frame >= w1) continue;
+        bool cached = false;
+        {
+            VRLock lock(osgMutex);
+            cached = s.isCached(frame);
+        }
+        if (!cached) convertFrame(s, frame);
     }
+}
 
-    VRTexturePtr img = VRTexture::create();
-    if (Ncols == 1) img->getImage()->set(Image::OSG_L_PF, width, height, 1, 1, 1, 0.0, data2, Image::OSG_UINT8_IMAGEDATA, true, 1);
-    if (Ncols == 3) img->getImage()->set(Image::OSG_RGB_PF, width, height, 1, 1, 1, 0.0, data2, Image::OSG_UINT8_IMAGEDATA, true, 1);
-    return img;
+void VRVideo::buildKeyFrameIndex() { // reads the packet headers once, no decoding
+    for (AVPacket packet; av_read_frame(vFile, &packet)>=0; av_packet_unref(&packet)) {
+        if (!vStreams.count(packet.stream_index)) continue;
+        if (!(packet.flags & AV_PKT_FLAG_KEY)) continue;
+        auto& s = vStreams[packet.stream_index];
+        int64_t pts = (packet.pts != AV_NOPTS_VALUE) ? packet.pts : packet.dts;
+        if (pts == AV_NOPTS_VALUE) continue;
+        s.keyPts.push_back(pts);
+    }
+
+    for (auto& v : vStreams) {
+        auto& s = v.second;
+        sort(s.keyPts.begin(), s.keyPts.end());
+        for (auto pts : s.keyPts) s.keyFrames.push_back(s.toFrame(pts));
+        if (s.keyPts.size()) av_seek_frame(vFile, v.first, s.keyPts[0], AVSEEK_FLAG_BACKWARD);
+        else av_seek_frame(vFile, v.first, s.startPts, AVSEEK_FLAG_BACKWARD);
+    }
+}
+
+void VRVideo::seekFrame(int stream, int frame) { // jumps to the keyframe before the frame
+    auto& s = vStreams[stream];
+    int k = s.findKey(frame);
+    int64_t pts = (k >= 0) ? s.keyPts[k] : s.toPts(frame);
+    int r = av_seek_frame(vFile, stream, pts, AVSEEK_FLAG_BACKWARD);
+    if (r < 0) cout << "VRVideo, av_seek_frame failed!" << endl;
+
+    for (auto& v : vStreams) {
+        avcodec_flush_buffers(v.second.vCodec);
+        v.second.decodedFrame = -1;
+    }
+    s.decodedFrame = ((k >= 0) ? s.keyFrames[k] : frame) - 1;
 }
 
 void VRVideo::open(string f) {
@@ -186,10 +259,10 @@ void VRVideo::open(string f) {
     cout << " VRVideo::open " << f << endl;
 
     if (!vFrame) vFrame = av_frame_alloc(); // Allocate video frame
-    if (!nFrame) nFrame = av_frame_alloc(); // Allocate video frame
 
     vStreams.clear();
     aStreams.clear();
+    playStream = -1;
     for (int i=0; i<(int)vFile->nb_streams; i++) {
         AVStream* avStream = vFile->streams[i];
         AVCodecParameters* avCodec = avStream->codecpar;
@@ -205,12 +278,18 @@ void VRVideo::open(string f) {
             vStreams[i] = VStream();
             vStreams[i].vCodec = avContext;
             vStreams[i].fps = av_q2d(avStream->avg_frame_rate);
+            vStreams[i].timeBase = av_q2d(avStream->time_base);
+            if (avStream->start_time != AV_NOPTS_VALUE) vStreams[i].startPts = avStream->start_time;
+            if (playStream < 0) playStream = i;
 
             // Find the decoder for the video stream
             AVDictionary* optionsDict = 0;
+            avContext->thread_count = decoderThreads;
+            avContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
 
             if (c == 0) { fprintf(stderr, "Unsupported codec!\n"); return; } // Codec not found
             if (avcodec_open2(avContext, c, &optionsDict)<0) return; // Could not open codec
+            initPool(vStreams[i], avContext->width, avContext->height, 3);
         }
 
         if (isAudio) {
@@ -226,66 +305,108 @@ void VRVideo::open(string f) {
         }
     }
 
+    buildKeyFrameIndex();
+
     worker = VRThreadCb::create( "video cache", bind(&VRVideo::cacheFrames, this, placeholders::_1) );
     wThreadID = VRScene::getCurrent()->initThread(worker, "video cache", true, 0);
 }
 
-void VRVideo::cacheFrames(VRThreadWeakPtr t) { loadSomeFrames(); }
+void VRVideo::cacheFrames(VRThreadWeakPtr t) {
+    if (!loadSomeFrames()) ::Thread::sleepMilli(1);
+}
 
-void VRVideo::loadSomeFrames() {
+/**
+ * Decodes the frames missing around the current frame, returns false if the window is complete.
+ * Forward playback caches mostly ahead of the current frame, backward playback mostly behind it.
+ * Decoding continues from the last decoded frame unless the keyframe index allows to skip ahead or the window is behind.
+ */
+bool VRVideo::loadSomeFrames() {
     VRLock lock(avMutex);
 
-    int currentF = currentFrame;
+    int stream, current, direction, speed;
+    {
+        VRLock lock(osgMutex);
+        stream = playStream;
+        current = currentFrame;
+        direction = playDirection;
+        speed = playSpeed;
+        interruptCaching = false;
+    }
+    if (!vFile || !vStreams.count(stream)) return false;
+    auto& s = vStreams[stream];
 
-    bool doReturn = true;
-    for (auto& s : vStreams) if (s.second.cachedFrameMax-currentF < cacheSize) doReturn = false;
-    //for (auto& s : aStreams) if (s.second.cachedFrameMax-currentF < cacheSize) doReturn = false;
-    //cout << "LF " << currentF << ", return? " << doReturn << endl;
-    if (doReturn) return;
+    int N = s.pool.size() ? s.pool.size() : cacheSize;
+    int behind = max(1, N/8);
+    int ahead = N - behind - 1;
+    int w0 = (direction > 0) ? current - behind : current - ahead;
+    int w1 = (direction > 0) ? current + ahead + 1 : current + behind + 1;
+    int nFrames = (s.lastFrame >= 0) ? s.lastFrame+1 : getNFrames(stream);
+    if (nFrames > 0) w1 = min(w1, nFrames);
+    w0 = max(w0, 0);
+
+    int r0 = (direction > 0) ? max(current, w0) : w0; // range that has to be cached
+    int r1 = (direction > 0) ? w1 : min(current+1, w1);
+    int first = -1;
+    {
+        VRLock lock(osgMutex);
+        for (int f = r0; f < r1 && first < 0; f++) if (!s.isCached(f) && !s.gaps.count(f)) first = f; // gaps count as filled
+    }
+    if (first < 0) return false;
 
-    for (AVPacket packet; av_read_frame(vFile, &packet)>=0; av_packet_unref(&packet)) { // read packets
-        if (interruptCaching) break;
+    int key = s.findKey(first);
+    bool skipAhead = (key >= 0 && s.keyFrames[key] > s.decodedFrame+1);
+    bool farAhead = (key < 0 && first - s.decodedFrame > N);
+    if (s.decodedFrame >= first || skipAhead || farAhead) seekFrame(stream, first);
 
-        int stream = packet.stream_index;
+    int budget = max(8, 2*speed); // packets until the playhead is checked again
+    int decoded = 0;
+    bool eof = true;
+    for (AVPacket packet; av_read_frame(vFile, &packet)>=0; av_packet_unref(&packet)) { // read packets
+        int pStream = packet.stream_index;
 
-        if (aStreams.count(stream)) {
-            auto a = aStreams[stream].audio;
+        if (aStreams.count(pStream) && s.decodedFrame >= audioFrontier) {
+            auto a = aStreams[pStream].audio;
             auto data = a->extractPacket(&packet);
             VRLock lock(osgMutex);
-            aStreams[stream].frames[aStreams[stream].cachedFrameMax] = data;
-            aStreams[stream].cachedFrameMax++;
+            aStreams[pStream].frames[aStreams[pStream].cachedFrameMax] = data;
+            aStreams[pStream].cachedFrameMax++;
         }
 
-        if (vStreams.count(stream)) {
-            //cout << " v frame0: " << currentF << " N: " << vStreams[stream].cachedFrameMax << endl;
-            auto img = convertFrame(stream, &packet);
-            if (!img) continue;
-            //cout << "  converted the frame!" << endl;
-            VRLock lock(osgMutex);
-            vStreams[stream].frames[vStreams[stream].cachedFrameMax] = img;
-            vStreams[stream].cachedFrameMax++;
+        if (vStreams.count(pStream)) {
+            decodePacket(pStream, &packet, w0, w1);
+            if (pStream == stream) decoded++;
         }
 
-        // break if all streams are sufficiently cached
-        bool doBreak = true;
-        for (auto& s : vStreams) if (s.second.cachedFrameMax-currentF < cacheSize) doBreak = false;
-        //for (auto& s : aStreams) if (s.second.cachedFrameMax-currentF < cacheSize) doBreak = false;
-        if (doBreak) { av_packet_unref(&packet); break; }
-    }
-
-    for (auto& s : vStreams) { // cleanup cache
-        if (interruptCaching) break;
-        vector<int> toRemove;
-        for (auto f : s.second.frames) { // read stream
-            if (f.first < currentF) toRemove.push_back(f.first);
+        if (s.decodedFrame >= r1-1 || decoded >= budget || interruptCaching) {
+            av_packet_unref(&packet);
+            eof = false;
+            break;
         }
+    }
 
-        for (auto r : toRemove) s.second.frames.erase(r);
+    if (eof) { // drain the decoder, the last frame is known from now on
+        decodePacket(stream, 0, w0, w1);
+        s.lastFrame = s.decodedFrame;
+        seekFrame(stream, current);
     }
 
-    interruptCaching = false;
+    audioFrontier = max(audioFrontier, s.decodedFrame);
+    return true;
+}
+
+void VRVideo::setCacheSize(int frames, int megabytes) {
+    VRLock lock(avMutex);
+    VRLock lock2(osgMutex);
+    cacheSize = max(frames, 4);
+    cacheMemory = megabytes;
+    for (auto& s : vStreams) { // reallocated with the next decoded frame
+        s.second.pool.clear();
+        s.second.poolFrames.clear();
+    }
 }
 
+void VRVideo::setDecoderThreads(int N) { decoderThreads = N; } // applies when opening a file
+
 void VRVideo::setVolume(float v) {
     volume = v;
     for (auto& a : aStreams) a.second.audio->setVolume(v);
@@ -298,26 +419,20 @@ size_t VRVideo::getNFrames(int stream) {
 
 float VRVideo::getDuration() { return duration; }
 
-void VRVideo::goTo(float t) { // TODO
-    VRLock lock(avMutex);
-
-    t = 0;
-
+void VRVideo::goTo(float t) { // the caching thread seeks to the nearest keyframe
     if (anim) anim->goTo(t);
+    if (!vStreams.count(playStream)) return;
 
-    int64_t timestamp = t; // TODO
-
-    cout << " goTo " << t << endl;
-    for (int i=0; i<(int)vFile->nb_streams; i++) {
-        int r = av_seek_frame(vFile, i, timestamp, AVSEEK_FLAG_BACKWARD);
-        if (r < 0) cout << "AAAAAAAA, av_seek_frame failed!!" << endl;
-        vStreams[i].frames.clear();
-        vStreams[i].cachedFrameMax = 0; // TODO
-
-        interruptCaching = true; // TODO
-        currentFrame = 0; // TODO
+    VRLock lock(osgMutex);
+    currentFrame = getNFrames(playStream) * t;
+    audioFrontier = currentFrame;
+    interruptCaching = true;
+
+    for (auto& a : aStreams) {
+        a.second.frames.clear();
+        a.second.cachedFrameMax = 0;
+        a.second.lastFrameQueued = 0;
     }
-    cout << "  goTo done" << endl;
 }
 
 void VRVideo::pause() {
@@ -339,7 +454,13 @@ bool VRVideo::isPaused() {
 
 void VRVideo::showFrame(int stream, int frame) {
     VRLock lock(osgMutex);
+    int delta = frame - currentFrame;
+    if (delta != 0) {
+        playDirection = (delta > 0) ? 1 : -1;
+        playSpeed = min(abs(delta), cacheSize);
+    }
     currentFrame = frame;
+    if (vStreams.count(stream)) playStream = stream;
 
     // video, just jump to frame
     auto f = getFrame(stream, frame);
@@ -359,9 +480,11 @@ void VRVideo::showFrame(int stream, int frame) {
         int I1 = aStream.cachedFrameMax; //min(frame+audioQueue, aStream.cachedFrameMax);
         //cout << ", queue audio: " << I0 << " -> " << I1 << ", queued buffers: " << aStream.audio->getInterface()->getQueuedBuffer() << endl;
         for (int i=I0; i<I1; i++) {
+            if (!aStream.frames.count(i)) continue;
             for (auto aframe : aStream.frames[i]) {
                 aStream.audio->playBuffer(aframe);
             }
+            aStream.frames.erase(i); // queued buffers are owned by the sound
         }
         aStream.lastFrameQueued = I1;
     }
@@ -384,12 +507,16 @@ void VRVideo::play(int stream, float t0, float t1, float v) {
 }
 
 VRTexturePtr VRVideo::getFrame(int stream, int i) {
+    VRLock lock(osgMutex);
     if (vStreams.count(stream) == 0) return 0;
-    if (vStreams[stream].frames.count(i) == 0) return 0;
-    return vStreams[stream].frames[i];
+    auto& s = vStreams[stream];
+    int slot = s.cachedSlot(i);
+    if (slot < 0) return 0;
+    return s.pool[slot];
 }
 
 VRTexturePtr VRVideo::getFrame(int stream, float t) {
+    if (vStreams.count(stream) == 0) return 0;
     int i = vStreams[stream].fps * duration * t;
-    return vStreams[stream].frames[i];
+    return getFrame(stream, i);
 }
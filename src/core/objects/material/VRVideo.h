@@ -20,13 +20,33 @@ typedef signed char ALbyte;
 
 OSG_BEGIN_NAMESPACE;
 
+/**
+ * Video texture, frames are decoded ahead of the playback by a caching thread.
+ * Each video stream decodes with multiple threads and converts into a fixed ring of reusable textures.
+ * A keyframe index built on open is used to seek, the cached window follows playback direction and speed.
+ */
 class VRVideo : public VRStorage {
     private:
         struct VStream {
             AVCodecContext* vCodec = 0;
-            map< int, VRTexturePtr > frames;
+            SwsContext* swsContext = 0;
             double fps = 0;
-            int cachedFrameMax = 0;
+            double timeBase = 0; // seconds per pts
+            int64_t startPts = 0;
+            int decodedFrame = -1; // last frame the decoder returned
+            int lastFrame = -1; // known once the end of the file was reached
+            vector<VRTexturePtr> pool; // frame i lives in slot i % pool.size()
+            vector<int> poolFrames; // frame held by each slot, -1 if empty
+            vector<int> keyFrames; // sorted
+            vector<int64_t> keyPts;
+            map<int, int> gaps; // frame numbers no decoded frame maps to, shown as the frame before
+
+            int toFrame(int64_t pts);
+            int64_t toPts(int frame);
+            int nextFrame(int64_t pts);
+            int findKey(int frame);
+            int cachedSlot(int frame);
+            bool isCached(int frame);
             ~VStream();
         };
 
@@ -48,8 +68,14 @@ class VRVideo : public VRStorage {
         double duration = 0;
 
         int cacheSize = 100;
+        int cacheMemory = 256; // MB per video stream
+        int decoderThreads = 0; // 0 lets the codec pick
         int audioQueue = 40;
         int currentFrame = 0;
+        int playStream = -1;
+        int playDirection = 1;
+        int playSpeed = 1; // frames per update
+        int audioFrontier = -1; // audio is only extracted when decoding new parts of the file
         bool interruptCaching = false;
 
         VRMaterialWeakPtr material;
@@ -58,9 +84,6 @@ class VRVideo : public VRStorage {
 
         AVFormatContext* vFile = 0;
         AVFrame* vFrame = 0;
-        AVFrame* nFrame = 0;
-        vector<UInt8> osgFrame;
-        SwsContext* swsContext = 0;
         AVPacket* packet = 0;
 
         VRMutex avMutex;
@@ -70,9 +93,13 @@ class VRVideo : public VRStorage {
 
         int getNStreams();
         int getStream(int j);
-        VRTexturePtr convertFrame(int stream, AVPacket* packet);
+        void buildKeyFrameIndex();
+        void initPool(VStream& s, int w, int h, int Ncols);
+        void seekFrame(int stream, int frame);
+        void decodePacket(int stream, AVPacket* packet, int w0, int w1);
+        void convertFrame(VStream& s, int frame);
         void frameUpdate(float t, int stream);
-        void loadSomeFrames();
+        bool loadSomeFrames();
         void cacheFrames(VRThreadWeakPtr t);
 
     public:
@@ -90,6 +117,8 @@ class VRVideo : public VRStorage {
         bool isPaused();
         void goTo(float t);
         void setVolume(float v);
+        void setCacheSize(int frames, int megabytes = 256);
+        void setDecoderThreads(int N);
 
         float getDuration();
         size_t getNFrames(int stream);
@@ -10,6 +10,7 @@
 #include "core/utils/VRGlobals.h"
 #include "core/utils/toString.h"
 #include "core/utils/VRFunction.h"
+#include "core/utils/VRMutex.h"
 #include "core/utils/VRUndoInterfaceT.h"
 #include "core/utils/VRStorage_template.h"
 #include "core/scene/import/VRExport.h"
@@ -22,8 +23,63 @@
 #include <OpenSG/OSGVisitSubTree.h>
 #include <OpenSG/OSGSceneFileHandler.h>
 
+#include <unordered_map>
+#include <unordered_set>
+#include <climits>
+#include <atomic>
+
 using namespace OSG;
 
+struct VRObjectIndex { // scene wide lookup tables, kept up to date on creation, rename, retag and destruction
+    typedef unordered_map<string, unordered_set<VRObject*>> Table;
+
+    VRMutex mtx;
+    unordered_map<Node*, VRObject*> nodes;
+    unordered_map<int, VRObject*> IDs;
+    Table names;
+    Table baseNames;
+    Table types;
+    Table tags;
+
+    void add(Table& t, const string& key, VRObject* o) { if (key != "") t[key].insert(o); }
+
+    void rem(Table& t, const string& key, VRObject* o) {
+        auto it = t.find(key);
+        if (it == t.end()) return;
+        it->second.erase(o);
+        if (it->second.empty()) t.erase(it);
+    }
+
+    vector<VRObject*> get(Table& t, const string& key) {
+        VRLock lock(mtx);
+        auto it = t.find(key);
+        if (it == t.end()) return vector<VRObject*>();
+        return vector<VRObject*>(it->second.begin(), it->second.end());
+    }
+};
+
+atomic<size_t> graphVersion(0); // counts the moves of subtrees with graph dependents
+
+VRObjectIndex& getObjectIndex() { // never destroyed, objects may outlive static destruction
+    static VRObjectIndex* index = new VRObjectIndex();
+    return *index;
+}
+
+void setNodeObject(Node* n, VRObject* o) {
+    if (!n) return;
+    auto& index = getObjectIndex();
+    VRLock lock(index.mtx);
+    index.nodes[n] = o;
+}
+
+void remNodeObject(Node* n, VRObject* o) {
+    if (!n) return;
+    auto& index = getObjectIndex();
+    VRLock lock(index.mtx);
+    auto it = index.nodes.find(n);
+    if (it != index.nodes.end() && it->second == o) index.nodes.erase(it);
+}
+
 template<> string typeName(const VRObject* o) {
     VRObject* O = (VRObject*)o;
     return O ? O->getType() : "VRObject";
@@ -40,7 +96,14 @@ VRObject::VRObject(string _name) {
     osg = OSGObject::create( makeNodeFor( group ) );
     core = OSGCore::create( group );
     OSG::setName(osg->node, name);
+    setNodeObject(osg->node, this);
     type = "Object";
+    {
+        auto& index = getObjectIndex();
+        VRLock lock(index.mtx);
+        index.IDs[ID] = this;
+    }
+    updateIndex();
 
     setStorageType("Object");
     store("type", &type);
@@ -63,6 +126,7 @@ void VRObject::setupBefore(VRStorageContextPtr context) {
 }
 
 void VRObject::setupAfter(VRStorageContextPtr context) {
+    updateIndex(); // type and attachments are loaded directly
     setVisibleMask(visibleMask);
     setPickable(pickable);
 
@@ -77,6 +141,16 @@ void VRObject::setupAfter(VRStorageContextPtr context) {
 
 VRObject::~VRObject() {
     //cout << " ~VRObject " << getName() << endl;
+    remNodeObject(osg->node, this);
+    {
+        auto& index = getObjectIndex();
+        VRLock lock(index.mtx);
+        index.IDs.erase(ID);
+        index.rem(index.names, indexedName, this);
+        index.rem(index.baseNames, indexedBaseName, this);
+        index.rem(index.types, indexedType, this);
+        for (auto& t : indexedTags) index.rem(index.tags, t, this);
+    }
     if (OSGCore::OSG_VALID) {
         NodeMTRecPtr p;
         if (osg->node) p = osg->node->getParent();
@@ -171,13 +245,56 @@ bool VRObject::hasTag(string name) { return attachments.count(name); }
 void VRObject::remTag(string name) { remAttachment(name); }
 
 void VRObject::addTag(string name) {
-    if (!attachments.count(name)) attachments[name] = new VRAttachment(name);
+    if (attachments.count(name)) return;
+    attachments[name] = new VRAttachment(name);
+    updateIndex();
 }
 
 void VRObject::remAttachment(string name) {
     if (attachments.count(name)) {
         delete attachments[name];
         attachments.erase(name);
+        updateIndex();
+    }
+}
+
+void VRObject::nameChanged() { updateIndex(); }
+
+void VRObject::updateIndex() {
+    auto& index = getObjectIndex();
+    VRLock lock(index.mtx);
+
+    if (indexedName != name) {
+        index.rem(index.names, indexedName, this);
+        index.add(index.names, name, this);
+        indexedName = name;
+    }
+
+    if (indexedBaseName != base_name) {
+        index.rem(index.baseNames, indexedBaseName, this);
+        index.add(index.baseNames, base_name, this);
+        indexedBaseName = base_name;
+    }
+
+    if (indexedType != type) {
+        index.rem(index.types, indexedType, this);
+        index.add(index.types, type, this);
+        indexedType = type;
+    }
+
+    bool tagsChanged = (indexedTags.size() != attachments.size());
+    if (!tagsChanged) {
+        size_t i = 0;
+        for (auto& a : attachments) if (indexedTags[i++] != a.first) { tagsChanged = true; break; }
+    }
+
+    if (tagsChanged) {
+        for (auto& t : indexedTags) index.rem(index.tags, t, this);
+        indexedTags.clear();
+        for (auto& a : attachments) {
+            index.add(index.tags, a.first, this);
+            indexedTags.push_back(a.first);
+        }
     }
 }
 
@@ -189,7 +306,7 @@ string VRObject::getAttachmentAsString(string name) {
 }
 
 void VRObject::setAttachmentFromString(string name, string value) {
-    if (!hasTag(name)) addAttachment(name, value);
+    if (!hasTag(name)) { addAttachment(name, value); return; }
     else {
         if (!attachments[name]->fromString(value))
             attachments[name]->set(value);
@@ -274,6 +391,7 @@ void VRObject::setCore(OSGCorePtr c, string _type, bool force) {
     type = _type;
     osg->node->setCore(c->core);
     specialized = true;
+    updateIndex();
 }
 
 OSGCorePtr VRObject::getCore() { return core; }
@@ -290,7 +408,9 @@ void VRObject::enableCore() { osg->node->setCore( core->core ); }
 void VRObject::wrapOSG(OSGObjectPtr node) {
     if (!node || !getNode()) return;
     if (!node->node) return;
+    remNodeObject(getNode()->node, this);
     getNode()->node = node->node;
+    setNodeObject(getNode()->node, this);
     if (!core || !node->node->getCore()) return;
     core->core = node->node->getCore();
 
@@ -327,11 +447,17 @@ void VRObject::addChild(VRObjectPtr child, bool osg, int place) {
 
     if (osg) addChild(child->osg);
     child->graphChanged = VRGlobals::CURRENT_FRAME;
+    if (child->graphDependents) graphVersion++;
     child->childIndex = children.size();
     children.push_back(child);
     child->parent = ptr();
     child->setSiblingPosition(place);
     updateChildrenIndices(true);
+    child->updateIndex(); // derived constructors may set the type after the base constructor
+    for (auto p = ptr(); p; p = p->getParent()) {
+        p->subtreeSize += child->subtreeSize;
+        p->graphDependents += child->graphDependents;
+    }
 }
 
 int VRObject::getChildIndex() { return childIndex; }
@@ -353,9 +479,16 @@ void VRObject::subChild(VRObjectPtr child, bool doOsg) {
 
     int target = findChild(child);
 
-    if (target != -1) children.erase(children.begin() + target);
+    if (target != -1) {
+        children.erase(children.begin() + target);
+        for (auto p = ptr(); p; p = p->getParent()) {
+            p->subtreeSize -= child->subtreeSize;
+            p->graphDependents -= child->graphDependents;
+        }
+    }
     if (child->getParent() == ptr()) child->parent.reset();
     child->graphChanged = VRGlobals::CURRENT_FRAME;
+    if (child->graphDependents) graphVersion++;
     updateChildrenIndices(true);
 }
 
@@ -438,6 +571,76 @@ VRObjectPtr VRObject::getAtPath(string path) {
     return res;
 }
 
+template<class P>
+void VRObject::appendChildren(vector<VRObjectPtr>& res, const P& predicate) { // same order as the recursive getChildren
+    for (auto& c : children) if (predicate(c.get())) res.push_back(c);
+    for (auto& c : children) c->appendChildren(res, predicate);
+}
+
+template<class P>
+VRObjectPtr VRObject::findPreorder(const P& predicate) {
+    for (auto& c : children) {
+        if (c.get() == this) continue; // workaround! TODO: find why ptr() can happn
+        if (predicate(c.get())) return c;
+        VRObjectPtr tmp = c->findPreorder(predicate);
+        if (tmp != 0) return tmp;
+    }
+    return 0;
+}
+
+/**
+ * Filters indexed objects to the ones below this object and sorts them like the recursive traversals would.
+ * Preorder sorts by the child index paths, the children order groups siblings and sorts by the path of their parent.
+ * The candidates are raw pointers from the index, call it with the index mutex locked,
+ * objects leave the index in their destructor and can not be freed while it is held.
+ */
+vector<VRObjectPtr> VRObject::inSubtree(const vector<VRObject*>& candidates, bool childrenOrder, bool includeSelf) {
+    vector<pair<vector<int>, VRObjectPtr>> found;
+    for (auto o : candidates) {
+        if (o == this) {
+            if (includeSelf) found.push_back( make_pair(childrenOrder ? vector<int>(1, INT_MAX) : vector<int>(), ptr()) );
+            continue;
+        }
+
+        vector<int> path;
+        VRObjectPtr obj;
+        VRObject* c = o;
+        while (c && c != this) {
+            auto p = c->parent.lock();
+            if (!p) { c = 0; break; }
+            int i = c->childIndex;
+            if (i < 0 || i >= (int)p->children.size() || p->children[i].get() != c) {
+                i = -1;
+                for (unsigned int j=0; j<p->children.size(); j++) if (p->children[j].get() == c) { i = j; break; }
+                if (i == -1) { c = 0; break; }
+            }
+            if (!obj) obj = p->children[i];
+            path.push_back(i);
+            c = p.get();
+        }
+        if (!c) continue;
+        reverse(path.begin(), path.end());
+        found.push_back( make_pair(path, obj) );
+    }
+
+    if (childrenOrder) {
+        sort(found.begin(), found.end(), [](const pair<vector<int>, VRObjectPtr>& a, const pair<vector<int>, VRObjectPtr>& b) {
+            auto& A = a.first;
+            auto& B = b.first;
+            if (A.size() == B.size() && equal(A.begin(), A.end()-1, B.begin())) return A.back() < B.back();
+            return lexicographical_compare(A.begin(), A.end()-1, B.begin(), B.end()-1);
+        });
+    } else {
+        sort(found.begin(), found.end(), [](const pair<vector<int>, VRObjectPtr>& a, const pair<vector<int>, VRObjectPtr>& b) {
+            return a.first < b.first;
+        });
+    }
+
+    vector<VRObjectPtr> res;
+    for (auto& f : found) res.push_back(f.second);
+    return res;
+}
+
 vector<VRObjectPtr> VRObject::getChildrenWithTag(string tag, bool recursive, bool includeSelf) {
     if (!recursive) {
         vector<VRObjectPtr> res;
@@ -445,13 +648,16 @@ vector<VRObjectPtr> VRObject::getChildrenWithTag(string tag, bool recursive, boo
         return res;
     }
 
+    {
+        auto& index = getObjectIndex();
+        VRLock lock(index.mtx);
+        auto candidates = index.get(index.tags, tag);
+        if (candidates.size()*4 <= subtreeSize) return inSubtree(candidates, true, includeSelf);
+    }
+
     vector<VRObjectPtr> res = getChildrenWithTag(tag);
     if (includeSelf && (hasTag(tag))) res.push_back( ptr() );
-
-    for (auto c : children) {
-        vector<VRObjectPtr> tmp = c->getChildrenWithTag(tag, true);
-        res.insert( res.end(), tmp.begin(), tmp.end() );
-    }
+    for (auto& c : children) c->appendChildren(res, [&](VRObject* o) { return o->hasTag(tag); });
     return res;
 }
 
@@ -463,75 +669,118 @@ vector<VRObjectPtr> VRObject::getChildren(bool recursive, string type, bool incl
         return res;
     }
 
+    if (type != "") {
+        auto& index = getObjectIndex();
+        VRLock lock(index.mtx);
+        auto candidates = index.get(index.types, type);
+        if (candidates.size()*4 <= subtreeSize) {
+            if (includeSelf && getType() == type && !count(candidates.begin(), candidates.end(), this)) candidates.push_back(this); // not yet indexed
+            return inSubtree(candidates, true, includeSelf);
+        }
+    }
+
     vector<VRObjectPtr> res = getChildren(false, type);
     if (includeSelf && (getType() == type || type == "")) res.push_back( ptr() );
-
-    for (auto c : children) {
-        vector<VRObjectPtr> tmp = c->getChildren(true, type);
-        res.insert( res.end(), tmp.begin(), tmp.end() );
-    }
+    for (auto& c : children) c->appendChildren(res, [&](VRObject* o) { return type == "" || o->getType() == type; });
     return res;
 }
 
 VRObjectPtr VRObject::find(OSGObjectPtr n, string indent) {
-    //cout << endl << indent << getName() << " " << node << " " << ptr() << flush;
+    if (!n) return 0;
     if (osg->node == n->node) return ptr();
-    for (auto& c : children) {
-        VRObjectPtr tmp = c->find(n, indent+" ");
-        if (tmp != 0) return tmp;
-    }
-    return 0;
+    auto& index = getObjectIndex();
+    VRLock lock(index.mtx);
+    VRObject* o = 0;
+    auto it = index.nodes.find(n->node);
+    if (it != index.nodes.end()) o = it->second;
+    if (!o || o->osg->node != n->node) return 0;
+    auto res = inSubtree(vector<VRObject*>(1, o), false, false);
+    return res.size() ? res[0] : 0;
+}
+
+VRObjectPtr VRObject::fromNode(OSGObjectPtr n) {
+    if (!n || !n->node) return 0;
+    auto& index = getObjectIndex();
+    VRLock lock(index.mtx);
+    auto it = index.nodes.find(n->node);
+    if (it == index.nodes.end()) return 0;
+    VRObject* o = it->second;
+    if (o->osg->node != n->node) return 0;
+    return o->ptr();
 }
 
 VRObjectPtr VRObject::find(VRObjectPtr obj) {
+    if (!obj) return 0;
     if (obj == ptr()) return ptr();
-    for (auto& c : children) {
-        VRObjectPtr tmp = c->find(obj);
-        if (tmp != 0) return tmp;
-    }
-    return 0;
+    auto res = inSubtree(vector<VRObject*>(1, obj.get()), false, false); // obj is held, no lock needed
+    return res.size() ? res[0] : 0;
 }
 
 VRObjectPtr VRObject::find(string Name) {
     if (name == Name) return ptr();
-    for (auto& c : children) {
-        if (c.get() == this) {
-            cout << "ERROR!! 'this' is also its child!" << endl;
-            continue; // workaround! TODO: find why ptr() can happn
+    {
+        auto& index = getObjectIndex();
+        VRLock lock(index.mtx);
+        auto candidates = index.get(index.names, Name);
+        if (candidates.empty()) return 0;
+        if (candidates.size()*4 <= subtreeSize) {
+            auto res = inSubtree(candidates, false, false);
+            return res.size() ? res[0] : 0;
         }
-        VRObjectPtr tmp = c->find(Name);
-        if (tmp != 0) return tmp;
     }
-    return 0;
+    return findPreorder([&](VRObject* o) { return o->name == Name; });
 }
 
 VRObjectPtr VRObject::findFirst(string Name) {
     if (base_name == Name) return ptr();
-    for (auto& c : children) {
-        if (c == ptr()) continue; // workaround! TODO: find why ptr() can happn
-        VRObjectPtr tmp = c->findFirst(Name);
-        if (tmp != 0) return tmp;
+    {
+        auto& index = getObjectIndex();
+        VRLock lock(index.mtx);
+        auto candidates = index.get(index.baseNames, Name);
+        if (candidates.empty()) return 0;
+        if (candidates.size()*4 <= subtreeSize) {
+            auto res = inSubtree(candidates, false, false);
+            return res.size() ? res[0] : 0;
+        }
     }
-    return 0;
+    return findPreorder([&](VRObject* o) { return o->base_name == Name; });
 }
 
 vector<VRObjectPtr> VRObject::findAll(string Name, vector<VRObjectPtr> res ) {
-    if (base_name == Name) res.push_back(ptr());
-    for (auto& c : children) {
-        if (c == ptr()) continue; // workaround! TODO: find why ptr() can happn
-        res = c->findAll(Name, res);
+    {
+        auto& index = getObjectIndex();
+        VRLock lock(index.mtx);
+        auto candidates = index.get(index.baseNames, Name);
+        if (candidates.size()*4 <= subtreeSize) {
+            if (base_name == Name && !count(candidates.begin(), candidates.end(), this)) candidates.push_back(this);
+            auto found = inSubtree(candidates, false, true);
+            res.insert(res.end(), found.begin(), found.end());
+            return res;
+        }
     }
+
+    visit([&](const VRObjectPtr& o) { if (o->base_name == Name) res.push_back(o); return true; });
     return res;
 }
 
 VRObjectPtr VRObject::find(int id) {
     if (ID == -1) return 0;
     if (ID == id) return ptr();
-    for (auto& c : children) {
-        VRObjectPtr tmp = c->find(id);
-        if (tmp != 0) return tmp;
+    auto& index = getObjectIndex();
+    VRLock lock(index.mtx);
+    auto it = index.IDs.find(id);
+    if (it == index.IDs.end()) return 0;
+    auto res = inSubtree(vector<VRObject*>(1, it->second), false, false);
+    return res.size() ? res[0] : 0;
+}
+
+void VRObject::traverse(VRObjectCbPtr visitor, string type, bool includeSelf) {
+    if (!visitor) return;
+    if (type == "") {
+        visit([&](const VRObjectPtr& o) { (*visitor)(o); return true; }, includeSelf);
+        return;
     }
-    return 0;
+    for (auto o : getChildren(true, type, includeSelf)) (*visitor)(o);
 }
 
 VRObjectPtr VRObject::getRoot() {
@@ -547,6 +796,12 @@ VRObjectPtr VRObject::findPickableAncestor() {
     else return getParent()->findPickableAncestor();
 }
 
+size_t VRObject::getGraphVersion() { return graphVersion; }
+
+void VRObject::addGraphDependent(int d) { // counted on all ancestors, moving the subtree changes the graph version
+    for (auto p = ptr(); p; p = p->getParent()) p->graphDependents += d;
+}
+
 bool VRObject::hasGraphChanged() {
     if (graphChanged == VRGlobals::CURRENT_FRAME) return true;
     if (getParent() == 0) return false;
@@ -33,8 +33,19 @@ class VRObject : public std::enable_shared_from_this<VRObject>, public VRName, p
         unsigned int visibleMask = -1;
         unsigned int graphChanged = 0; //is frame number
 
+        string indexedName; // keys under which the object is in the scene index
+        string indexedBaseName;
+        string indexedType;
+        vector<string> indexedTags;
+        size_t subtreeSize = 1;
+        int graphDependents = 0; // objects in the subtree the constraint graph depends on
+
         int findChild(VRObjectPtr node);
         void updateChildrenIndices(bool recursive = false);
+        void updateIndex();
+        vector<VRObjectPtr> inSubtree(const vector<VRObject*>& candidates, bool childrenOrder, bool includeSelf);
+        template<class P> void appendChildren(vector<VRObjectPtr>& res, const P& predicate);
+        template<class P> VRObjectPtr findPreorder(const P& predicate);
 
         static void unitTest();
 
@@ -50,6 +61,7 @@ class VRObject : public std::enable_shared_from_this<VRObject>, public VRName, p
         int old_child_id = 0;
 
         void setIntern(bool b);
+        void nameChanged() override;
         virtual void printInformation();
         virtual VRObjectPtr copy(vector<VRObjectPtr> children);
 
@@ -70,6 +82,8 @@ class VRObject : public std::enable_shared_from_this<VRObject>, public VRName, p
         VRObjectPtr getAtPath(string path);
 
         bool hasGraphChanged();
+        void addGraphDependent(int d);
+        static size_t getGraphVersion(); // changes of the parents of graph dependents
 
         template<typename T> void addAttachment(string name, T t);
         template<typename T> T getAttachment(string name);
@@ -94,6 +108,9 @@ class VRObject : public std::enable_shared_from_this<VRObject>, public VRName, p
         virtual void addChild(OSGObjectPtr n);
         virtual void subChild(OSGObjectPtr n);
         VRObjectPtr find(OSGObjectPtr n, string indent = " ");
+        static VRObjectPtr fromNode(OSGObjectPtr n);
+        template<class F> void visit(const F& visitor, bool includeSelf = true);
+        void traverse(VRObjectCbPtr visitor, string type = "", bool includeSelf = true);
 
         string getOSGTreeString();
         static string printOSGTreeString(OSGObjectPtr o, string indent = "");
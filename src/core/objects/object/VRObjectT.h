@@ -38,9 +38,16 @@ template<typename T>
 void OSG::VRObject::addAttachment(string name, T t) {
     if (!attachments.count(name)) attachments[name] = new VRAttachment(name);
     attachments[name]->set(t);
+    updateIndex();
 }
 
 template<typename T>
 T OSG::VRObject::getAttachment(string name) { return attachments[name]->get<T>(); }
 
+template<class F>
+void OSG::VRObject::visit(const F& visitor, bool includeSelf) { // preorder without allocations, return false from the visitor to skip the subtree
+    if (includeSelf && !visitor(ptr())) return;
+    for (auto& c : children) if (visitor(c)) c->visit(visitor, false);
+}
+
 #endif // VROBJECTT_H_INCLUDED
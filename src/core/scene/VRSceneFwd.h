@@ -16,6 +16,8 @@ ptrFwd(VRRenderStudio);
 ptrFwd(VRScene);
 ptrFwd(VRThread);
 ptrFwd(VRSpaceWarper);
+ptrFwd(VRSceneOptimizer);
+ptrFwd(VROcclusionCuller);
 ptrFwd(VRScenegraphInterface);
 
 }
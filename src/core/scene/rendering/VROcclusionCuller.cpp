@@ -0,0 +1,360 @@
+#include "VROcclusionCuller.h"
+#include "core/objects/OSGObject.h"
+#include "core/objects/VRCamera.h"
+#include "core/objects/VRLodTree.h"
+#include "core/objects/geometry/VRGeometry.h"
+#include "core/objects/geometry/OSGGeometry.h"
+#include "core/objects/material/VRMaterial.h"
+#include "core/math/partitioning/boundingbox.h"
+#include "core/scene/VRScene.h"
+#include "core/setup/VRSetup.h"
+#include "core/setup/windows/VRMultiWindow.h"
+#include "core/setup/windows/VRView.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRFunction.h"
+#include "core/utils/VRTimer.h"
+
+#include <OpenSG/OSGNode.h>
+#include <OpenSG/OSGGeometry.h>
+#include <OpenSG/OSGTransform.h>
+#include <OpenSG/OSGTriangleIterator.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace OSG;
+
+VROcclusionCuller::VROcclusionCuller() {}
+
+VROcclusionCuller::~VROcclusionCuller() { showAll(); }
+
+VROcclusionCullerPtr VROcclusionCuller::create() { return VROcclusionCullerPtr( new VROcclusionCuller() ); }
+VROcclusionCullerPtr VROcclusionCuller::ptr() { return shared_from_this(); }
+
+void VROcclusionCuller::setResolution(int w, int h) { width = max(4, (w+3)/4*4); height = max(1, h); }
+void VROcclusionCuller::setOccluderLimits(int N, int Ntri, double minSize) { maxOccluders = N; maxOccluderTriangles = Ntri; minOccluderSize = minSize; }
+
+void VROcclusionCuller::setRoot(VRObjectPtr r) {
+    showAll();
+    root = r;
+    updateOccluders();
+}
+
+void VROcclusionCuller::updateOccluders() { // the largest opaque static geometries, in world space
+    occluders.clear();
+    auto r = root.lock();
+    if (!r) return;
+
+    vector<pair<double, VRGeometryPtr>> candidates;
+    for (auto obj : r->getChildren(true, "Geometry", true)) {
+        auto g = dynamic_pointer_cast<VRGeometry>(obj);
+        if (!g || g->hasTag("dynamic") || !g->isVisible()) continue;
+        if (!g->getMesh() || !g->getMesh()->geo || !g->getMesh()->geo->getPositions()) continue;
+        if (g->getMaterial() && g->getMaterial()->getTransparency() < 1) continue;
+        auto bb = g->getWorldBoundingbox();
+        double s = bb->size().length();
+        if (s < minOccluderSize) continue;
+        candidates.push_back(make_pair(s, g));
+    }
+    sort(candidates.begin(), candidates.end(), [](const pair<double, VRGeometryPtr>& a, const pair<double, VRGeometryPtr>& b) { return a.first > b.first; });
+
+    for (auto& c : candidates) {
+        if (int(occluders.size()) >= maxOccluders) break;
+        Geometry* geo = c.second->getMesh()->geo;
+        GeoVectorProperty* pos = geo->getPositions();
+        Matrix4d m = c.second->getWorldMatrix();
+
+        Occluder o;
+        o.geo = c.second;
+        for (TriangleIterator it = geo->beginTriangles(); it != geo->endTriangles(); ++it) {
+            for (int j=0; j<3; j++) {
+                Pnt3d p = Pnt3d( pos->getValue<Pnt3f>( it.getPositionIndex(j) ) );
+                m.mult(p, p);
+                for (int k=0; k<3; k++) o.triangles.push_back(p[k]);
+            }
+            if (int(o.triangles.size()/9) > maxOccluderTriangles) break;
+        }
+        if (int(o.triangles.size()/9) > maxOccluderTriangles || o.triangles.size() == 0) continue;
+        occluders.push_back(o);
+    }
+}
+
+bool VROcclusionCuller::hasSingleView() { // the traversal masks are global, other views would miss the culled objects
+    auto setup = VRSetup::getCurrent();
+    if (!setup) return true;
+    size_t Nviews = 0;
+    for (auto w : setup->getWindows()) {
+        if (dynamic_pointer_cast<VRMultiWindow>(w.second)) return false;
+        for (auto v : w.second->getViews()) {
+            if (v->isStereo() || v->activeStereo()) return false;
+            Nviews++;
+        }
+    }
+    return Nviews <= 1;
+}
+
+void VROcclusionCuller::setActive(bool b) {
+    auto scene = VRScene::getCurrent();
+    if (!scene) return;
+    if (b && !hasSingleView()) { cout << "VROcclusionCuller::setActive refused, only a single mono view is supported" << endl; return; }
+    if (b && !updateCb) {
+        updateCb = VRUpdateCb::create("occlusion culling", bind(&VROcclusionCuller::update, this, VRCameraPtr(0)));
+        scene->addUpdateFkt(updateCb);
+    }
+    if (!b && updateCb) {
+        scene->dropUpdateFkt(updateCb);
+        updateCb = 0;
+        showAll();
+    }
+}
+
+void VROcclusionCuller::update(VRCameraPtr cam) {
+    if (!hasSingleView()) { showAll(); return; }
+    auto scene = VRScene::getCurrent();
+    if (!cam && scene) cam = scene->getActiveCamera();
+    if (!cam) return;
+    Matrix4d view = cam->getWorldMatrix();
+    view.invert();
+    Matrix4d vp = toMatrix4d( cam->getProjectionMatrix(width, height) );
+    vp.mult(view);
+    cull(vp);
+}
+
+void VROcclusionCuller::rasterize(const float* a, const float* b, const float* c) { // clip space, four floats per vertex
+    const float* v[3] = {a, b, c};
+    for (int k=0; k<3; k++) { // trivially outside one frustum plane
+        if (a[k] < -a[3] && b[k] < -b[3] && c[k] < -c[3]) return;
+        if (a[k] >  a[3] && b[k] >  b[3] && c[k] >  c[3]) return;
+    }
+
+    auto project = [&](const float* p, float* s) {
+        s[0] = (p[0]/p[3]*0.5f + 0.5f) * width;
+        s[1] = (p[1]/p[3]*0.5f + 0.5f) * height;
+        s[2] = p[2]/p[3];
+    };
+
+    if (a[2] >= -a[3] && b[2] >= -b[3] && c[2] >= -c[3]) {
+        float s[3][3];
+        for (int i=0; i<3; i++) project(v[i], s[i]);
+        rasterizeScreen(s[0], s[1], s[2]);
+        return;
+    }
+
+    float poly[4][4]; // clipped at the near plane, z + w >= 0
+    int N = 0;
+    for (int i=0; i<3; i++) {
+        const float* p = v[i];
+        const float* q = v[(i+1)%3];
+        float dp = p[2] + p[3];
+        float dq = q[2] + q[3];
+        if (dp >= 0) { for (int k=0; k<4; k++) poly[N][k] = p[k]; N++; }
+        if ((dp >= 0) != (dq >= 0)) {
+            float t = dp / (dp - dq);
+            for (int k=0; k<4; k++) poly[N][k] = p[k] + t*(q[k]-p[k]);
+            N++;
+        }
+    }
+
+    float s[4][3];
+    for (int i=0; i<N; i++) project(poly[i], s[i]);
+    for (int i=1; i+1<N; i++) rasterizeScreen(s[0], s[i], s[i+1]);
+}
+
+void VROcclusionCuller::rasterizeScreen(const float* a, const float* b, const float* c) { // screen x, y and NDC depth
+    float area = (c[0]-b[0])*(a[1]-b[1]) - (c[1]-b[1])*(a[0]-b[0]);
+    if (fabs(area) < 1e-8) return;
+    if (area < 0) { swap(b, c); area = -area; } // both windings occlude
+
+    float A0 = b[1]-c[1], B0 = c[0]-b[0], C0 = b[0]*c[1] - b[1]*c[0]; // edge opposite of a
+    float A1 = c[1]-a[1], B1 = a[0]-c[0], C1 = c[0]*a[1] - c[1]*a[0];
+    float A2 = a[1]-b[1], B2 = b[0]-a[0], C2 = a[0]*b[1] - a[1]*b[0];
+    float Az = (A0*a[2] + A1*b[2] + A2*c[2]) / area;
+    float Bz = (B0*a[2] + B1*b[2] + B2*c[2]) / area;
+    float Cz = (C0*a[2] + C1*b[2] + C2*c[2]) / area;
+
+    int x0 = max(0, int(floor(min(min(a[0], b[0]), c[0]))));
+    int x1 = min(width-1, int(ceil(max(max(a[0], b[0]), c[0]))));
+    int y0 = max(0, int(floor(min(min(a[1], b[1]), c[1]))));
+    int y1 = min(height-1, int(ceil(max(max(a[1], b[1]), c[1]))));
+    if (x0 > x1 || y0 > y1) return;
+    x0 &= ~3; // four pixels per step, the width is a multiple of four
+
+    vector<float>& D = depth[0];
+    for (int y=y0; y<=y1; y++) {
+        float py = y + 0.5f;
+        float* row = &D[y*width];
+        for (int x=x0; x<=x1; x+=4) {
+            float e0[4], e1[4], e2[4], z[4];
+            for (int k=0; k<4; k++) {
+                float px = x + k + 0.5f;
+                e0[k] = A0*px + B0*py + C0;
+                e1[k] = A1*px + B1*py + C1;
+                e2[k] = A2*px + B2*py + C2;
+                z[k] = Az*px + Bz*py + Cz;
+            }
+            for (int k=0; k<4; k++) {
+                bool inside = e0[k] >= 0 && e1[k] >= 0 && e2[k] >= 0 && z[k] >= -1;
+                row[x+k] = inside ? min(row[x+k], z[k]) : row[x+k];
+            }
+        }
+    }
+}
+
+void VROcclusionCuller::buildPyramid() { // each level keeps the farthest depth of four texels
+    levels.resize(1);
+    depth.resize(1);
+    levels[0] = make_pair(width, height);
+    while (levels.back().first > 1 || levels.back().second > 1) {
+        int w = levels.back().first;
+        int h = levels.back().second;
+        int W = (w+1)/2, H = (h+1)/2;
+        vector<float> L(W*H);
+        const vector<float>& P = depth.back();
+        for (int y=0; y<H; y++) {
+            int ya = 2*y, yb = min(2*y+1, h-1);
+            for (int x=0; x<W; x++) {
+                int xa = 2*x, xb = min(2*x+1, w-1);
+                L[y*W+x] = max( max(P[ya*w+xa], P[ya*w+xb]), max(P[yb*w+xa], P[yb*w+xb]) );
+            }
+        }
+        depth.push_back(L);
+        levels.push_back(make_pair(W, H));
+    }
+}
+
+bool VROcclusionCuller::isOccluded(const BoxVolume& v, const Matrix4d& m) { // m is the world matrix of the volume space
+    Pnt3f bMin, bMax;
+    v.getBounds(bMin, bMax);
+    Matrix4d mvp = VP;
+    mvp.mult(m);
+
+    float xMin = 1e30, xMax = -1e30, yMin = 1e30, yMax = -1e30, zMin = 1e30;
+    for (int i=0; i<8; i++) {
+        Vec4d p( i&1 ? bMax[0] : bMin[0], i&2 ? bMax[1] : bMin[1], i&4 ? bMax[2] : bMin[2], 1 );
+        double c[4];
+        for (int r=0; r<4; r++) c[r] = mvp[0][r]*p[0] + mvp[1][r]*p[1] + mvp[2][r]*p[2] + mvp[3][r]*p[3];
+        if (c[2] < -c[3] || c[3] <= 1e-9) return false; // crosses the near plane
+        float sx = (c[0]/c[3]*0.5 + 0.5) * width;
+        float sy = (c[1]/c[3]*0.5 + 0.5) * height;
+        xMin = min(xMin, sx); xMax = max(xMax, sx);
+        yMin = min(yMin, sy); yMax = max(yMax, sy);
+        zMin = min(zMin, float(c[2]/c[3]));
+    }
+
+    if (xMax < 0 || yMax < 0 || xMin >= width || yMin >= height) return false; // left to the frustum culling
+    int x0 = max(0, int(floor(xMin)));
+    int x1 = min(width-1, int(floor(xMax)));
+    int y0 = max(0, int(floor(yMin)));
+    int y1 = min(height-1, int(floor(yMax)));
+
+    size_t l = 0; // coarsest level with at most four texels per axis
+    while (l+1 < levels.size() && ((x1>>l) - (x0>>l) > 3 || (y1>>l) - (y0>>l) > 3)) l++;
+
+    int W = levels[l].first;
+    const vector<float>& D = depth[l];
+    for (int y = y0>>l; y <= (y1>>l); y++) {
+        for (int x = x0>>l; x <= (x1>>l); x++) {
+            if (D[y*W+x] + depthBias >= zMin) return false;
+        }
+    }
+    return true;
+}
+
+size_t VROcclusionCuller::countGeometries(Node* n) {
+    if (!n) return 0;
+    size_t N = dynamic_cast<Geometry*>(n->getCore()) ? 1 : 0;
+    for (unsigned int i=0; i<n->getNChildren(); i++) N += countGeometries(n->getChild(i));
+    return N;
+}
+
+void VROcclusionCuller::traverse(Node* n, Matrix4d m) { // m is the world matrix of the parent
+    if (!n || n->getTravMask() == 0) return;
+    const BoxVolume& v = n->getVolume();
+    bool occluder = occluderNodes.count(n) || occluderCores.count(n->getCore());
+    if (!occluder && !v.isEmpty() && !v.isInfinite()) {
+        stats.tested++;
+        if (isOccluded(v, m)) {
+            Hidden h;
+            h.node = n;
+            h.travMask = n->getTravMask();
+            h.culled = culledMask | (h.travMask & keptMask);
+            hidden[n] = h;
+            n->setTravMask(h.culled);
+            stats.culled += countGeometries(n);
+            return;
+        }
+    }
+
+    if (Transform* t = dynamic_cast<Transform*>(n->getCore())) m.mult( toMatrix4d(t->getMatrix()) );
+    for (unsigned int i=0; i<n->getNChildren(); i++) traverse(n->getChild(i), m);
+}
+
+void VROcclusionCuller::cull(const Matrix4d& viewProjection) {
+    showAll();
+    auto r = root.lock();
+    if (!r || !r->getNode() || !r->getNode()->node) return;
+    stats = Stats();
+    VP = viewProjection;
+
+    VRTimer timer;
+    depth.resize(1);
+    depth[0].assign(width*height, 1.f);
+    occluderNodes.clear();
+    occluderCores.clear();
+    for (auto& o : occluders) {
+        auto g = o.geo.lock();
+        if (!g || !g->isVisible()) continue;
+        stats.occluders++;
+        occluderNodes[g->getNode()->node] = true;
+        if (g->getMesh()) occluderCores[g->getMesh()->geo] = true; // the mesh node below
+        const vector<float>& T = o.triangles;
+        for (size_t i=0; i+9<=T.size(); i+=9) {
+            float c[3][4];
+            for (int j=0; j<3; j++) {
+                const float* p = &T[i+j*3];
+                for (int k=0; k<4; k++) c[j][k] = VP[0][k]*p[0] + VP[1][k]*p[1] + VP[2][k]*p[2] + VP[3][k];
+            }
+            rasterize(c[0], c[1], c[2]);
+            stats.triangles++;
+        }
+    }
+    buildPyramid();
+    stats.raster = timer.stop();
+
+    timer.reset();
+    Node* node = r->getNode()->node;
+    node->updateVolume();
+    Matrix4d m;
+    if (Node* parent = node->getParent()) m = toMatrix4d(parent->getToWorld());
+    traverse(node, m);
+    stats.test = timer.stop();
+}
+
+void VROcclusionCuller::showAll() {
+    for (auto& h : hidden) {
+        if (h.second.node->getTravMask() == h.second.culled) h.second.node->setTravMask(h.second.travMask); // else changed since
+    }
+    hidden.clear();
+}
+
+void VROcclusionCuller::reset() { showAll(); }
+
+bool VROcclusionCuller::isCulled(VRObjectPtr obj) {
+    for (; obj; obj = obj->getParent()) {
+        if (obj->getNode() && hidden.count(obj->getNode()->node)) return true;
+    }
+    return false;
+}
+
+VROcclusionCuller::Stats VROcclusionCuller::getLastStats() { return stats; }
+
+map<string, double> VROcclusionCuller::getStats() {
+    map<string, double> res;
+    res["occluders"] = stats.occluders;
+    res["triangles"] = stats.triangles;
+    res["tested"] = stats.tested;
+    res["culled"] = stats.culled;
+    res["hidden"] = hidden.size();
+    res["raster"] = stats.raster;
+    res["test"] = stats.test;
+    return res;
+}
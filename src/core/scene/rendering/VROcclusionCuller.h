@@ -0,0 +1,108 @@
+#ifndef VROCCLUSIONCULLER_H_INCLUDED
+#define VROCCLUSIONCULLER_H_INCLUDED
+
+#include <OpenSG/OSGConfig.h>
+#include <OpenSG/OSGMatrix.h>
+#include <OpenSG/OSGNode.h>
+#include "core/objects/VRObjectFwd.h"
+#include "core/scene/VRSceneFwd.h"
+#include "core/utils/VRFunctionFwd.h"
+
+#include <map>
+#include <vector>
+#include <string>
+
+OSG_BEGIN_NAMESPACE;
+using namespace std;
+
+class BoxVolume;
+
+/**
+ * CPU occlusion culling for dense static scenes, like factory halls or generated cities.
+ * The largest opaque geometries are chosen as occluders and rasterized into a low resolution depth buffer.
+ * A max depth pyramid of that buffer is tested against the node volumes of the subtree, VRLodTree cells included.
+ * Hidden subtrees get the culledMask as traversal mask, which the views leave out, until a later update finds them visible again.
+ * They keep the picking and shadow bits, the intersect action and the shadow maps are not culled.
+ * Their masks are only restored if nobody changed them in the meantime, like VRObject::setVisible or the VRSceneOptimizer.
+ * The camera is the only one rendering the scene, culling is refused with several views, stereo or distributed windows.
+ */
+class VROcclusionCuller : public std::enable_shared_from_this<VROcclusionCuller> {
+    public:
+        static const unsigned int culledMask = 1u << 30;
+        static const unsigned int keptMask = 8 | 16; // intersect action and shadow maps
+        static const unsigned int viewMask = ~(culledMask | keptMask); // traversal mask of the viewports
+
+        struct Stats {
+            size_t occluders = 0;
+            size_t triangles = 0;
+            size_t tested = 0;
+            size_t culled = 0; // geometries in hidden subtrees
+            double raster = 0; // ms
+            double test = 0; // ms
+        };
+
+    private:
+        struct Occluder {
+            VRGeometryWeakPtr geo;
+            vector<float> triangles; // world space, nine floats per triangle
+        };
+
+        struct Hidden {
+            NodeMTRecPtr node; // kept alive, the object may be deleted while culled
+            unsigned int travMask = 0;
+            unsigned int culled = 0; // the mask set by the culler
+        };
+
+        VRObjectWeakPtr root;
+        vector<Occluder> occluders;
+        map<Node*, Hidden> hidden; // culled nodes and their traversal masks
+        map<Node*, bool> occluderNodes; // not tested against their own raster
+        map<NodeCore*, bool> occluderCores;
+        VRUpdateCbPtr updateCb;
+        Stats stats;
+
+        int width = 256; // multiple of four
+        int height = 128;
+        int maxOccluders = 64;
+        int maxOccluderTriangles = 1<<14;
+        double minOccluderSize = 5;
+        float depthBias = 1e-5; // NDC, volumes have to be clearly behind the raster
+
+        Matrix4d VP; // view projection
+        vector<vector<float>> depth; // max depth pyramid in NDC, level 0 is the raster
+        vector<pair<int, int>> levels;
+
+        void rasterize(const float* a, const float* b, const float* c);
+        void rasterizeScreen(const float* a, const float* b, const float* c);
+        void buildPyramid();
+        bool isOccluded(const BoxVolume& v, const Matrix4d& m);
+        bool hasSingleView();
+        void traverse(Node* n, Matrix4d m);
+        size_t countGeometries(Node* n);
+        void showAll();
+
+    public:
+        VROcclusionCuller();
+        ~VROcclusionCuller();
+
+        static VROcclusionCullerPtr create();
+        VROcclusionCullerPtr ptr();
+
+        void setResolution(int w, int h);
+        void setOccluderLimits(int N, int Ntriangles, double minSize);
+
+        void setRoot(VRObjectPtr root);
+        void updateOccluders();
+        void setActive(bool b);
+        void update(VRCameraPtr cam = 0);
+        void cull(const Matrix4d& viewProjection);
+        void reset();
+
+        bool isCulled(VRObjectPtr obj);
+        Stats getLastStats();
+        map<string, double> getStats();
+};
+
+OSG_END_NAMESPACE;
+
+#endif // VROCCLUSIONCULLER_H_INCLUDED
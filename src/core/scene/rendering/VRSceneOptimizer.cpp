@@ -0,0 +1,316 @@
+#include "VRSceneOptimizer.h"
+#include "core/objects/OSGObject.h"
+#include "core/objects/geometry/VRGeometry.h"
+#include "core/objects/geometry/OSGGeometry.h"
+#include "core/objects/geometry/VRGeoData.h"
+#include "core/objects/material/VRMaterial.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <OpenSG/OSGNode.h>
+#include <OpenSG/OSGGeometry.h>
+#include <OpenSG/OSGTransform.h>
+#include <tuple>
+#include <cstring>
+
+using namespace OSG;
+
+map<VRObject*, pair<VRSceneOptimizer*, int>> batchChunks; // chunk geometries and their ID buffers
+map<VRObject*, pair<VRSceneOptimizer*, int>> batchOriginals;
+
+VRSceneOptimizer::VRSceneOptimizer() {}
+
+VRSceneOptimizer::~VRSceneOptimizer() { // the chunks stay in the scene, only the lookup is removed
+    for (auto& c : chunks) batchChunks.erase(c.geo.get());
+    for (auto& b : batched) if (auto g = b.geo.lock()) batchOriginals.erase(g.get());
+}
+
+VRSceneOptimizerPtr VRSceneOptimizer::create() { return VRSceneOptimizerPtr( new VRSceneOptimizer() ); }
+VRSceneOptimizerPtr VRSceneOptimizer::ptr() { return shared_from_this(); }
+
+void VRSceneOptimizer::setChunkSize(double s) { chunkSize = s; }
+void VRSceneOptimizer::setMaxChunkVertices(int N) { maxChunkVertices = N; }
+void VRSceneOptimizer::setInstancing(int minI, int minV) { minInstances = minI; minInstanceVertices = minV; }
+
+size_t meshHash(Geometry* geo) { // over every set property, equal hashes are confirmed with sameMesh
+    size_t h = 14695981039346656037ull;
+    auto hash = [&](size_t v) { h = (h ^ v) * 1099511628211ull; };
+    auto hashFloat = [&](float f) { uint32_t v; memcpy(&v, &f, 4); hash(v); };
+    auto hashIntegral = [&](GeoIntegralProperty* p) {
+        hash(p ? p->size() : 0);
+        if (p) for (unsigned int j=0; j<p->size(); j++) hash(p->getValue(j));
+    };
+
+    for (int i=0; i<16; i++) {
+        GeoVectorProperty* p = geo->getProperty(i);
+        if (!p) continue;
+        hash(i);
+        hash(p->size());
+        for (unsigned int j=0; j<p->size(); j++) {
+            Vec4f v = p->getValue<Vec4f>(j);
+            for (int k=0; k<4; k++) hashFloat(v[k]);
+        }
+        hashIntegral(geo->getIndex(i));
+    }
+
+    hashIntegral(geo->getTypes());
+    hashIntegral(geo->getLengths());
+    return h;
+}
+
+bool sameMesh(Geometry* a, Geometry* b) {
+    if (a == b) return true;
+    auto sameIntegral = [](GeoIntegralProperty* p, GeoIntegralProperty* q) {
+        if (p == q) return true;
+        if (!p || !q || p->size() != q->size()) return false;
+        for (unsigned int j=0; j<p->size(); j++) if (p->getValue(j) != q->getValue(j)) return false;
+        return true;
+    };
+
+    if (!sameIntegral(a->getTypes(), b->getTypes())) return false;
+    if (!sameIntegral(a->getLengths(), b->getLengths())) return false;
+    for (int i=0; i<16; i++) {
+        GeoVectorProperty* p = a->getProperty(i);
+        GeoVectorProperty* q = b->getProperty(i);
+        if (!sameIntegral(a->getIndex(i), b->getIndex(i))) return false;
+        if (p == q) continue;
+        if (!p || !q || p->size() != q->size()) return false;
+        for (unsigned int j=0; j<p->size(); j++) if (p->getValue<Vec4f>(j) != q->getValue<Vec4f>(j)) return false;
+    }
+    return true;
+}
+
+size_t vertexFormat(Geometry* geo) { // geometries are only merged with the same attributes
+    size_t f = 0;
+    for (int i=0; i<16; i++) {
+        GeoVectorProperty* p = geo->getProperty(i);
+        if (p && p->size()) f |= size_t(1) << i;
+    }
+    return f;
+}
+
+/** Repeated meshes share the core of the first, and with it its VBOs.
+    This is no hardware instancing, each instance is still drawn on its own. **/
+void VRSceneOptimizer::instantiate(vector<VRGeometryPtr>& geos) {
+    map<pair<VRMaterial*, size_t>, vector<vector<int>>> candidates; // meshes with equal hashes, split by their data
+    for (size_t i=0; i<geos.size(); i++) {
+        Geometry* geo = geos[i]->getMesh()->geo;
+        if (int(geo->getPositions()->size()) < minInstanceVertices) continue;
+        auto& groups = candidates[make_pair(geos[i]->getMaterial().get(), meshHash(geo))];
+        bool found = false;
+        for (auto& group : groups) {
+            if (!sameMesh(geos[group[0]]->getMesh()->geo, geo)) continue;
+            group.push_back(i);
+            found = true;
+            break;
+        }
+        if (!found) groups.push_back( vector<int>(1, i) );
+    }
+
+    vector<vector<int>> repeated;
+    for (auto& c : candidates) for (auto& group : c.second) repeated.push_back(group);
+
+    vector<bool> shared(geos.size(), false);
+    for (auto& r : repeated) {
+        if (int(r.size()) < minInstances) continue;
+        auto proto = geos[r[0]];
+        for (int i : r) {
+            shared[i] = true;
+            auto g = geos[i];
+            if (g == proto || g->getMesh() == proto->getMesh()) continue;
+            Instanced inst;
+            inst.geo = g;
+            inst.proto = proto;
+            inst.mesh = g->getMesh();
+            inst.refType = g->getReference().type;
+            inst.refParameter = g->getReference().parameter;
+            instanced.push_back(inst);
+            g->setMesh(proto->getMesh(), proto->getReference());
+        }
+    }
+
+    vector<VRGeometryPtr> rest;
+    for (size_t i=0; i<geos.size(); i++) if (!shared[i]) rest.push_back(geos[i]);
+    geos = rest;
+}
+
+void VRSceneOptimizer::batch(VRObjectPtr root, vector<VRGeometryPtr>& geos) {
+    vector<Matrix4d> matrices;
+    Vec3d pMin(1e30, 1e30, 1e30), pMax(-1e30, -1e30, -1e30);
+    for (auto& g : geos) {
+        matrices.push_back( root->getMatrixTo(g) );
+        Vec3d p = Vec3d(matrices.back()[3]);
+        for (int k=0; k<3; k++) { pMin[k] = min(pMin[k], p[k]); pMax[k] = max(pMax[k], p[k]); }
+    }
+
+    double S = chunkSize;
+    if (S <= 0) {
+        Vec3d D = pMax - pMin;
+        S = max(max(D[0], D[1]), D[2]) / 8.0;
+    }
+    if (S <= 1e-6) S = 1;
+
+    typedef tuple<VRMaterial*, size_t, int, int, int> Cell;
+    map<Cell, vector<int>> cells;
+    for (size_t i=0; i<geos.size(); i++) {
+        Vec3d p = Vec3d(matrices[i][3]) - pMin;
+        Cell c( geos[i]->getMaterial().get(), vertexFormat(geos[i]->getMesh()->geo), int(p[0]/S), int(p[1]/S), int(p[2]/S) );
+        cells[c].push_back(i);
+    }
+
+    for (auto& cell : cells) {
+        if (cell.second.size() < 2) continue;
+        auto mat = geos[cell.second[0]]->getMaterial();
+
+        VRGeoData data;
+        Chunk chunk;
+        auto flush = [&]() {
+            if (data.size() == 0) return;
+            chunk.geo = data.asGeometry("batch");
+            chunk.geo->setMaterial(mat);
+            chunk.geo->setPersistency(0);
+            root->addChild(chunk.geo);
+            batchChunks[chunk.geo.get()] = make_pair(this, int(chunks.size()));
+            chunks.push_back(chunk);
+            chunk = Chunk();
+            data = VRGeoData();
+        };
+
+        for (int i : cell.second) {
+            VRGeoData d(geos[i]);
+            if (data.size() > 0 && data.size() + d.size() > maxChunkVertices) flush();
+            data.append(d, matrices[i]);
+            chunk.objectIDs.resize(data.size(), batched.size());
+
+            Batched b;
+            b.geo = geos[i];
+            b.travMask = geos[i]->getNode()->node->getTravMask();
+            geos[i]->getNode()->node->setTravMask(0); // not stored, visibleMask is left untouched
+            batchOriginals[geos[i].get()] = make_pair(this, int(batched.size()));
+            batched.push_back(b);
+        }
+        flush();
+    }
+}
+
+bool isStatic(VRObjectPtr obj, VRObjectPtr root) { // the merged copies would not follow changes above the object
+    for (auto o = obj; o && o != root; o = o->getParent()) {
+        if (o->hasTag("dynamic")) return false;
+        auto t = dynamic_pointer_cast<VRTransform>(o);
+        if (!t) continue;
+        if (t->isDragged() || t->isConstrained() || t->getAnimations().size() > 0) return false;
+#ifndef WITHOUT_BULLET
+        if (t->hasDynamicPhysics()) return false;
+#endif
+    }
+    return true;
+}
+
+void VRSceneOptimizer::optimize(VRObjectPtr r) {
+    restore();
+    if (!r) return;
+    root = r;
+    before = measure(r);
+
+    vector<VRGeometryPtr> geos;
+    for (auto obj : r->getChildren(true, "Geometry")) {
+        auto g = dynamic_pointer_cast<VRGeometry>(obj);
+        if (!g || g->getType() != "Geometry" || !isStatic(g, r)) continue;
+        if (!g->isVisible() || g->getChildrenCount() > 0 || !g->getMaterial()) continue;
+        if (!g->getMesh() || !g->getMesh()->geo || !g->getMesh()->geo->getPositions()) continue;
+        geos.push_back(g);
+    }
+
+    instantiate(geos);
+    batch(r, geos);
+    after = measure(r);
+}
+
+void VRSceneOptimizer::restore() {
+    for (auto& c : chunks) {
+        batchChunks.erase(c.geo.get());
+        c.geo->destroy();
+    }
+
+    for (auto& b : batched) {
+        auto g = b.geo.lock();
+        if (!g) continue;
+        batchOriginals.erase(g.get());
+        g->getNode()->node->setTravMask(b.travMask);
+    }
+
+    map<VRGeometry*, VRGeometryPtr> protos;
+    for (auto& i : instanced) {
+        auto g = i.geo.lock();
+        if (!g) continue;
+        auto p = i.proto.lock();
+        if (p) protos[p.get()] = p;
+        if (p && g->getMesh() != p->getMesh()) continue; // replaced since
+        g->setMesh(i.mesh, VRGeometry::Reference(i.refType, i.refParameter));
+    }
+    for (auto p : protos) p.second->setMesh(p.second->getMesh(), p.second->getReference()); // the shared core points back to its prototype
+
+    chunks.clear();
+    batched.clear();
+    instanced.clear();
+}
+
+map<string, double> VRSceneOptimizer::getStats() {
+    map<string, double> res;
+    res["nodesBefore"] = before.nodes;
+    res["nodesAfter"] = after.nodes;
+    res["drawsBefore"] = before.draws;
+    res["drawsAfter"] = after.draws;
+    res["traversalBefore"] = before.traversal;
+    res["traversalAfter"] = after.traversal;
+    res["batched"] = batched.size();
+    res["chunks"] = chunks.size();
+    res["instanced"] = instanced.size();
+    return res;
+}
+
+VRSceneOptimizer::Stats VRSceneOptimizer::measure(VRObjectPtr root) { // walks the visible nodes like the cull traversal
+    Stats s;
+    if (!root || !root->getNode() || !root->getNode()->node) return s;
+
+    function<void(Node*, Matrix4d)> walk = [&](Node* n, Matrix4d m) {
+        if (!n || n->getTravMask() == 0) return;
+        s.nodes++;
+        NodeCore* core = n->getCore();
+        if (Transform* t = dynamic_cast<Transform*>(core)) m.mult( toMatrix4d(t->getMatrix()) );
+        if (dynamic_cast<Geometry*>(core)) s.draws++;
+        BoxVolume v = n->getVolume();
+        v.transform( toMatrix4f(m) );
+        for (unsigned int i=0; i<n->getNChildren(); i++) walk(n->getChild(i), m);
+    };
+
+    int Nruns = 10;
+    Node* node = root->getNode()->node;
+    node->updateVolume();
+    VRTimer t;
+    for (int i=0; i<Nruns; i++) {
+        s.nodes = s.draws = 0;
+        walk(node, Matrix4d());
+    }
+    s.traversal = t.stop() / Nruns;
+    return s;
+}
+
+VRObjectPtr VRSceneOptimizer::getBatchedObject(VRObjectPtr chunk, int vertex) {
+    if (!chunk) return 0;
+    auto it = batchChunks.find(chunk.get());
+    if (it == batchChunks.end()) return 0;
+    auto& c = it->second.first->chunks[it->second.second];
+    if (vertex < 0 || vertex >= int(c.objectIDs.size())) return 0;
+    return it->second.first->batched[ c.objectIDs[vertex] ].geo.lock();
+}
+
+bool VRSceneOptimizer::isBatched(VRObjectPtr obj) { return obj && batchOriginals.count(obj.get()); }
+
+void VRSceneOptimizer::showBatched(VRObjectPtr obj, bool b) { // drawn over its chunk, for highlighting
+    if (!obj) return;
+    auto it = batchOriginals.find(obj.get());
+    if (it == batchOriginals.end()) return;
+    auto& o = it->second.first->batched[it->second.second];
+    obj->getNode()->node->setTravMask(b ? o.travMask : 0);
+}
@@ -0,0 +1,89 @@
+#ifndef VRSCENEOPTIMIZER_H_INCLUDED
+#define VRSCENEOPTIMIZER_H_INCLUDED
+
+#include <OpenSG/OSGConfig.h>
+#include "core/objects/VRObjectFwd.h"
+#include "core/scene/VRSceneFwd.h"
+
+#include <map>
+#include <vector>
+#include <string>
+
+OSG_BEGIN_NAMESPACE;
+using namespace std;
+
+/**
+ * Optional optimisation pass for static subtrees, like imported CAD, IFC or OSM scenes.
+ * Repeated meshes above a size threshold share one geometry core, their VBOs are uploaded once.
+ * This is no hardware instancing, the draw calls stay the same, only memory and uploads are saved.
+ * The other static geometries are merged per material and vertex format into chunks on a spatial grid.
+ * Objects tagged dynamic or below a dragged, constrained, animated or dynamic physics transform are left as they are.
+ * The merged originals are kept hidden, an ID buffer maps the chunk vertices back to them,
+ * ray intersections return the original objects and the selector shows them while highlighted.
+ */
+class VRSceneOptimizer : public std::enable_shared_from_this<VRSceneOptimizer> {
+    public:
+        struct Stats {
+            size_t nodes = 0;
+            size_t draws = 0;
+            double traversal = 0; // ms
+        };
+
+    private:
+        struct Chunk {
+            VRGeometryPtr geo;
+            vector<int> objectIDs; // per vertex, index into batched
+        };
+
+        struct Instanced {
+            VRGeometryWeakPtr geo;
+            VRGeometryWeakPtr proto;
+            OSGGeometryPtr mesh; // the original mesh and its reference
+            int refType = 0;
+            string refParameter;
+        };
+
+        struct Batched {
+            VRGeometryWeakPtr geo;
+            unsigned int travMask = 0;
+        };
+
+        VRObjectWeakPtr root;
+        vector<Chunk> chunks;
+        vector<Batched> batched;
+        vector<Instanced> instanced;
+        Stats before;
+        Stats after;
+
+        double chunkSize = 0; // 0 for an eighth of the subtree extent
+        int maxChunkVertices = 1<<20;
+        int minInstances = 4;
+        int minInstanceVertices = 256;
+
+        void instantiate(vector<VRGeometryPtr>& geos);
+        void batch(VRObjectPtr root, vector<VRGeometryPtr>& geos);
+
+    public:
+        VRSceneOptimizer();
+        ~VRSceneOptimizer();
+
+        static VRSceneOptimizerPtr create();
+        VRSceneOptimizerPtr ptr();
+
+        void setChunkSize(double s);
+        void setMaxChunkVertices(int N);
+        void setInstancing(int minInstances, int minVertices);
+
+        void optimize(VRObjectPtr root);
+        void restore();
+        map<string, double> getStats();
+
+        static Stats measure(VRObjectPtr root);
+        static VRObjectPtr getBatchedObject(VRObjectPtr chunk, int vertex);
+        static bool isBatched(VRObjectPtr obj);
+        static void showBatched(VRObjectPtr obj, bool b);
+};
+
+OSG_END_NAMESPACE;
+
+#endif // VRSCENEOPTIMIZER_H_INCLUDED
@@ -123,6 +123,7 @@ PyMethodDef VRPyGeometry::methods[] = {
     {"remColors", PyWrapOpt( Geometry, remColors, "Removes color data", "0", void, bool ) },
     {"makeSingleIndex", PyWrap( Geometry, makeSingleIndex, "Make geometry single index", void ) },
     {"intersectEdges", PyWrap( Geometry, intersectEdges, "Intersect the geometry with a ray to get edges", vector<int>, Line, double ) },
+    {"updateBVH", PyWrapOpt( Geometry, updateBVH, "Refit the ray intersection BVH after changing mesh data in place, or rebuild it", "0", void, bool ) },
     {NULL}  /* Sentinel */
 };
 
@@ -26,6 +26,8 @@ PyMethodDef VRPyVideo::methods[] = {
     {"showFrame", PyWrap(Video, showFrame, "Show a specific frame of a stream (stream, frame)", void, int, int ) },
     {"getDuration", PyWrap(Video, getDuration, "Get total duration", float ) },
     {"goTo", PyWrap(Video, goTo, "Go to position t [0.0, 1.0]", void, float ) },
+    {"setCacheSize", PyWrapOpt(Video, setCacheSize, "Set the number of cached frames and the memory limit in MB per stream (frames, megabytes)", "256", void, int, int ) },
+    {"setDecoderThreads", PyWrap(Video, setDecoderThreads, "Set the decoding threads per stream, 0 is automatic, applies to the next opened file", void, int ) },
     {NULL}  /* Sentinel */
 };
 #endif
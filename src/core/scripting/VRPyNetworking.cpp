@@ -153,10 +153,19 @@ PyMethodDef VRPyUDPClient::methods[] = {
     {NULL}  /* Sentinel */
 };
 
+typedef map<string, double> mapSD;
+typedef function<void(const vector<VRUDPPacket>&)> packetsCb;
+
 PyMethodDef VRPyUDPServer::methods[] = {
     {"listen", PyWrapOpt(UDPServer, listen, "Listen on port", "", void, int) },
     {"close", PyWrap(UDPServer, close, "Close server", void) },
     {"onMessage", PyWrapOpt(UDPServer, onMessage, "Set onMessage callback", "0", void, function<string(string)>, bool) },
+    {"listenBatched", PyWrapOpt(UDPServer, listenBatched, "Listen on port, receive in batches into a packet ring drained once per frame, (port, ringSize, slotSize)", "4096|2048", void, int, int, int) },
+    {"onPackets", PyWrap(UDPServer, onPackets, "Set batched mode callback, called once per frame with a list of [payload, sender], callback signature: cb(packets)", void, packetsCb) },
+    {"update", PyWrap(UDPServer, update, "Drain the packet ring of the batched mode, done once per frame, only needed without a running scene manager", void) },
+    {"setCoalescing", PyWrap(UDPServer, setCoalescing, "In batched mode only pass the latest packet per source and frame", void, bool) },
+    {"setStamped", PyWrap(UDPServer, setStamped, "Packets start with a sequence and time stamp header, see stamp, used for loss, jitter and latency", void, bool) },
+    {"getStats", PyWrap(UDPServer, getStats, "Get packet loss, jitter and latency statistics of the batched mode", mapSD) },
     {NULL}  /* Sentinel */
 };
 
@@ -169,11 +178,19 @@ PyMethodDef VRPyTCPClient::methods[] = {
 };
 
 typedef function<string(string, size_t)> serverCb;
+typedef function<void(const VRTCPFrame&, size_t)> frameCb;
 
 PyMethodDef VRPyTCPServer::methods[] = {
     {"listen", PyWrapOpt(TCPServer, listen, "Listen on port", "", void, int, string) },
+    {"listenFramed", PyWrap(TCPServer, listenFramed, "Listen on port, messages are framed by a 4 byte little endian length prefix", void, int) },
+    {"setThreads", PyWrap(TCPServer, setThreads, "Set number of io threads, call before listen", void, int) },
+    {"setMaxQueue", PyWrap(TCPServer, setMaxQueue, "Set max outgoing bytes queued per session before reading is paused, framed mode only", void, size_t) },
     {"close", PyWrap(TCPServer, close, "Close server", void) },
     {"onMessage", PyWrap(TCPServer, onMessage, "Set onMessage callback, callback signature:  cb(msg, uID)", void, serverCb) },
+    {"onFrame", PyWrap(TCPServer, onFrame, "Set framed mode callback, called on the io threads, callback signature: cb(msg, uID)", void, frameCb) },
+    {"send", PyWrap(TCPServer, send, "Send framed message to session, returns False if dropped, (uID, msg)", bool, size_t, const string&) },
+    {"broadcast", PyWrap(TCPServer, broadcast, "Send framed message to all sessions", void, const string&) },
+    {"getStats", PyWrap(TCPServer, getStats, "Get connection and throughput statistics", mapSD) },
     {NULL}  /* Sentinel */
 };
 
@@ -231,6 +248,26 @@ template<> bool toValue(PyObject* o, function<void(string)>& e) {
     return 1;
 }
 
+template<> bool toValue(PyObject* o, function<void(const VRTCPFrame&, size_t)>& e) {
+    //if (!VRPyEntity::check(o)) return 0; // TODO: add checks!
+    Py_IncRef(o);
+	PyObject* args = PyTuple_New(2);
+    e = [o, args](const VRTCPFrame& frame, size_t uID) { VRPyBase::execPyCall2<string, size_t, string>(o, args, frame.str(), uID); }; // the frame data is only valid during the callback
+    return 1;
+}
+
+template<> bool toValue(PyObject* o, function<void(const vector<VRUDPPacket>&)>& e) {
+    //if (!VRPyEntity::check(o)) return 0; // TODO: add checks!
+    Py_IncRef(o);
+	PyObject* args = PyTuple_New(1);
+    e = [o, args](const vector<VRUDPPacket>& packets) { // copied, the packets are only valid during the callback
+        vector<vector<string>> data;
+        for (auto& p : packets) data.push_back({ string(p.data, p.size), VRUDPServer::getSourceName(p.source) });
+        VRPyBase::execPyCallVoid<vector<vector<string>>>(o, args, data);
+    };
+    return 1;
+}
+
 template<> bool toValue(PyObject* o, function<void(void)>& e) {
     //if (!VRPyEntity::check(o)) return 0; // TODO: add checks!
     Py_IncRef(o);
@@ -242,10 +279,14 @@ template<> bool toValue(PyObject* o, function<void(void)>& e) {
 template<> int toValue(stringstream& ss, function<string(string, size_t)>& e) { return 0; }
 template<> int toValue(stringstream& ss, function<string(string)>& e) { return 0; }
 template<> int toValue(stringstream& ss, function<void(string)>& e) { return 0; }
+template<> int toValue(stringstream& ss, function<void(const VRTCPFrame&, size_t)>& e) { return 0; }
+template<> int toValue(stringstream& ss, function<void(const vector<VRUDPPacket>&)>& e) { return 0; }
 template<> int toValue(stringstream& ss, function<void(void)>& e) { return 0; }
 
 template<> string typeName(const function<string(string, size_t)>* t) { return "string function(string, int)"; }
 template<> string typeName(const function<string(string)>* t) { return "string function(string)"; }
 template<> string typeName(const function<void(string)>* t) { return "void function(string)"; }
+template<> string typeName(const function<void(const VRTCPFrame&, size_t)>* t) { return "void function(string, int)"; }
+template<> string typeName(const function<void(const vector<VRUDPPacket>&)>* t) { return "void function(list of [payload, sender])"; }
 template<> string typeName(const function<void(void)>* t) { return "void function()"; }
 #endif
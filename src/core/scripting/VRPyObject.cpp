@@ -111,6 +111,7 @@ PyMethodDef VRPyObject::methods[] = {
     {"getTagValue", PyWrap(Object, getAttachmentAsString, "Return tag value", string, string) },
     {"hasAncestorWithTag", PyWrap(Object, hasAncestorWithTag, "Check if the object or an ancestor has a tag - obj hasAncestorWithTag( str tag )", VRObjectPtr, string) },
     {"getChildrenWithTag", PyWrapOpt(Object, getChildrenWithTag, "Get all children which have the tag (tag, recursive, includeSelf)", "0|0", vector<VRObjectPtr>, string, bool, bool) },
+    {"traverse", PyWrapOpt(Object, traverse, "Call the function for every object below, optionally only for a type (callback, type, includeSelf)", "|1", void, VRObjectCbPtr, string, bool) },
     {"setVolumeCheck", PyWrapOpt(Object, setVolumeCheck, "Enables or disabled the dynamic volume computation of that node - setVolumeCheck( bool )", "0", void, bool, bool) },
     {"setTravMask", PyWrap(Object, setTravMask, "Set the traversal mask of the object", void, int) },
     {"getTravMask", PyWrap(Object, getTravMask, "Get the traversal mask of the object", int) },
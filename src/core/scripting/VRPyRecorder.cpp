@@ -8,6 +8,8 @@ using namespace OSG;
 
 simpleVRPyType(Recorder, New_ptr);
 
+typedef map<string, double> mapSD;
+
 PyMethodDef VRPyRecorder::methods[] = {
     {"capture", (PyCFunction)VRPyRecorder::capture, METH_NOARGS, "Capture the current view as an image - capture()" },
     {"compile", (PyCFunction)VRPyRecorder::compile, METH_VARARGS, "Compile the recorded frames to a video file on disk - compile(string path)" },
@@ -17,12 +19,15 @@ PyMethodDef VRPyRecorder::methods[] = {
     {"getRecordingLength", (PyCFunction)VRPyRecorder::getRecordingLength, METH_NOARGS, "Get the length in seconds fromt he first to last of the captured frames - float getRecordingLength()" },
     {"setMaxFrames", (PyCFunction)VRPyRecorder::setMaxFrames, METH_VARARGS, "Set the maximum number of frames" },
     {"frameLimitReached", (PyCFunction)VRPyRecorder::frameLimitReached, METH_NOARGS, "Check if the frame limit has been reached" },
-    {"get", (PyCFunction)VRPyRecorder::get, METH_VARARGS, "Get capture i - get(int i)" },
+    {"get", (PyCFunction)VRPyRecorder::get, METH_VARARGS, "Get the image of the last capture, None for older frames, they are streamed to the video file - get(int i)" },
     {"setTransform", (PyCFunction)VRPyRecorder::setTransform, METH_VARARGS, "Apply the transform of the camera pose of frame i - setTransform(transform t, int i)" },
     {"getFrom", (PyCFunction)VRPyRecorder::getFrom, METH_VARARGS, "Get the position of the camera pose of frame i - getFrom(int i)" },
     {"getDir", (PyCFunction)VRPyRecorder::getDir, METH_VARARGS, "Get the direction of the camera pose of frame i - getDir(int i)" },
     {"getAt", (PyCFunction)VRPyRecorder::getAt, METH_VARARGS, "Get the at vector of the camera pose of frame i - getAt(int i)" },
     {"getUp", (PyCFunction)VRPyRecorder::getUp, METH_VARARGS, "Get the up vector of the camera pose of frame i - getUp(int i)" },
+    {"setOutput", PyWrap(Recorder, setOutput, "Set the video file the frames are streamed to while recording", void, string) },
+    {"setBufferSize", PyWrap(Recorder, setBufferSize, "Set the number of frame buffers, frames are dropped when all are in use", void, int) },
+    {"getStats", PyWrap(Recorder, getStats, "Get captured, dropped and encoded frames, achieved fps and encoder lag in ms", mapSD) },
     {NULL}  /* Sentinel */
 };
 
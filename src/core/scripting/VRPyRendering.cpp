@@ -8,6 +8,10 @@ using namespace OSG;
 
 simpleVRPyType(Rendering, 0);
 simpleVRPyType(RenderStudio, 0);
+simpleVRPyType(SceneOptimizer, New_ptr);
+simpleVRPyType(OcclusionCuller, New_ptr);
+
+typedef map<string, double> mapSD;
 
 PyMethodDef VRPyRendering::methods[] = {
     {"addStage", PyWrap(Rendering, addStage, "Add a stage to the rendering pipeline - addStage( str name, str insert_point )\n\ta common insertion point is the 'shading' stage", void, string, string ) },
@@ -28,3 +32,24 @@ PyMethodDef VRPyRenderStudio::methods[] = {
     {"getRoot", PyWrap(RenderStudio, getRoot, "Get root object", VRObjectPtr ) },
     {NULL}  /* Sentinel */
 };
+
+PyMethodDef VRPySceneOptimizer::methods[] = {
+    {"optimize", PyWrap(SceneOptimizer, optimize, "Merge the static geometries of a subtree into chunks and share repeated meshes - optimize( root )\n\tobjects tagged 'dynamic' are left alone", void, VRObjectPtr ) },
+    {"restore", PyWrap(SceneOptimizer, restore, "Remove the chunks and show the merged objects again", void ) },
+    {"setChunkSize", PyWrap(SceneOptimizer, setChunkSize, "Set the size of the grid cells geometries are merged in, 0 for an eighth of the subtree extent", void, double ) },
+    {"setMaxChunkVertices", PyWrap(SceneOptimizer, setMaxChunkVertices, "Set the maximum number of vertices per chunk", void, int ) },
+    {"setInstancing", PyWrap(SceneOptimizer, setInstancing, "Set the minimum number of repetitions and vertices for meshes to be shared - setInstancing( int N, int Nvertices )", void, int, int ) },
+    {"getStats", PyWrap(SceneOptimizer, getStats, "Get node count, draw count and traversal time in ms before and after optimizing", mapSD ) },
+    {NULL}  /* Sentinel */
+};
+
+PyMethodDef VRPyOcclusionCuller::methods[] = {
+    {"setRoot", PyWrap(OcclusionCuller, setRoot, "Set the subtree to cull and pick its occluders - setRoot( root )\n\tobjects tagged 'dynamic' are not used as occluders", void, VRObjectPtr ) },
+    {"updateOccluders", PyWrap(OcclusionCuller, updateOccluders, "Pick the occluders again, after the static scene changed", void ) },
+    {"setActive", PyWrap(OcclusionCuller, setActive, "Cull against the active camera each frame", void, bool ) },
+    {"setResolution", PyWrap(OcclusionCuller, setResolution, "Set the size of the depth buffer - setResolution( int width, int height )", void, int, int ) },
+    {"setOccluderLimits", PyWrap(OcclusionCuller, setOccluderLimits, "Set the maximum occluder count and triangles per occluder and the minimum occluder size - setOccluderLimits( int N, int Ntriangles, float size )", void, int, int, double ) },
+    {"reset", PyWrap(OcclusionCuller, reset, "Show all culled objects again", void ) },
+    {"getStats", PyWrap(OcclusionCuller, getStats, "Get occluder, triangle, tested and culled counts and the raster and test time in ms of the last update", mapSD ) },
+    {NULL}  /* Sentinel */
+};
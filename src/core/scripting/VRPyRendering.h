@@ -4,6 +4,8 @@
 #include "VRPyObject.h"
 #include "core/scene/rendering/VRRenderStudio.h"
 #include "core/scene/rendering/VRRenderManager.h"
+#include "core/scene/rendering/VRSceneOptimizer.h"
+#include "core/scene/rendering/VROcclusionCuller.h"
 
 namespace OSG {
     typedef VRRenderManager VRRendering;
@@ -18,4 +20,12 @@ struct VRPyRendering : VRPyBaseT<OSG::VRRendering> {
     static PyMethodDef methods[];
 };
 
+struct VRPySceneOptimizer : VRPyBaseT<OSG::VRSceneOptimizer> {
+    static PyMethodDef methods[];
+};
+
+struct VRPyOcclusionCuller : VRPyBaseT<OSG::VROcclusionCuller> {
+    static PyMethodDef methods[];
+};
+
 #endif // VRPYRENDERING_H_INCLUDED
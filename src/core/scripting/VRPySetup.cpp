@@ -22,8 +22,14 @@ PyMethodDef VRPyViewManager::methods[] = {
     {NULL}  /* Sentinel */
 };
 
+typedef map<string, double> mapSD;
+
 PyMethodDef VRPyWindowManager::methods[] = {
     {"getWindow", PyWrap(WindowManager, getWindow, "Get window by name", VRWindowPtr, string ) },
+    {"setPipelined", PyWrap(WindowManager, setPipelined, "Pipeline distributed windows created afterwards, the servers render while the next frame is simulated", void, bool ) },
+    {"isPipelined", PyWrap(WindowManager, isPipelined, "Check if distributed windows are pipelined", bool ) },
+    {"setMaxFrameLatency", PyWrap(WindowManager, setMaxFrameLatency, "Set how many frames the simulation may run ahead of pipelined windows", void, int ) },
+    {"getStats", PyWrap(WindowManager, getStats, "Get the frame time breakdown of the main thread in ms", mapSD ) },
     {NULL}  /* Sentinel */
 };
 
@@ -99,6 +99,7 @@ PyMethodDef VRPyTransform::methods[] = {
     {"rebaseDrag", PyWrap( Transform, rebaseDrag, "Rebase drag, use instead of switchParent", void, VRObjectPtr ) },
     {"isDragged", PyWrap( Transform, isDragged, "Check if transform is beeing dragged", bool ) },
     {"castRay", PyWrap(Transform, intersect, "Cast a ray and return the intersection with given subtree", VRIntersectionPtr, VRObjectPtr, Vec3d ) },
+    {"castRays", PyWrap(Transform, intersectRays, "Cast rays along local directions and return the intersections with given subtree", vector<VRIntersectionPtr>, VRObjectPtr, vector<Vec3d> ) },
     {"getDragParent", PyWrap(Transform, getDragParent, "Get the parent before the drag started", VRObjectPtr ) },
     {"lastChanged", PyWrap(Transform, getLastChange, "Return the frame when the last change occured", unsigned int ) },
     {"changedSince", PyWrapOpt(Transform, changedSince2, "Check if change occured since frame, flag includes frame", "1", bool, unsigned int, bool ) },
@@ -77,7 +77,7 @@ PyMethodDef VRSceneGlobals::methods[] = {
 	{"getSystemDirectory", (PyCFunction)VRSceneGlobals::getSystemDirectory, METH_VARARGS, "Return the path to one of the specific PolyVR directories - getSystemDirectory( str dir )\n\tdir can be: ROOT, EXAMPLES, RESSOURCES, TRAFFIC" },
 	{"setPhysicsActive", (PyCFunction)VRSceneGlobals::setPhysicsActive, METH_VARARGS, "Pause and unpause physics - setPhysicsActive( bool b )" },
 	{"setPhysicsTimestep", (PyCFunction)VRSceneGlobals::setPhysicsTimestep, METH_VARARGS, "Set physics timestep, default is 0.002, (single substep) - setPhysicsTimestep( double timestep )" },
-	{"runTest", (PyCFunction)VRSceneGlobals::runTest, METH_VARARGS, "Run a built-in system test - runTest( string test )" },
+	{"runTest", (PyCFunction)VRSceneGlobals::runTest, METH_VARARGS, "Run a built-in system test, returns False if it failed - bool runTest( string test )" },
 	{"getSceneMaterials", (PyCFunction)VRSceneGlobals::getSceneMaterials, METH_NOARGS, "Get all materials of the scene - getSceneMaterials()" },
 	{"getBackground", (PyCFunction)VRSceneGlobals::getBackground, METH_NOARGS, "Get background module" },
 	{"getSky", (PyCFunction)VRSceneGlobals::getSky, METH_NOARGS, "Get sky module" },
@@ -514,8 +514,8 @@ PyObject* VRSceneGlobals::render(VRSceneGlobals* self) {
 PyObject* VRSceneGlobals::runTest(VRSceneGlobals* self, PyObject *args) {
     const char* test = "";
     if (!PyArg_ParseTuple(args, "s", &test)) return NULL;
-    VRRunTest(test);
-    Py_RETURN_TRUE;
+    if (VRRunTest(test)) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
 }
 
 OSG_END_NAMESPACE;
@@ -4,17 +4,25 @@
 #include <OpenSG/OSGIntersectAction.h>
 #include <OpenSG/OSGSimpleMaterial.h>
 #include <OpenSG/OSGTriangleIterator.h>
+#include <OpenSG/OSGTransform.h>
+#include <OpenSG/OSGSwitch.h>
+#include <OpenSG/OSGDistanceLOD.h>
+#include <OpenSG/OSGVisitSubTree.h>
 
 #include "core/objects/geometry/VRGeometry.h"
 #include "core/objects/material/VRMaterial.h"
 #include "core/objects/OSGObject.h"
+#include "core/scene/rendering/VRSceneOptimizer.h"
+#include "core/math/partitioning/TriangleBVH.h"
 #include "core/utils/VRFunction.h"
 #include "core/utils/VRGlobals.h"
+#include "core/utils/VRThreadPool.h"
 #include "core/utils/toString.h"
 #include "VRSignal.h"
 #include "VRDevice.h"
 #include "VRIntersectAction.h"
 
+
 using namespace OSG;
 
 
@@ -71,6 +79,183 @@ Vec3i VRIntersect_computeVertices(VRIntersectionPtr ins, NodeMTRecPtr node) {
     return Vec3i(iter.getPositionIndex(0), iter.getPositionIndex(1), iter.getPositionIndex(2));
 }
 
+struct VRRayTarget {
+    Matrix4d toTree; // from the space the node lives in to the intersected tree
+    Matrix4d toLocal;
+    NodeMTRecPtr node; // geometry node, or subtree left to the intersect action
+    TriangleBVHPtr bvh;
+};
+
+struct VRRayHit {
+    double t = 1e30; // along the ray direction
+    Node* node = 0;
+    int triangle = -1;
+    int customID = -1;
+    Vec3d normal;
+};
+
+void VRIntersect_collectTargets(Node* node, const Matrix4d& m, const Matrix4d& mInv, const Line* cull, vector<VRRayTarget>& targets) {
+    if (!node || !(node->getTravMask() & 8)) return;
+
+    if (cull) { // single ray, skip the subtrees it misses like the intersect action does
+        node->updateVolume();
+        const BoxVolume& bv = node->getVolume();
+        Pnt3d p; Vec3d d;
+        mInv.mult(Pnt3d(cull->getPosition()), p);
+        mInv.mult(Vec3d(cull->getDirection()), d);
+        if (bv.isValid() && !bv.intersect(Line(Pnt3f(p), Vec3f(d)))) return;
+    }
+
+    VRRayTarget target;
+    target.toTree = m;
+    target.toLocal = mInv;
+    target.node = node;
+
+    NodeCore* core = node->getCore();
+    if (Geometry* geo = dynamic_cast<Geometry*>(core)) {
+        auto vrGeo = getGeometryAttachment(geo);
+        if (vrGeo && vrGeo->hasTag("SYSTEM:COLLISIONSHAPE")) return;
+        if (vrGeo) target.bvh = vrGeo->getBVH();
+        targets.push_back(target);
+        if (!target.bvh) return; // the intersect action traverses the children
+    }
+
+    if (dynamic_cast<Switch*>(core) || dynamic_cast<DistanceLOD*>(core) || dynamic_cast<VisitSubTree*>(core)) {
+        targets.push_back(target);
+        return;
+    }
+
+    Matrix4d cm = m;
+    Matrix4d cmInv = mInv;
+    if (Transform* t = dynamic_cast<Transform*>(core)) {
+        Matrix4d tm = toMatrix4d(t->getMatrix());
+        cm.mult(tm);
+        tm.invert();
+        tm.mult(mInv);
+        cmInv = tm;
+    }
+
+    for (unsigned int i=0; i<node->getNChildren(); i++) VRIntersect_collectTargets(node->getChild(i), cm, cmInv, cull, targets);
+}
+
+Vec3d VRIntersect_toTreeNormal(const VRRayTarget& target, Vec3d n) { // normals transform with the transposed inverse
+    const Matrix4d& L = target.toLocal;
+    n = Vec3d(Vec3d(L[0]).dot(n), Vec3d(L[1]).dot(n), Vec3d(L[2]).dot(n));
+    n.normalize();
+    return n;
+}
+
+void VRIntersect_castBVH(const VRRayTarget& target, const Line& ray, VRRayHit& hit) {
+    Pnt3d p; Vec3d d;
+    target.toLocal.mult(Pnt3d(ray.getPosition()), p);
+    target.toLocal.mult(Vec3d(ray.getDirection()), d);
+    auto h = target.bvh->intersect(Pnt3f(p), Vec3f(d), hit.t);
+    if (!h.hit) return;
+
+    hit.t = h.t;
+    hit.node = target.node;
+    hit.triangle = h.triangle;
+    hit.customID = -1;
+    hit.normal = VRIntersect_toTreeNormal(target, Vec3d(h.normal));
+}
+
+void VRIntersect_castAction(const VRRayTarget& target, const Line& ray, bool skipVols, VRRayHit& hit) {
+    Pnt3d p; Vec3d d;
+    target.toLocal.mult(Pnt3d(ray.getPosition()), p);
+    target.toLocal.mult(Vec3d(ray.getDirection()), d);
+
+    VRIntersectAction iAct;
+    iAct.setSkipVolumes(skipVols);
+    iAct.setTravMask(8);
+    iAct.setLine(Line(Pnt3f(p), Vec3f(d)));
+    iAct.apply(target.node);
+    if (!iAct.didHit()) return;
+
+    Pnt3d h;
+    target.toTree.mult(Pnt3d(iAct.getHitPoint()), h);
+    Vec3d rd = Vec3d(ray.getDirection());
+    double t = (h - Pnt3d(ray.getPosition())).dot(rd) / rd.squareLength();
+    if (t >= hit.t) return;
+    hit.t = t;
+    hit.node = iAct.getHitObject();
+    hit.triangle = iAct.getHitTriangle();
+    hit.customID = iAct.getHitLine();
+    hit.normal = VRIntersect_toTreeNormal(target, Vec3d(iAct.getHitNormal())); // the action ran in the local space of the target
+}
+
+/** Rays are given in the space of the tree parent, intersections are returned in world coordinates.
+    The tree is flattened once to its geometries, meshes are tested against their cached BVH,
+    everything else falls back to the intersect action. **/
+vector<VRIntersectionPtr> VRIntersect_castRays(VRObjectPtr tree, const vector<Line>& rays, bool skipVols) {
+    size_t N = rays.size();
+    vector<VRIntersectionPtr> res;
+    for (size_t i=0; i<N; i++) {
+        res.push_back( VRIntersection::create() );
+        res[i]->ray = rays[i];
+    }
+    if (!tree || !tree->getNode() || !tree->getNode()->node) return res;
+
+    vector<VRRayTarget> targets;
+    Matrix4d I;
+    const Line* cull = (N == 1 && !skipVols) ? &rays[0] : 0;
+    VRIntersect_collectTargets(tree->getNode()->node, I, I, cull, targets);
+
+    vector<const VRRayTarget*> meshTargets;
+    vector<const VRRayTarget*> actionTargets;
+    for (auto& t : targets) (t.bvh ? meshTargets : actionTargets).push_back(&t);
+
+    vector<VRRayHit> hits(N);
+    auto castRange = [&](size_t i0, size_t i1) { // BVH queries are read only, safe to run in parallel
+        for (size_t i = i0; i < i1; i++) {
+            for (auto t : meshTargets) VRIntersect_castBVH(*t, rays[i], hits[i]);
+        }
+    };
+
+    VRThreadPool::get()->parallelFor(N, 256, castRange);
+
+    for (auto t : actionTargets) {
+        for (size_t i=0; i<N; i++) VRIntersect_castAction(*t, rays[i], skipVols, hits[i]);
+    }
+
+    Matrix4d toWorld;
+    bool transformed = false;
+    if (auto p = tree->getParent()) {
+        toWorld = toMatrix4d( p->getNode()->node->getToWorld() );
+        transformed = true;
+    }
+
+    unsigned int now = VRGlobals::CURRENT_FRAME;
+    for (size_t i=0; i<N; i++) {
+        auto& hit = hits[i];
+        auto& ins = res[i];
+        ins->hit = (hit.node != 0);
+        if (!ins->hit) continue;
+        ins->time = now;
+
+        auto parent = OSGObject::create(hit.node->getParent());
+        auto obj = VRObject::fromNode(parent);
+        if (!obj) obj = tree->find(parent);
+        ins->object = obj;
+        if (obj) ins->name = obj->getName();
+        ins->point = Pnt3d(rays[i].getPosition()) + Vec3d(rays[i].getDirection())*hit.t;
+        ins->normal = hit.normal;
+        if (transformed) {
+            toWorld.mult( ins->point, ins->point );
+            toWorld.mult( ins->normal, ins->normal );
+        }
+        ins->triangle = hit.triangle;
+        ins->triangleVertices = VRIntersect_computeVertices(ins, hit.node);
+        if (auto o = VRSceneOptimizer::getBatchedObject(obj, ins->triangleVertices[0])) { // merged chunk, resolve the original
+            ins->object = o;
+            ins->name = o->getName();
+        }
+        ins->texel = VRIntersect_computeTexel(ins, hit.node);
+        ins->customID = hit.customID;
+    }
+
+    return res;
+}
+
 VRIntersectionPtr VRIntersect::intersectRay(VRObjectWeakPtr wtree, Line ray, bool skipVols) {
     //VRTimer t; t.start();
     auto ins = VRIntersection::create();
@@ -79,34 +264,10 @@ VRIntersectionPtr VRIntersect::intersectRay(VRObjectWeakPtr wtree, Line ray, boo
     if (!tree->getNode()) return ins;
     if (!tree->getNode()->node) return ins;
 
-    unsigned int now = VRGlobals::CURRENT_FRAME;
-
-    VRIntersectAction iAct;
-    iAct.setSkipVolumes(skipVols);
-    iAct.setTravMask(8);
-    iAct.setLine(ray);
-    iAct.apply(tree->getNode()->node);
-
-    ins->ray = ray;
-    ins->hit = iAct.didHit();
+    ins = VRIntersect_castRays(tree, {ray}, skipVols)[0];
     //cout << "VRIntersect::intersectRay " << ray << " with " << tree->getName() << " hit? " << ins.hit << endl;
-    if (ins->hit) {
-        ins->object = tree->find(OSGObject::create(iAct.getHitObject()->getParent()));
-        if (auto sp = ins->object.lock()) ins->name = sp->getName();
-        ins->point = Pnt3d(iAct.getHitPoint());
-        ins->normal = Vec3d(iAct.getHitNormal());
-        if (tree->getParent()) {
-            auto m = toMatrix4d( tree->getParent()->getNode()->node->getToWorld() );
-            m.mult( ins->point, ins->point );
-            m.mult( ins->normal, ins->normal );
-        }
-        ins->triangle = iAct.getHitTriangle();
-        ins->triangleVertices = VRIntersect_computeVertices(ins, iAct.getHitObject());
-        ins->texel = VRIntersect_computeTexel(ins, iAct.getHitObject());
-        ins->customID = iAct.getHitLine();
-        lastIntersection = ins;
-        ins->time = now;
-    } else {
+    if (ins->hit) lastIntersection = ins;
+    else {
         ins->object.reset();
         if (!lastIntersection || lastIntersection->time < ins->time) lastIntersection = ins;
     }
@@ -118,6 +279,27 @@ VRIntersectionPtr VRIntersect::intersectRay(VRObjectWeakPtr wtree, Line ray, boo
     return ins;
 }
 
+/** Intersects many world space rays with the tree at once, for sensor simulation and snapping **/
+vector<VRIntersectionPtr> VRIntersect::intersectRays(VRObjectPtr tree, vector<Line> rays, bool skipVols) {
+    if (!tree) return VRIntersect_castRays(tree, rays, skipVols);
+
+    vector<Line> local = rays;
+    if (auto p = tree->getParent()) {
+        auto m = toMatrix4d( p->getNode()->node->getToWorld() );
+        m.invert();
+        for (auto& r : local) {
+            Pnt3d o; Vec3d d;
+            m.mult(Pnt3d(r.getPosition()), o);
+            m.mult(Vec3d(r.getDirection()), d);
+            r = Line(Pnt3f(o), Vec3f(d));
+        }
+    }
+
+    auto res = VRIntersect_castRays(tree, local, skipVols);
+    for (size_t i=0; i<res.size(); i++) res[i]->ray = rays[i];
+    return res;
+}
+
 /**
 * @param wtree: root of sub scene graph to be intersected with
 * @param force: determines if reevaluation of intersection within a single frame should be forced
@@ -68,6 +68,7 @@ class VRIntersect {
         ~VRIntersect();
 
         VRIntersectionPtr intersect(VRObjectWeakPtr wtree, bool force = false, VRTransformPtr caster = 0, Vec3d dir = Vec3d(0,0,-1), bool skipVols = false);
+        static vector<VRIntersectionPtr> intersectRays(VRObjectPtr tree, vector<Line> rays, bool skipVols = false);
         void drag(VRIntersectionPtr i, VRTransformWeakPtr caster);
         bool drop(VRDeviceWeakPtr dev = VRDevicePtr(0), VRTransformWeakPtr beacon = VRTransformPtr(0));
         VRDeviceCbPtr addDrag(VRTransformWeakPtr caster, VRObjectWeakPtr tree);
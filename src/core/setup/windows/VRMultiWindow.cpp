@@ -1,9 +1,12 @@
 #include "VRMultiWindow.h"
 #include "VRView.h"
+#include "core/setup/VRSetup.h"
+#include "core/setup/VRNetwork.h"
 #include "core/utils/toString.h"
 #include "core/scene/VRSceneManager.h"
 #include "core/utils/VRFunction.h"
 #include "core/utils/VRProfiler.h"
+#include "core/utils/VRTimer.h"
 #include "core/utils/xml.h"
 #include "core/gui/VRGuiManager.h"
 
@@ -22,7 +25,14 @@ OSG_BEGIN_NAMESPACE;
 using namespace std;
 
 
-VRMultiWindow::VRMultiWindow() {
+// each pipelined window applies the main change list to its own aspect,
+// aspect 1 is shared by the nature, traffic and import threads
+int newPipelineAspect() {
+    static int lastAspect = 1;
+    return ++lastAspect;
+}
+
+VRMultiWindow::VRMultiWindow(bool pipelined) : VRWindow(pipelined ? newPipelineAspect() : 0) {
     type = "distributed";
 }
 
@@ -31,7 +41,7 @@ VRMultiWindow::~VRMultiWindow() {
 }
 
 VRMultiWindowPtr VRMultiWindow::ptr() { return static_pointer_cast<VRMultiWindow>( shared_from_this() ); }
-VRMultiWindowPtr VRMultiWindow::create() { return shared_ptr<VRMultiWindow>(new VRMultiWindow() ); }
+VRMultiWindowPtr VRMultiWindow::create(bool pipelined) { return shared_ptr<VRMultiWindow>(new VRMultiWindow(pipelined) ); }
 
 void VRMultiWindow::addServer(string server) { servers.push_back(server); }
 
@@ -64,6 +74,29 @@ void VRMultiWindow::setState(int s) {
     uiSignal("state_multiwindow_updated", {{"window", getName()}, {"state", getStateString()}});
 }
 
+/**
+ * The servers only accept the connection type they were started with, which is the one of their network slave.
+ * Servers that are not slaves of the current setup, or slaves that disagree, get StreamSock, the OpenSG default.
+ */
+string VRMultiWindow::getServerConnectionType() {
+    string type;
+    auto setup = VRSetup::getCurrent();
+    auto network = setup ? setup->getNetwork() : 0;
+    for (auto server : servers) {
+        VRNetworkSlavePtr slave;
+        if (network) for (auto node : network->getData()) {
+            for (auto s : node->getData()) if (s->getConnectionIdentifier() == server) slave = s;
+        }
+        if (!slave) return "StreamSock";
+        string t = slave->getConnectionType();
+        if (t != "Multicast" && t != "SockPipeline" && t != "StreamSock") return "StreamSock";
+        if (type != "" && type != t) return "StreamSock";
+        type = t;
+    }
+    if (type == "") return "StreamSock";
+    return type;
+}
+
 bool VRMultiWindow::init_win(const std::string &msg, const std::string &server, Real32 progress) {
     cout << endl << msg << " to " << server << " : " << progress;
     if (progress == 1) { setState(JUSTCONNECTED); return true; }
@@ -77,6 +110,7 @@ void VRMultiWindow::initialize() {
     cout << "Initializing MultiWindow\n";
     //cout << " Render MW " << getName() << " state " << getStateString() << endl;
     win = 0; _win = 0; tries = 0; setState(CONNECTING);
+    syncFrames = 0; syncTimeMax = 0;
     win = MultiDisplayWindow::create(); _win = win;
 #ifdef WITH_CLUSTERING_FIX
     win->setFrameCounting(false);
@@ -87,7 +121,9 @@ void VRMultiWindow::initialize() {
     win->setHServers(Nx);
     win->setVServers(Ny);
 
-    //win->setConnectionType(connection_type); // "Multicast", "SockPipeline" // not needed apparently!
+    string ctype = getServerConnectionType();
+    if (ctype != connection_type) cout << " connection type " << connection_type << " does not match the servers, using " << ctype << endl;
+    win->setConnectionType(ctype); // "Multicast" sends the change list once to all servers, "SockPipeline" passes it along the server chain
     for (auto s : servers) win->editMFServers()->push_back(s);
     for (auto wv : views) if (auto v = wv.lock()) v->setWindow(win);
 
@@ -99,8 +135,14 @@ void VRMultiWindow::initialize() {
 #endif
 }
 
+// pipelined windows are synced and rendered by their own thread, which has to use the window of its aspect
+MultiDisplayWindow* getAspectWindow(WindowMTRecPtr _win) {
+    return dynamic_cast<MultiDisplayWindow*>( convertToCurrentAspect(_win.get()) );
+}
+
 void OSG_sync(WindowMTRecPtr _win, RenderActionRefPtr ract) {
-    auto win = dynamic_pointer_cast<MultiDisplayWindow>(_win);
+    auto win = getAspectWindow(_win);
+    if (!win) return; // not yet in this aspect
     win->activate();
     win->frameInit();
     //win->renderAllViewports(ract);
@@ -109,7 +151,8 @@ void OSG_sync(WindowMTRecPtr _win, RenderActionRefPtr ract) {
 }
 
 void OSG_render(WindowMTRecPtr _win, RenderActionRefPtr ract) {
-    auto win = dynamic_pointer_cast<MultiDisplayWindow>(_win);
+    auto win = getAspectWindow(_win);
+    if (!win) return;
     //win->activate();
     //win->frameInit();
     win->renderAllViewports(ract);
@@ -136,7 +179,12 @@ void VRMultiWindow::sync(bool fromThread) {
     if (state == CONNECTED) {
         try {
             int pID = VRProfiler::get()->regStart("Multiwindow sync "+getName());
+            VRTimer timer;
+            changeListStats.computeBytes();
             OSG_sync(_win, ract);
+            syncTime = timer.stop();
+            syncTimeMax = max(syncTime, syncTimeMax);
+            syncFrames++;
             VRProfiler::get()->regStop(pID);
         } catch(exception& e) { reset(); }
     }
@@ -148,7 +196,9 @@ void VRMultiWindow::render(bool fromThread) {
             int pID = VRProfiler::get()->regStart("Multiwindow render "+getName());
             //cout << "VRMultiWindow::render " << fromThread << ", " << pID << endl;
             setState(RENDERING);
+            VRTimer timer;
             OSG_render(_win, ract);
+            swapTime = timer.stop(); // includes waiting for the servers to swap
             setState(CONNECTED);
             VRProfiler::get()->regStop(pID);
         } catch(exception& e) { reset(); }
@@ -160,6 +210,21 @@ int VRMultiWindow::getState() { return state; }
 void VRMultiWindow::setConnectionType(string ct) { connection_type = ct; }
 string VRMultiWindow::getConnectionType() { return connection_type; }
 
+map<string, double> VRMultiWindow::getStats() {
+    map<string, double> res;
+    res["servers"] = servers.size();
+    res["pipelined"] = isPipelined();
+    res["frames"] = syncFrames;
+    res["frameBytes"] = changeListStats.getFrameBytes();
+    res["totalBytes"] = changeListStats.getTotalBytes();
+    res["syncTime"] = syncTime;
+    res["syncTimeMax"] = syncTimeMax;
+    res["swapTime"] = swapTime;
+    res["applyTime"] = applyTime;
+    res["barrierTime"] = barrierTime;
+    return res;
+}
+
 string VRMultiWindow::getStateString() {
     if (state == CONNECTED) return "connected";
     if (state == RENDERING) return "rendering";
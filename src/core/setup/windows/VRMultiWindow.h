@@ -19,16 +19,22 @@ class VRMultiWindow : public VRWindow {
         int state = INITIALIZING;
         int tries = 0;
 
+        size_t syncFrames = 0;
+        double syncTime = 0;
+        double syncTimeMax = 0;
+        double swapTime = 0;
+
         void setState(int);
+        string getServerConnectionType();
 
         void render(bool fromThread = false) override;
         void sync(bool fromThread = false) override;
 
     public:
-        VRMultiWindow();
+        VRMultiWindow(bool pipelined = false);
         ~VRMultiWindow();
 
-        static VRMultiWindowPtr create();
+        static VRMultiWindowPtr create(bool pipelined = false);
         VRMultiWindowPtr ptr();
 
         enum STATE {
@@ -57,6 +63,8 @@ class VRMultiWindow : public VRWindow {
 
         void reset();
 
+        map<string, double> getStats();
+
         void save(XMLElementPtr node) override;
         void load(XMLElementPtr node) override;
 };
@@ -27,6 +27,7 @@
 #include "core/objects/VRLight.h"
 #include "core/scene/VRSceneManager.h"
 #include "core/scene/rendering/VRRenderStudio.h"
+#include "core/scene/rendering/VROcclusionCuller.h"
 
 using namespace OSG;
 
@@ -145,6 +146,9 @@ void VRView::setViewports() {//create && set size of viewports
         rView->setSize(p[0], p[1], p[2], p[3]);
     }
 
+    if (lView) lView->setTravMask(VROcclusionCuller::viewMask); // skips occlusion culled subtrees
+    if (rView) rView->setTravMask(VROcclusionCuller::viewMask);
+
     // renderingL stages
     if (renderingL) {
         renderingL->setHMDDeye(-1);
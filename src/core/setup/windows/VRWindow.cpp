@@ -11,19 +11,22 @@
 #include "core/utils/VRFunction.h"
 #include "core/utils/toString.h"
 #include "core/utils/VRProfiler.h"
+#include "core/utils/VRTimer.h"
 #include "core/utils/xml.h"
 
+#include <OpenSG/OSGChangeList.h>
+
 using namespace OSG;
 
 unsigned int VRWindow::active_window_count = 0;
 
-VRWindow::VRWindow() : changeListStats("remote") {
+VRWindow::VRWindow(int a) : changeListStats("remote"), aspect(a) {
     cout << "New Window" << endl;
     active_window_count++;
     string n = getName();
 #ifndef WASM
     winThread = VRThreadCb::create("VRWindow", bind(&VRWindow::update, this, _1) );
-    thread_id = VRSceneManager::get()->initThread(winThread,"window_"+n,true,0); // WASM crash, needed?
+    thread_id = VRSceneManager::get()->initThread(winThread,"window_"+n,true,aspect); // WASM crash, needed?
 #endif
 }
 
@@ -86,6 +89,11 @@ vector<VRViewPtr> VRWindow::getViews() {
 // clist->clear() will crash when an object is instantiated in main thread (VRGeometry::setMesh -> OSG::Window::registerGLObject)
 // will also crash in OSG::RemoteAspect::sendSync
 
+// ----------------- pipelined windows
+// the thread runs in an aspect of its own, not shared with other windows or threads, initialized once with the full state of the main thread
+// each frame the committed changes of the main thread are applied to that aspect while the main thread waits,
+// sending them to the servers and rendering then overlaps with the next frame of the main thread
+
 void VRWindow::update( weak_ptr<VRThread>  wt) {
 #ifndef WASM
     auto t = wt.lock();
@@ -94,13 +102,16 @@ void VRWindow::update( weak_ptr<VRThread>  wt) {
         BarrierRefPtr barrier = Barrier::get("PVR_rendering", true);
         auto appCL = t->appThread->getChangeList();
         auto clist = Thread::getCurrentChangeList();
+        double tBarrier = 0;
 
         auto wait = [&]() {
             waitingAtBarrier = true;
 #ifndef WASM
             int pID = VRProfiler::get()->regStart("window barrier "+getName());
 #endif
+            VRTimer timer;
             barrier->enter(active_window_count+1);
+            tBarrier += timer.stop();
 #ifndef WASM
             VRProfiler::get()->regStop(pID);
 #endif
@@ -109,16 +120,33 @@ void VRWindow::update( weak_ptr<VRThread>  wt) {
             return false;
         };
 
+        if (t->control_flag && aspect != 0 && !aspectSynced) {
+            t->syncFromMain();
+            aspectSynced = true;
+        }
+
         if (t->control_flag) {
             if (wait()) break;
             /** let the window manager initiate multi windows if necessary **/
             if (wait()) break;
-            clist->merge(*appCL);
-            //changeListStats.update();
-            sync(true);
-            clist->clear();
-            if (wait()) break;
+            VRTimer timer;
+            if (aspect == 0) {
+                clist->merge(*appCL);
+                applyTime = timer.stop();
+                //changeListStats.update();
+                sync(true);
+                clist->clear();
+                if (wait()) break;
+            } else {
+                appCL->applyNoClear();
+                commitChanges();
+                applyTime = timer.stop();
+                if (wait()) break;
+                sync(true);
+                clist->clear();
+            }
             render(true);
+            barrierTime = tBarrier;
         }
 
         osgSleep(1);
@@ -128,6 +156,7 @@ void VRWindow::update( weak_ptr<VRThread>  wt) {
 }
 
 bool VRWindow::isWaiting() { return waitingAtBarrier; }
+bool VRWindow::isPipelined() { return aspect != 0; }
 
 string VRWindow::getTitle() { return title; }
 string VRWindow::getIcon() { return icon; }
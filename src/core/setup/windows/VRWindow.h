@@ -39,10 +39,14 @@ class VRWindow : public std::enable_shared_from_this<VRWindow>, public VRName {
 
         VRThreadCbPtr winThread;
         int thread_id = -1;
+        int aspect = 0;
+        bool aspectSynced = false;
+        double applyTime = 0;
+        double barrierTime = 0;
         void update( VRThreadWeakPtr t );
 
     public:
-        VRWindow();
+        VRWindow(int aspect = 0);
         virtual ~VRWindow();
 
         static VRWindowPtr create();
@@ -64,6 +68,7 @@ class VRWindow : public std::enable_shared_from_this<VRWindow>, public VRName {
         void setContent(bool b);
 
         bool isWaiting();
+        bool isPipelined();
         void stop();
 
         void setMouse(VRMousePtr m);
@@ -11,9 +11,12 @@
 #include "core/setup/devices/VRKeyboard.h"
 #include "core/utils/VROptions.h"
 #include "core/utils/VRTimer.h"
+#include "core/utils/toString.h"
+#include "core/utils/system/VRSystem.h"
 #include "core/objects/object/VRObject.h"
 #include "core/utils/VRRate.h"
 #include "core/scene/VRScene.h"
+#include "core/scene/VRSceneManager.h"
 #include "core/setup/VRSetup.h"
 #include "core/scene/rendering/VRRenderStudio.h"
 #include "core/gui/VRGuiManager.h"
@@ -105,7 +108,7 @@ VRWindowPtr VRWindowManager::addGlutEditor(string name) {
 
 VRWindowPtr VRWindowManager::addMultiWindow(string name) {
 #ifndef WASM
-    VRMultiWindowPtr win = VRMultiWindow::create();
+    VRMultiWindowPtr win = VRMultiWindow::create(pipelined);
     win->setName(name);
     win->setAction(ract);
     windows[win->getName()] = win;
@@ -118,6 +121,20 @@ VRWindowPtr VRWindowManager::addMultiWindow(string name) {
 VRGlutEditorPtr VRWindowManager::getEditorWindow() { return editorWindow; }
 
 void VRWindowManager::pauseRendering(bool b) { rendering_paused = b; }
+void VRWindowManager::setPipelined(bool b) { pipelined = b; } // applies to distributed windows created afterwards
+bool VRWindowManager::isPipelined() { return pipelined; }
+void VRWindowManager::setMaxFrameLatency(int frames) { maxFrameLatency = max(frames, 0); }
+int VRWindowManager::getMaxFrameLatency() { return maxFrameLatency; }
+
+map<string, double> VRWindowManager::getStats() { // main thread frame breakdown in ms
+    map<string, double> res;
+    res["pipelined"] = pipelined;
+    res["simTime"] = simTime;
+    res["commitTime"] = commitTime;
+    res["waitTime"] = waitTime;
+    res["skippedFrames"] = skippedFrames;
+    return res;
+}
 
 void VRWindowManager::getWindowSize(string name, int& width, int& height) {
     if (!checkWin(name)) return;
@@ -141,6 +158,8 @@ bool VRWindowManager::doRenderSync = false;
 
 void VRWindowManager::updateWindows() {
     if (rendering_paused) return;
+    double tStart = getTime()*1e-3;
+    if (tLastUpdate > 0) simTime = tStart - tLastUpdate;
     auto scene = VRScene::getCurrent();
     if (scene) scene->allowScriptThreads();
 
@@ -190,8 +209,10 @@ void VRWindowManager::updateWindows() {
     };
 
 #ifndef WASM
+    double tWait = 0;
     auto wait = [&](int timeout = -1) {
         int pID = VRProfiler::get()->regStart("window manager barrier");
+        VRTimer timer;
 
         if (timeout > 0) {
             size_t tEnter = time(0);
@@ -207,25 +228,55 @@ void VRWindowManager::updateWindows() {
         }
 
         barrier->enter(VRWindow::active_window_count+1);
+        tWait += timer.stop();
         VRProfiler::get()->regStop(pID);
         return true;
     };
+
+    auto waitForWindows = [&](int timeout) { // bounds how many frames the main thread runs ahead of pipelined windows
+        int pID = VRProfiler::get()->regStart("window manager latency bound");
+        VRTimer timer;
+        size_t tEnter = time(0);
+        while (barrier->getNumWaiting() < VRWindow::active_window_count) {
+            VRSceneManager::get()->ThreadManagerUpdate(); // windows may wait for the initial sync of their aspect
+            this_thread::sleep_for(chrono::microseconds(1));
+            int delta = time(0) - tEnter;
+            if (delta >= timeout) {
+                cout << "WARNING! pipelined windows exceed the frame latency!" << endl;
+                return false;
+            }
+        }
+        tWait += timer.stop();
+        VRProfiler::get()->regStop(pID);
+        return true;
+    };
+
+    bool hasPipelined = false;
+    for (auto w : getWindows()) if (w.second->isPipelined()) hasPipelined = true;
 #endif
 
     auto tryRender = [&]() {
 #ifndef WASM
-        if (barrier->getNumWaiting() != VRWindow::active_window_count) return true;
+        if (hasPipelined) VRSceneManager::get()->ThreadManagerUpdate(); // initial sync of the window aspects
+        if (barrier->getNumWaiting() != VRWindow::active_window_count) {
+            if (!hasPipelined || frameLatency < maxFrameLatency) { frameLatency++; skippedFrames++; return true; }
+            if (!waitForWindows(5)) return false;
+        }
+        frameLatency = 0;
         if (!wait()) return false;
         for (auto w : getWindows() ) if (auto win = dynamic_pointer_cast<VRMultiWindow>(w.second)) if (win->getState() == VRMultiWindow::INITIALIZING) win->initialize();
+        VRTimer timer;
         commitChanges();
+        commitTime = timer.stop();
 
         auto clist = Thread::getCurrentChangeList();
         VRGlobals::NCHANGED = clist->getNumChanged();
         VRGlobals::NCREATED = clist->getNumCreated();
-        if (VRGlobals::NCHANGED == 0 && VRGlobals::NCREATED == 0) return true;
+        if (!hasPipelined && VRGlobals::NCHANGED == 0 && VRGlobals::NCREATED == 0) return true; // pipelined windows pass all barriers to stay in step
         //changeListStats.update();
         if (!wait()) return false;
         // let the windows merge the change lists, sync and clear
+        // pipelined windows only apply the changes to their aspect, syncing and rendering overlaps with the next frame
         if (!wait()) return false;
 #ifndef WITHOUT_GLUT
         int pID2 = profiler->regStart("process glut events");
@@ -277,6 +328,10 @@ void VRWindowManager::updateWindows() {
 #endif
     }
 
+#ifndef WASM
+    waitTime = tWait;
+#endif
+    tLastUpdate = getTime()*1e-3;
     if (scene) scene->blockScriptThreads();
 }
 
@@ -315,6 +370,8 @@ VRWindowPtr VRWindowManager::getWindow(string name) {
 }
 
 void VRWindowManager::save(XMLElementPtr node) {
+    node->setAttribute("pipelined", toString(pipelined));
+    node->setAttribute("maxFrameLatency", toString(maxFrameLatency));
     for (auto window : windows) {
         XMLElementPtr wn = node->addChild("Window");
         window.second->save(wn);
@@ -323,6 +380,8 @@ void VRWindowManager::save(XMLElementPtr node) {
 
 void VRWindowManager::load(XMLElementPtr node) {
     cout << " load windows" << endl;
+    if (node->hasAttribute("pipelined")) pipelined = toBool(node->getAttribute("pipelined"));
+    if (node->hasAttribute("maxFrameLatency")) maxFrameLatency = toInt(node->getAttribute("maxFrameLatency"));
     for (auto el : node->getChildren()) {
         if (!el) continue;
 
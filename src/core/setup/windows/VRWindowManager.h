@@ -22,6 +22,15 @@ class VRWindowManager {
         VRChangeList changeListStats;
         bool rendering_paused = false;
 
+        bool pipelined = false;
+        int maxFrameLatency = 1;
+        int frameLatency = 0; // frames the main thread is ahead of the pipelined windows
+        size_t skippedFrames = 0; // total
+        double tLastUpdate = 0;
+        double simTime = 0;
+        double commitTime = 0;
+        double waitTime = 0;
+
         bool checkWin(string name);
 
     public:
@@ -45,6 +54,12 @@ class VRWindowManager {
         void resizeWindow(string name, int w, int h);
 
         void pauseRendering(bool b);
+        void setPipelined(bool b);
+        bool isPipelined();
+        void setMaxFrameLatency(int frames);
+        int getMaxFrameLatency();
+        map<string, double> getStats();
+
         RenderActionRefPtr getRenderAction();
         void updateWindows();
         void stopWindows();
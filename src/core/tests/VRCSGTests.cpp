@@ -0,0 +1,74 @@
+#include "VRTestCases.h"
+
+#ifndef WITHOUT_CGAL
+#include "addons/Engineering/CSG/CSGGeometry.h"
+#include "core/objects/geometry/OSGGeometry.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool csgBackendsBenchmark() { // same models with both backends, cold and with one leaf changed
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " CSG benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    auto build = [](string b, vector<VRGeometryPtr>& leafs, double x3) {
+        auto root = CSGGeometry::create("csgBenchmark");
+        auto left = CSGGeometry::create("csgBenchmarkL");
+        auto right = CSGGeometry::create("csgBenchmarkR");
+        root->addChild(left);
+        root->addChild(right);
+
+        leafs.clear();
+        for (int i=0; i<4; i++) {
+            auto g = VRGeometry::create("leaf"+toString(i));
+            g->setPrimitive(i%2 ? "Box 1 1 1 4 4 4" : "Sphere 0.6 3");
+            g->setFrom(Vec3d(i == 3 ? x3 : i*0.4, 0, 0));
+            leafs.push_back(g);
+            (i < 2 ? left : right)->addChild(g);
+        }
+
+        for (auto c : {root, left, right}) c->setBackend(b);
+        left->setOperation("subtract");
+        right->setOperation("unite");
+        return root;
+    };
+
+    auto countVertices = [](CSGGeometryPtr g) -> size_t {
+        auto mesh = g->getMesh();
+        return (mesh && mesh->geo && mesh->geo->getPositions()) ? mesh->geo->getPositions()->size() : 0;
+    };
+
+    for (auto b : CSGGeometry::getBackends()) {
+        vector<VRGeometryPtr> leafs;
+        auto root = build(b, leafs, 1.2);
+
+        VRTimer t;
+        bool built = root->setEditMode(false);
+        double tCold = t.stop(); t.reset();
+        check(built && countVertices(root) > 0, "tree of backend "+b);
+
+        leafs[3]->setFrom(Vec3d(1.3, 0.1, 0)); // only the right sub tree and the root are recomputed
+        root->setEditMode(true);
+        built = root->setEditMode(false);
+        double tLeaf = t.stop();
+
+        size_t N = countVertices(root);
+        cout << "CSG benchmark, backend " << b << ": tree in " << tCold << " ms, after leaf change " << tLeaf << " ms, " << N << " vertices" << endl;
+
+        vector<VRGeometryPtr> refLeafs;
+        auto reference = build(b, refLeafs, 1.3);
+        refLeafs[3]->setFrom(Vec3d(1.3, 0.1, 0));
+        reference->setEditMode(false);
+        check(built && N > 0 && N == countVertices(reference), "tree of backend "+b+" after leaf change differs from a cold build");
+    }
+
+    cout << "CSG benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
+#endif
@@ -0,0 +1,210 @@
+#include "VRTestCases.h"
+
+#include "core/objects/geometry/VRGeoData.h"
+#include "core/objects/geometry/VRGeometry.h"
+#include "core/math/pose.h"
+#include "core/math/path.h"
+#include "core/math/polygon.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+#include "addons/WorldGenerator/VRWorldGenerator.h"
+#include "addons/WorldGenerator/buildings/VRDistrict.h"
+#include "addons/WorldGenerator/roads/VRRoadNetwork.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace OSG;
+
+bool geoBuilderBenchmark() { // a height field of quads, pushed one by one, with a reserved builder and with parallel builders
+    int G = 512;
+    size_t Nq = G*G;
+    auto corner = [&](int x, int z) { return Pnt3f(x, sin(x*0.1)*cos(z*0.1), z); };
+
+    VRTimer timer;
+    VRGeoData d1;
+    for (size_t q=0; q<Nq; q++) {
+        int x = q%G;
+        int z = q/G;
+        Vec3d n(0,1,0);
+        d1.pushVert(Pnt3d(corner(x,z)), n, Vec2d(0,0));
+        d1.pushVert(Pnt3d(corner(x,z+1)), n, Vec2d(0,1));
+        d1.pushVert(Pnt3d(corner(x+1,z+1)), n, Vec2d(1,1));
+        d1.pushVert(Pnt3d(corner(x+1,z)), n, Vec2d(1,0));
+        d1.pushQuad();
+    }
+    double t1 = timer.stop();
+
+    timer.reset();
+    VRGeoData d2;
+    vector<VRGeoData::Builder> parts(1, VRGeoData::Builder(true, false, 1));
+    parts[0].reserve(4*Nq, 4*Nq);
+    for (size_t q=0; q<Nq; q++) {
+        int x = q%G;
+        int z = q/G;
+        Vec3f n(0,1,0);
+        parts[0].pushVert(corner(x,z), n, Color4f(), Vec2f(0,0));
+        parts[0].pushVert(corner(x,z+1), n, Color4f(), Vec2f(0,1));
+        parts[0].pushVert(corner(x+1,z+1), n, Color4f(), Vec2f(1,1));
+        parts[0].pushVert(corner(x+1,z), n, Color4f(), Vec2f(1,0));
+        parts[0].pushQuad();
+    }
+    d2.concat(parts);
+    double t2 = timer.stop();
+
+    timer.reset();
+    VRGeoData d3;
+    d3.buildParallel(Nq, VRGeoData::Builder(true, false, 1), [&](VRGeoData::Builder& b, size_t q) {
+        int x = q%G;
+        int z = q/G;
+        int i = b.addVertices(4);
+        b.positions[i  ] = corner(x,z);
+        b.positions[i+1] = corner(x,z+1);
+        b.positions[i+2] = corner(x+1,z+1);
+        b.positions[i+3] = corner(x+1,z);
+        for (int k=0; k<4; k++) b.normals[i+k] = Vec3f(0,1,0);
+        b.texCoords[0][i  ] = Vec2f(0,0);
+        b.texCoords[0][i+1] = Vec2f(0,1);
+        b.texCoords[0][i+2] = Vec2f(1,1);
+        b.texCoords[0][i+3] = Vec2f(1,0);
+        b.pushQuad(i, i+1, i+2, i+3);
+    });
+    double t3 = timer.stop();
+
+    auto same = [&](VRGeoData& a, VRGeoData& b) {
+        if (a.size() != b.size() || a.getNIndices() != b.getNIndices()) return false;
+        if (a.getNTypes() != b.getNTypes()) return false;
+        for (int i=0; i<a.size(); i++) {
+            if (a.getPosition(i) != b.getPosition(i)) return false;
+            if (a.getTexCoord(i) != b.getTexCoord(i)) return false;
+        }
+        for (int i=0; i<a.getNIndices(); i++) {
+            if (a.getIndex(i) != b.getIndex(i)) return false;
+        }
+        return true;
+    };
+
+    timer.reset();
+    auto geo = d3.asGeometry("geoBench");
+    double t4 = timer.stop();
+
+    bool ok = d1.size() == int(4*Nq) && same(d1,d2) && same(d1,d3);
+    cout << "geo data benchmark, " << Nq << " quads, pushed in " << t1 << " ms, reserved builder " << t2 << " ms, parallel builders " << t3 << " ms";
+    cout << ", applied in " << t4 << " ms" << endl;
+    cout << "geo data benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
+
+bool districtGenerationBenchmark() { // a grid of block buildings, merged one by one against the parallel facade builders
+    int N = 16;
+    auto district = VRDistrict::create();
+    srand(0);
+    map<string, VRPolygonPtr> footprints; // added in the order of the district, both passes visit the buildings in the same order
+    for (int i=0; i<N*N; i++) {
+        Vec2d c = Vec2d(i%N, i/N) * 30;
+        double w = 8 + rand()%12;
+        double d = 8 + rand()%12;
+        auto p = VRPolygon::create();
+        p->addPoint(c + Vec2d(-w,-d)*0.5);
+        p->addPoint(c + Vec2d( w,-d)*0.5);
+        p->addPoint(c + Vec2d( w, d)*0.5);
+        p->addPoint(c + Vec2d(-w, d)*0.5);
+        footprints["bench"+toString(i)] = p;
+    }
+
+    VRTimer timer;
+    int i = 0;
+    for (auto f : footprints) {
+        string type = i%5 == 0 ? "shopping" : "residential"; // random shop fronts
+        district->addBuilding(f.second, 2+i%6, toString(i), "bench", type);
+        i++;
+    }
+    double t1 = timer.stop();
+    VRGeoData merged(district->getFacades());
+
+    timer.reset();
+    district->computeGeometry();
+    double t2 = timer.stop();
+    VRGeoData parallel(district->getFacades());
+
+    string mismatch;
+    if (merged.size() == 0) mismatch = "empty facades";
+    else if (merged.size() != parallel.size()) mismatch = "vertex count " + toString(merged.size()) + " / " + toString(parallel.size());
+    else if (merged.getNIndices() != parallel.getNIndices()) mismatch = "index count";
+    for (int i=0; i<merged.getNIndices() && mismatch == ""; i++) {
+        if (merged.getIndex(i) != parallel.getIndex(i)) mismatch = "index " + toString(i);
+    }
+    for (int i=0; i<merged.size() && mismatch == ""; i++) {
+        if ((merged.getPosition(i) - parallel.getPosition(i)).length() > 1e-5) mismatch = "position of vertex " + toString(i);
+        else if ((merged.getNormal(i) - parallel.getNormal(i)).length() > 1e-5) mismatch = "normal of vertex " + toString(i);
+        else if (merged.getColor(i) != parallel.getColor(i)) mismatch = "color of vertex " + toString(i);
+        else if (merged.getTexCoord(i) != parallel.getTexCoord(i)) mismatch = "texture coordinate of vertex " + toString(i);
+        else if (merged.getTexCoord2(i) != parallel.getTexCoord2(i)) mismatch = "second texture coordinate of vertex " + toString(i);
+    }
+
+    bool ok = mismatch == "";
+    cout << "district benchmark, " << N*N << " buildings, merged in " << t1 << " ms, parallel builders " << t2 << " ms";
+    cout << ", facade vertices " << merged.size() << ", facades " << (ok ? "identical" : "DIFFER in " + mismatch) << endl;
+    cout << "district benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
+
+bool roadGenerationBenchmark() { // guard rail poles merged one by one against the pole builders, then guard rails along parallel roads
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " road network benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    auto world = VRWorldGenerator::create();
+    auto roads = world->addRoadNetwork();
+
+    vector<PosePtr> poles;
+    for (int i=0; i<1024; i++) poles.push_back( Pose::create(Vec3d(i%32 * 10, 0.5, -(i/32) * 1.3), Vec3d(0,0,-1), Vec3d(0,1,0)) );
+
+    VRTimer timer;
+    auto merged = VRGeometry::create("guardRailPolesBench");
+    auto pole = VRGeometry::create("pole");
+    pole->setPrimitive("Box 0.02 1 0.2 1 1 1");
+    for (auto p : poles) merged->merge(pole, p);
+    double t1 = timer.stop();
+
+    timer.reset();
+    roads->addGuardRailPoles(poles, 1, 0.2);
+    double t2 = timer.stop();
+    VRGeoData d1(merged);
+    VRGeoData d2(roads->getGuardRailPolesGeo());
+
+    auto bounds = [](VRGeoData& d) {
+        Vec3d a(1e9,1e9,1e9), b(-1e9,-1e9,-1e9);
+        for (int i=0; i<d.size(); i++) {
+            Pnt3d p = d.getPosition(i);
+            for (int k=0; k<3; k++) { a[k] = min(a[k], p[k]); b[k] = max(b[k], p[k]); }
+        }
+        return make_pair(a, b);
+    };
+
+    auto b1 = bounds(d1);
+    auto b2 = bounds(d2);
+    check(d2.getNFaces() == int(6*poles.size()), "pole faces " + toString(d2.getNFaces()));
+    check((b1.first-b2.first).length() < 1e-4 && (b1.second-b2.second).length() < 1e-4, "pole bounds differ from the merged boxes");
+
+    int N = 16;
+    int Nfaces = d2.getNFaces();
+    timer.reset();
+    for (int i=0; i<N; i++) {
+        auto path = Path::create();
+        path->addPoint( Pose::create(Vec3d(i*10, 0, 0), Vec3d(0,0,-1)) );
+        path->addPoint( Pose::create(Vec3d(i*10, 0, -500), Vec3d(0,0,-1)) );
+        path->compute(64);
+        roads->addGuardRail(path, 1);
+    }
+    double t3 = timer.stop();
+    check(VRGeoData(roads->getGuardRailPolesGeo()).getNFaces() > Nfaces, "no poles along the guard rails");
+
+    cout << "road network benchmark, " << poles.size() << " poles, merged in " << t1 << " ms, builders " << t2 << " ms, faces " << d1.getNFaces() << " / " << d2.getNFaces();
+    cout << ", " << N << " guard rails of 500 m in " << t3 << " ms" << endl;
+    cout << "road network benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,79 @@
+#include "VRTestCases.h"
+
+#include "core/setup/devices/VRIntersect.h"
+#include "core/setup/devices/VRIntersectAction.h"
+#include "core/objects/geometry/VRGeometry.h"
+#include "core/objects/OSGObject.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+#include <random>
+
+using namespace OSG;
+
+bool intersectRaysBenchmark() { // grid of spheres and boxes, random rays, intersect action as reference
+    auto root = VRObject::create("intersectBench");
+    int Ngrid = 20;
+    for (int i=0; i<Ngrid; i++) {
+        for (int j=0; j<Ngrid; j++) {
+            auto g = (i+j)%2 ? VRGeometry::create("sphere", "Sphere", "0.4 3") : VRGeometry::create("box", "Box", "0.6 0.6 0.6 4 4 4");
+            g->setFrom(Vec3d(i-Ngrid*0.5, 0, j-Ngrid*0.5));
+            root->addChild(g);
+        }
+    }
+
+    mt19937 rng(42);
+    uniform_real_distribution<float> U(-Ngrid*0.5, Ngrid*0.5);
+    int Nrays = 10000;
+    vector<Line> rays;
+    for (int i=0; i<Nrays; i++) {
+        Pnt3f p(U(rng), 5, U(rng));
+        Vec3f d = Vec3f(U(rng)*0.1, -1, U(rng)*0.1);
+        d.normalize();
+        rays.push_back(Line(p, d));
+    }
+
+    VRTimer timer;
+    vector<Pnt3d> reference;
+    for (auto& r : rays) {
+        VRIntersectAction iAct;
+        iAct.setTravMask(8);
+        iAct.setLine(r);
+        iAct.apply(root->getNode()->node);
+        reference.push_back(iAct.didHit() ? Pnt3d(iAct.getHitPoint()) : Pnt3d(1e30, 0, 0));
+    }
+    double tAction = timer.stop(); timer.reset();
+
+    VRIntersect::intersectRays(root, {rays[0]}); // builds the BVHs
+    double tBuild = timer.stop(); timer.reset();
+
+    int Nhits = 0;
+    int Nmismatch = 0;
+    for (int i=0; i<Nrays; i++) {
+        auto ins = VRIntersect::intersectRays(root, {rays[i]})[0];
+        Nhits += ins->hit;
+        if (ins->hit != (reference[i][0] < 1e29)) Nmismatch++;
+        else if (ins->hit && (ins->point - reference[i]).length() > 1e-3) Nmismatch++;
+    }
+    double tSingle = timer.stop(); timer.reset();
+
+    auto batch = VRIntersect::intersectRays(root, rays);
+    double tBatch = timer.stop();
+    for (int i=0; i<Nrays; i++) if (batch[i]->hit != (reference[i][0] < 1e29)) Nmismatch++;
+
+    cout << "intersect benchmark, " << Nrays << " rays on " << Ngrid*Ngrid << " meshes, " << Nhits << " hits" << endl;
+    cout << " intersect action: " << tAction << " ms, BVH build: " << tBuild << " ms" << endl;
+    cout << " single rays: " << tSingle << " ms, batch: " << tBatch << " ms" << endl;
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " intersect benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    check(Nmismatch == 0, ::toString(Nmismatch) + " rays differ from the intersect action");
+    check(Nhits > 0 && Nhits < Nrays, "rays hit all or none of the meshes");
+    cout << "intersect benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
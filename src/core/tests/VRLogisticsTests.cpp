@@ -0,0 +1,65 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/Factory/VRLogistics.h"
+#include "core/math/pose.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool logisticsBenchmark() { // headless week of a four station line
+    auto run = [](int seed, VRTimer& timer) {
+        auto logistics = FLogistics::create();
+        logistics->setSeed(seed);
+        auto net = logistics->addNetwork();
+
+        vector<int> nodes;
+        for (int i=0; i<6; i++) nodes.push_back( net->addNode(Pose::create(Vec3d(i*5,0,0))) );
+        for (int i=0; i<5; i++) net->connect(nodes[i], nodes[i+1]);
+
+        logistics->addSource(nodes[0], 60, true);
+        logistics->addStation(nodes[1], 40);
+        logistics->addStation(nodes[2], 55);
+        logistics->addStation(nodes[3], 30);
+        logistics->addStation(nodes[4], 50);
+        logistics->addSink(nodes[5]);
+
+        for (int i=0; i<5; i++) {
+            auto t = logistics->addTransporter("PRODUCT");
+            t->setPath(logistics->computeRoute(nodes[i], nodes[i+1]));
+            t->setSpeed(1.0);
+        }
+
+        timer.reset();
+        logistics->run(7*24*3600);
+        return logistics->getStatistics();
+    };
+
+    VRTimer timer;
+    auto stats = run(42, timer);
+    double T = timer.stop();
+    auto stats2 = run(42, timer);
+    auto stats3 = run(7, timer);
+    bool deterministic = true;
+    for (string k : {"events", "completed", "wipAverage", "leadTime"}) if (stats[k] != stats2[k]) deterministic = false;
+
+    cout << "Logistics benchmark, one simulated week in " << T << " ms, " << stats["events"] << " events" << endl;
+    for (auto& s : stats) cout << " " << s.first << ": " << s.second << endl;
+    cout << " throughput with seed 7: " << stats3["throughput"] << endl;
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " logistics benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    double week = 7*24*3600;
+    check(deterministic, "same seed, different statistics");
+    check(stats["time"] == week, "simulated time");
+    check(stats["completed"] > 0 && stats3["completed"] > 0, "no product completed");
+    check(stats["completed"] <= week/55 + 1, "more products than the slowest station can process");
+    check(stats["created"] == stats["completed"] + stats["wip"], "products lost in the line");
+    cout << "logistics benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
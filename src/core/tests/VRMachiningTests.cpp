@@ -0,0 +1,82 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/Machining/VRMachiningCode.h"
+#include "core/utils/system/VRSystem.h"
+#include "core/utils/VRTimer.h"
+#include "core/utils/Thread.h"
+
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <cmath>
+
+using namespace OSG;
+
+bool gcodeBenchmark() { // zig zag lines with half circles, loading, seeking and a preview window
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " G code benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    string path = "gcodeBenchmark.nc";
+    int N = 1000000;
+    {
+        ofstream file(path);
+        file << "; benchmark program\nG17\nV100\n";
+        for (int i=0; i<N; i++) {
+            double x = (i/10) * 2.0;
+            if (i%10 == 9) file << "G2 X" << x+2 << " Y-5 I1 J0\n";
+            else file << "G1 X" << x << " Y" << (i%2 ? 5 : -5) << " Z" << (i%10)*0.1 << "\n";
+        }
+    }
+
+    auto code = VRMachiningCode::create();
+    VRTimer timer;
+    code->readGCode(path, 1.0);
+    double tLoad = timer.stop();
+    size_t Nsegments = code->length();
+    double T = code->getDuration();
+
+    code->clear();
+    timer.reset();
+    code->readGCode(path, 1.0, true);
+    while (code->length() == 0 && code->isLoading()) ::Thread::sleepMilli(1);
+    double tFirst = timer.stop();
+    code->waitForLoading();
+    double tStream = timer.stop();
+    check(Nsegments > 0 && T > 0, "empty motion table");
+    check(code->length() == Nsegments && abs(code->getDuration() - T) <= 1e-6*T, "background loading differs from loading in one go");
+
+    mt19937 rng(1);
+    uniform_real_distribution<double> dist(0, T);
+    int Nseeks = 1000000;
+    Vec3d sum;
+    timer.reset();
+    for (int i=0; i<Nseeks; i++) sum += code->getPosition(dist(rng));
+    double tSeek = timer.stop() * 1000.0 / Nseeks;
+
+    bool seeks = true; // positions in the middle of segments, up to the float precision of the motion table
+    uniform_int_distribution<size_t> segment(0, Nsegments-1);
+    for (int i=0; i<1000; i++) {
+        size_t k = segment(rng);
+        auto s = code->getSegment(k);
+        if (s.duration <= 0) continue;
+        Vec3d p = code->getPosition(s.tStart + s.duration*0.5);
+        if (s.G == 1) seeks = seeks && (p - Vec3d(s.p0 + s.p1)*0.5).length() < 1e-4;
+        else seeks = seeks && abs((p - Vec3d(s.center)).length() - (s.p0 - s.center).length()) < 1e-4;
+    }
+    check(seeks, "seeked positions are off their segments");
+
+    timer.reset();
+    code->asGeometry(T*0.5, T*0.5 + 60);
+    double tPreview = timer.stop();
+    check(code->length() == Nsegments, "preview changed the motion table");
+    removeFile(path);
+
+    cout << "G code benchmark, " << N << " blocks, " << Nsegments << " segments (" << Nsegments*sizeof(VRMachiningCode::Segment)/1e6 << " MB), duration " << T << " s" << endl;
+    cout << " load " << tLoad << " ms, background: first segment after " << tFirst << " ms, done after " << tStream << " ms" << endl;
+    cout << " seek " << tSeek << " us, preview of one minute " << tPreview << " ms" << endl;
+    cout << "G code benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,68 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/Mechanics/VRMechanism.h"
+#include "core/objects/geometry/VRPrimitive.h"
+#include "core/objects/VRTransform.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+#include <cmath>
+
+using namespace OSG;
+
+bool mechanismBenchmark() { // rows of meshing gears, each row driven by a motor at its first gear
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " mechanism benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    for (int N : {10, 30, 100}) {
+        auto mechanism = VRMechanism::create();
+        double d = 2 * VRGear(0.1, 0.02, 0.1, 32, 0.02, 0).radius();
+
+        VRTimer timer;
+        vector<vector<VRTransformPtr>> rows(N);
+        for (int i=0; i<N; i++) {
+            for (int j=0; j<N; j++) {
+                auto t = VRTransform::create("gear");
+                t->setFrom(Vec3d(j*d, i*3*d, 0));
+                mechanism->addGear(t, 0.1, 0.02, 0.1, 32, 0.02, 0, Vec3d(0,0,-1), Vec3d());
+                rows[i].push_back(t);
+                if (j == 0) mechanism->addMotor("motor"+toString(i), t, 1.0);
+            }
+        }
+        double tAdd = timer.stop();
+        check(mechanism->getNParts() == N*N, "parts of "+toString(N*N)+" gears");
+
+        timer.reset();
+        mechanism->updateNeighbors();
+        double tNeighbors = timer.stop();
+
+        int Nframes = 100;
+        timer.reset();
+        for (int k=0; k<Nframes; k++) {
+            mechanism->update(false);
+            mechanism->update(true);
+        }
+        double tFrame = timer.stop() / Nframes;
+
+        bool valid = true; // all driven gears turn with the same speed, alternating direction
+        for (auto& row : rows) {
+            double a1 = mechanism->getLastChange(row[1]);
+            if (abs(a1) < 1e-9) valid = false;
+            for (int j=2; j<N; j++) {
+                double a = mechanism->getLastChange(row[j]);
+                if (abs(a + mechanism->getLastChange(row[j-1])) > 1e-3*abs(a1)) valid = false;
+            }
+        }
+        check(valid, "gear speeds of "+toString(N*N)+" gears");
+
+        cout << "Mechanism benchmark, " << N*N << " gears: add " << tAdd << " ms, neighbors " << tNeighbors << " ms";
+        cout << ", frame " << tFrame << " ms" << endl;
+    }
+
+    cout << "mechanism benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,60 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/Milling/VRMillingWorkPiece.h"
+#include "addons/Engineering/Milling/VRMillingCuttingToolProfile.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+#include <cmath>
+
+using namespace OSG;
+
+bool millingDexelsBenchmark() { // pocket of a 20x5x20 cm stock with a 1 cm end mill
+    auto profile = VRMillingCuttingToolProfile::create();
+    profile->addPointProfile(Vec2d(0, 0.005));
+    profile->addPointProfile(Vec2d(0.03, 0.005));
+
+    auto wp = VRMillingWorkPiece::create("millingBenchmark");
+    wp->setCuttingProfile(profile);
+    wp->setFeedRate(0.05);
+    wp->initDexels(Vec3i(400, 100, 400), 0.0005);
+
+    int Nsegments = 0;
+    double pathLength = 0;
+    double bottom = 0.02;
+    VRTimer t;
+    for (double y = 0.02; y > 0.0; y -= 0.005) { // depth passes
+        for (double z = -0.08; z <= 0.08; z += 0.008) { // zig zag lines
+            bool fwd = int((z + 0.08) / 0.008 + 0.5) % 2 == 0;
+            Vec3d p0(fwd ? -0.08 : 0.08, y, z);
+            Vec3d p1(fwd ? 0.08 : -0.08, y, z);
+            wp->cutSegment(p0, p1);
+            wp->cutSegment(p1, p1 + Vec3d(0, 0, 0.008));
+            Nsegments += 2;
+            pathLength += 0.168;
+        }
+        bottom = y;
+    }
+    double tCut = t.stop(); t.reset();
+    wp->updateGeometry();
+    double tMesh = t.stop();
+
+    double V = wp->getRemovedVolume();
+    double T = wp->getCycleTime();
+    cout << "Milling benchmark, " << Nsegments << " segments: cut in " << tCut << " ms, remeshed in " << tMesh << " ms, removed volume "
+         << V << ", cycle time " << T << " s" << endl;
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " milling benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    double pocket = 0.16 * 0.16 * (0.025 - bottom); // the tool center covers at least this area down to the last pass
+    double stock = 0.2 * 0.05 * 0.2;
+    check(V >= pocket && V <= stock, "removed volume out of the pocket bounds");
+    check(abs(T - pathLength / 0.05) < 1e-6 * T, "cycle time does not match the path length");
+
+    cout << "milling benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,156 @@
+#include "VRTestCases.h"
+
+#ifndef WITHOUT_TCP
+#include "core/networking/tcp/VRTCPServer.h"
+#include "core/networking/tcp/VRTCPUtils.h"
+#include "core/networking/udp/VRUDPServer.h"
+#include "core/networking/udp/VRUDPClient.h"
+#include "core/utils/toString.h"
+#include "core/utils/Thread.h"
+#include "core/utils/VRMutex.h"
+
+#include <boost/asio.hpp>
+#include <iostream>
+
+using namespace OSG;
+using namespace boost::asio;
+using ip::tcp;
+
+bool tcpFramedTest() { // framing and backpressure against a raw loopback client
+    int port = 54310;
+    auto server = VRTCPServer::create("tcpFramedTest");
+    server->setThreads(2);
+    server->setMaxQueue(1<<16);
+
+    VRMutex mtx;
+    vector<string> received;
+    size_t answerSize = 0;
+    server->onFrame([&](const VRTCPFrame& frame, size_t uID) {
+        VRLock lock(mtx);
+        received.push_back(frame.str());
+        if (answerSize) server->send(uID, string(answerSize, 'a'));
+    });
+    server->listenFramed(port);
+
+    io_service io;
+    tcp::socket client(io);
+    client.open(tcp::v4());
+    client.set_option(socket_base::receive_buffer_size(4096));
+    client.connect(tcp::endpoint(ip::address::from_string("127.0.0.1"), port));
+
+    auto waitFor = [&](function<bool()> done) {
+        for (int i=0; i<2000 && !done(); i++) Thread::sleepMilli(1);
+        return done();
+    };
+
+    auto countReceived = [&]() { VRLock lock(mtx); return received.size(); };
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " tcpFramed test failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    // framing, empty and large frames, headers split over several writes
+    vector<string> sent = { "", "hello", string(100000, 'x'), "a", "last" };
+    string stream;
+    for (auto& s : sent) stream += VRTCPUtils::frame(s);
+    for (size_t i=0; i<stream.size(); i += 3) boost::asio::write(client, boost::asio::buffer(stream.data()+i, min(size_t(3), stream.size()-i)));
+    check(waitFor([&]() { return countReceived() == sent.size(); }), "received "+to_string(countReceived())+" of "+to_string(sent.size())+" frames");
+    {
+        VRLock lock(mtx);
+        check(received == sent, "frame payloads differ");
+        received.clear();
+        answerSize = 1<<14;
+    }
+
+    // backpressure, answers pile up while the client does not read
+    size_t N = 1024;
+    stream = "";
+    for (size_t i=0; i<N; i++) stream += VRTCPUtils::frame(to_string(i));
+    boost::asio::write(client, boost::asio::buffer(stream));
+    Thread::sleepMilli(200);
+    check(server->getStats()["stalls"] > 0, "reading did not pause");
+
+    size_t answers = 0;
+    string in;
+    auto done = [&]() {
+        auto s = server->getStats();
+        return s["messagesIn"] == sent.size()+N && answers + s["dropped"] == N;
+    };
+    for (int i=0; i<5000 && !done(); i++) {
+        size_t A = client.available();
+        if (A == 0) { Thread::sleepMilli(1); continue; }
+        size_t S = in.size();
+        in.resize(S+A);
+        boost::asio::read(client, boost::asio::buffer(&in[S], A));
+        while (in.size() >= 4) { // consume complete frames
+            size_t L = size_t((unsigned char)in[0]) | size_t((unsigned char)in[1])<<8 | size_t((unsigned char)in[2])<<16 | size_t((unsigned char)in[3])<<24;
+            if (in.size() < 4+L) break;
+            check(L == answerSize, "answer of "+to_string(L)+" bytes");
+            in.erase(0, 4+L);
+            answers++;
+        }
+    }
+
+    auto s = server->getStats();
+    check(countReceived() == N, "received "+to_string(countReceived())+" of "+to_string(N)+" requests");
+    check(answers + s["dropped"] == N, to_string(answers)+" answers and "+to_string(s["dropped"])+" dropped of "+to_string(N));
+
+    boost::system::error_code ec;
+    client.close(ec);
+    server->close();
+
+    // listen again after close
+    {
+        VRLock lock(mtx);
+        received.clear();
+        answerSize = 0;
+    }
+    server->listenFramed(port);
+    tcp::socket client2(io);
+    client2.connect(tcp::endpoint(ip::address::from_string("127.0.0.1"), port), ec);
+    check(!ec, "reconnect after close failed: "+ec.message());
+    if (!ec) {
+        boost::asio::write(client2, boost::asio::buffer(VRTCPUtils::frame("again")));
+        check(waitFor([&]() { return countReceived() == 1; }), "no frame received after listening again");
+    }
+    client2.close(ec);
+    server->close();
+
+    cout << "tcpFramed test " << (ok ? "passed" : "FAILED") << ", " << s["stalls"] << " stalls, " << s["dropped"] << " dropped" << endl;
+    return ok;
+}
+
+bool udpBatchTest() { // local sender on loopback, every 100th packet is skipped
+    int N = 10000;
+    auto server = VRUDPServer::create("udpBatchTest");
+    server->setStamped(true);
+    server->listenBatched(54300);
+
+    size_t delivered = 0;
+    server->onPackets([&](const vector<VRUDPPacket>& packets) { delivered += packets.size(); });
+
+    auto client = VRUDPClient::create("udpBatchTest");
+    client->connect("127.0.0.1", 54300);
+    int skipped = 0;
+    for (int i=0; i<N; i++) {
+        if (i%100 == 50) { skipped++; continue; }
+        client->send( VRUDPServer::stamp("sample "+toString(i), i) );
+        if (i%200 == 0) { // paced, so the loopback socket buffer does not overflow
+            Thread::sleepMilli(1);
+            server->update();
+        }
+    }
+
+    Thread::sleepMilli(100);
+    server->update();
+    auto stats = server->getStats();
+    server->close();
+
+    bool ok = delivered == size_t(N-skipped) && stats["lost"] == skipped && stats["overflow"] == 0;
+    cout << "udpBatch test " << (ok ? "passed" : "FAILED") << ", delivered " << delivered << " of " << N-skipped << " packets, lost " << stats["lost"] << " of " << skipped << endl;
+    if (!ok) for (auto s : stats) cout << " " << s.first << ": " << s.second << endl;
+    return ok;
+}
+#endif
@@ -0,0 +1,72 @@
+#include "VRTestCases.h"
+
+#include "core/objects/object/VRObject.h"
+#include "core/objects/object/VRObjectT.h"
+#include "core/objects/VRTransform.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool sceneIndexBenchmark() {
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " scene index benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+ // indexed queries against a full traversal, for growing scenes
+    for (int N : {1000, 10000, 100000}) {
+        auto root = VRObject::create("benchRoot");
+        vector<VRObjectPtr> objects(1, root);
+        for (int i=1; i<N; i++) {
+            VRObjectPtr o;
+            if (i%100 == 0) o = VRTransform::create("benchTrans"+toString(i));
+            else o = VRObject::create("benchObj"+toString(i));
+            if (i%50 == 0) o->addTag("benchTag");
+            objects[(i-1)/8]->addChild(o);
+            objects.push_back(o);
+        }
+
+        string target = objects[N/2]->getName();
+        int Nfind = 1000;
+        int Nquery = 10;
+        VRObjectPtr hit, miss;
+        vector<VRObjectPtr> transforms, tagged;
+
+        VRTimer t;
+        for (int i=0; i<Nfind; i++) hit = root->find(target);
+        double tHit = t.stop() * 1000.0 / Nfind; t.reset();
+        for (int i=0; i<Nfind; i++) miss = root->find("benchMissing");
+        double tMiss = t.stop() * 1000.0 / Nfind; t.reset();
+        for (int i=0; i<Nquery; i++) transforms = root->getChildren(true, "Transform");
+        double tType = t.stop() * 1000.0 / Nquery; t.reset();
+        for (int i=0; i<Nquery; i++) tagged = root->getChildrenWithTag("benchTag", true);
+        double tTag = t.stop() * 1000.0 / Nquery; t.reset();
+
+        VRObjectPtr refHit;
+        vector<VRObjectPtr> refTransforms, refTagged;
+        function<void(VRObjectPtr)> collect = [&](VRObjectPtr o) { // order of the recursive getChildren
+            for (auto& c : o->getChildren()) {
+                if (c->getType() == "Transform") refTransforms.push_back(c);
+                if (c->hasTag("benchTag")) refTagged.push_back(c);
+            }
+            for (auto& c : o->getChildren()) collect(c);
+        };
+        collect(root);
+        root->visit([&](const VRObjectPtr& o) {
+            if (!refHit && o->getName() == target) refHit = o;
+            return !refHit;
+        });
+        double tScan = t.stop() * 1000.0;
+
+        cout << "scene index benchmark, " << N << " objects: find " << tHit << " us, miss " << tMiss << " us, by type " << tType << " us, by tag " << tTag << " us, full scan " << tScan << " us" << endl;
+        check(hit && hit == refHit && !miss, "find by name in "+toString(N)+" objects");
+        check(transforms == refTransforms, "children by type in "+toString(N)+" objects");
+        check(tagged == refTagged, "children by tag in "+toString(N)+" objects");
+    }
+
+    cout << "scene index benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
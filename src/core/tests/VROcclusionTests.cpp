@@ -0,0 +1,124 @@
+#include "VRTestCases.h"
+
+#include "core/scene/rendering/VROcclusionCuller.h"
+#include "core/objects/OSGObject.h"
+#include "core/objects/VRLodTree.h"
+#include "core/objects/geometry/VRGeometry.h"
+#include "core/setup/devices/VRIntersect.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <OpenSG/OSGNode.h>
+#include <iostream>
+#include <cmath>
+
+using namespace OSG;
+
+bool occlusionCullingBenchmark() { // a city block grid with many small parts in the streets and courtyards, walked along a street
+    int N = 8; // blocks per axis
+    double B = 12, S = 8; // block and street width
+    auto root = VRObject::create("occlusionBench");
+
+    for (int i=0; i<N*N; i++) {
+        auto g = VRGeometry::create("block"+toString(i), "Box", toString(B)+" 20 "+toString(B)+" 1 1 1");
+        g->setFrom(Vec3d((i%N)*(B+S), 10, (i/N)*(B+S)));
+        root->addChild(g);
+    }
+
+    auto lods = VRLodTree::create("parts", 8);
+    root->addChild(lods);
+    vector<VRGeometryPtr> parts;
+    int M = 96;
+    double L = N*(B+S);
+    for (int i=0; i<M*M; i++) {
+        Vec3d p( (i%M)*L/M - B*0.5 - S*0.5, 0.5, (i/M)*L/M - B*0.5 - S*0.5 );
+        auto g = VRGeometry::create("part"+toString(i), "Box", "0.6 0.6 0.6 1 1 1");
+        lods->addObject(g, p, 0, false);
+        parts.push_back(g);
+    }
+
+    auto perspective = [](double fov, double aspect, double near, double far) {
+        Matrix4d P;
+        double f = 1.0/tan(fov*0.5);
+        P[0][0] = f/aspect;
+        P[1][1] = f;
+        P[2][2] = (far+near)/(near-far);
+        P[3][2] = 2*far*near/(near-far);
+        P[2][3] = -1;
+        P[3][3] = 0;
+        return P;
+    };
+
+    auto lookAt = [](Vec3d e, Vec3d d, Vec3d u) {
+        d.normalize();
+        Vec3d s = d.cross(u);
+        s.normalize();
+        u = s.cross(d);
+        Matrix4d V;
+        for (int k=0; k<3; k++) { V[k][0] = s[k]; V[k][1] = u[k]; V[k][2] = -d[k]; }
+        V[3][0] = -s.dot(e);
+        V[3][1] = -u.dot(e);
+        V[3][2] = d.dot(e);
+        return V;
+    };
+
+    auto culler = VROcclusionCuller::create();
+    VRTimer t;
+    culler->setRoot(root);
+    double tSetup = t.stop();
+
+    Matrix4d P = perspective(60*Pi/180, 2, 0.1, 500);
+    double z = B*0.5 + S*0.5; // center of the first street
+    size_t Nposes = 16, Noccluders = 0, culled = 0, tested = 0, violations = 0, checked = 0;
+    double tRaster = 0, tTest = 0;
+    Matrix4d VP;
+    for (size_t i=0; i<Nposes; i++) {
+        double a = (i%2 ? 0.2 : -0.2) + 0.05*i;
+        Vec3d eye(-S + i*L/Nposes, 1.7, z);
+        VP = P;
+        VP.mult( lookAt(eye, Vec3d(cos(a), -0.05, sin(a)), Vec3d(0,1,0)) );
+        culler->cull(VP);
+
+        auto s = culler->getLastStats();
+        Noccluders = s.occluders;
+        culled += s.culled;
+        tested += s.tested;
+        tRaster += s.raster;
+        tTest += s.test;
+
+        vector<Line> rays; // a culled part must not be the first hit from the eye
+        vector<VRGeometryPtr> targets;
+        for (size_t j=0; j<parts.size(); j+=17) {
+            if (!culler->isCulled(parts[j])) continue;
+            Vec3d d = parts[j]->getWorldPosition() - eye;
+            rays.push_back( Line(Pnt3f(eye), Vec3f(d)) );
+            targets.push_back(parts[j]);
+        }
+        culler->reset();
+        auto hits = VRIntersect::intersectRays(root, rays);
+        for (size_t j=0; j<hits.size() && j<targets.size(); j++) {
+            checked++;
+            if (hits[j]->hit && hits[j]->getIntersected() == targets[j]) violations++;
+        }
+    }
+
+    cout << "occlusion culling benchmark, " << Noccluders << " occluders selected in " << tSetup << " ms, " << parts.size() << " parts" << endl;
+    cout << " per frame: " << double(culled)/Nposes << " geometries culled, " << double(tested)/Nposes << " volumes tested, raster " << tRaster/Nposes << " ms, test " << tTest/Nposes << " ms" << endl;
+    cout << " " << violations << " visible parts culled of " << checked << " checked" << endl;
+
+    culler->cull(VP); // masks changed while culled are kept
+    vector<VRGeometryPtr> culledParts;
+    for (auto& p : parts) if (culler->isCulled(p) && (p->getNode()->node->getTravMask() & VROcclusionCuller::culledMask)) culledParts.push_back(p);
+    bool masksKept = true; // parts culled as a whole cell are not culled themselves
+    if (culledParts.size() >= 2) {
+        masksKept = (culledParts[1]->getNode()->node->getTravMask() & VROcclusionCuller::keptMask) == VROcclusionCuller::keptMask; // still picked and shadowed
+        culledParts[0]->setVisible(false);
+        culler->reset();
+        masksKept = masksKept && culledParts[0]->getNode()->node->getTravMask() == 0 && culledParts[1]->getNode()->node->getTravMask() == 0xffffffff;
+        culledParts[0]->setVisible(true);
+    }
+    cout << " changed masks kept: " << masksKept << ", " << culledParts.size() << " parts culled themselves" << endl;
+    bool ok = violations == 0 && checked > 0 && masksKept;
+    cout << "occlusion culling benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
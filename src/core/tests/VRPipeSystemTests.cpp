@@ -0,0 +1,67 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/VRPipeSystem.h"
+#include "addons/Semantics/Reasoning/VREntity.h"
+#include "core/math/pose.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+#include <cmath>
+
+using namespace OSG;
+
+bool pipeSystemBenchmark() { // chains of tanks, valves, pumps and junctions of growing size
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " pipe system benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    vector<string> types = { "Tank", "Junction", "Valve", "Junction", "Pump", "Junction" };
+    vector<map<string, string>> params = {
+        {{"volume", "1"}, {"pressure", "2"}}, {},
+        {{"state", "1"}, {"radius", "0.05"}}, {},
+        {{"performance", "1"}, {"maxPressure", "5"}}, {} };
+
+    for (int N : {60, 600, 6000, 60000}) {
+        auto system = VRPipeSystem::create();
+        system->setSyncRate(0);
+
+        int last = -1;
+        vector<int> segments;
+        for (int i=0; i<N; i++) {
+            int t = i % types.size();
+            int nID = system->addNode(types[t]+toString(i), Pose::create(Vec3d(i,0,0)), types[t], params[t]);
+            if (last >= 0) segments.push_back( system->addSegment(0.05, last, nID) );
+            last = nID;
+        }
+
+        VRTimer timer;
+        system->update(); // compiles the state
+        double tFirst = timer.stop();
+
+        int Nsteps = 10;
+        timer.reset();
+        for (int i=0; i<Nsteps; i++) system->update();
+        double tStep = timer.stop() / Nsteps;
+
+        timer.reset();
+        system->syncToOntology();
+        double tSync = timer.stop();
+
+        cout << "Pipe system benchmark, " << N << " nodes: first frame " << tFirst << " ms, frame " << tStep << " ms, ontology sync " << tSync << " ms" << endl;
+
+        bool finite = true;
+        for (int s : segments) finite = finite && isfinite(system->getSegmentPressure(s)) && isfinite(system->getSegmentFlow(s));
+        check(finite, "segment state of "+toString(N)+" nodes is not finite");
+
+        double p = system->getTankPressure("Tank0");
+        double synced = system->getNodeEntity( system->getNode("Tank0") )->getValue("pressure", -1.0);
+        check(isfinite(p) && p > 0, "tank pressure of "+toString(N)+" nodes");
+        check(abs(synced - p) <= 1e-3 * abs(p), "tank pressure of "+toString(N)+" nodes not synced to the ontology");
+    }
+
+    cout << "pipe system benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,255 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/Programming/VRLADEngine.h"
+#include "addons/Engineering/Programming/VRLADVariable.h"
+#include "addons/Engineering/Programming/VRSCLEngine.h"
+#include "addons/Engineering/Programming/VRSCLProgram.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool ladEngineBenchmark() { // chained rungs of contacts and coils, moves and a calculation, interpreted and compiled
+    typedef VRLADEngine::CompileUnit CompileUnit;
+    typedef VRLADEngine::Access Access;
+    typedef VRLADEngine::Part Part;
+    typedef VRLADEngine::Wire Wire;
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " LAD benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    int N = 2000;
+
+    auto build = [&]() {
+        auto engine = VRLADEngine::create();
+        map<string, VRLADVariablePtr> variables;
+        auto addVariable = [&](string name, string value) {
+            auto v = VRLADVariable::create();
+            v->setName(name);
+            v->setValue(value);
+            v->setStartValue(value);
+            variables[name] = v;
+        };
+
+        for (int i=0; i<=N; i++) addVariable("v"+::toString(i), i == 0 ? "1" : "0");
+        addVariable("delay", "T#5s"); // values that do not survive a float
+        addVariable("position", "123456.789");
+        addVariable("factor", "2.5");
+        for (string out : {"mask2", "delay2", "position2", "product"}) addVariable(out, "0");
+
+        VRLADEngine::CompileUnitPtr cu;
+        auto addUnit = [&](string cuID) {
+            cu = VRLADEngine::CompileUnitPtr( new CompileUnit(cuID) );
+            cu->variables = variables;
+            engine->addCompileUnit(cu);
+        };
+
+        auto addAccess = [&](string UId, string var, bool constant = false) {
+            auto access = VRLADEngine::AccessPtr( new Access(UId, cu) );
+            access->components.push_back(var);
+            if (constant) access->constant = true;
+            else access->variable = var;
+            cu->accesses[UId] = access;
+        };
+
+        auto addPart = [&](string UId, string name) {
+            auto part = VRLADEngine::PartPtr( new Part(UId, cu, name) );
+            cu->parts[UId] = part;
+            return part;
+        };
+
+        auto addWire = [&](string UId) {
+            auto wire = VRLADEngine::WirePtr( new Wire(UId, cu) );
+            cu->wires[UId] = wire;
+            return wire;
+        };
+
+        auto addPower = [&](string UId, string pID) {
+            auto power = addWire(UId);
+            power->powerrail = true;
+            cu->poweredWireIDs.push_back(power->ID);
+            power->addOutput(pID);
+        };
+
+        auto addOperand = [&](string UId, string aID, string pID, bool input) {
+            auto operand = addWire(UId);
+            operand->accessID = aID;
+            if (input) operand->addOutput(pID);
+            else operand->addInput(pID);
+            operand->addOperand(pID);
+        };
+
+        for (int i=0; i<N; i++) {
+            addUnit("cu"+::toString(100000+i)); // keeps the rungs ordered in the map
+            addAccess("a1", "v"+::toString(i));
+            addAccess("a2", "v"+::toString(i+1));
+            addPart("p1", "Contact")->negated = (i%3 == 2);
+            addPart("p2", "Coil");
+            addPower("w1", "p1");
+            addOperand("w2", "a1", "p1", true);
+            auto link = addWire("w3");
+            link->addInput("p1");
+            link->addOutput("p2");
+            addOperand("w4", "a2", "p2", true);
+        }
+
+        addUnit("move");
+        vector<pair<string, string>> moves = { {"16#FF", "mask2"}, {"delay", "delay2"}, {"position", "position2"} };
+        for (size_t i = 0; i < moves.size(); i++) {
+            string k = ::toString(int(i));
+            addAccess("in"+k, moves[i].first, i == 0);
+            addAccess("out"+k, moves[i].second);
+            addPart("p"+k, "Move");
+            addPower("w"+k, "p"+k);
+            addOperand("wi"+k, "in"+k, "p"+k, true);
+            addOperand("wo"+k, "out"+k, "p"+k, false);
+        }
+
+        addUnit("calc"); // product := factor * 4 if position >= 100
+        addAccess("a1", "position");
+        addAccess("a2", "100", true);
+        addAccess("a3", "factor");
+        addAccess("a4", "4", true);
+        addAccess("a5", "product");
+        addPart("p1", "Ge");
+        addPart("p2", "Calc");
+        addPower("w1", "p1");
+        addOperand("w2", "a1", "p1", true);
+        addOperand("w3", "a2", "p1", true);
+        auto link = addWire("w4");
+        link->addInput("p1");
+        link->addOutput("p2");
+        addOperand("w5", "a3", "p2", true);
+        addOperand("w6", "a4", "p2", true);
+        addOperand("w7", "a5", "p2", false);
+        return engine;
+    };
+
+    auto interpreted = build();
+    auto compiled = build();
+    interpreted->setCompiled(false);
+
+    VRTimer t;
+    interpreted->iterate();
+    double tInterpreted = t.stop(); t.reset();
+    compiled->compile();
+    double tCompile = t.stop(); t.reset();
+    compiled->iterate();
+    double tCompiled = t.stop(); t.reset();
+
+    bool equivalent = true;
+    for (auto cuID : interpreted->getCompileUnits()) {
+        auto cu = interpreted->getCompileUnit(cuID);
+        auto cu2 = compiled->getCompileUnit(cuID);
+        for (auto& w : cu->wires) if (w.second->lastComputationResult != cu2->wires[w.first]->lastComputationResult) equivalent = false;
+        for (auto& p : cu->parts) if (p.second->lastComputationResult != cu2->parts[p.first]->lastComputationResult) equivalent = false;
+        for (auto& v : cu->variables) if (v.second->getValue() != cu2->variables[v.first]->getValue()) equivalent = false;
+    }
+    check(equivalent, "compiled and interpreted results differ");
+
+    auto moved = compiled->getCompileUnit("move")->variables;
+    check(moved["mask2"]->getValue() == "16#FF" && moved["delay2"]->getValue() == "T#5s" && moved["position2"]->getValue() == "123456.789",
+          "moved values changed: " + moved["mask2"]->getValue() + " " + moved["delay2"]->getValue() + " " + moved["position2"]->getValue());
+    check(toFloat(moved["product"]->getValue()) == 10, "product is " + moved["product"]->getValue());
+    check(build()->verify(3), "verify");
+
+    t.reset();
+    int Ncycles = 100;
+    compiled->iterate(Ncycles);
+    double tCycle = t.stop() / Ncycles;
+
+    cout << "LAD benchmark, " << N << " rungs: interpreted " << tInterpreted << " ms, compile " << tCompile << " ms, compiled " << tCompiled
+         << " ms, stable scan cycle " << tCycle << " ms" << endl;
+    cout << "LAD benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
+
+bool sclEngineBenchmark() { // loops, a state machine, a timer and global tags, checked against the same logic in C++
+    string scl =
+        "FUNCTION_BLOCK \"Bench\"\n"
+        "VAR\n"
+        "  counter : DInt;\n"
+        "  state : Int := 0;\n"
+        "  level : Real;\n"
+        "  i : Int;\n"
+        "  delay : TON;\n"
+        "END_VAR\n"
+        "VAR_TEMP\n"
+        "  sum : DInt;\n"
+        "END_VAR\n"
+        "BEGIN\n"
+        "  #sum := 0;\n"
+        "  FOR #i := 1 TO 100 DO\n"
+        "    #sum := #sum + #i;\n"
+        "  END_FOR;\n"
+        "  #counter := #counter + 1;\n"
+        "  CASE #state OF\n"
+        "    0: IF \"start\" THEN #state := 1; END_IF;\n"
+        "    1: #level := #level + 0.5; IF #level >= 10.0 THEN #state := 2; END_IF;\n"
+        "    2: #level := MAX(#level - 1.0, 0.0); IF #level <= 0.0 THEN #state := 0; END_IF;\n"
+        "  ELSE\n"
+        "    #state := 0;\n"
+        "  END_CASE;\n"
+        "  #delay(IN := #state = 1, PT := T#10ms);\n"
+        "  \"sum\" := #sum;\n"
+        "  \"pump\" := #state = 1;\n"
+        "  \"alarm\" := #delay.Q;\n"
+        "END_FUNCTION_BLOCK\n";
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " SCL benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    auto engine = VRSCLEngine::create();
+    VRTimer t;
+    auto script = engine->addSCL("bench", scl);
+    double tCompile = t.stop();
+    check(script->getProgram() != 0, "compilation failed");
+    if (!ok) return false;
+    script->getProgram()->setCycleTime(1);
+    script->setValue("start", 1);
+
+    int state = 0, counter = 0, Ncheck = 1000;
+    double level = 0, delayStart = 0;
+    bool valid = true;
+    for (int i=1; i<=Ncheck && valid; i++) { // reference model, one cycle of 1 ms
+        engine->iterate();
+        counter++;
+        if (state == 0) state = 1;
+        else if (state == 1) { level += 0.5; if (level >= 10) state = 2; }
+        else if (state == 2) { level = max(level - 1.0, 0.0); if (level <= 0) state = 0; }
+        bool wasRunning = delayStart > 0;
+        if (state != 1) delayStart = 0;
+        else if (!wasRunning) delayStart = i;
+        bool alarm = delayStart > 0 && i - delayStart >= 10;
+
+        valid = script->getValue("sum") == 5050 && script->getValue("counter") == counter && script->getValue("state") == state
+             && script->getValue("level") == level && script->getValue("pump") == (state == 1) && script->getValue("alarm") == alarm;
+        check(valid, "cycle " + toString(i) + " differs from the reference");
+    }
+
+    vector<string> unsupported = { // must fail the compilation instead of running without the missing parts
+        "VAR\n  s : STRUCT a : Int; END_STRUCT;\nEND_VAR\nBEGIN\n  #a := 1;\n",
+        "VAR\n  a : Int;\nEND_VAR\nBEGIN\n  #pid(IN := TRUE);\n",
+        "VAR\n  a : Int;\nEND_VAR\nBEGIN\n  #a := #pid.Q;\n"
+    };
+    for (auto& u : unsupported) {
+        check(!engine->addSCL("unsupported", u)->getProgram(), "unsupported program compiled: " + u);
+    }
+
+    t.reset();
+    int Ncycles = 100000;
+    engine->iterate(Ncycles);
+    double tCycle = t.stop() * 1000.0 / Ncycles;
+
+    cout << "SCL benchmark: compile " << tCompile << " ms, " << Ncycles << " cycles, " << tCycle << " us per cycle" << endl;
+    cout << "SCL benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,213 @@
+#include "VRTestCases.h"
+
+#include "addons/Semantics/Reasoning/VROntology.h"
+#include "addons/Semantics/Reasoning/VROntologyIndex.h"
+#include "addons/Semantics/Reasoning/VRReasoner.h"
+#include "addons/Semantics/Reasoning/VRConcept.h"
+#include "addons/Semantics/Reasoning/VREntity.h"
+#include "addons/Semantics/Reasoning/VRProperty.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool ontologyIndexBenchmark() { // query latency against ontology size, index vs linear is_a scan, cached reasoner queries
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " ontology benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    for (int N : {1000, 10000, 100000}) {
+        auto o = VROntology::create("benchmark");
+        auto machine = o->addConcept("Machine");
+        machine->addProperty("state", "string");
+        machine->addProperty("cell", "string");
+        o->addConcept("Robot", "Machine");
+        o->addConcept("Conveyor", "Machine");
+        o->addConcept("Cell");
+
+        size_t Nmachines = 0, Nerrors = 0, NrobotErrors = 0;
+        vector<string> types = {"Robot", "Conveyor", "Cell"};
+        for (int i=0; i<N; i++) {
+            auto e = o->addEntity("e"+::toString(i), types[i%3]);
+            if (i%3 != 2) {
+                e->set("state", i%10 == 0 ? "error" : "ok");
+                e->set("cell", "e"+::toString(i - i%3 + 2));
+                Nmachines++;
+                if (i%10 == 0) Nerrors++;
+                if (i%10 == 0 && i%3 == 0) NrobotErrors++;
+            }
+        }
+
+        VRTimer t;
+        size_t n1 = o->getEntities("Machine").size();
+        double tIndex = t.stop(); t.reset();
+
+        size_t n2 = 0;
+        for (auto& e : o->entities) if (e.second->is_a("Machine")) n2++;
+        double tScan = t.stop(); t.reset();
+
+        size_t n3 = o->getEntitiesByValue("state", "error").size();
+        double tValue = t.stop(); t.reset();
+
+        size_t n4 = o->getReferencing(o->getEntity("e2")).size();
+        double tRef = t.stop();
+
+        cout << "ontology benchmark, " << N << " entities:" << endl;
+        cout << "  concept query " << n1 << " in " << tIndex << " ms (linear scan " << n2 << " in " << tScan << " ms)" << endl;
+        cout << "  value query " << n3 << " in " << tValue << " ms, reference query " << n4 << " in " << tRef << " ms" << endl;
+        check(n1 == Nmachines && n2 == Nmachines, "concept query of "+::toString(N)+" entities");
+        check(n3 == Nerrors, "value query of "+::toString(N)+" entities");
+        check(n4 == 2, "reference query of "+::toString(N)+" entities");
+
+        string query = "q(r):Robot(r);is(r.state,error)";
+        t.reset();
+        size_t r1 = o->process(query).size();
+        double tFirst = t.stop(); t.reset();
+        size_t r2 = o->process(query).size();
+        double tCached = t.stop(); t.reset();
+        o->addEntity("extraCell", "Cell"); // does not affect the query
+        size_t r3 = o->process(query).size();
+        double tUnaffected = t.stop(); t.reset();
+        o->getEntity("e3")->set("state", "error");
+        size_t r4 = o->process(query).size();
+        double tChanged = t.stop();
+
+        cout << "  reasoner query " << r1 << " in " << tFirst << " ms, repeated " << r2 << " in " << tCached << " ms";
+        cout << ", after unrelated change " << r3 << " in " << tUnaffected << " ms, after robot change " << r4 << " in " << tChanged << " ms" << endl;
+        check(r1 == NrobotErrors && r2 == r1 && r3 == r1, "cached reasoner query of "+::toString(N)+" entities");
+        check(r4 == r1+1, "reasoner query after a change of "+::toString(N)+" entities");
+
+        if (N > 10000) continue; // the interpreter creates a variable for every entity
+        auto interpreter = VRReasoner::create();
+        interpreter->setOption("incremental", false);
+        t.reset();
+        size_t r5 = interpreter->process(query, o).size();
+        double tInterpreted = t.stop();
+        cout << "  interpreted query " << r5 << " in " << tInterpreted << " ms" << endl;
+        check(r5 == r4, "interpreted query of "+::toString(N)+" entities");
+    }
+
+    cout << "ontology benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
+
+bool ontologyIndexTest() { // the indices follow direct edits of property values and of the taxonomy
+    auto o = VROntology::create("indexTest");
+    auto machine = o->addConcept("Machine");
+    machine->addProperty("state", "string");
+    o->addConcept("Robot", "Machine");
+    o->addConcept("Device");
+    auto r1 = o->addEntity("r1", "Robot");
+    auto r2 = o->addEntity("r2", "Robot");
+    r1->set("state", "ok");
+    r2->set("state", "ok");
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " ontology index test failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    auto byValue = [&](string v) { return o->getEntitiesByValue("state", v).size(); };
+    check(byValue("ok") == 2 && byValue("error") == 0, "initial values");
+
+    r1->properties["state"][0]->setValue("error"); // bypasses VREntity::set
+    check(byValue("ok") == 1 && byValue("error") == 1, "value changed by the property");
+    auto errors = o->getEntitiesByValue("state", "error");
+    check(errors.size() == 1 && errors[0] == r1, "entity found by its new value");
+
+    o->getConcept("Device")->append( o->getConcept("Machine") ); // Machine gets a second parent
+    check(o->getEntities("Device").size() == 2, "entities of a concept appended to another");
+
+    o->getConcept("Device")->removeChild( o->getConcept("Machine") );
+    check(o->getEntities("Device").size() == 0, "entities of a concept removed from another");
+
+    size_t schema = o->schemaVersion;
+    o->rebuildIndex();
+    check(o->schemaVersion == schema, "index rebuild keeps the schema");
+
+    auto other = VROntology::create("indexTestOther");
+    auto tool = other->addConcept("Tool");
+    tool->append( other->addConcept("Hammer") );
+    other->getConcept("Hammer")->removeParent(tool);
+    check(!o->index->needsRebuild() && o->schemaVersion == schema, "taxonomy change of another ontology");
+
+    cout << "ontology index test " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
+
+bool reasonerCompiledTest() { // compiled queries against the interpreter on a fixed ontology, before and after changes
+    auto o = VROntology::create("reasonerTest");
+    auto machine = o->addConcept("Machine");
+    machine->addProperty("state", "string");
+    machine->addProperty("cell", "string");
+    o->addConcept("Robot", "Machine");
+    o->addConcept("Conveyor", "Machine");
+    o->addConcept("Cell");
+    o->addRule("inCell(m,c):Machine(m);Cell(c);has(m,c)", "Machine");
+
+    o->addEntity("c1", "Cell");
+    o->addEntity("c2", "Cell");
+    auto r1 = o->addEntity("r1", "Robot", {{"state", "error"}, {"cell", "c1"}});
+    auto r2 = o->addEntity("r2", "Robot", {{"state", "ok"}, {"cell", "c2"}});
+    auto r3 = o->addEntity("r3", "Robot", {{"state", "ok"}, {"cell", "c1"}});
+    auto v1 = o->addEntity("v1", "Conveyor", {{"state", "error"}, {"cell", "c2"}});
+
+    vector<string> queries = {
+        "q(r):Robot(r);is(r.state,error)",
+        "q(m):Machine(m)",
+        "q(r):is(r.state,ok);Robot(r)", // declared after the filter
+        "q(m):Machine(m);has(m,c1)",
+        "q(c):Cell(c);Machine(m);is(m.state,error);has(m,c)",
+        "q(m):Machine(m);inCell(m,c2)", // rule
+        "q(r):Robot(r);is(r.cell,r1.cell)" // entity on the right side
+    };
+
+    auto compiled = VRReasoner::create();
+    auto interpreter = VRReasoner::create();
+    interpreter->setOption("incremental", false);
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " reasoner test failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    auto names = [](vector<VREntityPtr> entities) {
+        string s;
+        for (auto e : entities) s += e->getName() + " ";
+        return s;
+    };
+
+    auto compare = [&](string when) {
+        for (auto q : queries) {
+            string a = names( compiled->process(q, o) );
+            string b = names( interpreter->process(q, o) );
+            check(a == b, q + " " + when + ", compiled: " + a + ", interpreted: " + b);
+            string mode = compiled->getMode(q);
+            check(mode == "compiled" || mode == "incremental", q + " is not compiled");
+        }
+    };
+
+    compare("initially");
+    check(names(compiled->process(queries[0], o)) == "r1 ", "initial errors");
+    check(compiled->getMode(queries[0]) == "incremental", "single variable query is not incremental");
+
+    r2->set("state", "error");
+    r3->set("cell", "c2");
+    o->addEntity("r4", "Robot", {{"state", "error"}, {"cell", "c1"}});
+    o->remEntity(v1);
+    compare("after changes");
+    check(names(compiled->process(queries[0], o)) == "r1 r2 r4 ", "errors after changes");
+    check(compiled->getMode(queries[0]) == "incremental", "errors are no longer updated incrementally");
+
+    r1->properties["state"][0]->setValue("ok"); // bypasses VREntity::set
+    compare("after a direct value change");
+
+    cout << "reasoner test " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,70 @@
+#include "VRTestCases.h"
+
+#ifndef WITHOUT_AV
+#include "core/tools/VRRecorder.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+#include "core/utils/system/VRSystem.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool recorderBenchmark() { // headless, synthetic 720p frames at 60 fps and as a burst without pacing
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " recorder benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    int W = 1280;
+    int H = 720;
+    vector<unsigned char> img(W*H*3);
+    auto fillFrame = [&](int i) {
+        for (int y=0; y<H; y++) {
+            unsigned char* row = &img[y*W*3];
+            for (int x=0; x<W; x++) {
+                row[3*x+0] = (unsigned char)(x + i*4);
+                row[3*x+1] = (unsigned char)(y + i*2);
+                row[3*x+2] = (unsigned char)((x^y) + i);
+            }
+        }
+    };
+
+    for (bool paced : {true, false}) {
+        string mode = paced ? "60 fps" : "burst";
+        string path = paced ? "recorder_benchmark_paced.avi" : "recorder_benchmark_burst.avi";
+        auto rec = VRRecorder::create();
+        rec->setOutput(path);
+        int N = 300;
+        int accepted = 0;
+        double tPush = 0;
+        VRTimer timer;
+        for (int i=0; i<N; i++) {
+            fillFrame(i);
+            VRTimer t;
+            if (rec->pushFrame(&img[0], W, H)) accepted++;
+            tPush += t.stop();
+            if (paced) doFrameSleep(timer.stop(), 60);
+            timer.reset();
+        }
+
+        VRTimer t;
+        rec->compile(path);
+        double tFlush = t.stop();
+        auto stats = rec->getStats();
+        size_t bytes = exists(path) ? readFileContent(path).size() : 0;
+
+        cout << "recorder benchmark " << mode << ": main thread " << tPush*1000.0/N << " us per frame, captured " << stats["captured"] << ", dropped " << stats["dropped"];
+        cout << ", " << stats["fps"] << " fps, encoder " << stats["encodedFps"] << " fps, lag " << stats["lag"] << " ms (max " << stats["maxLag"] << "), flush " << tFlush << " ms, " << bytes/1024 << " kB" << endl;
+        check(accepted > 0 && stats["captured"] == accepted, mode+", captured frames");
+        check(stats["captured"] + stats["dropped"] == N, mode+", captured and dropped frames");
+        check(stats["encoded"] == stats["captured"] && stats["queued"] == 0, mode+", encoded frames after the flush");
+        check(bytes > 0, mode+", video file");
+        removeFile(path);
+    }
+
+    cout << "recorder benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
+#endif
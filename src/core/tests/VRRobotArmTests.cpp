@@ -0,0 +1,93 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/VRRobotArm.h"
+#include "core/math/pose.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+#include <random>
+
+using namespace OSG;
+
+bool robotKinematicsBenchmark() { // path validation for a cell of robots with different geometries
+    int Narms = 100;
+    int Nposes = 1000;
+
+    mt19937 rng(42);
+    uniform_real_distribution<double> U(-1, 1);
+
+    vector<VRRobotArmPtr> arms;
+    vector<vector<PosePtr>> paths;
+    for (int i=0; i<Narms; i++) {
+        auto arm = VRRobotArm::create("kuka");
+        arm->setLengths({ 0.2, float(0.25 + 0.001*i), 0.3, 0.2, 0.03 });
+        arm->setAxisOffsets({ 0.05, 0.02 });
+        arm->setJointLimits({ Vec2d(-2.9, 2.9), Vec2d(-2.0, 1.0), Vec2d(-1.0, 4.0), Vec2d(-3.0, 3.0), Vec2d(-2.1, 2.1), Vec2d(-6.0, 6.0) });
+        arms.push_back(arm);
+
+        vector<PosePtr> path;
+        for (int j=0; j<Nposes; j++) {
+            if (j%2 == 0) { // reachable by construction
+                vector<float> angles;
+                for (int k=0; k<6; k++) angles.push_back(U(rng)*Pi*0.5);
+                path.push_back( arm->calcForwardKinematicsBatch({angles})[0] );
+            } else { // random poses, partially out of range
+                Vec3d p(U(rng)*0.7, 0.2+U(rng)*0.5, U(rng)*0.7);
+                Vec3d d(U(rng), U(rng), U(rng));
+                d.normalize();
+                Vec3d u = d.cross(Vec3d(U(rng), U(rng), U(rng)));
+                u.normalize();
+                path.push_back( Pose::create(p, d, u) );
+            }
+        }
+        paths.push_back(path);
+    }
+
+    VRTimer timer;
+    vector<vector<bool>> reference(Narms);
+    for (int i=0; i<Narms; i++) {
+        for (auto& p : paths[i]) reference[i].push_back( arms[i]->canReach(p, true) );
+    }
+    double tSequential = timer.stop();
+
+    timer.reset();
+    vector<vector<int>> flags;
+    for (int i=0; i<Narms; i++) flags.push_back( arms[i]->checkPoses(paths[i], true) );
+    double tBatch = timer.stop();
+
+    int Nreachable = 0;
+    int NinLimits = 0;
+    int Nsingular = 0;
+    bool valid = true;
+    for (int i=0; i<Narms; i++) {
+        for (int j=0; j<Nposes; j++) {
+            int f = flags[i][j];
+            if (f & VRRobotArm::REACHABLE) Nreachable++;
+            if (f & VRRobotArm::IN_LIMITS) NinLimits++;
+            if (f & VRRobotArm::SINGULAR) Nsingular++;
+            if (bool(f & VRRobotArm::REACHABLE) != reference[i][j]) valid = false;
+        }
+    }
+
+    timer.reset();
+    for (int i=0; i<Narms; i++) arms[i]->calcReverseKinematicsBatch(paths[i], true);
+    double tIK = timer.stop();
+
+    int N = Narms*Nposes;
+    cout << "Robot kinematics benchmark, " << Narms << " robots, " << N << " poses" << endl;
+    cout << " sequential canReach: " << tSequential << " ms, " << tSequential*1000.0/N << " us per pose" << endl;
+    cout << " batched check: " << tBatch << " ms, " << tBatch*1000.0/N << " us per pose (speedup " << tSequential/max(tBatch, 1e-3) << ")" << endl;
+    cout << " batched reverse kinematics only: " << tIK << " ms" << endl;
+    cout << " reachable " << Nreachable << ", in limits " << NinLimits << ", near singularity " << Nsingular << endl;
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " robot kinematics benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    check(valid, "batched reachability differs from canReach");
+    check(Nreachable > 0 && Nreachable < N, "all or none of the poses are reachable");
+    cout << "robot kinematics benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
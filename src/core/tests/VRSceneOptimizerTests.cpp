@@ -0,0 +1,89 @@
+#include "VRTestCases.h"
+
+#include "core/scene/rendering/VRSceneOptimizer.h"
+#include "core/objects/geometry/VRGeometry.h"
+#include "core/objects/material/VRMaterial.h"
+#include "core/setup/devices/VRIntersect.h"
+#include "core/math/kinematics/VRConstraint.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool sceneOptimizerBenchmark() { // a grid of small parts with a few materials and repeated high resolution meshes
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " scene optimizer benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    int N = 64;
+    auto root = VRObject::create("optimizerBench");
+
+    vector<VRMaterialPtr> mats;
+    for (int i=0; i<4; i++) {
+        auto m = VRMaterial::create("optimizerBench"+toString(i));
+        m->setDiffuse(Color3f(0.2*i, 0.5, 0.8));
+        mats.push_back(m);
+    }
+
+    for (int i=0; i<N*N; i++) {
+        auto g = VRGeometry::create("part"+toString(i), "Box", "0.8 0.8 0.8 1 1 1");
+        g->setFrom(Vec3d(i%N, 0, i/N));
+        g->setMaterial(mats[i%4]);
+        root->addChild(g);
+    }
+
+    for (int i=0; i<64; i++) {
+        auto g = VRGeometry::create("tree"+toString(i), "Sphere", "0.5 3");
+        g->setFrom(Vec3d((i%8)*8 + 0.5, 2, (i/8)*8 + 0.5));
+        g->setMaterial(mats[0]);
+        root->addChild(g);
+    }
+
+    vector<Line> rays; // straight down onto the parts, below the trees
+    for (int i=0; i<N*N; i+=7) rays.push_back( Line(Pnt3f(i%N, 1.5, i/N), Vec3f(0,-1,0)) );
+
+    auto pick = [&]() {
+        vector<string> names;
+        for (auto& ins : VRIntersect::intersectRays(root, rays)) {
+            auto obj = ins->getIntersected();
+            names.push_back(obj ? obj->getName() : "");
+        }
+        return names;
+    };
+
+    auto moving = VRTransform::create("moving"); // below a constrained transform, left as it is
+    moving->getConstraint()->setActive(true);
+    root->addChild(moving);
+    auto part = VRGeometry::create("movingPart", "Box", "0.8 0.8 0.8 1 1 1");
+    part->setFrom(Vec3d(-2, 0, 0)); // outside of the rays
+    part->setMaterial(mats[0]);
+    moving->addChild(part);
+
+    map<VRGeometry*, OSGGeometryPtr> meshes;
+    for (auto obj : root->getChildren(true, "Geometry")) if (auto g = dynamic_pointer_cast<VRGeometry>(obj)) meshes[g.get()] = g->getMesh();
+
+    auto reference = pick();
+    auto optimizer = VRSceneOptimizer::create();
+    VRTimer t;
+    optimizer->optimize(root);
+    double tOptimize = t.stop();
+
+    auto s = optimizer->getStats();
+    cout << "scene optimizer benchmark, optimized in " << tOptimize << " ms, " << s["batched"] << " batched in " << s["chunks"] << " chunks, " << s["instanced"] << " instanced" << endl;
+    cout << " nodes " << s["nodesBefore"] << " -> " << s["nodesAfter"] << ", draws " << s["drawsBefore"] << " -> " << s["drawsAfter"];
+    cout << ", traversal " << s["traversalBefore"] << " -> " << s["traversalAfter"] << " ms" << endl;
+    check(pick() == reference, "picking after the optimization");
+    check(!VRSceneOptimizer::isBatched(part), "part below a constrained transform batched");
+    check(s["batched"] > 0 && s["drawsAfter"] < s["drawsBefore"], "no draws saved");
+
+    optimizer->restore();
+    check(pick() == reference, "picking after the restore");
+    for (auto m : meshes) if (m.first->getMesh() != m.second) { check(false, "original mesh of "+m.first->getName()); break; }
+
+    cout << "scene optimizer benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
@@ -0,0 +1,43 @@
+#ifndef VRTESTCASES_H_INCLUDED
+#define VRTESTCASES_H_INCLUDED
+
+/**
+ * Regression tests and benchmarks, run by name with VRRunTest.
+ * They print their results and return false if a check failed.
+ */
+
+#ifndef WITHOUT_TCP
+bool tcpFramedTest();
+bool udpBatchTest();
+#endif
+
+bool ontologyIndexBenchmark();
+bool ontologyIndexTest();
+bool reasonerCompiledTest();
+bool millingDexelsBenchmark();
+bool pipeSystemBenchmark();
+bool ladEngineBenchmark();
+bool sclEngineBenchmark();
+bool wiringSimulationBenchmark();
+bool mechanismBenchmark();
+bool gcodeBenchmark();
+bool robotKinematicsBenchmark();
+bool logisticsBenchmark();
+bool intersectRaysBenchmark();
+bool sceneIndexBenchmark();
+bool constraintsBenchmark();
+bool sceneOptimizerBenchmark();
+bool geoBuilderBenchmark();
+bool districtGenerationBenchmark();
+bool roadGenerationBenchmark();
+bool occlusionCullingBenchmark();
+
+#ifndef WITHOUT_CGAL
+bool csgBackendsBenchmark();
+#endif
+
+#ifndef WITHOUT_AV
+bool recorderBenchmark();
+#endif
+
+#endif // VRTESTCASES_H_INCLUDED
@@ -0,0 +1,101 @@
+#include "VRTestCases.h"
+
+#include "core/objects/VRTransform.h"
+#include "core/math/kinematics/VRConstraint.h"
+#include "core/utils/VRGlobals.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+#include <cmath>
+
+using namespace OSG;
+
+bool constraintsBenchmark() { // chains of hinges on moving bases, constrained in world space
+    int Nchains = 512;
+    int Nlinks = 8;
+    int Nframes = 50;
+
+    auto makeTree = [&](vector<VRTransformPtr>& roots, vector<VRTransformPtr>& links) {
+        for (int i=0; i<Nchains; i++) {
+            auto root = VRTransform::create("base");
+            roots.push_back(root);
+            VRTransformPtr parent = root;
+            for (int j=0; j<Nlinks; j++) {
+                auto link = VRTransform::create("link");
+                link->setFrom(Vec3d(0, 0.2, 0));
+                parent->addChild(link);
+                auto c = VRConstraint::create();
+                c->free({0,2,5});
+                c->lock({3,4});
+                c->setMinMax(1, -0.5, 0.5 + 0.1*j); // height band
+                link->setConstraint(c);
+                links.push_back(link);
+                parent = link;
+            }
+        }
+    };
+
+    auto moveRoots = [&](vector<VRTransformPtr>& roots, int f) {
+        for (size_t i=0; i<roots.size(); i++) {
+            double a = 0.1*f + 0.01*i;
+            roots[i]->setTransform(Vec3d(i%32, sin(a), i/32), Vec3d(0.3*cos(a), 0.5*sin(a), -1), Vec3d(0,1,0));
+        }
+    };
+
+    auto setActive = [](vector<VRTransformPtr>& links, bool b) {
+        for (auto& l : links) l->getConstraint()->setActive(b);
+    };
+
+    auto updateReference = [](vector<VRTransformPtr>& links) { // the former serial update, in chain order
+        for (auto& obj : links) {
+            if (!obj->getConstraint()->isActive()) continue;
+            obj->updateChange();
+        }
+    };
+
+    vector<VRTransformPtr> rootsA, linksA, rootsB, linksB;
+    makeTree(rootsA, linksA);
+    makeTree(rootsB, linksB);
+
+    VRTimer timer;
+    double tSerial = 0;
+    double tLevels = 0;
+    double deviation = 0;
+    for (int f=0; f<2*Nframes; f++) { // moving bases first, then static frames
+        VRGlobals::CURRENT_FRAME++;
+        if (f < Nframes) {
+            moveRoots(rootsA, f);
+            moveRoots(rootsB, f);
+        }
+
+        setActive(linksA, true);
+        setActive(linksB, false);
+        timer.reset();
+        updateReference(linksA);
+        double t1 = timer.stop();
+
+        setActive(linksA, false);
+        setActive(linksB, true);
+        timer.reset();
+        VRTransform::updateConstraints();
+        double t2 = timer.stop();
+
+        if (f == Nframes) {
+            cout << "constraint benchmark, moving: serial " << tSerial/Nframes << " ms, levels " << tLevels/Nframes << " ms per frame" << endl;
+            tSerial = tLevels = 0;
+        }
+        tSerial += t1;
+        tLevels += t2;
+
+        for (size_t i=0; i<linksA.size(); i++) {
+            deviation = max(deviation, (linksA[i]->getWorldPosition() - linksB[i]->getWorldPosition()).length());
+            deviation = max(deviation, (linksA[i]->getWorldDirection() - linksB[i]->getWorldDirection()).length());
+        }
+    }
+
+    bool ok = deviation < 1e-6;
+    cout << "constraint benchmark, static: serial " << tSerial/Nframes << " ms, levels " << tLevels/Nframes << " ms per frame" << endl;
+    cout << " " << linksA.size() << " links per tree, max deviation " << deviation << endl;
+    cout << "constraint benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
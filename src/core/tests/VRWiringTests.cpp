@@ -0,0 +1,129 @@
+#include "VRTestCases.h"
+
+#include "addons/Engineering/Wiring/VRWiringSimulation.h"
+#include "addons/Engineering/Wiring/VRElectricComponent.h"
+#include "addons/Engineering/Wiring/VRElectricSystem.h"
+#include "addons/Engineering/Wiring/VRWire.h"
+#include "addons/Semantics/Reasoning/VREntity.h"
+#include "addons/Semantics/Reasoning/VRProperty.h"
+#include "addons/Semantics/Reasoning/VROntology.h"
+#include "core/utils/toString.h"
+#include "core/utils/VRTimer.h"
+
+#include <iostream>
+
+using namespace OSG;
+
+bool wiringSimulationBenchmark() { // branches of a switch and a chain of connectors and fuses
+    int Nbranches = 100;
+    int Nchain = 100;
+
+    bool ok = true;
+    auto check = [&](bool b, string what) {
+        if (!b) cout << " wiring benchmark failed: " << what << endl;
+        ok = ok && b;
+    };
+
+    auto o = VROntology::create("wiring");
+    o->addConcept("Component", "", {{"state", "string"}});
+    o->addConcept("ConnectorComponent", "Component");
+    o->addConcept("Switch", "Component");
+    o->addConcept("Fuse", "Component");
+    o->addConcept("Port", "", {{"current", "string"}});
+    o->addConcept("Wire", "", {{"current", "string"}});
+
+    auto system = VRElectricSystem::create();
+    auto sim = system->getSimulation();
+    sim->setSource("=BENCH+-XPWR", "0");
+
+    auto addComponent = [&](string ecadID, string concept, string state) {
+        auto c = system->newComponent("", ecadID, "");
+        c->setEntity( o->addEntity(ecadID, concept, {{"state", state}}) );
+        for (string port : {"0", "1"}) {
+            c->addPort(port, ecadID + ":" + port, "", "");
+            c->setPortEntity(port, o->addEntity(ecadID + ":" + port, "Port"));
+        }
+        return c;
+    };
+
+    auto connect = [&](VRElectricComponentPtr c1, VRElectricComponentPtr c2) {
+        auto w = VRWire::create();
+        w->setEntity( o->addEntity(c1->ecadID + "-" + c2->ecadID, "Wire") );
+        w->source = VRElectricComponent::Address(c1->ecadID + ":1");
+        w->source.ecadID = c1->ecadID;
+        w->source.port = "1";
+        w->target = VRElectricComponent::Address(c2->ecadID + ":0");
+        w->target.ecadID = c2->ecadID;
+        w->target.port = "0";
+        c1->connections.push_back(w);
+        c2->connections.push_back(w);
+        c1->ports["1"].connection = w;
+        c2->ports["0"].connection = w;
+    };
+
+    auto source = addComponent("=BENCH+-XPWR", "ConnectorComponent", "");
+    vector<VRElectricComponentPtr> switches;
+    vector<VRElectricComponentPtr> ends; // last component of each branch
+    for (int b = 0; b < Nbranches; b++) {
+        auto previous = addComponent("S"+::toString(b), "Switch", "pressed");
+        switches.push_back(previous);
+        connect(source, previous);
+        for (int k = 0; k < Nchain; k++) {
+            string ID = "C"+::toString(b)+"_"+::toString(k);
+            auto c = k%10 == 9 ? addComponent(ID, "Fuse", "closed") : addComponent(ID, "ConnectorComponent", "");
+            connect(previous, c);
+            previous = c;
+        }
+        ends.push_back(previous);
+    }
+
+    auto snapshot = [&]() {
+        vector<string> res;
+        for (auto& c : system->getComponents()) {
+            for (auto& p : c.second->ports) res.push_back(p.second.entity->get("current")->getValue());
+            for (auto& w : c.second->connections) res.push_back(w->entity->get("current")->getValue());
+        }
+        return res;
+    };
+
+    auto compare = [&](string when) { // reference result after the event driven result
+        auto s = snapshot();
+        sim->iterateReference();
+        check(s == snapshot(), "event driven and reference currents differ " + when);
+    };
+
+    auto powered = [&](int branch) { return ends[branch]->ports["0"].entity->get("current")->getValue() == "1"; };
+
+    VRTimer t;
+    sim->iterateReference();
+    double tReference = t.stop(); t.reset();
+    sim->iterate();
+    double tCompile = t.stop(); t.reset();
+    compare("initially");
+    bool allPowered = true;
+    for (int b = 0; b < Nbranches; b++) allPowered = allPowered && powered(b);
+    check(allPowered, "branches of pressed switches without current");
+
+    t.reset();
+    int Nidle = 100;
+    for (int i = 0; i < Nidle; i++) sim->iterate();
+    double tIdle = t.stop() / Nidle;
+
+    double tToggle = 0;
+    int Ntoggles = 20;
+    for (int i = 0; i < Ntoggles; i++) {
+        int branch = (i/2*7) % Nbranches;
+        auto e = switches[branch]->entity; // open, then close again
+        e->set("state", i%2 == 0 ? "unpressed" : "pressed");
+        t.reset();
+        sim->iterate();
+        tToggle += t.stop() / Ntoggles;
+        check(powered(branch) == (i%2 == 1), "current of branch " + ::toString(branch) + " after toggle " + ::toString(i));
+        compare("after toggle " + ::toString(i));
+    }
+
+    cout << "Wiring benchmark, " << system->getComponents().size() << " components: reference " << tReference << " ms, compile " << tCompile
+         << " ms, idle frame " << tIdle << " ms, switch toggle " << tToggle << " ms" << endl;
+    cout << "wiring benchmark " << (ok ? "passed" : "FAILED") << endl;
+    return ok;
+}
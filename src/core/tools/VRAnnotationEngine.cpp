@@ -187,6 +187,8 @@ bool VRAnnotationEngine::applyIntersectionAction(Action* action) {
 	else return VRGeometry::applyIntersectionAction(action); // fallback
 }
 
+TriangleBVHPtr VRAnnotationEngine::getBVH() { return 0; } // labels are intersected by applyIntersectionAction
+
 bool VRAnnotationEngine::checkUIn(int i) {
     if (i < 0 || i > (int)data->size()) return true;
     return false;
@@ -82,6 +82,7 @@ class VRAnnotationEngine : public VRGeometry {
         map<int, string> getLabels();
 
         virtual bool applyIntersectionAction(Action* ia) override;
+        virtual TriangleBVHPtr getBVH() override;
 };
 
 OSG_END_NAMESPACE;
@@ -11,6 +11,8 @@
 #include "core/utils/VRFunction.h"
 #include "core/utils/VRGlobals.h"
 #include "core/utils/system/VRSystem.h"
+#include "core/utils/Thread.h"
+#include "core/math/pose.h"
 
 #include <OpenSG/OSGImage.h>
 
@@ -25,64 +27,36 @@ extern "C" {
 using namespace OSG;
 
 namespace OSG {
-class VRFrame {
+class VRFrame { // pooled frame buffer, reused during the whole recording
     public:
-        VRTexturePtr capture = 0;
-        int timestamp = 0;
-
-        int valid = 0;
-        int pktSize = 0;
-        vector<char> pktData;
-
-        int width = 0;
-        int height = 0;
-
-        Vec3d f,a,u; // from at up
-
-        VRFrame() {}
-        ~VRFrame() {}
-
-        void transcode(AVFrame* frame, AVCodecContext* codec_context, SwsContext* sws_context, int i) {
-            valid = 0;
-            if (!capture) return;
-
-            AVPacket pkt;
-            av_init_packet(&pkt);
-            pkt.data = NULL;    // packet data will be allocated by the encoder
-            pkt.size = 0;
-
-            const unsigned char* data = capture->getImage()->getData();
-            if (codec_context->pix_fmt == AV_PIX_FMT_YUV420P) {
-                const int in_linesize[1] = { 3 * codec_context->width };
-                sws_scale(sws_context, (const uint8_t * const *)&data, in_linesize, 0, codec_context->height, frame->data, frame->linesize);
-            }
-
-            /* encode the image */
-            frame->pts = i;
-            int ret = avcodec_send_frame(codec_context, frame);
-            //int ret = avcodec_encode_video2(codec_context, &pkt, frame, valid);
-            if (ret < 0) { fprintf(stderr, "Error encoding frame\n"); return; }
-
-            while (ret >= 0) {
-                ret = avcodec_receive_packet(codec_context, &pkt);
-                //if (ret == AVERROR(EAGAIN)) break;
-                if (ret < 0) return;
-
-
-                pktSize += pkt.size;
-                pktData.resize(pktSize);
-                memcpy(&pktData[pktSize - pkt.size], pkt.data, pkt.size);
-
-                av_packet_unref(&pkt);
-
-                if (ret == AVERROR_EOF) break;
-            }
-
-            capture = 0;
+        int index = 0;
+        double captureTime = 0; // ms
+        vector<unsigned char> rgb;
+        AVFrame* yuv = 0;
+
+        VRFrame(int width, int height) {
+            rgb.resize(width*height*3);
+#ifdef OLD_LIBAV
+            yuv = avcodec_alloc_frame();
+#else
+            yuv = av_frame_alloc();
+#endif
+            if (!yuv) { fprintf(stderr, "Could not allocate video frame\n"); return; }
+            yuv->format = AV_PIX_FMT_YUV420P;
+            yuv->width  = width;
+            yuv->height = height;
+            int ret = av_image_alloc(yuv->data, yuv->linesize, width, height, AV_PIX_FMT_YUV420P, 32);
+            if (ret < 0) fprintf(stderr, "Could not allocate raw picture buffer\n");
         }
 
-        void write(FILE* f) {
-            if (valid) fwrite(&pktData[0], 1, pktSize, f);
+        ~VRFrame() {
+            if (!yuv) return;
+            av_freep(&yuv->data[0]);
+#ifdef OLD_LIBAV
+            avcodec_free_frame(&yuv);
+#else
+            av_frame_free(&yuv);
+#endif
         }
 };
 }
@@ -98,12 +72,14 @@ VRRecorder::VRRecorder() {
     toggleCallback = VRFunction<bool>::create("recorder toggle", bind(&VRRecorder::setRecording, this, _1));
     updateCallback = VRUpdateCb::create("recorder update", bind(&VRRecorder::capture, this));
 
-    //initCodec();
     setCodec("MPEG2VIDEO");
     setBitrate(20);
 }
 
-VRRecorder::~VRRecorder() { ; }
+VRRecorder::~VRRecorder() {
+    stopPipeline();
+}
+
 shared_ptr<VRRecorder> VRRecorder::create() { return shared_ptr<VRRecorder>(new VRRecorder()); }
 
 void VRRecorder::setView(int i) {
@@ -113,21 +89,22 @@ void VRRecorder::setView(int i) {
 }
 
 void VRRecorder::setMaxFrames(int maxf) { maxFrames = maxf; }
-bool VRRecorder::frameLimitReached() { return ((int)captures.size() == maxFrames); }
+bool VRRecorder::frameLimitReached() { return ((int)poses.size() == maxFrames); }
+void VRRecorder::setBufferSize(int N) { poolSize = max(N, 2); } // applies to the next recording
+void VRRecorder::setOutput(string path) { outPath = path; }
 
 void VRRecorder::setTransform(VRTransformPtr t, int f) {
-    if (f >= (int)captures.size() || f < 0) return;
-    VRFrame* fr = captures[f];
-    cout << "setTransform " << t->getName() << " " << fr->f << endl;
-    t->setFrom(fr->f);
-    t->setAt(fr->a);
-    t->setUp(fr->u);
+    if (f >= (int)poses.size() || f < 0) return;
+    cout << "setTransform " << t->getName() << " " << getFrom(f) << endl;
+    t->setFrom(getFrom(f));
+    t->setAt(getAt(f));
+    t->setUp(getUp(f));
 }
 
-Vec3d VRRecorder::getFrom(int f) { VRFrame* fr = captures[f]; return fr->f; }
-Vec3d VRRecorder::getDir(int f) { VRFrame* fr = captures[f]; Vec3d d = fr->a - fr->f; d.normalize(); return d; }
-Vec3d VRRecorder::getAt(int f) { VRFrame* fr = captures[f]; return fr->a; }
-Vec3d VRRecorder::getUp(int f) { VRFrame* fr = captures[f]; return fr->u; }
+Vec3d VRRecorder::getFrom(int f) { return poses[f]->pos(); }
+Vec3d VRRecorder::getDir(int f) { Vec3d d = poses[f]->dir(); d.normalize(); return d; }
+Vec3d VRRecorder::getAt(int f) { return poses[f]->pos() + poses[f]->dir(); }
+Vec3d VRRecorder::getUp(int f) { return poses[f]->up(); }
 
 void VRRecorder::capture() {
     auto v = view.lock();
@@ -138,26 +115,186 @@ void VRRecorder::capture() {
     if (!v) return;
     if (frameLimitReached()) return;
 
-    //int ts = VRGlobals::get()->CURRENT_FRAME;
-    VRFrame* f = new VRFrame();
-    captures.push_back(f);
-    f->capture = v->grab();
-    f->timestamp = getTime()*1e-3;
+    auto tex = v->grab();
+    if (!tex || !tex->getImage()) return;
+    lastCapture = tex;
 
+    PosePtr pose;
     VRTransformPtr t = v->getCamera();
-    if (t == 0) return;
-    f->f = t->getFrom();
-    f->a = t->getAt();
-    f->u = t->getUp();
+    if (t) pose = Pose::create(t->getFrom(), t->getAt() - t->getFrom(), t->getUp());
+
+    auto img = tex->getImage();
+    pushFrame(img->getData(), img->getWidth(), img->getHeight(), pose);
+}
+
+bool VRRecorder::pushFrame(const unsigned char* rgb, int w, int h, PosePtr pose) { // RGB24, returns false if the frame was dropped
+    if (!rgb || frameLimitReached()) return false;
+    if (!encoding && !startPipeline(w, h)) return false;
+    if (w != width || h != height) { dropped++; return false; } // the encoder is set up for the size of the first frame
+
+    VRFrame* f = 0;
+    {
+        lock_guard<mutex> lock(pipeMutex);
+        if (freeFrames.size() == 0) { dropped++; return false; } // workers are behind, do not stall the rendering
+        f = freeFrames.front();
+        freeFrames.pop_front();
+    }
+
+    memcpy(&f->rgb[0], rgb, w*h*3);
+    f->captureTime = getTime()*1e-3;
+    f->index = nextIndex;
+    poses.push_back(pose ? pose : Pose::create());
+    timestamps.push_back(f->captureTime);
+
+    {
+        lock_guard<mutex> lock(pipeMutex);
+        nextIndex++;
+        capturedFrames.push_back(f);
+    }
+    pipeChanged.notify_all();
+    return true;
+}
+
+bool VRRecorder::startPipeline(int w, int h) {
+    width = w;
+    height = h;
+    streamPath = outPath != "" ? outPath : getPath();
+    if (!openOutput(streamPath)) {
+        closeOutput();
+        closeCodec();
+        return false;
+    }
+
+    for (int i=0; i<poolSize; i++) {
+        VRFrame* f = new VRFrame(w, h);
+        pool.push_back(f);
+        freeFrames.push_back(f);
+    }
+
+    nextIndex = 0;
+    nextEncode = 0;
+    encoding = true;
+    tEncodeStart = getTime()*1e-3;
+
+    int Nconverters = max(1, min(int(thread::hardware_concurrency())-2, 4)); // leave cores for rendering and encoding
+    for (int i=0; i<Nconverters; i++) converters.push_back( new ::Thread("recorder conversion", [this]() { convertLoop(); }) );
+    encoder = new ::Thread("recorder encoding", [this]() { encodeLoop(); });
+    return true;
+}
+
+void VRRecorder::stopPipeline() { // waits until all queued frames are encoded
+    if (!encoding) return;
+    {
+        lock_guard<mutex> lock(pipeMutex);
+        encoding = false;
+    }
+    pipeChanged.notify_all();
+
+    for (auto t : converters) { t->join(); delete t; }
+    converters.clear();
+    if (encoder) { encoder->join(); delete encoder; }
+    encoder = 0;
+
+    closeOutput();
+    closeCodec();
+    for (auto f : pool) delete f;
+    pool.clear();
+    freeFrames.clear();
+    capturedFrames.clear();
+    convertedFrames.clear();
+}
+
+void VRRecorder::convertLoop() {
+    SwsContext* sws_context = sws_getContext(
+        width, height, AV_PIX_FMT_RGB24,
+        width, height, AV_PIX_FMT_YUV420P,
+        SWS_FAST_BILINEAR, 0, 0, 0);
+    if (!sws_context) fprintf(stderr, "Could not initialize the conversion context\n");
+    const int in_linesize[1] = { 3 * width };
+
+    while (true) {
+        VRFrame* f = 0;
+        {
+            unique_lock<mutex> lock(pipeMutex);
+            pipeChanged.wait(lock, [&]() { return capturedFrames.size() || !encoding; });
+            if (capturedFrames.empty()) break;
+            f = capturedFrames.front();
+            capturedFrames.pop_front();
+        }
+
+        const unsigned char* data = &f->rgb[0];
+        if (sws_context) sws_scale(sws_context, (const uint8_t * const *)&data, in_linesize, 0, height, f->yuv->data, f->yuv->linesize);
+
+        {
+            lock_guard<mutex> lock(pipeMutex);
+            convertedFrames[f->index] = f;
+        }
+        pipeChanged.notify_all();
+    }
+
+    if (sws_context) sws_freeContext(sws_context);
+}
+
+void VRRecorder::encodeLoop() {
+    AVPacket* pkt = av_packet_alloc();
+
+    while (true) {
+        VRFrame* f = 0;
+        {
+            unique_lock<mutex> lock(pipeMutex);
+            pipeChanged.wait(lock, [&]() { return convertedFrames.count(nextEncode) || (!encoding && nextEncode == nextIndex); });
+            auto it = convertedFrames.find(nextEncode);
+            if (it == convertedFrames.end()) break;
+            f = it->second;
+            convertedFrames.erase(it);
+        }
+
+        f->yuv->pts = f->index;
+        if (avcodec_send_frame(codec_context, f->yuv) < 0) fprintf(stderr, "Error encoding frame\n");
+        else receivePackets(pkt);
+
+        double lag = getTime()*1e-3 - f->captureTime;
+        lock_guard<mutex> lock(pipeMutex);
+        lagSum += lag;
+        lagMax = max(lagMax, lag);
+        encoded++;
+        nextEncode++;
+        freeFrames.push_back(f);
+    }
 
-    f->width = f->capture->getImage()->getWidth();
-    f->height = f->capture->getImage()->getHeight();
+    avcodec_send_frame(codec_context, NULL); // get the delayed frames
+    receivePackets(pkt);
+    av_packet_free(&pkt);
 
-    if (!frame) initFrame();
+    lock_guard<mutex> lock(pipeMutex);
+    tEncodeEnd = getTime()*1e-3;
+}
 
-    //f->capture->write("pics/pic-" + toString(captures.size()-1) + toString(f->timestamp) + ".png");
+void VRRecorder::receivePackets(AVPacket* pkt) {
+    while (avcodec_receive_packet(codec_context, pkt) >= 0) writePacket(pkt);
+}
 
-    f->transcode(frame, codec_context, sws_context, captures.size()-1);
+void VRRecorder::writePacket(AVPacket* pkt) {
+    av_packet_rescale_ts(pkt, codec_context->time_base, stream->time_base);
+    pkt->stream_index = stream->index;
+    if (av_interleaved_write_frame(format_context, pkt) < 0) fprintf(stderr, "Error writing packet\n");
+}
+
+map<string, double> VRRecorder::getStats() {
+    lock_guard<mutex> lock(pipeMutex);
+    double T = getRecordingLength();
+    double tEncode = (encoding ? getTime()*1e-3 : tEncodeEnd) - tEncodeStart;
+
+    map<string, double> res;
+    res["captured"] = poses.size();
+    res["dropped"] = dropped;
+    res["encoded"] = encoded;
+    res["queued"] = nextIndex - nextEncode;
+    res["fps"] = T > 0 ? (poses.size()-1) / T : 0;
+    res["encodedFps"] = tEncode > 0 ? encoded * 1000.0 / tEncode : 0;
+    res["lag"] = encoded > 0 ? lagSum / encoded : 0; // ms
+    res["maxLag"] = lagMax;
+    return res;
 }
 
 bool VRRecorder::isRunning() { return running; }
@@ -191,161 +328,110 @@ void VRRecorder::enableVSync(bool b) {
 #endif
 }
 
-void VRRecorder::clear() {
-    for (auto f : captures) delete f;
-    captures.clear();
+void VRRecorder::clear() { // discards the recording, including the frames already streamed to disk
+    stopPipeline();
+    if (streamPath != "" && outPath == "") removeFile(streamPath);
+    streamPath = "";
+    poses.clear();
+    timestamps.clear();
+    lastCapture = 0;
+    dropped = 0;
+    encoded = 0;
+    lagSum = 0;
+    lagMax = 0;
 }
 
-int VRRecorder::getRecordingSize() { return captures.size(); }
+int VRRecorder::getRecordingSize() { return poses.size(); }
 float VRRecorder::getRecordingLength() {
-    if (captures.size() == 0) return 0;
-    int t0 = (*captures.begin())->timestamp;
-    int t1 = (*captures.rbegin())->timestamp;
+    if (timestamps.size() == 0) return 0;
+    int t0 = *timestamps.begin();
+    int t1 = *timestamps.rbegin();
     return (t1-t0)*0.001; //seconds
 }
 
-void VRRecorder::setBitrate(int br) { bitrate = br; initCodec(); }
+void VRRecorder::setBitrate(int br) { bitrate = br; }
 int VRRecorder::getBitrate() { return bitrate; }
-void VRRecorder::setCodec(string c) { codecName = c; initCodec(); }
+void VRRecorder::setCodec(string c) { codecName = c; }
 string VRRecorder::getCodec() { return codecName; }
 
-void VRRecorder::initCodec() {
-    if (captures.size() == 0) { fprintf(stderr, "No initial capture for CODEC init!\n"); return; }
+bool VRRecorder::initCodec() {
     AVCodecID codec_id = (AVCodecID)codecs[codecName];
     codec = (AVCodec*)avcodec_find_encoder(codec_id);
-    if (!codec) { fprintf(stderr, "Codec not found\n"); return; }
+    if (!codec) { fprintf(stderr, "Codec not found\n"); return false; }
 
     codec_context = avcodec_alloc_context3(codec);
-    if (!codec_context) { fprintf(stderr, "Could not allocate video codec context\n"); return; }
+    if (!codec_context) { fprintf(stderr, "Could not allocate video codec context\n"); return false; }
 
-    codec_context->width = captures[0]->width;
-    codec_context->height = captures[0]->height;
+    codec_context->width = width;
+    codec_context->height = height;
     codec_context->bit_rate = codec_context->width*codec_context->height * bitrate;
 	codec_context->time_base.num = 1;
 	codec_context->time_base.den = 25;/* frames per second */
     codec_context->gop_size = 10; /* emit one intra frame every ten frames */
     codec_context->max_b_frames = 1;
     codec_context->pix_fmt = AV_PIX_FMT_YUV420P;
-    //codec_context->pix_fmt = AV_PIX_FMT_RGB24;
+    if (format_context->oformat->flags & AVFMT_GLOBALHEADER) codec_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     av_opt_set(codec_context->priv_data, "preset", "ultrafast", 0);
 
     AVDictionary *param = 0;
     av_dict_set(&param, "crf", "0", 0);
-    if (avcodec_open2(codec_context, codec, &param) < 0) { fprintf(stderr, "Could not open codec\n"); return; } /* open codec */
-
-    sws_context = sws_getContext(
-        codec_context->width, codec_context->height, AV_PIX_FMT_RGB24,
-        codec_context->width, codec_context->height, AV_PIX_FMT_YUV420P,
-        SWS_FAST_BILINEAR, 0, 0, 0);
-    if (!sws_context) fprintf(stderr, "Could not initialize the conversion context\n");
+    if (avcodec_open2(codec_context, codec, &param) < 0) { fprintf(stderr, "Could not open codec\n"); return false; } /* open codec */
+    return true;
 }
 
 void VRRecorder::closeCodec() {
+    if (!codec_context) return;
     avcodec_close(codec_context);
     av_free(codec_context);
+    codec_context = 0;
 }
 
-void VRRecorder::initFrame() {
-    initCodec();
-#ifdef OLD_LIBAV
-    frame = avcodec_alloc_frame(); // Allocate frame
-#else
-    frame = av_frame_alloc(); // Allocate frame
-#endif
-    if (!frame) { fprintf(stderr, "Could not allocate video frame\n"); return; }
-    frame->format = codec_context->pix_fmt;
-    frame->width  = codec_context->width;
-    frame->height = codec_context->height;
-
-    /* the image can be allocated by any means && av_image_alloc() is
-    * just the most convenient way if av_malloc() is to be used */
-    int ret = av_image_alloc(frame->data, frame->linesize, codec_context->width, codec_context->height, codec_context->pix_fmt, 32);
-    if (ret < 0) { fprintf(stderr, "Could not allocate raw picture buffer\n"); return; }
-}
+bool VRRecorder::openOutput(string path) { // the container is guessed from the path, packets are written while recording
+    avformat_alloc_output_context2(&format_context, NULL, NULL, path.c_str());
+    if (!format_context) avformat_alloc_output_context2(&format_context, NULL, "avi", path.c_str());
+    if (!format_context) { fprintf(stderr, "Could not allocate output format for %s\n", path.c_str()); return false; }
+    if (!initCodec()) return false;
 
-void VRRecorder::closeFrame() {
-    av_freep(&frame->data[0]);
-#ifdef OLD_LIBAV
-    avcodec_free_frame(&frame);
-#else
-    av_frame_free(&frame);
-#endif
-    frame = 0;
-}
-
-void VRRecorder::writeHeader(string path) {
-    AVFormatContext* ofmt_ctx = 0;
-    auto ofmt = av_guess_format("avi", path.c_str(), NULL);
-    auto status = avformat_alloc_output_context2(&ofmt_ctx, ofmt, "avi", path.c_str());
-    if (status < 0) std::cerr << "could not allocate output format" << std::endl;
-    AVStream* stream = avformat_new_stream(ofmt_ctx, codec);
-    ofmt_ctx->duration = 60*1000000; // 60 sec
-    //stream->codec = codec_context;
+    stream = avformat_new_stream(format_context, NULL);
+    if (!stream) { fprintf(stderr, "Could not allocate output stream\n"); return false; }
     stream->time_base = codec_context->time_base;
-    stream->duration = ofmt_ctx->duration;
-    stream->avg_frame_rate = av_make_q(60,1);
     avcodec_parameters_from_context(stream->codecpar, codec_context);
-#if LIBAVFORMAT_VERSION_MAJOR < 58
-    stream->display_aspect_ratio = av_make_q(stream->codec->width, stream->codec->height);
-#endif
-    ofmt_ctx->video_codec = codec;
 
-    av_dict_set(&ofmt_ctx->metadata, "TPFL", "testtest", 0);
-    av_dump_format(ofmt_ctx, 0, path.c_str(), 1);
-    avio_open(&ofmt_ctx->pb, path.c_str(), AVIO_FLAG_WRITE);
-
-    avformat_init_output(ofmt_ctx, NULL);
-    avformat_write_header(ofmt_ctx, &ofmt_ctx->metadata);
-    avio_close(ofmt_ctx->pb);
+    if (avio_open(&format_context->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) { fprintf(stderr, "Could not open %s\n", path.c_str()); return false; }
+    if (avformat_write_header(format_context, NULL) < 0) {
+        fprintf(stderr, "Could not write header of %s\n", path.c_str());
+        avio_closep(&format_context->pb);
+        return false;
+    }
+    return true;
 }
 
-void VRRecorder::compile(string path) {
-    if (captures.size() == 0) return;
-
-    bool doWriteHeader = false; // TODO: doesnt work yet!
-
-    if (doWriteHeader) writeHeader(path);
-
-
-    // write frames
-    FILE* f = 0;
-    if (doWriteHeader) f = fopen(path.c_str(), "ab");
-    else f =  fopen(path.c_str(), "wb");
-    if (!f) { fprintf(stderr, "Could not open %s\n", path.c_str()); return; }
-
-    for (int i=0; i<(int)captures.size(); i++) captures[i]->write(f);
-
-    /* get the delayed frames */
-    /*for (int got_output = 1; got_output;) {
-        fflush(stdout);
-
-        AVPacket pkt;
-        av_init_packet(&pkt);
-        pkt.size = 0;
-        pkt.data = NULL;
-        int ret = avcodec_encode_video2(codec_context, &pkt, NULL, &got_output);
-        if (ret < 0) { fprintf(stderr, "Error encoding frame\n"); return; }
-
-        if (got_output) {
-            fwrite(pkt.data, 1, pkt.size, f);
-            av_packet_unref(&pkt);
-        }
-    }*/
-
-    /* add sequence end code to have a real mpeg file */
-    uint8_t endcode[] = { 0, 0, 1, 0xb7 };
-    fwrite(endcode, 1, sizeof(endcode), f);
-    fclose(f);
+void VRRecorder::closeOutput() {
+    if (!format_context) return;
+    if (format_context->pb) {
+        av_write_trailer(format_context);
+        avio_closep(&format_context->pb);
+    }
+    avformat_free_context(format_context);
+    format_context = 0;
+    stream = 0;
+}
 
-    //av_write_trailer(ofmt_ctx);
+void VRRecorder::compile(string path) { // finishes the encoding, the file has been written while recording
+    if (!encoding && streamPath == "") return;
+    stopPipeline();
+    if (path != "" && path != streamPath) {
+        if (rename(streamPath.c_str(), path.c_str()) != 0) fprintf(stderr, "Could not move %s to %s\n", streamPath.c_str(), path.c_str());
+    }
+    streamPath = "";
 
-    closeCodec();
-    closeFrame();
+    auto stats = getStats();
+    cout << "VRRecorder::compile " << path << ", " << stats["encoded"] << " frames, " << stats["dropped"] << " dropped, " << stats["fps"] << " fps, lag " << stats["lag"] << " ms" << endl;
 }
 
-VRTexturePtr VRRecorder::get(int f) {
-    VRFrame* fr = captures[f];
-    return fr->capture;
+VRTexturePtr VRRecorder::get(int f) { // only the last capture is kept, the image data of the others lives in the video
+    if (f != (int)poses.size()-1) return 0;
+    return lastCapture;
 }
 
 void VRRecorder::setRecording(bool b) {
@@ -2,8 +2,13 @@
 #define VRRECORDER_H_INCLUDED
 
 #include "core/math/OSGMathFwd.h"
+#include "core/math/VRMathFwd.h"
 #include <string>
 #include <vector>
+#include <list>
+#include <map>
+#include <mutex>
+#include <condition_variable>
 
 #include "core/utils/VRFunctionFwd.h"
 #include "core/objects/VRObjectFwd.h"
@@ -12,19 +17,28 @@
 
 class AVCodec;
 class AVCodecContext;
-class AVFrame;
-class SwsContext;
+class AVFormatContext;
+class AVStream;
+class AVPacket;
+class Thread;
 
 OSG_BEGIN_NAMESPACE;
 using namespace std;
 
 class VRFrame;
 
+/**
+ * Records a view to a video file.
+ * Captured images are copied into a bounded pool of frame buffers, when no buffer is free the frame is dropped.
+ * Worker threads convert the frames to YUV, one encoder thread encodes them in order and muxes the packets into the output file.
+ */
 class VRRecorder {
     private:
         int viewID = 0;
         VRViewWeakPtr view;
-        vector<VRFrame*> captures;
+        vector<PosePtr> poses; // camera pose of each recorded frame
+        vector<int> timestamps;
+        VRTexturePtr lastCapture;
         int maxFrames = -1;
         bool running = 0;
 
@@ -34,18 +48,47 @@ class VRRecorder {
 
         AVCodec* codec = 0;
         AVCodecContext* codec_context = 0;
-        AVFrame* frame = 0;
-        SwsContext* sws_context = NULL;
+        AVFormatContext* format_context = 0;
+        AVStream* stream = 0;
+        string outPath; // set by the user, else a new path per recording
+        string streamPath; // file of the current recording
+
+        int poolSize = 8;
+        int width = 0;
+        int height = 0;
+        bool encoding = false;
+        vector<VRFrame*> pool;
+        list<VRFrame*> freeFrames;
+        list<VRFrame*> capturedFrames;
+        map<int, VRFrame*> convertedFrames; // by frame index, the encoder needs them in order
+        int nextIndex = 0;
+        int nextEncode = 0;
+        mutex pipeMutex;
+        condition_variable pipeChanged; // frames captured or converted, or the recording stopped
+        vector< ::Thread* > converters;
+        ::Thread* encoder = 0;
+
+        int dropped = 0;
+        int encoded = 0;
+        double lagSum = 0; // ms from capture to encoded
+        double lagMax = 0;
+        double tEncodeStart = 0;
+        double tEncodeEnd = 0;
 
         VRToggleCbPtr toggleCallback;
         VRUpdateCbPtr updateCallback;
 
-        void writeHeader(string path);
-
-        void initCodec();
+        bool initCodec();
         void closeCodec();
-        void initFrame();
-        void closeFrame();
+        bool openOutput(string path);
+        void closeOutput();
+        void writePacket(AVPacket* pkt);
+        void receivePackets(AVPacket* pkt);
+
+        bool startPipeline(int w, int h);
+        void stopPipeline();
+        void convertLoop();
+        void encodeLoop();
 
     public:
         VRRecorder();
@@ -62,7 +105,11 @@ class VRRecorder {
 
         void setView(int i);
         void capture();
+        bool pushFrame(const unsigned char* rgb, int w, int h, PosePtr pose = 0);
         void compile(string path);
+        void setOutput(string path);
+        void setBufferSize(int N);
+        map<string, double> getStats();
         void clear();
         bool isRunning();
         int getRecordingSize();
@@ -74,7 +121,7 @@ class VRRecorder {
         Vec3d getDir(int f);
         Vec3d getAt(int f);
         Vec3d getUp(int f);
-        VRTexturePtr get(int f);
+        VRTexturePtr get(int f); // only the last frame, the others are in the video file
 
         void setRecording(bool b);
         string getPath();
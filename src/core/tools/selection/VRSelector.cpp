@@ -3,6 +3,7 @@
 #include "core/objects/geometry/VRGeometry.h"
 #include "core/objects/geometry/OSGGeometry.h"
 #include "core/scene/VRScene.h"
+#include "core/scene/rendering/VRSceneOptimizer.h"
 #include "core/utils/toString.h"
 
 #include <OpenSG/OSGGeometry.h>
@@ -28,6 +29,7 @@ VRSelectorPtr VRSelector::create() { return VRSelectorPtr( new VRSelector() ); }
 VRSelector::MatStore::MatStore(VRGeometryPtr geo) {
     this->geo = geo;
     mat = geo->getMaterial();
+    batched = VRSceneOptimizer::isBatched(geo);
 }
 
 void VRSelector::update() {
@@ -40,6 +42,7 @@ void VRSelector::update() {
         if (!geo) continue;
         if (!geo->getMaterial()) continue;
         orig_mats.push_back(MatStore(geo));
+        if (orig_mats.back().batched) VRSceneOptimizer::showBatched(geo, true); // merged into a chunk, drawn again while selected
 
         VRMaterialPtr mat = getMat();
         mat->prependPasses(geo->getMaterial());
@@ -120,7 +123,12 @@ VRMaterialPtr VRSelector::getMat() {
 }
 
 void VRSelector::deselect() {
-    for (auto ms : orig_mats) if ( auto geo = ms.geo.lock() ) geo->setMaterial(ms.mat);
+    for (auto ms : orig_mats) {
+        auto geo = ms.geo.lock();
+        if (!geo) continue;
+        geo->setMaterial(ms.mat);
+        if (ms.batched) VRSceneOptimizer::showBatched(geo, false);
+    }
     orig_mats.clear();
     if (subselection) subselection->destroy();
     subselection.reset();
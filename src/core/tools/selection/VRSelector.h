@@ -31,6 +31,7 @@ class VRSelector {
         struct MatStore {
             VRGeometryWeakPtr geo;
             VRMaterialPtr mat;
+            bool batched = false;
             MatStore(VRGeometryPtr geo);
         };
         vector<MatStore> orig_mats;
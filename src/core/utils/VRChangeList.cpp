@@ -3,6 +3,7 @@
 
 #include <OpenSG/OSGThread.h>
 #include <OpenSG/OSGChangeList.h>
+#include <OpenSG/OSGFieldContainerFactory.h>
 #include <OpenSG/OSGVector.h>
 
 using namespace OSG;
@@ -16,6 +17,8 @@ int VRChangeList::getCreated() { return 0; }
 int VRChangeList::getChanged() { return 0; }
 
 size_t VRChangeList::getTotalEntities() { return totalEntites[0]; }
+size_t VRChangeList::getFrameBytes() { return frameBytes; }
+size_t VRChangeList::getTotalBytes() { return totalBytes; }
 
 bool doOutput = true;
 void VRChangeList::stopOutput() { doOutput = false; }
@@ -72,6 +75,29 @@ void VRChangeList::update() {
     cout << endl;
 }
 
+size_t VRChangeList::computeBytes() { // estimates the size of the current change list as serialized by the remote aspect
+    ChangeList* clist = Thread::getCurrentChangeList();
+    FieldContainerFactoryBase* factory = FieldContainerFactory::the();
+    size_t bytes = 0;
+
+    auto count = [&](ContainerChangeEntry* entry) {
+        UInt32 desc = entry->uiEntryDesc;
+        bytes += sizeof(UInt8) + sizeof(UInt32); // command and container ID
+        if (desc == ContainerChangeEntry::Create) bytes += sizeof(UInt32); // type ID
+        if (desc != ContainerChangeEntry::Change) return;
+        bytes += sizeof(BitVector); // field mask
+        FieldContainer* fc = factory->getContainer(entry->uiContainerId);
+        if (fc) bytes += fc->getBinSize(entry->whichField);
+    };
+
+    for (auto it = clist->beginCreated(); it != clist->endCreated(); it++) count(*it);
+    for (auto it = clist->begin(); it != clist->end(); it++) count(*it);
+
+    frameBytes = bytes;
+    totalBytes += bytes;
+    return bytes;
+}
+
 
 
 
@@ -12,6 +12,8 @@ class VRChangeList {
     private:
         string name;
         vector<size_t> totalEntites = vector<size_t>(7,0);
+        size_t frameBytes = 0;
+        size_t totalBytes = 0;
 
     public:
         VRChangeList(string name);
@@ -22,6 +24,10 @@ class VRChangeList {
         int getChanged();
 
         size_t getTotalEntities();
+        size_t getFrameBytes();
+        size_t getTotalBytes();
+
+        size_t computeBytes();
 
         void update();
         void stopOutput();
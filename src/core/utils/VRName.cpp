@@ -173,8 +173,11 @@ void VRName::compileName(bool expectUnique) {
     }
 
     name = nameSpace->compileName(base_name, name_suffix);
+    nameChanged();
 }
 
+void VRName::nameChanged() {}
+
 string VRName::setName(string name) {
     if (!nameSpace) setNameSpace(nameSpaceName);
     nameSpace->applyFilter(name);
@@ -43,6 +43,8 @@ class VRName : public VRStorage {
         string nameSpaceName = "__global__";
         VRNameSpace* nameSpace = 0;
 
+        virtual void nameChanged();
+
     public:
         VRName();
         ~VRName();
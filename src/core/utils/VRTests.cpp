@@ -1,4 +1,5 @@
 #include "VRTests.h"
+#include "core/tests/VRTestCases.h"
 
 #include "core/scene/VRScene.h"
 #include "core/objects/object/VRObject.h"
@@ -104,7 +105,9 @@ void debugFields(string data) {
     }
 }
 
-void VRRunTest(string test) {
+
+bool VRRunTest(string test) {
+    bool ok = true;
     cout << "run test " << test << endl;
 
     if (test == "listActiveMaterials") listActiveMaterials();
@@ -114,6 +117,37 @@ void VRRunTest(string test) {
 #endif
 #ifndef WITHOUT_VIRTUOSE
     if (test == "haptic1") VRHaptic::runTest1();
+#endif
+#ifndef WITHOUT_TCP
+    if (test == "tcpFramed") ok = tcpFramedTest();
+    if (test == "udpBatch") ok = udpBatchTest();
+#endif
+    if (test == "ontologyIndex") ok = ontologyIndexBenchmark();
+    if (test == "ontologyIndexTest") ok = ontologyIndexTest();
+    if (test == "reasonerCompiled") ok = reasonerCompiledTest();
+    if (test == "millingDexels") ok = millingDexelsBenchmark();
+    if (test == "pipeSystem") ok = pipeSystemBenchmark();
+    if (test == "ladEngine") ok = ladEngineBenchmark();
+    if (test == "sclEngine") ok = sclEngineBenchmark();
+    if (test == "wiringSimulation") ok = wiringSimulationBenchmark();
+    if (test == "mechanism") ok = mechanismBenchmark();
+    if (test == "gcode") ok = gcodeBenchmark();
+    if (test == "robotKinematics") ok = robotKinematicsBenchmark();
+    if (test == "logistics") ok = logisticsBenchmark();
+    if (test == "intersectRays") ok = intersectRaysBenchmark();
+    if (test == "sceneIndex") ok = sceneIndexBenchmark();
+    if (test == "constraints") ok = constraintsBenchmark();
+    if (test == "sceneOptimizer") ok = sceneOptimizerBenchmark();
+    if (test == "occlusionCulling") ok = occlusionCullingBenchmark();
+    if (test == "geoBuilder") ok = geoBuilderBenchmark();
+    if (test == "districtGeneration") ok = districtGenerationBenchmark();
+    if (test == "roadGeneration") ok = roadGenerationBenchmark();
+#ifndef WITHOUT_AV
+    if (test == "recorder") ok = recorderBenchmark();
+#endif
+#ifndef WITHOUT_CGAL
+    if (test == "csgBackends") ok = csgBackendsBenchmark();
 #endif
     if (startsWith(test, "debugFields")) debugFields( subString(test, 12, test.size()-12) );
+    return ok;
 }
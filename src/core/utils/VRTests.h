@@ -5,6 +5,6 @@
 
 using namespace std;
 
-void VRRunTest(string test);
+bool VRRunTest(string test); // false if a test check failed
 
 #endif // VRTESTS_H_INCLUDED
@@ -0,0 +1,97 @@
+#include "VRThreadPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct VRThreadPool::Job {
+    function<void(size_t)> f;
+    size_t N = 0;
+    atomic<size_t> next{0};
+    atomic<size_t> done{0};
+    mutex mtx;
+    condition_variable finished;
+
+    bool runNext() { // false when all tasks are taken
+        size_t i = next++;
+        if (i >= N) return false;
+        f(i);
+        if (++done == N) {
+            lock_guard<mutex> lock(mtx);
+            finished.notify_all();
+        }
+        return true;
+    }
+};
+
+struct VRThreadPool::Data {
+    vector<thread> workers;
+    deque<shared_ptr<Job>> jobs;
+    mutex mtx;
+    condition_variable wakeup;
+};
+
+thread_local bool inPoolTask = false;
+
+VRThreadPool::VRThreadPool() {
+    data = new Data();
+    size_t N = max(1u, thread::hardware_concurrency());
+    for (size_t i=1; i<N; i++) {
+        data->workers.push_back( thread(&VRThreadPool::work, this) );
+        data->workers.back().detach(); // blocked on the wakeup until the process ends
+    }
+}
+
+VRThreadPool* VRThreadPool::get() {
+    static VRThreadPool* instance = new VRThreadPool();
+    return instance;
+}
+
+size_t VRThreadPool::size() { return data->workers.size() + 1; }
+
+void VRThreadPool::work() {
+    inPoolTask = true;
+    while (true) {
+        shared_ptr<Job> job;
+        {
+            unique_lock<mutex> lock(data->mtx);
+            data->wakeup.wait(lock, [&]() { return data->jobs.size() > 0; });
+            job = data->jobs.front();
+            if (job->next >= job->N) { data->jobs.pop_front(); continue; }
+        }
+        while (job->runNext()) {}
+    }
+}
+
+void VRThreadPool::run(size_t Ntasks, function<void(size_t)> f) {
+    if (Ntasks == 0) return;
+    if (Ntasks == 1 || inPoolTask || data->workers.size() == 0) {
+        for (size_t i=0; i<Ntasks; i++) f(i);
+        return;
+    }
+
+    auto job = make_shared<Job>();
+    job->f = f;
+    job->N = Ntasks;
+    {
+        lock_guard<mutex> lock(data->mtx);
+        data->jobs.push_back(job);
+    }
+    data->wakeup.notify_all();
+
+    inPoolTask = true;
+    while (job->runNext()) {}
+    inPoolTask = false;
+
+    unique_lock<mutex> lock(job->mtx);
+    job->finished.wait(lock, [&]() { return job->done == job->N; });
+}
+
+void VRThreadPool::parallelFor(size_t N, size_t grain, function<void(size_t, size_t)> f) {
+    size_t Nchunks = min(size(), N/max(grain, size_t(1)) + 1);
+    if (Nchunks <= 1) { f(0, N); return; }
+    size_t chunk = (N + Nchunks - 1) / Nchunks;
+    run(Nchunks, [&](size_t t) { f(min(N, t*chunk), min(N, (t+1)*chunk)); });
+}
@@ -0,0 +1,33 @@
+#ifndef VRTHREADPOOL_H_INCLUDED
+#define VRTHREADPOOL_H_INCLUDED
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Persistent worker threads for short data parallel loops, like solver levels, mesh chunks or ray batches.
+ * The workers are started once, run blocks until all tasks are done and the calling thread works on them too.
+ * Calls from inside a task run serially, calls from several threads share the workers.
+ */
+class VRThreadPool {
+    private:
+        struct Job;
+        struct Data;
+        Data* data = 0;
+
+        VRThreadPool();
+        void work();
+
+    public:
+        static VRThreadPool* get();
+
+        size_t size(); // workers and the calling thread
+
+        void run(size_t Ntasks, function<void(size_t)> f);
+        void parallelFor(size_t N, size_t grain, function<void(size_t, size_t)> f); // contiguous ranges of at least grain items
+};
+
+#endif // VRTHREADPOOL_H_INCLUDED